@@ -1,7 +1,9 @@
 #include "application.h"
 #include "board.h"
 #include "system_info.h"
+#include "task_profiler.h"
 #include "audio_codec.h"
+#include "audio_buffer_pool.h"
 #include "assets/lang_config.h"
 #include "assets.h"
 
@@ -155,6 +157,18 @@ void Application::Start() {
     audio_service_.Initialize(codec);
     audio_service_.Start();
 
+#if CONFIG_AUDIO_PROMPT_PCM_CACHE
+    audio_service_.PreloadSounds({
+        Lang::Sounds::OGG_SUCCESS, Lang::Sounds::OGG_POPUP,
+        Lang::Sounds::OGG_0, Lang::Sounds::OGG_1, Lang::Sounds::OGG_2, Lang::Sounds::OGG_3, Lang::Sounds::OGG_4,
+        Lang::Sounds::OGG_5, Lang::Sounds::OGG_6, Lang::Sounds::OGG_7, Lang::Sounds::OGG_8, Lang::Sounds::OGG_9,
+    });
+#endif
+
+#if CONFIG_TASK_PROFILER
+    TaskProfiler::GetInstance().Start(CONFIG_TASK_PROFILER_INTERVAL_MS, CONFIG_TASK_PROFILER_MAX_TASKS);
+#endif
+
     // 强制设置音量为60
     Board::GetInstance().GetAudioCodec()->SetOutputVolume(60);
 
@@ -162,7 +176,7 @@ void Application::Start() {
     audio_afe_ws_sender_init();
 
     // Start video stream
-    start_video_stream("ws://192.168.1.104:8765");
+    start_video_stream();
     
     // 【重要】注释掉 Raw PCM 发送，避免与 Opus 流混淆
     // audio_afe_ws_hook(&audio_service_); 
@@ -191,7 +205,7 @@ void Application::Start() {
 
     esp_timer_start_periodic(clock_timer_handle_, 1000000);
 
-    SystemInfo::PrintHeapStats();
+    SystemInfo::UpdateHeapMetrics();
     SetDeviceState(kDeviceStateIdle);
     display->ShowNotification(Lang::Strings::STANDBY);
     
@@ -226,9 +240,18 @@ void Application::MainEventLoop() {
             clock_ticks_++;
             auto display = Board::GetInstance().GetDisplay();
             display->UpdateStatusBar();
+            SystemInfo::UpdateHeapMetrics();
         
             if (clock_ticks_ % 10 == 0) {
-                SystemInfo::PrintHeapStats();
+                AudioBufferPool::GetInstance().LogStats();
+                auto jitter = audio_service_.GetJitterBufferStats();
+                ESP_LOGI(TAG, "Jitter buffer: depth=%lu target=%lums jitter=%lums late=%lu dropped=%lu concealed=%lu underruns=%lu",
+                    jitter.depth, jitter.target_ms, jitter.jitter_ms, jitter.late_packets, jitter.dropped_packets, jitter.concealed_frames, jitter.underruns);
+#if CONFIG_TASK_PROFILER
+                if (clock_ticks_ % 30 == 0) {
+                    TaskProfiler::GetInstance().Log(5);
+                }
+#endif
             }
         }
     }
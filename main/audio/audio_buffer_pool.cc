@@ -0,0 +1,132 @@
+#include "audio_buffer_pool.h"
+#include "audio_service.h"
+
+#include <esp_log.h>
+
+#include <algorithm>
+
+#define TAG "AudioBufferPool"
+
+#if CONFIG_AUDIO_BUFFER_POOL_IN_PSRAM
+#define AUDIO_BUFFER_POOL_CAPS (MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT)
+#else
+#define AUDIO_BUFFER_POOL_CAPS (MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT)
+#endif
+
+// Empties a pooled buffer and makes sure it has room for reserve elements in the pool's memory
+template <typename Buffer>
+static void ResetPooledBuffer(Buffer& buffer, size_t reserve) {
+    buffer.clear();
+    if (buffer.capacity() >= reserve && buffer.get_allocator().caps == AUDIO_BUFFER_POOL_CAPS) {
+        return;
+    }
+    Buffer pooled{typename Buffer::allocator_type(AUDIO_BUFFER_POOL_CAPS)};
+    pooled.reserve(std::max(reserve, buffer.capacity()));
+    buffer.swap(pooled);
+}
+
+void AudioBufferPool::Initialize(size_t pcm_samples, size_t frame_samples) {
+    frame_samples_ = frame_samples;
+    bool ok = task_pool_.Initialize(CONFIG_AUDIO_BUFFER_POOL_TASKS, pcm_samples, AUDIO_BUFFER_POOL_CAPS,
+        [](AudioTask& task, size_t reserve) {
+            task.type = kAudioTaskTypeEncodeToSendQueue;
+            task.timestamp = 0;
+            task.capture_time_ms = 0;
+            task.frame.reset();
+            ResetPooledBuffer(task.pcm, reserve);
+        },
+        [](const AudioTask& task) { return task.pcm.capacity(); });
+    ok = packet_pool_.Initialize(CONFIG_AUDIO_BUFFER_POOL_PACKETS, CONFIG_AUDIO_BUFFER_POOL_PACKET_BYTES, AUDIO_BUFFER_POOL_CAPS,
+        [](AudioStreamPacket& packet, size_t reserve) {
+            packet.sample_rate = 0;
+            packet.frame_duration = 0;
+            packet.timestamp = 0;
+            ResetPooledBuffer(packet.payload, reserve);
+        },
+        [](const AudioStreamPacket& packet) { return packet.payload.capacity(); }) && ok;
+    ok = frame_pool_.Initialize(CONFIG_AUDIO_BUFFER_POOL_FRAMES, frame_samples, AUDIO_BUFFER_POOL_CAPS,
+        [](PcmFrame& frame, size_t reserve) {
+            frame.capture_time_ms = 0;
+            frame.refs.store(0, std::memory_order_relaxed);
+            frame.pcm.clear();
+            if (frame.pcm.capacity() < reserve) {
+                frame.pcm.reserve(reserve);
+            }
+        },
+        [](const PcmFrame& frame) { return frame.pcm.capacity(); }) && ok;
+
+    if (!ok) {
+        ESP_LOGE(TAG, "Failed to allocate audio buffer pool");
+        return;
+    }
+    ESP_LOGI(TAG, "Audio buffer pool ready: %d tasks x %u samples, %d packets x %d bytes, %d shared frames x %u samples",
+        CONFIG_AUDIO_BUFFER_POOL_TASKS, (unsigned int)pcm_samples,
+        CONFIG_AUDIO_BUFFER_POOL_PACKETS, CONFIG_AUDIO_BUFFER_POOL_PACKET_BYTES, CONFIG_AUDIO_BUFFER_POOL_FRAMES,
+        (unsigned int)frame_samples);
+}
+
+AudioTaskPtr AudioBufferPool::AcquireTask() {
+    AudioTask* task = task_pool_.Acquire();
+    if (task == nullptr) {
+        return AudioTaskPtr(new AudioTask());
+    }
+    return AudioTaskPtr(task);
+}
+
+AudioStreamPacketPtr AudioBufferPool::AcquirePacket() {
+    AudioStreamPacket* packet = packet_pool_.Acquire();
+    if (packet == nullptr) {
+        return AudioStreamPacketPtr(new AudioStreamPacket());
+    }
+    return AudioStreamPacketPtr(packet);
+}
+
+PcmFrameRef AudioBufferPool::AcquireFrame() {
+    PcmFrame* frame = frame_pool_.Acquire();
+    if (frame == nullptr) {
+        frame = new PcmFrame();
+        frame->pcm.reserve(frame_samples_);
+    }
+    return PcmFrameRef(frame);
+}
+
+bool AudioBufferPool::Recycle(AudioTask* task) {
+    return task_pool_.Release(task);
+}
+
+bool AudioBufferPool::Recycle(AudioStreamPacket* packet) {
+    return packet_pool_.Release(packet);
+}
+
+bool AudioBufferPool::Recycle(PcmFrame* frame) {
+    return frame_pool_.Release(frame);
+}
+
+void AudioBufferPool::LogStats() {
+    auto tasks = task_pool_.GetStats();
+    auto packets = packet_pool_.GetStats();
+    auto frames = frame_pool_.GetStats();
+    ESP_LOGI(TAG, "tasks: in_use=%lu/%lu peak=%lu heap=%lu realloc=%lu, packets: in_use=%lu/%lu peak=%lu heap=%lu realloc=%lu",
+        tasks.in_use, tasks.capacity, tasks.peak_in_use, tasks.heap_fallbacks, tasks.buffer_reallocs,
+        packets.in_use, packets.capacity, packets.peak_in_use, packets.heap_fallbacks, packets.buffer_reallocs);
+    ESP_LOGI(TAG, "frames: in_use=%lu/%lu peak=%lu heap=%lu realloc=%lu",
+        frames.in_use, frames.capacity, frames.peak_in_use, frames.heap_fallbacks, frames.buffer_reallocs);
+}
+
+void AudioPoolDeleter::operator()(AudioTask* task) const {
+    if (!AudioBufferPool::GetInstance().Recycle(task)) {
+        delete task;
+    }
+}
+
+void PcmFrameRef::Release(PcmFrame* frame) {
+    if (!AudioBufferPool::GetInstance().Recycle(frame)) {
+        delete frame;
+    }
+}
+
+void AudioPoolDeleter::operator()(AudioStreamPacket* packet) const {
+    if (!AudioBufferPool::GetInstance().Recycle(packet)) {
+        delete packet;
+    }
+}
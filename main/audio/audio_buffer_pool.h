@@ -0,0 +1,166 @@
+#ifndef AUDIO_BUFFER_POOL_H
+#define AUDIO_BUFFER_POOL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <vector>
+
+#include <esp_heap_caps.h>
+
+#include "protocol.h"
+#include "pcm_frame.h"
+
+struct AudioTask;
+
+using AudioTaskPtr = std::unique_ptr<AudioTask, AudioPoolDeleter>;
+
+struct AudioPoolStats {
+    uint32_t capacity = 0;
+    uint32_t in_use = 0;
+    uint32_t peak_in_use = 0;
+    uint32_t acquired = 0;
+    uint32_t heap_fallbacks = 0;    // pool was empty, object came from the heap
+    uint32_t buffer_reallocs = 0;   // a pooled buffer had to grow or was re-reserved
+};
+
+/*
+ * A fixed slab of preconstructed objects. The slab is allocated once with the given
+ * heap caps and never freed, so recycling objects does not touch the heap.
+ */
+template <typename T>
+class SlabPool {
+public:
+    typedef void (*ResetFunction)(T& object, size_t reserve);
+    typedef size_t (*CapacityFunction)(const T& object);
+
+    SlabPool() = default;
+    SlabPool(const SlabPool&) = delete;
+    SlabPool& operator=(const SlabPool&) = delete;
+
+    bool Initialize(size_t count, size_t reserve, uint32_t caps, ResetFunction reset, CapacityFunction capacity) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (slab_ != nullptr || count == 0) {
+            return false;
+        }
+        slab_ = static_cast<T*>(heap_caps_malloc(sizeof(T) * count, caps));
+        if (slab_ == nullptr) {
+            slab_ = static_cast<T*>(heap_caps_malloc(sizeof(T) * count, MALLOC_CAP_8BIT));
+        }
+        if (slab_ == nullptr) {
+            return false;
+        }
+        count_ = count;
+        reserve_ = reserve;
+        reset_ = reset;
+        capacity_ = capacity;
+        free_list_.reserve(count);
+        buffer_capacity_.resize(count);
+        for (size_t i = 0; i < count; i++) {
+            T* object = new (&slab_[i]) T();
+            reset_(*object, reserve_);
+            buffer_capacity_[i] = capacity_(*object);
+            free_list_.push_back(object);
+        }
+        stats_.capacity = count;
+        return true;
+    }
+
+    // Returns nullptr when the pool is exhausted or not initialized
+    T* Acquire() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (free_list_.empty()) {
+            stats_.heap_fallbacks++;
+            return nullptr;
+        }
+        T* object = free_list_.back();
+        free_list_.pop_back();
+        stats_.acquired++;
+        stats_.in_use++;
+        if (stats_.in_use > stats_.peak_in_use) {
+            stats_.peak_in_use = stats_.in_use;
+        }
+        return object;
+    }
+
+    // Returns false when the object does not belong to this slab
+    bool Release(T* object) {
+        if (slab_ == nullptr || object < slab_ || object >= slab_ + count_) {
+            return false;
+        }
+        size_t index = object - slab_;
+        reset_(*object, reserve_);
+        size_t capacity = capacity_(*object);
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (capacity != buffer_capacity_[index]) {
+            buffer_capacity_[index] = capacity;
+            stats_.buffer_reallocs++;
+        }
+        free_list_.push_back(object);
+        stats_.in_use--;
+        return true;
+    }
+
+    AudioPoolStats GetStats() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return stats_;
+    }
+
+private:
+    T* slab_ = nullptr;
+    size_t count_ = 0;
+    size_t reserve_ = 0;
+    ResetFunction reset_ = nullptr;
+    CapacityFunction capacity_ = nullptr;
+    std::vector<T*> free_list_;
+    std::vector<size_t> buffer_capacity_;
+    std::mutex mutex_;
+    AudioPoolStats stats_;
+};
+
+/*
+ * Pools for AudioTask, AudioStreamPacket and the shared PcmFrame.
+ *
+ * Objects handed out by AcquireTask() / AcquirePacket() are AudioTaskPtr /
+ * AudioStreamPacketPtr, whose AudioPoolDeleter routes them back here instead of
+ * freeing them, so the PCM / payload capacity survives and the steady-state audio
+ * pipeline does no heap allocations. Objects created with plain new are still freed.
+ * PcmFrames are reference counted and return here when their last PcmFrameRef is dropped.
+ */
+class AudioBufferPool {
+public:
+    static AudioBufferPool& GetInstance() {
+        static AudioBufferPool instance;
+        return instance;
+    }
+    AudioBufferPool(const AudioBufferPool&) = delete;
+    AudioBufferPool& operator=(const AudioBufferPool&) = delete;
+
+    // pcm_samples sizes tasks (decoded audio at the output rate), frame_samples the shared 16kHz frames
+    void Initialize(size_t pcm_samples, size_t frame_samples);
+    AudioTaskPtr AcquireTask();
+    AudioStreamPacketPtr AcquirePacket();
+    PcmFrameRef AcquireFrame();
+    bool Recycle(AudioTask* task);
+    bool Recycle(AudioStreamPacket* packet);
+    bool Recycle(PcmFrame* frame);
+
+    AudioPoolStats GetTaskStats() { return task_pool_.GetStats(); }
+    AudioPoolStats GetPacketStats() { return packet_pool_.GetStats(); }
+    AudioPoolStats GetFrameStats() { return frame_pool_.GetStats(); }
+    void LogStats();
+
+private:
+    AudioBufferPool() = default;
+    ~AudioBufferPool() = default;
+
+    SlabPool<AudioTask> task_pool_;
+    SlabPool<AudioStreamPacket> packet_pool_;
+    SlabPool<PcmFrame> frame_pool_;
+    size_t frame_samples_ = 0;
+};
+
+#endif // AUDIO_BUFFER_POOL_H
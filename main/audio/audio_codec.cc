@@ -14,7 +14,9 @@ AudioCodec::AudioCodec() {
 AudioCodec::~AudioCodec() {
 }
 
-void AudioCodec::OutputData(std::vector<int16_t>& data) {
+void AudioCodec::OutputData(AudioPcmBuffer& data) {
+    output_stage_.Process(data.data(), data.size(), software_volume_ ? output_volume_ : 100,
+        output_sample_rate_ * output_channels_);
     Write(data.data(), data.size());
 }
 
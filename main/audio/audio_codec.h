@@ -10,6 +10,8 @@
 #include <functional>
 
 #include "board.h"
+#include "output_stage.h"
+#include "psram_allocator.h"
 
 #define AUDIO_CODEC_DMA_DESC_NUM 6
 #define AUDIO_CODEC_DMA_FRAME_NUM 240
@@ -24,7 +26,7 @@ public:
     virtual void EnableInput(bool enable);
     virtual void EnableOutput(bool enable);
 
-    virtual void OutputData(std::vector<int16_t>& data);
+    virtual void OutputData(AudioPcmBuffer& data);
     virtual bool InputData(std::vector<int16_t>& data);
     virtual void Start();
 
@@ -51,6 +53,9 @@ protected:
     int input_channels_ = 1;
     int output_channels_ = 1;
     int output_volume_ = 70;
+    // The codec has no volume control of its own, OutputData() applies output_volume_
+    bool software_volume_ = false;
+    OutputStage output_stage_;
 
     virtual int Read(int16_t* dest, int samples) = 0;
     virtual int Write(const int16_t* data, int samples) = 0;
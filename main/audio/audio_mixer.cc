@@ -0,0 +1,64 @@
+#include "audio_mixer.h"
+
+#include <algorithm>
+#include <cstring>
+
+void AudioMixer::Initialize(size_t max_samples) {
+    acc_.assign(max_samples, 0);
+}
+
+void AudioMixer::SetGain(AudioMixerLane lane, int32_t gain) {
+    gain_[lane] = std::min(std::max(gain, (int32_t)0), kUnity);
+}
+
+void AudioMixer::SetDucking(int32_t gain) {
+    ducking_ = std::min(std::max(gain, (int32_t)0), kUnity);
+}
+
+void AudioMixer::Mix(const int16_t* const inputs[kMixerLaneCount], int16_t* out, size_t samples) {
+    if (acc_.size() < samples) {
+        acc_.resize(samples);
+    }
+    bool ducked = inputs[kMixerLanePrompt] != nullptr || inputs[kMixerLaneTone] != nullptr;
+
+    // Speech alone at unity gain, the common case, passes through untouched
+    if (!ducked && inputs[kMixerLaneSpeech] == out && applied_[kMixerLaneSpeech] == kUnity && gain_[kMixerLaneSpeech] == kUnity) {
+        for (int lane = 0; lane < kMixerLaneCount; lane++) {
+            applied_[lane] = gain_[lane];
+        }
+        return;
+    }
+
+    int32_t* acc = acc_.data();
+    memset(acc, 0, samples * sizeof(int32_t));
+    for (int lane = 0; lane < kMixerLaneCount; lane++) {
+        int32_t target = gain_[lane];
+        if (lane == kMixerLaneSpeech && ducked) {
+            target = (target * ducking_) >> 14;
+        }
+        int32_t start = applied_[lane];
+        applied_[lane] = target;
+        const int16_t* in = inputs[lane];
+        if (in == nullptr || samples == 0) {
+            continue;
+        }
+
+        if (start == target) {
+            for (size_t i = 0; i < samples; i++) {
+                acc[i] += (in[i] * target) >> 14;
+            }
+            continue;
+        }
+        // Q14 gain with 16 fractional bits for the interpolation, at most 2^30
+        int32_t gain = start << 16;
+        int32_t step = (int32_t)(((int64_t)(target - start) << 16) / (int64_t)samples);
+        for (size_t i = 0; i < samples; i++) {
+            acc[i] += (in[i] * (gain >> 16)) >> 14;
+            gain += step;
+        }
+    }
+
+    for (size_t i = 0; i < samples; i++) {
+        out[i] = (int16_t)std::min(std::max(acc[i], (int32_t)INT16_MIN), (int32_t)INT16_MAX);
+    }
+}
@@ -0,0 +1,49 @@
+#ifndef AUDIO_MIXER_H
+#define AUDIO_MIXER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+enum AudioMixerLane {
+    kMixerLaneSpeech,       // server stream, through the jitter buffer and the speech decoder
+    kMixerLanePrompt,       // PlaySound(), cached PCM or its own decoder
+    kMixerLaneTone,         // PlayTestTone()
+    kMixerLaneCount,
+};
+
+/*
+ * Sums the playback lanes into one output frame, in the opus codec task.
+ *
+ * Every lane has its own gain, speech is additionally ducked while a prompt or a tone
+ * plays. Gain changes (including ducking in and out) are interpolated across the next
+ * frame, so they do not click. The lanes are accumulated in 32 bits and saturated to
+ * 16 bits once at the end.
+ *
+ * Gains are Q14 attenuations (0 to kUnity). The cost is one multiply-accumulate per
+ * sample per active lane plus the final saturation, without branches in the loops.
+ */
+class AudioMixer {
+public:
+    static constexpr int32_t kUnity = 1 << 14;
+
+    // Largest frame Mix() is called with, the accumulator is allocated once
+    void Initialize(size_t max_samples);
+
+    // Thread safe, takes effect with the next frame
+    void SetGain(AudioMixerLane lane, int32_t gain);
+    // Speech gain while the prompt or tone lane plays
+    void SetDucking(int32_t gain);
+
+    // inputs[lane] is nullptr for silent lanes. out may alias one of the inputs.
+    void Mix(const int16_t* const inputs[kMixerLaneCount], int16_t* out, size_t samples);
+
+private:
+    std::vector<int32_t> acc_;
+    std::atomic<int32_t> gain_[kMixerLaneCount] = {{kUnity}, {kUnity}, {kUnity}};
+    std::atomic<int32_t> ducking_{kUnity};
+    int32_t applied_[kMixerLaneCount] = {kUnity, kUnity, kUnity};    // gain at the end of the last frame
+};
+
+#endif // AUDIO_MIXER_H
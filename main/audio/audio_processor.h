@@ -20,7 +20,11 @@ public:
     virtual void OnOutput(std::function<void(std::vector<int16_t>&& data)> callback) = 0;
     virtual void OnVadStateChange(std::function<void(bool speaking)> callback) = 0;
     virtual size_t GetFeedSize() = 0;
+    // Size of the frames passed to the output callback, may change while running
+    virtual void SetFrameDuration(int frame_duration_ms) = 0;
     virtual void EnableDeviceAec(bool enable) = 0;
+    // Whether OnVadStateChange reports anything right now (AFE VAD is off while device AEC runs)
+    virtual bool IsVadEnabled() = 0;
 };
 
 #endif
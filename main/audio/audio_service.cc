@@ -2,7 +2,9 @@
 #include <esp_log.h>
 #include <cstring>
 #include <cmath>
+#include <algorithm>
 #include "audio_uploader.h"
+#include "audio_trace.h"
 
 #if CONFIG_USE_AUDIO_PROCESSOR
 #include "processors/afe_audio_processor.h"
@@ -34,11 +36,69 @@ AudioService::~AudioService() {
 void AudioService::Initialize(AudioCodec* codec) {
     codec_ = codec;
     codec_->Start();
+    // Before any task that records trace points is created
+    audio_trace_init();
 
     /* Setup the audio codec */
     opus_decoder_ = std::make_unique<OpusDecoderWrapper>(codec->output_sample_rate(), 1, OPUS_FRAME_DURATION_MS);
     opus_encoder_ = std::make_unique<OpusEncoderWrapper>(16000, 1, OPUS_FRAME_DURATION_MS);
+#if CONFIG_AUDIO_OPUS_GOVERNOR
+    opus_governor_ = std::make_unique<OpusGovernor>(OPUS_FRAME_DURATION_MS,
+        CONFIG_AUDIO_OPUS_COMPLEXITY_MIN, CONFIG_AUDIO_OPUS_COMPLEXITY_MAX);
+    opus_encoder_->SetComplexity(opus_governor_->state().complexity);
+    opus_encoder_->SetDtx(false);
+#else
     opus_encoder_->SetComplexity(0);
+#endif
+
+    metrics_.input_frames = metrics_register("audio.input_frames", METRIC_COUNTER);
+    metrics_.encode_frames = metrics_register("audio.encode_frames", METRIC_COUNTER);
+    metrics_.decode_frames = metrics_register("audio.decode_frames", METRIC_COUNTER);
+    metrics_.playback_frames = metrics_register("audio.playback_frames", METRIC_COUNTER);
+    metrics_.encode_us = metrics_register("audio.encode_us", METRIC_HISTOGRAM);
+    metrics_.decode_us = metrics_register("audio.decode_us", METRIC_HISTOGRAM);
+    metrics_.output_us = metrics_register("audio.output_us", METRIC_HISTOGRAM);
+    metrics_.encode_queue = metrics_register("audio.encode_queue", METRIC_GAUGE);
+    metrics_.decode_queue = metrics_register("audio.decode_queue", METRIC_GAUGE);
+    metrics_.playback_queue = metrics_register("audio.playback_queue", METRIC_GAUGE);
+    metrics_.opus_complexity = metrics_register("audio.opus_complexity", METRIC_GAUGE);
+    metric_set(metrics_.opus_complexity, opus_governor_ ? opus_governor_->state().complexity : 0);
+
+    /* Preallocate audio buffers, big enough for one frame at either the encoder or the speaker rate */
+    int max_sample_rate = std::max(16000, codec->output_sample_rate());
+    size_t frame_samples = max_sample_rate * OPUS_MAX_FRAME_DURATION_MS / 1000;
+    AudioBufferPool::GetInstance().Initialize(frame_samples, OPUS_MAX_FRAME_DURATION_MS * 16000 / 1000);
+    resample_buffer_.reserve(frame_samples);
+    size_t input_frames = codec->input_sample_rate() * OPUS_MAX_FRAME_DURATION_MS / 1000;
+    input_raw_.reserve(input_frames * codec->input_channels());
+    input_planar_.reserve(input_frames * codec->input_channels());
+    input_buffer_.reserve(OPUS_MAX_FRAME_DURATION_MS * 16000 / 1000 * codec->input_channels());
+    input_resampled_.reserve(input_buffer_.capacity());
+    encoded_payload_.reserve(CONFIG_AUDIO_BUFFER_POOL_PACKET_BYTES);
+    encode_pcm_.reserve(OPUS_MAX_FRAME_DURATION_MS * 16000 / 1000);
+    decode_payload_.reserve(CONFIG_AUDIO_BUFFER_POOL_PACKET_BYTES);
+    decode_pcm_.reserve(frame_samples);
+
+    /* Mixer lanes work in frames of at most OPUS_MAX_FRAME_DURATION_MS at the output rate */
+    size_t output_frame_samples = codec->output_sample_rate() * OPUS_MAX_FRAME_DURATION_MS / 1000;
+    mixer_.Initialize(output_frame_samples);
+    mixer_.SetDucking(CONFIG_AUDIO_MIXER_DUCKING_PERCENT * AudioMixer::kUnity / 100);
+    // One frame being mixed plus one decoded prompt packet, with room for resampler rounding
+    prompt_pcm_.Initialize(output_frame_samples * 3, output_frame_samples);
+    prompt_payload_.reserve(CONFIG_AUDIO_BUFFER_POOL_PACKET_BYTES);
+    prompt_decoded_.reserve(frame_samples);
+    prompt_lane_.reserve(output_frame_samples);
+    tone_lane_.reserve(output_frame_samples);
+
+    audio_encode_queue_.SetTracePoint(AUDIO_TRACE_ENCODE_QUEUE_PUSH);
+    audio_decode_queue_.SetTracePoint(AUDIO_TRACE_DECODE_QUEUE_PUSH);
+    audio_playback_queue_.SetTracePoint(AUDIO_TRACE_PLAYBACK_QUEUE_PUSH);
+
+#if CONFIG_AUDIO_PROMPT_PCM_CACHE
+    prompt_cache_.Initialize(codec->output_sample_rate(), CONFIG_AUDIO_PROMPT_PCM_CACHE_KB * 1024);
+#else
+    prompt_cache_.Initialize(codec->output_sample_rate(), 0);
+#endif
 
     if (codec->input_sample_rate() != 16000) {
         input_resampler_.Configure(codec->input_sample_rate(), 16000);
@@ -52,12 +112,8 @@ void AudioService::Initialize(AudioCodec* codec) {
 #endif
 
     audio_processor_->OnOutput([this](std::vector<int16_t>&& data) {
-        if (afe_output_callback_) {
-            std::vector<int16_t> copy = data;
-            afe_output_callback_(std::move(copy));
-        }
-        // 将 AFE 输出送入发送队列；PushTaskToEncodeQueue 自带丢弃策略避免阻塞
-        PushTaskToEncodeQueue(kAudioTaskTypeEncodeToSendQueue, std::move(data));
+        // 将 AFE 输出送入发送队列和 PCM 分接点；入队自带丢弃策略避免阻塞
+        DispatchPcmFrame(std::move(data));
     });
 
     audio_processor_->OnVadStateChange([this](bool speaking) {
@@ -131,12 +187,21 @@ void AudioService::Stop() {
         AS_EVENT_WAKE_WORD_RUNNING |
         AS_EVENT_AUDIO_PROCESSOR_RUNNING);
 
-    std::lock_guard<std::mutex> lock(audio_queue_mutex_);
-    audio_encode_queue_.clear();
-    audio_decode_queue_.clear();
-    audio_playback_queue_.clear();
-    audio_testing_queue_.clear();
-    audio_queue_cv_.notify_all();
+    audio_encode_queue_.Clear();
+    audio_decode_queue_.Clear();
+    prompt_queue_.Clear();
+    tone_queue_.Clear();
+    prompt_abort_ = true;
+    audio_playback_queue_.Clear();
+    audio_testing_queue_.Clear();
+    NotifyTask(audio_output_task_handle_, AS_NOTIFY_STOP);
+    NotifyTask(opus_codec_task_handle_, AS_NOTIFY_STOP);
+}
+
+void AudioService::NotifyTask(TaskHandle_t task, uint32_t bits) {
+    if (task != nullptr) {
+        xTaskNotify(task, bits, eSetBits);
+    }
 }
 
 bool AudioService::ReadAudioData(std::vector<int16_t>& data, int sample_rate, int samples) {
@@ -146,34 +211,44 @@ bool AudioService::ReadAudioData(std::vector<int16_t>& data, int sample_rate, in
         codec_->EnableInput(true);
     }
 
+    AUDIO_TRACE(AUDIO_TRACE_I2S_READ_START, metric_get(metrics_.input_frames));
+    int channels = codec_->input_channels();
     if (codec_->input_sample_rate() != sample_rate) {
-        data.resize(samples * codec_->input_sample_rate() / sample_rate * codec_->input_channels());
-        if (!codec_->InputData(data)) {
+        /* Read the DMA block into the scratch arena and resample straight into data */
+        size_t frames = samples * codec_->input_sample_rate() / sample_rate;
+        input_raw_.resize(frames * channels);
+        if (!codec_->InputData(input_raw_)) {
             return false;
         }
-        if (codec_->input_channels() == 2) {
-            auto mic_channel = std::vector<int16_t>(data.size() / 2);
-            auto reference_channel = std::vector<int16_t>(data.size() / 2);
-            for (size_t i = 0, j = 0; i < mic_channel.size(); ++i, j += 2) {
-                mic_channel[i] = data[j];
-                reference_channel[i] = data[j + 1];
+        if (channels == 2) {
+            /* Deinterleave into planar [mic | reference] */
+            input_planar_.resize(frames * 2);
+            int16_t* mic = input_planar_.data();
+            int16_t* reference = mic + frames;
+            const int16_t* src = input_raw_.data();
+            for (size_t i = 0; i < frames; ++i) {
+                mic[i] = src[2 * i];
+                reference[i] = src[2 * i + 1];
             }
-            auto resampled_mic = std::vector<int16_t>(input_resampler_.GetOutputSamples(mic_channel.size()));
-            auto resampled_reference = std::vector<int16_t>(reference_resampler_.GetOutputSamples(reference_channel.size()));
-            input_resampler_.Process(mic_channel.data(), mic_channel.size(), resampled_mic.data());
-            reference_resampler_.Process(reference_channel.data(), reference_channel.size(), resampled_reference.data());
-            data.resize(resampled_mic.size() + resampled_reference.size());
-            for (size_t i = 0, j = 0; i < resampled_mic.size(); ++i, j += 2) {
-                data[j] = resampled_mic[i];
-                data[j + 1] = resampled_reference[i];
+            size_t mic_samples = input_resampler_.GetOutputSamples(frames);
+            size_t reference_samples = reference_resampler_.GetOutputSamples(frames);
+            input_resampled_.resize(mic_samples + reference_samples);
+            int16_t* resampled_mic = input_resampled_.data();
+            int16_t* resampled_reference = resampled_mic + mic_samples;
+            input_resampler_.Process(mic, frames, resampled_mic);
+            reference_resampler_.Process(reference, frames, resampled_reference);
+            data.resize(mic_samples * 2);
+            int16_t* dst = data.data();
+            for (size_t i = 0; i < mic_samples; ++i) {
+                dst[2 * i] = resampled_mic[i];
+                dst[2 * i + 1] = resampled_reference[i];
             }
         } else {
-            auto resampled = std::vector<int16_t>(input_resampler_.GetOutputSamples(data.size()));
-            input_resampler_.Process(data.data(), data.size(), resampled.data());
-            data = std::move(resampled);
+            data.resize(input_resampler_.GetOutputSamples(frames));
+            input_resampler_.Process(input_raw_.data(), frames, data.data());
         }
     } else {
-        data.resize(samples * codec_->input_channels());
+        data.resize(samples * channels);
         if (!codec_->InputData(data)) {
             return false;
         }
@@ -181,7 +256,9 @@ bool AudioService::ReadAudioData(std::vector<int16_t>& data, int sample_rate, in
 
     /* Update the last input time */
     last_input_time_ = std::chrono::steady_clock::now();
-    debug_statistics_.input_count++;
+    last_capture_ms_ = esp_timer_get_time() / 1000;
+    AUDIO_TRACE(AUDIO_TRACE_I2S_READ_END, metric_get(metrics_.input_frames));
+    metric_inc(metrics_.input_frames);
 
 #if CONFIG_USE_AUDIO_DEBUGGER
     // 音频调试：发送原始音频数据
@@ -211,21 +288,22 @@ void AudioService::AudioInputTask() {
 
         /* Used for audio testing in NetworkConfiguring mode by clicking the BOOT button */
         if (bits & AS_EVENT_AUDIO_TESTING_RUNNING) {
-            if (audio_testing_queue_.size() >= AUDIO_TESTING_MAX_DURATION_MS / OPUS_FRAME_DURATION_MS) {
+            size_t max_frames = std::min<size_t>(audio_testing_queue_.capacity(), AUDIO_TESTING_MAX_DURATION_MS / frame_duration_ms_);
+            if (audio_testing_queue_.size() >= max_frames) {
                 ESP_LOGW(TAG, "Audio testing queue is full, stopping audio testing");
                 EnableAudioTesting(false);
                 continue;
             }
-            std::vector<int16_t> data;
-            int samples = OPUS_FRAME_DURATION_MS * 16000 / 1000;
+            auto& data = input_buffer_;
+            int samples = frame_duration_ms_ * 16000 / 1000;
             if (ReadAudioData(data, 16000, samples)) {
-                // If input channels is 2, we need to fetch the left channel data
+                // If input channels is 2, keep the left channel in place
                 if (codec_->input_channels() == 2) {
-                    auto mono_data = std::vector<int16_t>(data.size() / 2);
-                    for (size_t i = 0, j = 0; i < mono_data.size(); ++i, j += 2) {
-                        mono_data[i] = data[j];
+                    size_t mono_samples = data.size() / 2;
+                    for (size_t i = 0; i < mono_samples; ++i) {
+                        data[i] = data[2 * i];
                     }
-                    data = std::move(mono_data);
+                    data.resize(mono_samples);
                 }
                 PushTaskToEncodeQueue(kAudioTaskTypeEncodeToTestingQueue, std::move(data));
                 continue;
@@ -234,7 +312,7 @@ void AudioService::AudioInputTask() {
 
         /* Feed the wake word */
         if (bits & AS_EVENT_WAKE_WORD_RUNNING) {
-            std::vector<int16_t> data;
+            auto& data = input_buffer_;
             int samples = wake_word_->GetFeedSize();
             if (samples > 0) {
                 if (ReadAudioData(data, 16000, samples)) {
@@ -246,7 +324,7 @@ void AudioService::AudioInputTask() {
 
         /* Feed the audio processor */
         if (bits & AS_EVENT_AUDIO_PROCESSOR_RUNNING) {
-            std::vector<int16_t> data;
+            auto& data = input_buffer_;
             int samples = audio_processor_->GetFeedSize();
             if (samples > 0) {
                 if (ReadAudioData(data, 16000, samples)) {
@@ -264,140 +342,257 @@ void AudioService::AudioInputTask() {
 }
 
 void AudioService::AudioOutputTask() {
+    audio_playback_queue_.SetConsumerTask(xTaskGetCurrentTaskHandle(), AS_NOTIFY_PLAYBACK_QUEUE);
+
     while (true) {
-        std::unique_lock<std::mutex> lock(audio_queue_mutex_);
-        audio_queue_cv_.wait(lock, [this]() { return !audio_playback_queue_.empty() || service_stopped_; });
+        AudioTaskPtr task;
+        while (!service_stopped_ && !audio_playback_queue_.Pop(task)) {
+            xTaskNotifyWait(0, UINT32_MAX, nullptr, portMAX_DELAY);
+        }
         if (service_stopped_) {
             break;
         }
 
-        auto task = std::move(audio_playback_queue_.front());
-        audio_playback_queue_.pop_front();
-        audio_queue_cv_.notify_all();
-        lock.unlock();
-
         if (!codec_->output_enabled()) {
             esp_timer_stop(audio_power_timer_);
             esp_timer_start_periodic(audio_power_timer_, AUDIO_POWER_CHECK_INTERVAL_MS * 1000);
             codec_->EnableOutput(true);
         }
+        uint32_t frame = metric_get(metrics_.playback_frames);
+        int64_t output_start = esp_timer_get_time();
+        AUDIO_TRACE(AUDIO_TRACE_OUTPUT_START, frame);
         codec_->OutputData(task->pcm);
+        AUDIO_TRACE(AUDIO_TRACE_OUTPUT_END, frame);
+        metric_observe(metrics_.output_us, esp_timer_get_time() - output_start);
         ESP_LOGD(TAG, "Played chunk samples=%u", (unsigned int)task->pcm.size());
 
         /* Update the last output time */
         last_output_time_ = std::chrono::steady_clock::now();
-        debug_statistics_.playback_count++;
+        metric_inc(metrics_.playback_frames);
 
 #if CONFIG_USE_SERVER_AEC
         /* Record the timestamp for server AEC */
         if (task->timestamp > 0) {
-            lock.lock();
-            timestamp_queue_.push_back(task->timestamp);
+            uint32_t timestamp = task->timestamp;
+            timestamp_queue_.Push(std::move(timestamp));
         }
 #endif
     }
 
+    audio_playback_queue_.SetConsumerTask(nullptr, 0);
     ESP_LOGW(TAG, "Audio output task stopped");
 }
 
 void AudioService::OpusCodecTask() {
     ESP_LOGI(TAG, "Opus codec task started");
-    
-    while (true) {
-        std::unique_lock<std::mutex> lock(audio_queue_mutex_);
-        audio_queue_cv_.wait(lock, [this]() {
-            return service_stopped_ ||
-                !audio_encode_queue_.empty() ||
-                (!audio_decode_queue_.empty() && audio_playback_queue_.size() < MAX_PLAYBACK_TASKS_IN_QUEUE);
-        });
-
-        if (service_stopped_) {
-            break;
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+    audio_encode_queue_.SetConsumerTask(self, AS_NOTIFY_ENCODE_QUEUE);
+    audio_decode_queue_.SetConsumerTask(self, AS_NOTIFY_DECODE_QUEUE);
+    prompt_queue_.SetConsumerTask(self, AS_NOTIFY_DECODE_QUEUE);
+    tone_queue_.SetConsumerTask(self, AS_NOTIFY_DECODE_QUEUE);
+    audio_playback_queue_.SetProducerTask(self, AS_NOTIFY_PLAYBACK_SPACE);
+
+    while (!service_stopped_) {
+        bool busy = false;
+        metric_set(metrics_.decode_queue, audio_decode_queue_.size());
+        metric_set(metrics_.encode_queue, audio_encode_queue_.size());
+        metric_set(metrics_.playback_queue, audio_playback_queue_.size());
+        if (opus_governor_) {
+            // 编码队列满说明编码落后了一整帧，调节器据此降低 complexity
+            opus_governor_->OnQueueDepth(audio_encode_queue_.size(), audio_encode_queue_.capacity());
         }
 
-        /* ------------------ Decoding Logic (Server -> Speaker) ------------------ */
-        if (!audio_decode_queue_.empty() && audio_playback_queue_.size() < MAX_PLAYBACK_TASKS_IN_QUEUE) {
-            auto packet = std::move(audio_decode_queue_.front());
-            audio_decode_queue_.pop_front();
-            audio_queue_cv_.notify_all();
-            lock.unlock(); // 解锁进行耗时操作
-
-            auto task = std::make_unique<AudioTask>();
-            task->type = kAudioTaskTypeDecodeToPlaybackQueue;
-            task->timestamp = packet->timestamp;
-
-            SetDecodeSampleRate(packet->sample_rate, packet->frame_duration);
-            
-            // 解码 Opus
-            if (opus_decoder_->Decode(std::move(packet->payload), task->pcm)) {
-                // 重采样逻辑
-                if (opus_decoder_->sample_rate() != codec_->output_sample_rate()) {
-                    int target_size = output_resampler_.GetOutputSamples(task->pcm.size());
-                    std::vector<int16_t> resampled(target_size);
-                    output_resampler_.Process(task->pcm.data(), task->pcm.size(), resampled.data());
-                    task->pcm = std::move(resampled);
+        /* ------------------ Playback (Server / prompts / tone -> Mixer -> Speaker) ------------------ */
+        // 缓冲中不会 Pop，Clear() 留下的过期包在这里释放槽位，等待空间的生产者才能继续
+        audio_decode_queue_.DropStale();
+        if (!audio_playback_queue_.full()) {
+            AudioStreamPacketPtr packet;
+            AudioTaskPtr task;
+            JitterBufferAction action = jitter_buffer_.OnPlayout(audio_decode_queue_.size(), audio_playback_queue_.empty(), esp_timer_get_time());
+            // 已做过丢包补偿的时隙，其迟到的包直接丢弃，播放延迟不随每次欠载增长
+            while (action == kJitterBufferDrop && audio_decode_queue_.Pop(packet)) {
+                packet.reset();
+                action = jitter_buffer_.OnPlayout(audio_decode_queue_.size(), audio_playback_queue_.empty(), esp_timer_get_time());
+            }
+            if ((action == kJitterBufferDecode && audio_decode_queue_.Pop(packet)) || action == kJitterBufferConceal) {
+                busy = true;
+                task = AudioBufferPool::GetInstance().AcquireTask();
+                task->type = kAudioTaskTypeDecodeToPlaybackQueue;
+                task->timestamp = 0;
+
+                if (packet) {
+                    task->timestamp = packet->timestamp;
+                    SetDecodeSampleRate(packet->sample_rate, packet->frame_duration);
+                } else {
+                    // 丢包补偿：空包送入解码器触发 Opus PLC
+                    packet = AudioBufferPool::GetInstance().AcquirePacket();
                 }
 
-                // 放入播放队列
-                lock.lock();
-                audio_playback_queue_.push_back(std::move(task));
-                audio_queue_cv_.notify_all(); // 通知 OutputTask
-            } else {
-                ESP_LOGE(TAG, "Failed to decode audio");
-                lock.lock();
+                // 解码 Opus
+                uint32_t frame = metric_get(metrics_.decode_frames);
+                int64_t decode_start = esp_timer_get_time();
+                AUDIO_TRACE(AUDIO_TRACE_DECODE_START, frame);
+                decode_payload_.assign(packet->payload.begin(), packet->payload.end());
+                bool decoded = opus_decoder_->Decode(std::move(decode_payload_), decode_pcm_);
+                AUDIO_TRACE(AUDIO_TRACE_DECODE_END, frame);
+                metric_observe(metrics_.decode_us, esp_timer_get_time() - decode_start);
+                if (decoded) {
+                    // 重采样逻辑：直接写入池化的 PCM 缓冲
+                    if (opus_decoder_->sample_rate() != codec_->output_sample_rate()) {
+                        task->pcm.resize(output_resampler_.GetOutputSamples(decode_pcm_.size()));
+                        output_resampler_.Process(decode_pcm_.data(), decode_pcm_.size(), task->pcm.data());
+                    } else {
+                        task->pcm.assign(decode_pcm_.begin(), decode_pcm_.end());
+                    }
+                } else {
+                    ESP_LOGE(TAG, "Failed to decode audio");
+                    task.reset();
+                }
+                metric_inc(metrics_.decode_frames);
+            }
+
+            // 提示音与测试音按语音帧长混入；没有语音时按自己的块长播放
+            bool speech = task != nullptr;
+            size_t samples = speech ? task->pcm.size() : codec_->output_sample_rate() * OPUS_MAX_FRAME_DURATION_MS / 1000;
+            size_t prompt = FillPromptLane(samples);
+            size_t tone = FillToneLane(samples);
+            if (!speech && (prompt > 0 || tone > 0)) {
+                samples = std::max(prompt, tone);
+                task = AudioBufferPool::GetInstance().AcquireTask();
+                task->type = kAudioTaskTypeDecodeToPlaybackQueue;
+                task->timestamp = 0;
+                task->pcm.resize(samples);
+            }
+            if (task) {
+                busy = true;
+                const int16_t* inputs[kMixerLaneCount] = {
+                    speech ? task->pcm.data() : nullptr,
+                    prompt > 0 ? prompt_lane_.data() : nullptr,
+                    tone > 0 ? tone_lane_.data() : nullptr,
+                };
+                mixer_.Mix(inputs, task->pcm.data(), samples);
+                // 放入播放队列 (仅本任务生产，上面已确认有空位)
+                audio_playback_queue_.Push(std::move(task));
             }
-            debug_statistics_.decode_count++;
         }
-        
+
         /* ------------------ Encoding Logic (Mic -> Server) ------------------ */
         // 注意：这里不需要再检查 audio_send_queue_ 的大小，因为我们直接发给 uploader
-        if (!audio_encode_queue_.empty()) {
-            // 如果还持有锁，先释放，取出任务
-            if (!lock.owns_lock()) lock.lock();
-            
-            auto task = std::move(audio_encode_queue_.front());
-            audio_encode_queue_.pop_front();
-            audio_queue_cv_.notify_all();
-            lock.unlock(); // 解锁进行耗时编码
-
-            // 准备编码输出容器
-            std::vector<uint8_t> encoded_payload;
-            
-            // 执行编码
-            if (opus_encoder_->Encode(std::move(task->pcm), encoded_payload)) {
+        AudioTaskPtr task;
+        if (audio_encode_queue_.Pop(task)) {
+            busy = true;
+
+            // 执行编码 (输出容器复用，避免每帧分配)
+            auto& encoded_payload = encoded_payload_;
+            // 处理器输出的帧与 PCM 分接点共享，只读；先拷入编码器自己的输入缓冲再交给 Encode()
+            if (task->frame) {
+                encode_pcm_.assign(task->frame->pcm.begin(), task->frame->pcm.end());
+            } else {
+                encode_pcm_.assign(task->pcm.begin(), task->pcm.end());
+            }
+            auto& pcm = encode_pcm_;
+            // 帧长由 AFE 输出决定，切换帧长时编码器跟随帧大小重建
+            int frame_duration_ms = pcm.size() * 1000 / 16000;
+            if (frame_duration_ms != opus_encoder_->duration_ms()) {
+                ReconfigureEncoder(frame_duration_ms);
+            }
+            // DTX only during silence reported by the VAD for this frame, never without a VAD
+            if (opus_governor_ && opus_governor_->SetVoiceActive(task->voice || !task->vad)) {
+                opus_encoder_->SetDtx(opus_governor_->state().dtx);
+            }
+            uint32_t frame = metric_get(metrics_.encode_frames);
+            int64_t encode_start = esp_timer_get_time();
+            AUDIO_TRACE(AUDIO_TRACE_ENCODE_START, frame);
+            bool encoded = opus_encoder_->Encode(std::move(pcm), encoded_payload);
+            AUDIO_TRACE(AUDIO_TRACE_ENCODE_END, frame);
+            int64_t encode_us = esp_timer_get_time() - encode_start;
+            metric_observe(metrics_.encode_us, encode_us);
+            if (opus_governor_) {
+                opus_governor_->OnEncode(encode_us);
+                UpdateOpusGovernor();
+            }
+            if (encoded) {
                 
                 // 处理编码后的数据
                 if (task->type == kAudioTaskTypeEncodeToSendQueue) {
                     // === 核心修改：直接发送给 WebSocket Uploader ===
                     // 不再存入 audio_send_queue_，减少内存占用和延迟
                     // encoded_payload.data() 是 Opus 数据，encoded_payload.size() 是长度
-                    audio_uploader_send_bytes(encoded_payload.data(), encoded_payload.size());
+                    audio_uploader_send_frame(encoded_payload.data(), encoded_payload.size(),
+                        task->capture_time_ms, frame_duration_ms, task->voice);
 
                 } else if (task->type == kAudioTaskTypeEncodeToTestingQueue) {
                     // 用于本地测试的回环逻辑 (Boot Button 测试)
-                    auto packet = std::make_unique<AudioStreamPacket>();
-                    packet->payload = std::move(encoded_payload);
-                    packet->frame_duration = OPUS_FRAME_DURATION_MS;
+                    auto packet = AudioBufferPool::GetInstance().AcquirePacket();
+                    packet->payload.assign(encoded_payload.begin(), encoded_payload.end());
+                    packet->frame_duration = frame_duration_ms;
                     packet->sample_rate = 16000;
-                    
-                    lock.lock();
-                    audio_testing_queue_.push_back(std::move(packet));
-                    lock.unlock();
+                    audio_testing_queue_.Push(std::move(packet));
                 }
                 
-                debug_statistics_.encode_count++;
+                metric_inc(metrics_.encode_frames);
             } else {
                 ESP_LOGE(TAG, "Failed to encode audio");
             }
-            
-            // 循环回来重新获取锁
-            lock.lock();
+        }
+
+        // 没有可处理的数据时，等待任一队列的通知 (缓冲中时最多等到抖动缓冲的截止时间)
+        if (!busy) {
+            int64_t timeout_us = jitter_buffer_.GetTimeoutUs(esp_timer_get_time());
+            TickType_t ticks = portMAX_DELAY;
+            if (timeout_us >= 0) {
+                ticks = pdMS_TO_TICKS(timeout_us / 1000) + 1;
+            }
+            xTaskNotifyWait(0, UINT32_MAX, nullptr, ticks);
         }
     }
 
+    audio_encode_queue_.SetConsumerTask(nullptr, 0);
+    audio_decode_queue_.SetConsumerTask(nullptr, 0);
+    prompt_queue_.SetConsumerTask(nullptr, 0);
+    tone_queue_.SetConsumerTask(nullptr, 0);
+    audio_playback_queue_.SetProducerTask(nullptr, 0);
     ESP_LOGW(TAG, "Opus codec task stopped");
 }
 
+bool AudioService::SetFrameDuration(int frame_duration_ms) {
+    if (frame_duration_ms != 10 && frame_duration_ms != 20 && frame_duration_ms != 40 && frame_duration_ms != 60) {
+        ESP_LOGW(TAG, "Unsupported frame duration: %d ms", frame_duration_ms);
+        return false;
+    }
+    if (frame_duration_ms_.exchange(frame_duration_ms) == frame_duration_ms) {
+        return true;
+    }
+    ESP_LOGI(TAG, "Frame duration -> %d ms", frame_duration_ms);
+    if (audio_processor_initialized_) {
+        audio_processor_->SetFrameDuration(frame_duration_ms);
+    }
+    return true;
+}
+
+// Opus codec task only
+void AudioService::ReconfigureEncoder(int frame_duration_ms) {
+    opus_encoder_ = std::make_unique<OpusEncoderWrapper>(16000, 1, frame_duration_ms);
+    if (opus_governor_) {
+        opus_governor_->SetFrameDuration(frame_duration_ms);
+        opus_encoder_->SetComplexity(opus_governor_->state().complexity);
+        opus_encoder_->SetDtx(opus_governor_->state().dtx);
+    } else {
+        opus_encoder_->SetComplexity(0);
+    }
+}
+
+void AudioService::UpdateOpusGovernor() {
+    if (!opus_governor_->Update(esp_timer_get_time())) {
+        return;
+    }
+    auto& state = opus_governor_->state();
+    opus_encoder_->SetComplexity(state.complexity);
+    metric_set(metrics_.opus_complexity, state.complexity);
+    ESP_LOGI(TAG, "Opus complexity -> %d (encode avg %lu us, max %lu us over %lu frames, queue depth %lu)",
+        state.complexity, state.avg_encode_us, state.max_encode_us, state.frames, state.max_queue_depth);
+}
+
 void AudioService::SetDecodeSampleRate(int sample_rate, int frame_duration) {
     if (opus_decoder_->sample_rate() == sample_rate && opus_decoder_->duration_ms() == frame_duration) {
         return;
@@ -414,51 +609,93 @@ void AudioService::SetDecodeSampleRate(int sample_rate, int frame_duration) {
 }
 
 void AudioService::PushTaskToEncodeQueue(AudioTaskType type, std::vector<int16_t>&& pcm) {
-    auto task = std::make_unique<AudioTask>();
+    auto task = AudioBufferPool::GetInstance().AcquireTask();
     task->type = type;
-    task->pcm = std::move(pcm);
-    
-    /* Push the task to the encode queue */
-    std::unique_lock<std::mutex> lock(audio_queue_mutex_);
+    task->voice = false;
+    task->vad = false;
+    // Copied into the pooled frame, the caller's buffer keeps its storage for the next read
+    task->pcm.assign(pcm.begin(), pcm.end());
+    PushTaskToEncodeQueue(std::move(task));
+}
 
+// Processor output: the samples move into a pooled shared frame, the encoder and every PCM tap hold a ref to it.
+// The caller gets the frame's previous buffer back, so both sides keep their capacity and nothing is copied.
+void AudioService::DispatchPcmFrame(std::vector<int16_t>&& pcm) {
+    auto frame = AudioBufferPool::GetInstance().AcquireFrame();
+    PcmFrame* writable = frame.mutable_frame();
+    if (pcm.capacity() >= writable->pcm.capacity()) {
+        writable->pcm.swap(pcm);
+        pcm.clear();
+    } else {
+        // A smaller buffer would make the pool reallocate when the frame is recycled
+        writable->pcm.assign(pcm.begin(), pcm.end());
+    }
+    // The frame ends with the latest microphone read
+    writable->capture_time_ms = last_capture_ms_ - writable->pcm.size() * 1000 / 16000;
+
+    {
+        std::lock_guard<std::mutex> lock(pcm_taps_mutex_);
+        for (auto& tap : pcm_taps_) {
+            tap.second(frame);
+        }
+    }
+
+    auto task = AudioBufferPool::GetInstance().AcquireTask();
+    task->type = kAudioTaskTypeEncodeToSendQueue;
+    task->frame = std::move(frame);
+    // The processor reports a VAD change before it outputs the frame it applies to
+    task->voice = voice_detected_;
+    task->vad = audio_processor_->IsVadEnabled();
+    PushTaskToEncodeQueue(std::move(task));
+}
+
+void AudioService::PushTaskToEncodeQueue(AudioTaskPtr task) {
+    std::lock_guard<std::mutex> lock(encode_producer_mutex_);
     /* If the task is to send queue, we need to set the timestamp */
-    if (type == kAudioTaskTypeEncodeToSendQueue && !timestamp_queue_.empty()) {
-        if (timestamp_queue_.size() <= MAX_TIMESTAMPS_IN_QUEUE) {
-            task->timestamp = timestamp_queue_.front();
+    if (task->type == kAudioTaskTypeEncodeToSendQueue) {
+        if (task->frame) {
+            task->capture_time_ms = task->frame->capture_time_ms;
         } else {
-            ESP_LOGW(TAG, "Timestamp queue (%u) is full, dropping timestamp", timestamp_queue_.size());
+            // The frame ends with the latest microphone read
+            task->capture_time_ms = last_capture_ms_ - task->pcm.size() * 1000 / 16000;
+        }
+        uint32_t timestamp = 0;
+        if (timestamp_queue_.Pop(timestamp)) {
+            task->timestamp = timestamp;
         }
-        timestamp_queue_.pop_front();
     }
 
-    if (audio_encode_queue_.size() < MAX_ENCODE_TASKS_IN_QUEUE) {
-        audio_encode_queue_.push_back(std::move(task));
-        audio_queue_cv_.notify_all();
-    }
+    /* Push the task to the encode queue, drop it when the encoder is lagging behind */
+    audio_encode_queue_.Push(std::move(task));
 }
 
-bool AudioService::PushPacketToDecodeQueue(std::unique_ptr<AudioStreamPacket> packet, bool wait) {
-    std::unique_lock<std::mutex> lock(audio_queue_mutex_);
-    if (audio_decode_queue_.size() >= MAX_DECODE_PACKETS_IN_QUEUE) {
-        if (wait) {
-            audio_queue_cv_.wait(lock, [this]() { return audio_decode_queue_.size() < MAX_DECODE_PACKETS_IN_QUEUE; });
-        } else {
+void AudioService::EndDecodeStream() {
+    jitter_buffer_.OnEndOfStream();
+}
+
+bool AudioService::PushPacketToDecodeQueue(AudioStreamPacketPtr packet, bool wait) {
+    while (true) {
+        {
+            std::lock_guard<std::mutex> lock(decode_producer_mutex_);
+            int frame_duration = packet->frame_duration;
+            if (audio_decode_queue_.Push(std::move(packet))) {
+                jitter_buffer_.OnArrival(esp_timer_get_time(), frame_duration);
+                return true;
+            }
+        }
+        if (!wait || service_stopped_) {
             return false;
         }
+        // Do not hold the producer lock while waiting, so the network callback can still drop instead of block
+        audio_decode_queue_.WaitForSpace(pdMS_TO_TICKS(OPUS_FRAME_DURATION_MS));
     }
-    audio_decode_queue_.push_back(std::move(packet));
-    audio_queue_cv_.notify_all();
-    return true;
 }
 
-std::unique_ptr<AudioStreamPacket> AudioService::PopPacketFromSendQueue() {
-    std::lock_guard<std::mutex> lock(audio_queue_mutex_);
-    if (audio_send_queue_.empty()) {
+AudioStreamPacketPtr AudioService::PopPacketFromSendQueue() {
+    AudioStreamPacketPtr packet;
+    if (!audio_send_queue_.Pop(packet)) {
         return nullptr;
     }
-    auto packet = std::move(audio_send_queue_.front());
-    audio_send_queue_.pop_front();
-    audio_queue_cv_.notify_all();
     return packet;
 }
 
@@ -472,12 +709,14 @@ const std::string& AudioService::GetLastWakeWord() const {
     return wake_word_->GetLastDetectedWakeWord();
 }
 
-std::unique_ptr<AudioStreamPacket> AudioService::PopWakeWordPacket() {
-    auto packet = std::make_unique<AudioStreamPacket>();
-    if (wake_word_->GetWakeWordOpus(packet->payload)) {
-        return packet;
+AudioStreamPacketPtr AudioService::PopWakeWordPacket() {
+    std::vector<uint8_t> opus;
+    if (!wake_word_->GetWakeWordOpus(opus)) {
+        return nullptr;
     }
-    return nullptr;
+    auto packet = AudioBufferPool::GetInstance().AcquirePacket();
+    packet->payload.assign(opus.begin(), opus.end());
+    return packet;
 }
 
 void AudioService::EnableWakeWordDetection(bool enable) {
@@ -506,7 +745,7 @@ void AudioService::EnableVoiceProcessing(bool enable) {
     ESP_LOGD(TAG, "%s voice processing", enable ? "Enabling" : "Disabling");
     if (enable) {
         if (!audio_processor_initialized_) {
-            audio_processor_->Initialize(codec_, OPUS_FRAME_DURATION_MS, models_list_);
+            audio_processor_->Initialize(codec_, frame_duration_ms_, models_list_);
             audio_processor_initialized_ = true;
         }
 
@@ -527,17 +766,33 @@ void AudioService::EnableAudioTesting(bool enable) {
         xEventGroupSetBits(event_group_, AS_EVENT_AUDIO_TESTING_RUNNING);
     } else {
         xEventGroupClearBits(event_group_, AS_EVENT_AUDIO_TESTING_RUNNING);
-        /* Copy audio_testing_queue_ to audio_decode_queue_ */
-        std::lock_guard<std::mutex> lock(audio_queue_mutex_);
-        audio_decode_queue_ = std::move(audio_testing_queue_);
-        audio_queue_cv_.notify_all();
+        /* Move audio_testing_queue_ to audio_decode_queue_ */
+        // Clear() only marks the queued packets stale, their slots are free once the codec
+        // task has drained them, and a recording can be longer than the decode queue: wait
+        // for space instead of dropping the rest
+        audio_decode_queue_.Clear();
+        AudioStreamPacketPtr packet;
+        while (audio_testing_queue_.Pop(packet)) {
+            while (true) {
+                {
+                    std::lock_guard<std::mutex> lock(decode_producer_mutex_);
+                    if (audio_decode_queue_.Push(std::move(packet))) {
+                        break;
+                    }
+                }
+                if (service_stopped_) {
+                    return;
+                }
+                audio_decode_queue_.WaitForSpace(pdMS_TO_TICKS(OPUS_MAX_FRAME_DURATION_MS));
+            }
+        }
     }
 }
 
 void AudioService::EnableDeviceAec(bool enable) {
     ESP_LOGI(TAG, "%s device AEC", enable ? "Enabling" : "Disabling");
     if (!audio_processor_initialized_) {
-        audio_processor_->Initialize(codec_, OPUS_FRAME_DURATION_MS, models_list_);
+        audio_processor_->Initialize(codec_, frame_duration_ms_, models_list_);
         audio_processor_initialized_ = true;
     }
 
@@ -548,8 +803,21 @@ void AudioService::SetCallbacks(AudioServiceCallbacks& callbacks) {
     callbacks_ = callbacks;
 }
 
-void AudioService::SetAfeOutputCallback(std::function<void(std::vector<int16_t>&&)> callback) {
-    afe_output_callback_ = callback;
+int AudioService::AddPcmTap(PcmTap tap) {
+    std::lock_guard<std::mutex> lock(pcm_taps_mutex_);
+    int id = next_pcm_tap_id_++;
+    pcm_taps_.emplace_back(id, std::move(tap));
+    return id;
+}
+
+void AudioService::RemovePcmTap(int id) {
+    std::lock_guard<std::mutex> lock(pcm_taps_mutex_);
+    for (auto it = pcm_taps_.begin(); it != pcm_taps_.end(); ++it) {
+        if (it->first == id) {
+            pcm_taps_.erase(it);
+            return;
+        }
+    }
 }
 
 void AudioService::PlayTestTone(int freq_hz, int duration_ms) {
@@ -562,24 +830,20 @@ void AudioService::PlayTestTone(int freq_hz, int duration_ms) {
         codec_->EnableOutput(true);
     }
 
-    const int sample_rate = codec_->output_sample_rate();
-    const int total_samples = sample_rate * duration_ms / 1000;
-    const float omega = 2.0f * static_cast<float>(M_PI) * static_cast<float>(freq_hz) / static_cast<float>(sample_rate);
-    std::vector<int16_t> pcm;
-    pcm.resize(total_samples);
-    for (int i = 0; i < total_samples; ++i) {
-        float s = std::sin(omega * static_cast<float>(i));
-        pcm[i] = static_cast<int16_t>(s * 6000.0f);
+    ToneRequest request = {freq_hz, duration_ms};
+    std::lock_guard<std::mutex> lock(decode_producer_mutex_);
+    if (!tone_queue_.Push(std::move(request))) {
+        ESP_LOGW(TAG, "Tone queue full, dropped test tone freq=%dHz", freq_hz);
+        return;
     }
+    ESP_LOGI(TAG, "Queued test tone freq=%dHz duration=%dms", freq_hz, duration_ms);
+}
 
-    codec_->OutputData(pcm);
-    last_output_time_ = std::chrono::steady_clock::now();
-    ESP_LOGI(TAG, "Played test tone freq=%dHz duration=%dms samples=%d", freq_hz, duration_ms, total_samples);
+void AudioService::SetMixerGain(AudioMixerLane lane, int percent) {
+    mixer_.SetGain(lane, percent * AudioMixer::kUnity / 100);
 }
 
 void AudioService::PlaySound(const std::string_view& ogg) {
-    ESP_LOGI(TAG, "PlaySound called, size=%d", (int)ogg.size());
-    
     if (!codec_->output_enabled()) {
         esp_timer_stop(audio_power_timer_);
         esp_timer_start_periodic(audio_power_timer_, AUDIO_POWER_CHECK_INTERVAL_MS * 1000);
@@ -587,115 +851,170 @@ void AudioService::PlaySound(const std::string_view& ogg) {
         ESP_LOGI(TAG, "Output enabled");
     }
 
-    const uint8_t* buf = reinterpret_cast<const uint8_t*>(ogg.data());
-    size_t size = ogg.size();
-    size_t offset = 0;
-
-    auto find_page = [&](size_t start)->size_t {
-        for (size_t i = start; i + 4 <= size; ++i) {
-            if (buf[i] == 'O' && buf[i+1] == 'g' && buf[i+2] == 'g' && buf[i+3] == 'S') return i;
+    // Preloaded prompts play from the cached PCM, others are decoded by the prompt lane
+    // straight from the asset in flash, RAM use does not grow with the prompt length
+    PromptItem item;
+    item.pcm = prompt_cache_.GetPcm(ogg);
+    if (item.pcm == nullptr) {
+        item.index = prompt_cache_.GetIndex(ogg);
+        if (item.index == nullptr || item.index->packets.empty()) {
+            return;
         }
-        return static_cast<size_t>(-1);
+    }
+    while (true) {
+        {
+            std::lock_guard<std::mutex> lock(decode_producer_mutex_);
+            if (prompt_queue_.Push(std::move(item))) {
+                break;
+            }
+        }
+        if (service_stopped_) {
+            return;
+        }
+        prompt_queue_.WaitForSpace(pdMS_TO_TICKS(OPUS_MAX_FRAME_DURATION_MS));
+    }
+    if (item.pcm != nullptr) {
+        ESP_LOGD(TAG, "Queued cached prompt, samples=%u", (unsigned int)item.pcm->count);
+    } else {
+        ESP_LOGI(TAG, "Queued prompt, %u opus packets (sr=%d)", (unsigned int)item.index->packets.size(), item.index->sample_rate);
+    }
+}
+
+void AudioService::PreloadSounds(std::vector<std::string_view> sounds) {
+    struct PreloadJob {
+        PromptCache* cache;
+        std::vector<std::string_view> sounds;
     };
+    auto job = new PreloadJob{&prompt_cache_, std::move(sounds)};
+    BaseType_t ret = xTaskCreate([](void* arg) {
+        auto job = static_cast<PreloadJob*>(arg);
+        for (auto& sound : job->sounds) {
+            job->cache->Preload(sound);
+        }
+        delete job;
+        vTaskDelete(NULL);
+    }, "prompt_preload", 4096 * 2, job, 1, nullptr);
+    if (ret != pdPASS) {
+        // Prompts still play, decoded on first use
+        ESP_LOGE(TAG, "Failed to create prompt preload task");
+        delete job;
+    }
+}
 
-    bool seen_head = false;
-    bool seen_tags = false;
-    int sample_rate = 16000; // 默认值
-    size_t queued_packets = 0;
+// Opus codec task only. Tops the prompt lane up to samples from the cached PCM or the prompt
+// decoder, prompts play one after another. Returns the valid samples in prompt_lane_, which is
+// zero padded to samples, or 0 while no prompt plays.
+size_t AudioService::FillPromptLane(size_t samples) {
+    if (prompt_abort_.exchange(false)) {
+        prompt_playing_ = PromptItem();
+        prompt_pcm_.Clear();
+        tone_remaining_ = 0;
+    }
+    while (prompt_pcm_.size() < samples) {
+        if (prompt_playing_.pcm == nullptr && prompt_playing_.index == nullptr) {
+            if (!prompt_queue_.Pop(prompt_playing_)) {
+                break;
+            }
+            prompt_position_ = 0;
+        }
 
-    while (true) {
-        size_t pos = find_page(offset);
-        if (pos == static_cast<size_t>(-1)) break;
-        offset = pos;
-        if (offset + 27 > size) break;
-
-        const uint8_t* page = buf + offset;
-        uint8_t page_segments = page[26];
-        size_t seg_table_off = offset + 27;
-        if (seg_table_off + page_segments > size) break;
-
-        size_t body_size = 0;
-        for (size_t i = 0; i < page_segments; ++i) body_size += page[27 + i];
-
-        size_t body_off = seg_table_off + page_segments;
-        if (body_off + body_size > size) break;
-
-        // Parse packets using lacing
-        size_t cur = body_off;
-        size_t seg_idx = 0;
-        while (seg_idx < page_segments) {
-            size_t pkt_len = 0;
-            size_t pkt_start = cur;
-            bool continued = false;
-            do {
-                uint8_t l = page[27 + seg_idx++];
-                pkt_len += l;
-                cur += l;
-                continued = (l == 255);
-            } while (continued && seg_idx < page_segments);
-
-            if (pkt_len == 0) continue;
-            const uint8_t* pkt_ptr = buf + pkt_start;
-
-            if (!seen_head) {
-                // 解析OpusHead包
-                if (pkt_len >= 19 && std::memcmp(pkt_ptr, "OpusHead", 8) == 0) {
-                    seen_head = true;
-                    
-                    // OpusHead结构：[0-7] "OpusHead", [8] version, [9] channel_count, [10-11] pre_skip
-                    // [12-15] input_sample_rate, [16-17] output_gain, [18] mapping_family
-                    if (pkt_len >= 12) {
-                        uint8_t version = pkt_ptr[8];
-                        uint8_t channel_count = pkt_ptr[9];
-                        
-                        if (pkt_len >= 16) {
-                            // 读取输入采样率 (little-endian)
-                            sample_rate = pkt_ptr[12] | (pkt_ptr[13] << 8) | 
-                                        (pkt_ptr[14] << 16) | (pkt_ptr[15] << 24);
-                            ESP_LOGI(TAG, "OpusHead: version=%d, channels=%d, sample_rate=%d", 
-                                version, channel_count, sample_rate);
-                        }
-                    }
-                }
-                continue;
+        if (prompt_playing_.pcm != nullptr) {
+            // Cached PCM is at the output rate already
+            const PromptPcm* pcm = prompt_playing_.pcm;
+            size_t count = std::min(samples - prompt_pcm_.size(), pcm->count - prompt_position_);
+            prompt_pcm_.Push(pcm->samples + prompt_position_, count);
+            prompt_position_ += count;
+            if (prompt_position_ >= pcm->count) {
+                prompt_playing_ = PromptItem();
             }
-            if (!seen_tags) {
-                // Expect OpusTags in second packet
-                if (pkt_len >= 8 && std::memcmp(pkt_ptr, "OpusTags", 8) == 0) {
-                    seen_tags = true;
-                }
-                continue;
+            continue;
+        }
+
+        const PromptIndex* index = prompt_playing_.index;
+        if (prompt_position_ >= index->packets.size()) {
+            prompt_playing_ = PromptItem();
+            continue;
+        }
+        const PromptPacket& entry = index->packets[prompt_position_++];
+        if (prompt_decoder_ == nullptr || prompt_decoder_->sample_rate() != index->sample_rate) {
+            // Prompts are encoded with 60 ms frames, see scripts/mp3_to_ogg.sh
+            prompt_decoder_ = std::make_unique<OpusDecoderWrapper>(index->sample_rate, 1, 60);
+            if (index->sample_rate != codec_->output_sample_rate()) {
+                prompt_resampler_.Configure(index->sample_rate, codec_->output_sample_rate());
             }
+        }
+        // One packet at a time from flash into the reused input buffer, see prompt_payload_
+        const uint8_t* payload = reinterpret_cast<const uint8_t*>(index->data) + entry.offset;
+        prompt_payload_.assign(payload, payload + entry.size);
+        if (!prompt_decoder_->Decode(std::move(prompt_payload_), prompt_decoded_)) {
+            ESP_LOGE(TAG, "Failed to decode prompt");
+            continue;
+        }
+        if (prompt_decoder_->sample_rate() != codec_->output_sample_rate()) {
+            resample_buffer_.resize(prompt_resampler_.GetOutputSamples(prompt_decoded_.size()));
+            prompt_resampler_.Process(prompt_decoded_.data(), prompt_decoded_.size(), resample_buffer_.data());
+            prompt_pcm_.Push(resample_buffer_.data(), resample_buffer_.size());
+        } else {
+            prompt_pcm_.Push(prompt_decoded_.data(), prompt_decoded_.size());
+        }
+    }
 
-            // Audio packet (Opus)
-            auto packet = std::make_unique<AudioStreamPacket>();
-            packet->sample_rate = sample_rate;
-            packet->frame_duration = 60;
-            packet->payload.resize(pkt_len);
-            std::memcpy(packet->payload.data(), pkt_ptr, pkt_len);
-            PushPacketToDecodeQueue(std::move(packet), true);
-            queued_packets++;
+    size_t count = std::min(samples, prompt_pcm_.size());
+    if (count == 0) {
+        return 0;
+    }
+    prompt_lane_.resize(samples);
+    prompt_pcm_.Copy(prompt_lane_.data(), count);
+    prompt_pcm_.Skip(count);
+    std::fill(prompt_lane_.begin() + count, prompt_lane_.end(), 0);
+    return count;
+}
+
+// Opus codec task only. Same contract as FillPromptLane(), for PlayTestTone().
+size_t AudioService::FillToneLane(size_t samples) {
+    if (tone_remaining_ == 0) {
+        ToneRequest request;
+        if (!tone_queue_.Pop(request)) {
+            return 0;
         }
+        int sample_rate = codec_->output_sample_rate();
+        tone_remaining_ = sample_rate * request.duration_ms / 1000;
+        tone_phase_ = 0;
+        tone_step_ = 2.0f * static_cast<float>(M_PI) * static_cast<float>(request.freq_hz) / static_cast<float>(sample_rate);
+    }
 
-        offset = body_off + body_size;
+    size_t count = std::min(samples, tone_remaining_);
+    tone_lane_.resize(samples);
+    for (size_t i = 0; i < count; ++i) {
+        tone_lane_[i] = static_cast<int16_t>(std::sin(tone_phase_ + tone_step_ * static_cast<float>(i)) * 6000.0f);
     }
+    std::fill(tone_lane_.begin() + count, tone_lane_.end(), 0);
+    tone_phase_ = std::fmod(tone_phase_ + tone_step_ * static_cast<float>(count), 2.0f * static_cast<float>(M_PI));
+    tone_remaining_ -= count;
+    return count;
+}
 
-    ESP_LOGI(TAG, "Queued %u opus packets for playback (sr=%d)", (unsigned int)queued_packets, sample_rate);
+JitterBufferStats AudioService::GetJitterBufferStats() {
+    auto stats = jitter_buffer_.GetStats();
+    stats.depth = audio_decode_queue_.size();
+    return stats;
 }
 
 bool AudioService::IsIdle() {
-    std::lock_guard<std::mutex> lock(audio_queue_mutex_);
-    return audio_encode_queue_.empty() && audio_decode_queue_.empty() && audio_playback_queue_.empty() && audio_testing_queue_.empty();
+    return audio_encode_queue_.empty() && audio_decode_queue_.empty() && audio_playback_queue_.empty() && audio_testing_queue_.empty() &&
+        prompt_queue_.empty() && tone_queue_.empty();
 }
 
 void AudioService::ResetDecoder() {
-    std::lock_guard<std::mutex> lock(audio_queue_mutex_);
     opus_decoder_->ResetState();
-    timestamp_queue_.clear();
-    audio_decode_queue_.clear();
-    audio_playback_queue_.clear();
-    audio_testing_queue_.clear();
-    audio_queue_cv_.notify_all();
+    jitter_buffer_.Reset();
+    timestamp_queue_.Clear();
+    audio_decode_queue_.Clear();
+    prompt_queue_.Clear();
+    tone_queue_.Clear();
+    prompt_abort_ = true;
+    audio_playback_queue_.Clear();
+    audio_testing_queue_.Clear();
 }
 
 void AudioService::CheckAndUpdateAudioPowerState() {
@@ -2,10 +2,9 @@
 #define AUDIO_SERVICE_H
 
 #include <memory>
-#include <deque>
-#include <condition_variable>
 #include <chrono>
 #include <mutex>
+#include <atomic>
 
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
@@ -19,30 +18,52 @@
 
 #include "audio_codec.h"
 #include "audio_processor.h"
+#include "spsc_queue.h"
+#include "audio_buffer_pool.h"
+#include "pcm_frame.h"
+#include "jitter_buffer.h"
+#include "opus_governor.h"
+#include "prompt_cache.h"
+#include "audio_mixer.h"
+#include "frame_rechunker.h"
 #include "processors/audio_debugger.h"
 #include "wake_word.h"
 #include "protocol.h"
+#include "metrics.h"
 
 
 /*
  * There are two types of audio data flow:
  * 1. (MIC) -> [Processors] -> {Encode Queue} -> [Opus Encoder] -> {Send Queue} -> (Server)
- * 2. (Server) -> {Decode Queue} -> [Opus Decoder] -> {Playback Queue} -> (Speaker)
+ * 2. (Server) -> {Decode Queue} -> [Opus Decoder] -> [Mixer] -> {Playback Queue} -> (Speaker)
  *
  * We use one task for MIC / Speaker / Processors, and one task for Opus Encoder / Opus Decoder.
  * 
  * Decode Queue and Send Queue are the main queues, because Opus packets are quite smaller than PCM packets.
- * 
+ * The Opus Decoder takes packets out of the Decode Queue as the JitterBuffer allows, and fills gaps with PLC.
+ * Prompts (PlaySound) and the test tone are separate Mixer lanes fed from their own queues: cached PCM
+ * or a prompt decoder, and a tone generator. They play over the server speech, which is ducked meanwhile,
+ * and never wait for the Decode Queue.
+ *
+ * Every queue is a lock-free SPSC ring. Instead of one shared condition variable, each
+ * consumer task is woken by its own task notification bit (AS_NOTIFY_*), so a push to
+ * one pipe never wakes the tasks waiting on the others.
  */
 
-#define OPUS_FRAME_DURATION_MS 60
+// Default frame duration, AudioService::SetFrameDuration() switches it at runtime
+#define OPUS_FRAME_DURATION_MS CONFIG_AUDIO_FRAME_DURATION_MS
+// Buffers are sized for the longest supported frame, packet queues for the shortest
+#define OPUS_MAX_FRAME_DURATION_MS 60
+#define OPUS_MIN_FRAME_DURATION_MS 10
 #define MAX_ENCODE_TASKS_IN_QUEUE 2
 #define MAX_PLAYBACK_TASKS_IN_QUEUE 2
 //#define MAX_DECODE_PACKETS_IN_QUEUE (2400 / OPUS_FRAME_DURATION_MS)
 #define MAX_DECODE_PACKETS_IN_QUEUE 150
-#define MAX_SEND_PACKETS_IN_QUEUE (2400 / OPUS_FRAME_DURATION_MS)
+#define MAX_SEND_PACKETS_IN_QUEUE (2400 / OPUS_MIN_FRAME_DURATION_MS)
 #define AUDIO_TESTING_MAX_DURATION_MS 10000
 #define MAX_TIMESTAMPS_IN_QUEUE 3
+#define MAX_PROMPTS_IN_QUEUE 16
+#define MAX_TONES_IN_QUEUE 2
 
 #define AUDIO_POWER_TIMEOUT_MS 15000
 #define AUDIO_POWER_CHECK_INTERVAL_MS 1000
@@ -53,6 +74,15 @@
 #define AS_EVENT_AUDIO_PROCESSOR_RUNNING    (1 << 2)
 #define AS_EVENT_PLAYBACK_NOT_EMPTY         (1 << 3)
 
+#define AS_NOTIFY_ENCODE_QUEUE              (1 << 0)
+#define AS_NOTIFY_DECODE_QUEUE              (1 << 1)
+#define AS_NOTIFY_PLAYBACK_QUEUE            (1 << 2)
+#define AS_NOTIFY_PLAYBACK_SPACE            (1 << 3)
+#define AS_NOTIFY_STOP                      (1 << 4)
+
+// Receives every processed frame, must not block. Keep the ref to use the samples later.
+typedef std::function<void(const PcmFrameRef& frame)> PcmTap;
+
 struct AudioServiceCallbacks {
     std::function<void(void)> on_send_queue_available;
     std::function<void(const std::string&)> on_wake_word_detected;
@@ -67,17 +97,40 @@ enum AudioTaskType {
     kAudioTaskTypeDecodeToPlaybackQueue,
 };
 
+// Queued by PlaySound(): preloaded PCM, or the packet index decoded by the prompt lane
+struct PromptItem {
+    const PromptPcm* pcm = nullptr;
+    const PromptIndex* index = nullptr;
+};
+
+struct ToneRequest {
+    int freq_hz;
+    int duration_ms;
+};
+
 struct AudioTask {
     AudioTaskType type;
-    std::vector<int16_t> pcm;
+    AudioPcmBuffer pcm;
+    PcmFrameRef frame;          // encode tasks from the processor: shared frame, pcm stays empty
     uint32_t timestamp;
+    uint32_t capture_time_ms;   // when the frame was read from the microphone, for the uplink header
+    bool voice;                 // AFE VAD reported speech when the frame was produced
+    bool vad;                   // a VAD was running for this frame; without one DTX stays off
 };
 
-struct DebugStatistics {
-    uint32_t input_count = 0;
-    uint32_t decode_count = 0;
-    uint32_t encode_count = 0;
-    uint32_t playback_count = 0;
+// Entries in the metrics registry, registered in AudioService::Initialize()
+struct AudioServiceMetrics {
+    metric_t* input_frames = nullptr;
+    metric_t* encode_frames = nullptr;
+    metric_t* decode_frames = nullptr;
+    metric_t* playback_frames = nullptr;
+    metric_t* encode_us = nullptr;
+    metric_t* decode_us = nullptr;
+    metric_t* output_us = nullptr;
+    metric_t* encode_queue = nullptr;
+    metric_t* decode_queue = nullptr;
+    metric_t* playback_queue = nullptr;
+    metric_t* opus_complexity = nullptr;
 };
 
 class AudioService {
@@ -89,7 +142,7 @@ public:
     void Start();
     void Stop();
     void EncodeWakeWord();
-    std::unique_ptr<AudioStreamPacket> PopWakeWordPacket();
+    AudioStreamPacketPtr PopWakeWordPacket();
     const std::string& GetLastWakeWord() const;
     bool IsVoiceDetected() const { return voice_detected_; }
     bool IsIdle();
@@ -99,18 +152,32 @@ public:
 
     void EnableWakeWordDetection(bool enable);
     void EnableVoiceProcessing(bool enable);
-    void SetAfeOutputCallback(std::function<void(std::vector<int16_t>&&)> callback);
+    // Fan out processed PCM without copying, returns an id for RemovePcmTap()
+    int AddPcmTap(PcmTap tap);
+    void RemovePcmTap(int id);
     void EnableAudioTesting(bool enable);
     void EnableDeviceAec(bool enable);
 
     void SetCallbacks(AudioServiceCallbacks& callbacks);
+    // Plays through the tone lane of the mixer, returns at once
     void PlayTestTone(int freq_hz = 1000, int duration_ms = 200);
+    // Per lane playback gain, 0-100 percent
+    void SetMixerGain(AudioMixerLane lane, int percent);
 
-    bool PushPacketToDecodeQueue(std::unique_ptr<AudioStreamPacket> packet, bool wait = false);
-    std::unique_ptr<AudioStreamPacket> PopPacketFromSendQueue();
+    bool PushPacketToDecodeQueue(AudioStreamPacketPtr packet, bool wait = false);
+    // The server sent the last packet of a sentence or stopped speaking: the queued packets
+    // play out, then playback stops without concealment until the next packet
+    void EndDecodeStream();
+    AudioStreamPacketPtr PopPacketFromSendQueue();
     void PlaySound(const std::string_view& sound);
+    // Decode prompts into the PCM cache in a background task, so PlaySound() starts them without decoding
+    void PreloadSounds(std::vector<std::string_view> sounds);
     bool ReadAudioData(std::vector<int16_t>& data, int sample_rate, int samples);
     void ResetDecoder();
+    // 10, 20, 40 or 60 ms. Takes effect at the next AFE output frame, the encoder follows the frame size.
+    bool SetFrameDuration(int frame_duration_ms);
+    int frame_duration_ms() const { return frame_duration_ms_; }
+    JitterBufferStats GetJitterBufferStats();
     void SetModelsList(srmodel_list_t* models_list);
 
 private:
@@ -120,12 +187,27 @@ private:
     std::unique_ptr<WakeWord> wake_word_;
     std::unique_ptr<AudioDebugger> audio_debugger_;
     std::unique_ptr<OpusEncoderWrapper> opus_encoder_;
+    std::unique_ptr<OpusGovernor> opus_governor_;
     std::unique_ptr<OpusDecoderWrapper> opus_decoder_;
-    std::function<void(std::vector<int16_t>&&)> afe_output_callback_;
+    std::mutex pcm_taps_mutex_;
+    std::vector<std::pair<int, PcmTap>> pcm_taps_;
+    int next_pcm_tap_id_ = 1;
     OpusResampler input_resampler_;
     OpusResampler reference_resampler_;
     OpusResampler output_resampler_;
-    DebugStatistics debug_statistics_;
+    // Scratch buffers owned by the opus codec task
+    std::vector<int16_t> resample_buffer_;
+    std::vector<uint8_t> encoded_payload_;
+    std::vector<int16_t> encode_pcm_;       // encoder input, shared frames are read-only
+    // Decoder input and output: the wrapper takes plain vectors, pooled buffers may live in PSRAM
+    std::vector<uint8_t> decode_payload_;
+    std::vector<int16_t> decode_pcm_;
+    // Scratch arena owned by the audio input task, keeps its capacity between frames
+    std::vector<int16_t> input_buffer_;     // 16kHz frame fed to wake word / processor
+    std::vector<int16_t> input_raw_;        // interleaved block read from the codec
+    std::vector<int16_t> input_planar_;     // deinterleaved [mic | reference]
+    std::vector<int16_t> input_resampled_;  // resampled [mic | reference]
+    AudioServiceMetrics metrics_;
     srmodel_list_t* models_list_ = nullptr;
 
     EventGroupHandle_t event_group_;
@@ -134,19 +216,47 @@ private:
     TaskHandle_t audio_input_task_handle_ = nullptr;
     TaskHandle_t audio_output_task_handle_ = nullptr;
     TaskHandle_t opus_codec_task_handle_ = nullptr;
-    std::mutex audio_queue_mutex_;
-    std::condition_variable audio_queue_cv_;
-    std::deque<std::unique_ptr<AudioStreamPacket>> audio_decode_queue_;
-    std::deque<std::unique_ptr<AudioStreamPacket>> audio_send_queue_;
-    std::deque<std::unique_ptr<AudioStreamPacket>> audio_testing_queue_;
-    std::deque<std::unique_ptr<AudioTask>> audio_encode_queue_;
-    std::deque<std::unique_ptr<AudioTask>> audio_playback_queue_;
+    // The decode queue has several producers (network, audio testing), serialize them
+    std::mutex decode_producer_mutex_;
+    SpscQueue<AudioStreamPacketPtr, MAX_DECODE_PACKETS_IN_QUEUE> audio_decode_queue_;
+    JitterBuffer jitter_buffer_;
+    SpscQueue<AudioStreamPacketPtr, MAX_SEND_PACKETS_IN_QUEUE> audio_send_queue_;
+    SpscQueue<AudioStreamPacketPtr, AUDIO_TESTING_MAX_DURATION_MS / OPUS_MIN_FRAME_DURATION_MS> audio_testing_queue_;
+    // The encode queue has two producers (processor output, audio testing in the input task),
+    // the lock also covers the timestamp queue they pop from
+    std::mutex encode_producer_mutex_;
+    SpscQueue<AudioTaskPtr, MAX_ENCODE_TASKS_IN_QUEUE> audio_encode_queue_;
+    SpscQueue<AudioTaskPtr, MAX_PLAYBACK_TASKS_IN_QUEUE> audio_playback_queue_;
+    // Prompt and tone lanes, the queues share the decode queue producer lock
+    PromptCache prompt_cache_;
+    SpscQueue<PromptItem, MAX_PROMPTS_IN_QUEUE> prompt_queue_;
+    SpscQueue<ToneRequest, MAX_TONES_IN_QUEUE> tone_queue_;
+    std::atomic<bool> prompt_abort_{false};         // stops the prompt and tone lanes
+    // Mixer and lane state, opus codec task only
+    AudioMixer mixer_;
+    PromptItem prompt_playing_;
+    size_t prompt_position_ = 0;                    // sample for cached PCM, packet otherwise
+    std::unique_ptr<OpusDecoderWrapper> prompt_decoder_;
+    OpusResampler prompt_resampler_;
+    FrameRechunker<int16_t> prompt_pcm_;            // decoded prompt audio at the output rate
+    // Reused decoder input: Decode() takes a vector, the packet is copied in from flash and
+    // the capacity is kept, so a prompt of any length plays without heap allocations
+    std::vector<uint8_t> prompt_payload_;
+    std::vector<int16_t> prompt_decoded_;
+    std::vector<int16_t> prompt_lane_;
+    std::vector<int16_t> tone_lane_;
+    size_t tone_remaining_ = 0;
+    float tone_phase_ = 0;
+    float tone_step_ = 0;
     // For server AEC
-    std::deque<uint32_t> timestamp_queue_;
+    SpscQueue<uint32_t, MAX_TIMESTAMPS_IN_QUEUE> timestamp_queue_;
 
     bool wake_word_initialized_ = false;
     bool audio_processor_initialized_ = false;
     bool voice_detected_ = false;
+    std::atomic<int> frame_duration_ms_{OPUS_FRAME_DURATION_MS};
+    // End of the latest microphone read (ms since boot)
+    std::atomic<uint32_t> last_capture_ms_{0};
     bool service_stopped_ = true;
     bool audio_input_need_warmup_ = false;
 
@@ -158,8 +268,15 @@ private:
     void AudioOutputTask();
     void OpusCodecTask();
     void PushTaskToEncodeQueue(AudioTaskType type, std::vector<int16_t>&& pcm);
+    void PushTaskToEncodeQueue(AudioTaskPtr task);
+    void DispatchPcmFrame(std::vector<int16_t>&& pcm);
     void SetDecodeSampleRate(int sample_rate, int frame_duration);
+    size_t FillPromptLane(size_t samples);
+    size_t FillToneLane(size_t samples);
+    void UpdateOpusGovernor();
+    void ReconfigureEncoder(int frame_duration_ms);
     void CheckAndUpdateAudioPowerState();
+    void NotifyTask(TaskHandle_t task, uint32_t bits);
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,107 @@
+#include "audio_trace.h"
+
+#if CONFIG_AUDIO_TRACE
+
+#include <atomic>
+#include <cstdio>
+#include <esp_timer.h>
+#include <esp_heap_caps.h>
+#include <esp_log.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#define TAG "AudioTrace"
+
+// Power of two, so the monotonic write index maps to a slot with a mask
+#define AUDIO_TRACE_RECORDS (1 << CONFIG_AUDIO_TRACE_RING_ORDER)
+
+static audio_trace_record_t* trace_ring = nullptr;
+static std::atomic<uint32_t> trace_index{0};
+static std::atomic<bool> trace_paused{false};
+// Writers between their pause check and the end of their record
+static std::atomic<int> trace_writers{0};
+
+void audio_trace_init(void) {
+    if (trace_ring != nullptr) {
+        return;
+    }
+    trace_ring = (audio_trace_record_t*)heap_caps_calloc(AUDIO_TRACE_RECORDS, sizeof(audio_trace_record_t),
+        MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (trace_ring == nullptr) {
+        trace_ring = (audio_trace_record_t*)heap_caps_calloc(AUDIO_TRACE_RECORDS, sizeof(audio_trace_record_t),
+            MALLOC_CAP_8BIT);
+    }
+    if (trace_ring == nullptr) {
+        ESP_LOGE(TAG, "Failed to allocate %d trace records", AUDIO_TRACE_RECORDS);
+    }
+}
+
+void audio_trace_record(uint16_t point, uint16_t id) {
+    if (trace_ring == nullptr) {
+        return;
+    }
+    // Announce the write before checking the pause; audio_trace_dump does the reverse,
+    // so either the dump waits for this record or this record sees the pause
+    trace_writers.fetch_add(1);
+    if (trace_paused.load()) {
+        trace_writers.fetch_sub(1, std::memory_order_release);
+        return;
+    }
+    uint32_t index = trace_index.fetch_add(1, std::memory_order_relaxed);
+    audio_trace_record_t& record = trace_ring[index & (AUDIO_TRACE_RECORDS - 1)];
+    record.timestamp_us = (uint32_t)esp_timer_get_time();
+    record.point = point;
+    record.id = id;
+    trace_writers.fetch_sub(1, std::memory_order_release);
+}
+
+void audio_trace_dump(audio_trace_sink_t sink, void* arg) {
+    if (trace_ring == nullptr) {
+        return;
+    }
+    if (trace_paused.exchange(true)) {
+        ESP_LOGW(TAG, "Dump already in progress");
+        return;
+    }
+    while (trace_writers.load() > 0) {
+        vTaskDelay(1);
+    }
+
+    uint32_t end = trace_index.load();
+    uint32_t count = end < AUDIO_TRACE_RECORDS ? end : AUDIO_TRACE_RECORDS;
+    audio_trace_header_t header = {AUDIO_TRACE_MAGIC, AUDIO_TRACE_VERSION, sizeof(audio_trace_record_t), count};
+    sink(&header, sizeof(header), arg);
+
+    // Oldest first, in two contiguous runs
+    uint32_t start = end - count;
+    uint32_t first = start & (AUDIO_TRACE_RECORDS - 1);
+    uint32_t first_count = count < AUDIO_TRACE_RECORDS - first ? count : AUDIO_TRACE_RECORDS - first;
+    sink(&trace_ring[first], first_count * sizeof(audio_trace_record_t), arg);
+    if (count > first_count) {
+        sink(&trace_ring[0], (count - first_count) * sizeof(audio_trace_record_t), arg);
+    }
+
+    trace_paused.store(false);
+}
+
+static void UartSink(const void* data, size_t len, void* arg) {
+    const uint8_t* bytes = (const uint8_t*)data;
+    while (len > 0) {
+        size_t line = len < 64 ? len : 64;
+        printf("AUDIO_TRACE ");
+        for (size_t i = 0; i < line; i++) {
+            printf("%02x", bytes[i]);
+        }
+        printf("\n");
+        bytes += line;
+        len -= line;
+    }
+}
+
+void audio_trace_dump_uart(void) {
+    printf("AUDIO_TRACE BEGIN\n");
+    audio_trace_dump(UartSink, nullptr);
+    printf("AUDIO_TRACE END\n");
+}
+
+#endif // CONFIG_AUDIO_TRACE
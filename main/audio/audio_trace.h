@@ -0,0 +1,90 @@
+#ifndef AUDIO_TRACE_H
+#define AUDIO_TRACE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Per-frame latency trace points for the audio pipeline.
+ *
+ * Records are 8 bytes (microsecond timestamp, trace point, frame id) written into a
+ * lock-free ring shared by all tasks; the oldest records are overwritten. Paired
+ * points (*_START / *_END, queue PUSH / POP) use the same id so the host script
+ * scripts/audio_trace.py can turn a dump into Chrome trace JSON and per-stage
+ * latency percentiles.
+ *
+ * Compiled out unless CONFIG_AUDIO_TRACE is enabled.
+ */
+
+enum AudioTracePoint {
+    // Uplink
+    AUDIO_TRACE_I2S_READ_START = 0,
+    AUDIO_TRACE_I2S_READ_END,
+    AUDIO_TRACE_AFE_FEED,
+    AUDIO_TRACE_AFE_FETCH,
+    AUDIO_TRACE_ENCODE_QUEUE_PUSH,
+    AUDIO_TRACE_ENCODE_QUEUE_POP,
+    AUDIO_TRACE_ENCODE_START,
+    AUDIO_TRACE_ENCODE_END,
+    AUDIO_TRACE_WS_SEND_START,
+    AUDIO_TRACE_WS_SEND_END,
+    // Downlink
+    AUDIO_TRACE_DECODE_QUEUE_PUSH,
+    AUDIO_TRACE_DECODE_QUEUE_POP,
+    AUDIO_TRACE_DECODE_START,
+    AUDIO_TRACE_DECODE_END,
+    AUDIO_TRACE_PLAYBACK_QUEUE_PUSH,
+    AUDIO_TRACE_PLAYBACK_QUEUE_POP,
+    AUDIO_TRACE_OUTPUT_START,
+    AUDIO_TRACE_OUTPUT_END,
+    AUDIO_TRACE_POINT_COUNT,
+};
+
+typedef struct {
+    uint32_t timestamp_us;
+    uint16_t point;
+    uint16_t id;
+} __attribute__((packed)) audio_trace_record_t;
+
+// Dump format: audio_trace_header_t followed by count records, little endian
+#define AUDIO_TRACE_MAGIC   0x43525441  // "ATRC"
+#define AUDIO_TRACE_VERSION 1
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t record_size;
+    uint32_t count;
+} __attribute__((packed)) audio_trace_header_t;
+
+typedef void (*audio_trace_sink_t)(const void *data, size_t len, void *arg);
+
+#if CONFIG_AUDIO_TRACE
+// Allocates the ring (PSRAM when available). Call once before the audio tasks start;
+// records made before it are dropped.
+void audio_trace_init(void);
+void audio_trace_record(uint16_t point, uint16_t id);
+// Writes the ring (oldest first) to sink. Recording is paused and records in flight are
+// waited for first, so the dump holds only complete records; points traced during the dump
+// are lost. A dump started while another one runs returns without calling sink.
+void audio_trace_dump(audio_trace_sink_t sink, void *arg);
+// Prints the dump as "AUDIO_TRACE <hex>" lines on the console
+void audio_trace_dump_uart(void);
+#define AUDIO_TRACE(point, id) audio_trace_record((point), (uint16_t)(id))
+#else
+static inline void audio_trace_init(void) {}
+static inline void audio_trace_dump(audio_trace_sink_t sink, void *arg) {}
+static inline void audio_trace_dump_uart(void) {}
+#define AUDIO_TRACE(point, id) do {} while (0)
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // AUDIO_TRACE_H
@@ -0,0 +1,203 @@
+#include "file_audio_codec.h"
+
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <freertos/task.h>
+#include <cstring>
+
+#define TAG "FileAudioCodec"
+
+struct WavChunkHeader {
+    char id[4];
+    uint32_t size;
+} __attribute__((packed));
+
+struct WavFormat {
+    uint16_t audio_format;
+    uint16_t channels;
+    uint32_t sample_rate;
+    uint32_t byte_rate;
+    uint16_t block_align;
+    uint16_t bits_per_sample;
+} __attribute__((packed));
+
+FileAudioCodec::FileAudioCodec(const std::string& input_path, const std::string& output_path,
+    int output_sample_rate, bool realtime, bool loop) : realtime_(realtime), loop_(loop) {
+    duplex_ = true;
+    input_reference_ = false;
+    input_channels_ = 1;
+    input_sample_rate_ = 16000;
+    output_sample_rate_ = output_sample_rate;
+
+    if (!input_path.empty() && !OpenInput(input_path)) {
+        ESP_LOGE(TAG, "Failed to open input %s, reading silence", input_path.c_str());
+    }
+    if (!output_path.empty() && !OpenOutput(output_path)) {
+        ESP_LOGE(TAG, "Failed to open output %s, discarding playback", output_path.c_str());
+    }
+}
+
+FileAudioCodec::~FileAudioCodec() {
+    if (input_file_ != nullptr) {
+        fclose(input_file_);
+    }
+    if (output_file_ != nullptr) {
+        FinalizeOutput();
+        fclose(output_file_);
+    }
+}
+
+bool FileAudioCodec::OpenInput(const std::string& path) {
+    input_file_ = fopen(path.c_str(), "rb");
+    if (input_file_ == nullptr) {
+        return false;
+    }
+
+    char riff[12];
+    if (fread(riff, 1, sizeof(riff), input_file_) != sizeof(riff) ||
+        memcmp(riff, "RIFF", 4) != 0 || memcmp(riff + 8, "WAVE", 4) != 0) {
+        ESP_LOGE(TAG, "%s is not a WAV file", path.c_str());
+        fclose(input_file_);
+        input_file_ = nullptr;
+        return false;
+    }
+
+    WavFormat format = {};
+    bool has_format = false;
+    WavChunkHeader chunk;
+    while (fread(&chunk, 1, sizeof(chunk), input_file_) == sizeof(chunk)) {
+        if (memcmp(chunk.id, "fmt ", 4) == 0) {
+            if (chunk.size < sizeof(format) || fread(&format, 1, sizeof(format), input_file_) != sizeof(format)) {
+                break;
+            }
+            fseek(input_file_, chunk.size - sizeof(format) + (chunk.size & 1), SEEK_CUR);
+            has_format = true;
+        } else if (memcmp(chunk.id, "data", 4) == 0) {
+            if (!has_format || format.audio_format != 1 || format.bits_per_sample != 16 ||
+                format.channels < 1 || format.channels > 2) {
+                ESP_LOGE(TAG, "%s must be 16-bit PCM, mono or stereo", path.c_str());
+                break;
+            }
+            input_data_offset_ = ftell(input_file_);
+            input_sample_rate_ = format.sample_rate;
+            input_channels_ = format.channels;
+            input_reference_ = format.channels == 2;
+            ESP_LOGI(TAG, "Input %s: %lu Hz, %d channels", path.c_str(), format.sample_rate, format.channels);
+            return true;
+        } else {
+            fseek(input_file_, chunk.size + (chunk.size & 1), SEEK_CUR);
+        }
+    }
+
+    fclose(input_file_);
+    input_file_ = nullptr;
+    return false;
+}
+
+bool FileAudioCodec::OpenOutput(const std::string& path) {
+    output_file_ = fopen(path.c_str(), "wb");
+    if (output_file_ == nullptr) {
+        return false;
+    }
+    output_data_bytes_ = 0;
+    FinalizeOutput();
+    return true;
+}
+
+// Write (or rewrite) the header with the current data size, so the file is playable at any time
+void FileAudioCodec::FinalizeOutput() {
+    struct {
+        char riff[4];
+        uint32_t riff_size;
+        char wave[4];
+        WavChunkHeader fmt_header;
+        WavFormat fmt;
+        WavChunkHeader data_header;
+    } __attribute__((packed)) header = {
+        {'R', 'I', 'F', 'F'}, 36 + output_data_bytes_, {'W', 'A', 'V', 'E'},
+        {{'f', 'm', 't', ' '}, sizeof(WavFormat)},
+        {1, 1, (uint32_t)output_sample_rate_, (uint32_t)output_sample_rate_ * 2, 2, 16},
+        {{'d', 'a', 't', 'a'}, output_data_bytes_},
+    };
+    long position = ftell(output_file_);
+    fseek(output_file_, 0, SEEK_SET);
+    fwrite(&header, 1, sizeof(header), output_file_);
+    if (position > (long)sizeof(header)) {
+        fseek(output_file_, position, SEEK_SET);
+    }
+    fflush(output_file_);
+}
+
+void FileAudioCodec::Pace(int64_t& start_us, int64_t& samples, int count, int sample_rate) {
+    if (!realtime_) {
+        return;
+    }
+    int64_t now = esp_timer_get_time();
+    if (start_us == 0) {
+        start_us = now;
+    }
+    samples += count;
+    int64_t due_us = start_us + samples * 1000000 / sample_rate;
+    if (due_us > now) {
+        vTaskDelay(pdMS_TO_TICKS((due_us - now) / 1000));
+    } else if (now - due_us > 1000000) {
+        // Fell behind by more than a second (the pipeline was paused), resync
+        start_us = now;
+        samples = 0;
+    }
+}
+
+void FileAudioCodec::SetOutputVolume(int volume) {
+    // Files are written unscaled, do not persist the volume in NVS either
+    output_volume_ = volume;
+}
+
+void FileAudioCodec::EnableInput(bool enable) {
+    if (enable && !input_enabled_) {
+        input_start_us_ = 0;
+        input_samples_ = 0;
+    }
+    AudioCodec::EnableInput(enable);
+}
+
+void FileAudioCodec::EnableOutput(bool enable) {
+    if (enable && !output_enabled_) {
+        output_start_us_ = 0;
+        output_samples_ = 0;
+    }
+    if (!enable && output_file_ != nullptr) {
+        FinalizeOutput();
+    }
+    AudioCodec::EnableOutput(enable);
+}
+
+void FileAudioCodec::Start() {
+    EnableInput(true);
+    EnableOutput(true);
+    ESP_LOGI(TAG, "File audio codec started (%s)", realtime_ ? "realtime" : "as fast as possible");
+}
+
+int FileAudioCodec::Read(int16_t* dest, int samples) {
+    int read = 0;
+    if (input_file_ != nullptr) {
+        read = fread(dest, sizeof(int16_t), samples, input_file_);
+        if (read < samples && loop_) {
+            fseek(input_file_, input_data_offset_, SEEK_SET);
+            read += fread(dest + read, sizeof(int16_t), samples - read, input_file_);
+        }
+    }
+    if (read < samples) {
+        memset(dest + read, 0, (samples - read) * sizeof(int16_t));
+    }
+    Pace(input_start_us_, input_samples_, samples / input_channels_, input_sample_rate_);
+    return samples;
+}
+
+int FileAudioCodec::Write(const int16_t* data, int samples) {
+    if (output_file_ != nullptr) {
+        size_t written = fwrite(data, sizeof(int16_t), samples, output_file_);
+        output_data_bytes_ += written * sizeof(int16_t);
+    }
+    Pace(output_start_us_, output_samples_, samples, output_sample_rate_);
+    return samples;
+}
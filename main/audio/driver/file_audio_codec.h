@@ -0,0 +1,51 @@
+#ifndef _FILE_AUDIO_CODEC_H
+#define _FILE_AUDIO_CODEC_H
+
+#include "audio_codec.h"
+
+#include <cstdio>
+#include <string>
+
+/*
+ * AudioCodec backed by 16-bit PCM WAV files instead of I2S, so the audio pipeline can be
+ * driven from recordings (SD card / SPIFFS / semihosting, or a host build of the pipeline).
+ *
+ * Input is read from input_path; its sample rate and channel count (1, or 2 with the
+ * reference on the second channel) come from the WAV header. After the end of the file
+ * the codec returns silence, or starts over when loop is set. Output is written to
+ * output_path as mono WAV. In realtime mode Read / Write are paced to the sample rate,
+ * otherwise they run as fast as possible for throughput benchmarks.
+ */
+class FileAudioCodec : public AudioCodec {
+private:
+    FILE* input_file_ = nullptr;
+    FILE* output_file_ = nullptr;
+    long input_data_offset_ = 0;
+    uint32_t output_data_bytes_ = 0;
+    bool realtime_;
+    bool loop_;
+    int64_t input_start_us_ = 0;
+    int64_t input_samples_ = 0;
+    int64_t output_start_us_ = 0;
+    int64_t output_samples_ = 0;
+
+    bool OpenInput(const std::string& path);
+    bool OpenOutput(const std::string& path);
+    void FinalizeOutput();
+    void Pace(int64_t& start_us, int64_t& samples, int count, int sample_rate);
+
+    virtual int Read(int16_t* dest, int samples) override;
+    virtual int Write(const int16_t* data, int samples) override;
+
+public:
+    FileAudioCodec(const std::string& input_path, const std::string& output_path,
+        int output_sample_rate, bool realtime = true, bool loop = false);
+    virtual ~FileAudioCodec();
+
+    virtual void SetOutputVolume(int volume) override;
+    virtual void EnableInput(bool enable) override;
+    virtual void EnableOutput(bool enable) override;
+    virtual void Start() override;
+};
+
+#endif // _FILE_AUDIO_CODEC_H
@@ -0,0 +1,30 @@
+#ifndef _I2S_SAMPLE_CONVERT_H
+#define _I2S_SAMPLE_CONVERT_H
+
+#include <algorithm>
+#include <cstdint>
+
+// Sample conversion between 16-bit PCM and the 32-bit I2S slot used by NoAudioCodec.
+// Kept out of no_audio_codec.cc so the host tests can check them without the I2S driver.
+//
+// Portable C only, there is no ESP32-S3 PIE (EE.*) variant. Each loop is a shift, or a
+// shift and a clamp, per sample; the scaled output, the part with arithmetic, is done by
+// OutputStage straight into the slot. A PIE kernel could be neither built nor compared
+// bit for bit against these loops without the Xtensa toolchain and a board, and the host
+// test cannot execute it, so it is left out rather than shipped unverified.
+
+// 16-bit samples to the left-justified 32-bit I2S slot
+inline void ConvertToI2s(const int16_t* in, int32_t* out, int samples) {
+    for (int i = 0; i < samples; i++) {
+        out[i] = (int32_t)in[i] * 65536;
+    }
+}
+
+// 32-bit I2S slot to 16-bit samples, saturated to +/-INT16_MAX
+inline void ConvertFromI2s(const int32_t* in, int16_t* out, int samples) {
+    for (int i = 0; i < samples; i++) {
+        out[i] = (int16_t)std::min(std::max(in[i] >> 12, (int32_t)-INT16_MAX), (int32_t)INT16_MAX);
+    }
+}
+
+#endif // _I2S_SAMPLE_CONVERT_H
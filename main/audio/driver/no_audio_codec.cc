@@ -1,11 +1,17 @@
 #include "no_audio_codec.h"
+#include "i2s_sample_convert.h"
 
 #include <esp_log.h>
-#include <cmath>
+#include <algorithm>
 #include <cstring>
 
 #define TAG "NoAudioCodec"
 
+NoAudioCodec::NoAudioCodec() {
+    // No codec chip, the volume is applied by the output stage
+    software_volume_ = true;
+}
+
 NoAudioCodec::~NoAudioCodec() {
     if (rx_handle_ != nullptr) {
         ESP_ERROR_CHECK(i2s_channel_disable(rx_handle_));
@@ -356,43 +362,46 @@ NoAudioCodecSimplexPdm::NoAudioCodecSimplexPdm(int input_sample_rate, int output
     ESP_LOGI(TAG, "Simplex channels created");
 }
 
+void NoAudioCodec::OutputData(AudioPcmBuffer& data) {
+    std::lock_guard<std::mutex> lock(data_if_mutex_);
+    if (tx_buffer_.size() < data.size()) {
+        tx_buffer_.resize(data.size());
+    }
+    // Volume and limiter go straight into the 32-bit slot, so a low volume keeps the
+    // bits a 16-bit intermediate would round away
+    output_stage_.Process(data.data(), tx_buffer_.data(), data.size(), output_volume_,
+        output_sample_rate_ * output_channels_);
+    WriteSlots(data.size());
+}
+
 int NoAudioCodec::Write(const int16_t* data, int samples) {
     std::lock_guard<std::mutex> lock(data_if_mutex_);
-    std::vector<int32_t> buffer(samples);
-
-    // output_volume_: 0-100
-    // volume_factor_: 0-65536
-    int32_t volume_factor = pow(double(output_volume_) / 100.0, 2) * 65536;
-    for (int i = 0; i < samples; i++) {
-        int64_t temp = int64_t(data[i]) * volume_factor; // 使用 int64_t 进行乘法运算
-        if (temp > INT32_MAX) {
-            buffer[i] = INT32_MAX;
-        } else if (temp < INT32_MIN) {
-            buffer[i] = INT32_MIN;
-        } else {
-            buffer[i] = static_cast<int32_t>(temp);
-        }
+    if (tx_buffer_.size() < (size_t)samples) {
+        tx_buffer_.resize(samples);
     }
+    ConvertToI2s(data, tx_buffer_.data(), samples);
+    return WriteSlots(samples);
+}
 
+int NoAudioCodec::WriteSlots(int samples) {
     size_t bytes_written;
-    ESP_ERROR_CHECK(i2s_channel_write(tx_handle_, buffer.data(), samples * sizeof(int32_t), &bytes_written, portMAX_DELAY));
+    ESP_ERROR_CHECK(i2s_channel_write(tx_handle_, tx_buffer_.data(), samples * sizeof(int32_t), &bytes_written, portMAX_DELAY));
     return bytes_written / sizeof(int32_t);
 }
 
 int NoAudioCodec::Read(int16_t* dest, int samples) {
     size_t bytes_read;
 
-    std::vector<int32_t> bit32_buffer(samples);
-    if (i2s_channel_read(rx_handle_, bit32_buffer.data(), samples * sizeof(int32_t), &bytes_read, portMAX_DELAY) != ESP_OK) {
+    if (rx_buffer_.size() < (size_t)samples) {
+        rx_buffer_.resize(samples);
+    }
+    if (i2s_channel_read(rx_handle_, rx_buffer_.data(), samples * sizeof(int32_t), &bytes_read, portMAX_DELAY) != ESP_OK) {
         ESP_LOGE(TAG, "Read Failed!");
         return 0;
     }
 
     samples = bytes_read / sizeof(int32_t);
-    for (int i = 0; i < samples; i++) {
-        int32_t value = bit32_buffer[i] >> 12;
-        dest[i] = (value > INT16_MAX) ? INT16_MAX : (value < -INT16_MAX) ? -INT16_MAX : (int16_t)value;
-    }
+    ConvertFromI2s(rx_buffer_.data(), dest, samples);
     return samples;
 }
 
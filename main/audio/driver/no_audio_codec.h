@@ -6,8 +6,17 @@
 #include <driver/gpio.h>
 #include <driver/i2s_pdm.h>
 #include <mutex>
+#include <vector>
 
 class NoAudioCodec : public AudioCodec {
+private:
+    // 32-bit I2S slot buffers, kept between calls and only grown
+    std::vector<int32_t> tx_buffer_;
+    std::vector<int32_t> rx_buffer_;
+
+    // Writes the first samples of tx_buffer_, data_if_mutex_ held
+    int WriteSlots(int samples);
+
 protected:
     std::mutex data_if_mutex_;
 
@@ -15,7 +24,10 @@ protected:
     virtual int Read(int16_t* dest, int samples) override;
 
 public:
+    NoAudioCodec();
     virtual ~NoAudioCodec();
+
+    virtual void OutputData(AudioPcmBuffer& data) override;
 };
 
 class NoAudioCodecDuplex : public NoAudioCodec {
@@ -0,0 +1,142 @@
+#ifndef FRAME_RECHUNKER_H
+#define FRAME_RECHUNKER_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+/*
+ * Fixed-capacity circular buffer that turns blocks of arbitrary size into frames of
+ * exactly frame_size() samples.
+ *
+ * Storage is allocated once in Initialize(). Push() copies into the ring, Drain()
+ * hands out complete frames as (pointer, count) views: straight into the ring when
+ * the frame is contiguous, through a preallocated scratch frame when it wraps. No
+ * samples are moved around and nothing is reallocated after Initialize().
+ *
+ * When a push does not fit, the oldest samples are overwritten and counted in
+ * dropped(), so the ring always holds the latest capacity() samples. That makes it
+ * usable as a pre-roll history as well as a re-chunker.
+ *
+ * Not thread safe, Push() and Drain() belong to one task. SetFrameSize() takes effect
+ * with the next frame, samples already buffered are kept. Allocator picks where the
+ * ring lives, e.g. PsramAllocator for long pre-roll histories.
+ */
+template <typename T, typename Allocator = std::allocator<T>>
+class FrameRechunker {
+public:
+    static_assert(std::is_trivially_copyable<T>::value, "FrameRechunker copies samples with memcpy");
+
+    FrameRechunker() = default;
+    FrameRechunker(const FrameRechunker&) = delete;
+    FrameRechunker& operator=(const FrameRechunker&) = delete;
+
+    // capacity must be at least the largest frame size plus the largest block pushed at once,
+    // max_frame_size bounds SetFrameSize() and sizes the scratch frame (0: capacity)
+    void Initialize(size_t capacity, size_t frame_size, size_t max_frame_size = 0) {
+        ring_.assign(capacity, T());
+        scratch_.assign(max_frame_size > 0 ? std::min(max_frame_size, capacity) : capacity, T());
+        head_ = 0;
+        size_ = 0;
+        dropped_ = 0;
+        SetFrameSize(frame_size);
+    }
+
+    // Returns false when frame_size is 0 or larger than the scratch frame
+    bool SetFrameSize(size_t frame_size) {
+        if (frame_size == 0 || frame_size > scratch_.size()) {
+            return false;
+        }
+        frame_size_ = frame_size;
+        return true;
+    }
+
+    void Push(const T* data, size_t count) {
+        size_t capacity = ring_.size();
+        if (capacity == 0) {
+            dropped_ += count;
+            return;
+        }
+        if (count > capacity) {
+            dropped_ += count - capacity;
+            data += count - capacity;
+            count = capacity;
+        }
+        if (size_ + count > capacity) {
+            size_t overflow = size_ + count - capacity;
+            head_ = Wrap(head_ + overflow);
+            size_ -= overflow;
+            dropped_ += overflow;
+        }
+        size_t tail = Wrap(head_ + size_);
+        size_t first = std::min(count, capacity - tail);
+        memcpy(&ring_[tail], data, first * sizeof(T));
+        memcpy(&ring_[0], data + first, (count - first) * sizeof(T));
+        size_ += count;
+    }
+
+    // Calls on_frame(const T* frame, size_t frame_size) for every complete frame, returns the frame count.
+    // The view is only valid during the call.
+    template <typename F>
+    size_t Drain(F&& on_frame) {
+        size_t frames = 0;
+        while (size_ >= frame_size_) {
+            size_t frame_size = frame_size_;
+            on_frame(Peek(scratch_.data(), frame_size), frame_size);
+            Skip(frame_size);
+            frames++;
+        }
+        return frames;
+    }
+
+    // Copies the oldest count samples to out without consuming them, count <= size()
+    void Copy(T* out, size_t count) const {
+        size_t first = std::min(count, ring_.size() - head_);
+        memcpy(out, &ring_[head_], first * sizeof(T));
+        memcpy(out + first, &ring_[0], (count - first) * sizeof(T));
+    }
+
+    void Skip(size_t count) {
+        count = std::min(count, size_);
+        head_ = Wrap(head_ + count);
+        size_ -= count;
+    }
+
+    void Clear() {
+        head_ = 0;
+        size_ = 0;
+    }
+
+    size_t size() const { return size_; }
+    size_t capacity() const { return ring_.size(); }
+    size_t frame_size() const { return frame_size_; }
+    // Samples overwritten or rejected because the ring was full
+    uint32_t dropped() const { return dropped_; }
+
+private:
+    std::vector<T, Allocator> ring_;
+    std::vector<T, Allocator> scratch_;
+    size_t head_ = 0;
+    size_t size_ = 0;
+    size_t frame_size_ = 0;
+    uint32_t dropped_ = 0;
+
+    size_t Wrap(size_t index) const {
+        return index >= ring_.size() ? index - ring_.size() : index;
+    }
+
+    // Contiguous view of the oldest count samples, copied to scratch only when they wrap
+    const T* Peek(T* scratch, size_t count) const {
+        if (head_ + count <= ring_.size()) {
+            return &ring_[head_];
+        }
+        Copy(scratch, count);
+        return scratch;
+    }
+};
+
+#endif // FRAME_RECHUNKER_H
@@ -0,0 +1,135 @@
+#include "jitter_buffer.h"
+
+#include <algorithm>
+#include <esp_log.h>
+
+#define TAG "JitterBuffer"
+
+JitterBuffer::JitterBuffer()
+    : base_target_ms_(CONFIG_AUDIO_JITTER_TARGET_MS),
+      max_target_ms_(CONFIG_AUDIO_JITTER_MAX_MS),
+      max_conceal_frames_(CONFIG_AUDIO_JITTER_MAX_CONCEAL_FRAMES),
+      frame_duration_ms_(60) {
+}
+
+int JitterBuffer::TargetMs() const {
+    // Twice the smoothed late arrival covers most bursts, rounded up to whole frames
+    int target_ms = base_target_ms_ + 2 * jitter_us_ / 1000;
+    int frames = (target_ms + frame_duration_ms_ - 1) / frame_duration_ms_;
+    frames = std::max(frames, 1);
+    frames = std::min(frames, std::max(max_target_ms_ / frame_duration_ms_, 1));
+    return frames * frame_duration_ms_;
+}
+
+void JitterBuffer::OnArrival(int64_t now_us, int frame_duration_ms) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (frame_duration_ms > 0) {
+        frame_duration_ms_ = frame_duration_ms;
+    }
+    if (last_arrival_us_ != 0) {
+        // Only late packets cause underruns, early (bursty) ones just sit in the queue
+        int64_t late_us = (now_us - last_arrival_us_) - frame_duration_ms_ * 1000;
+        if (late_us <= max_target_ms_ * 1000LL) {
+            int32_t sample = late_us > 0 ? (int32_t)late_us : 0;
+            jitter_us_ += (sample - jitter_us_) / 16;
+        }
+        // A longer gap is a new utterance, not jitter
+    }
+    last_arrival_us_ = now_us;
+    end_of_stream_ = false;
+    if (state_ == kStateBuffering && buffering_since_us_ == 0) {
+        buffering_since_us_ = now_us;
+    }
+}
+
+void JitterBuffer::OnEndOfStream() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    end_of_stream_ = true;
+}
+
+JitterBufferAction JitterBuffer::OnPlayout(size_t depth, bool playback_empty, int64_t now_us) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats_.depth = depth;
+
+    if (state_ == kStateBuffering) {
+        if (depth == 0) {
+            return kJitterBufferWait;
+        }
+        if (buffering_since_us_ == 0) {
+            // Packets moved in without OnArrival (audio testing loopback)
+            buffering_since_us_ = now_us;
+        }
+        int target_ms = TargetMs();
+        if ((int)depth * frame_duration_ms_ < target_ms && now_us - buffering_since_us_ < target_ms * 1000LL) {
+            return kJitterBufferWait;
+        }
+        state_ = kStatePlaying;
+        concealed_run_ = 0;
+        late_debt_ = 0;
+        buffering_since_us_ = 0;
+        ESP_LOGD(TAG, "Start playout, depth=%u target=%dms", (unsigned int)depth, target_ms);
+    }
+
+    if (depth > 0) {
+        if (concealed_run_ > 0) {
+            stats_.late_packets++;
+            late_debt_ += concealed_run_;
+            concealed_run_ = 0;
+        }
+        // The oldest packets belong to slots that were concealed, skip them while newer ones
+        // wait behind. A single packet is played late instead, dropping it would underrun again.
+        if (late_debt_ > 0 && depth > 1) {
+            late_debt_--;
+            stats_.dropped_packets++;
+            return kJitterBufferDrop;
+        }
+        return kJitterBufferDecode;
+    }
+
+    // Underrun, only fill in when the speaker is about to run dry
+    if (!playback_empty) {
+        return kJitterBufferWait;
+    }
+    // A packet overdue by more than the target delay is the end of the utterance rather than jitter
+    int64_t overdue_us = now_us - last_arrival_us_ - frame_duration_ms_ * 1000LL;
+    bool ended = end_of_stream_ || (last_arrival_us_ != 0 && overdue_us > TargetMs() * 1000LL);
+    if (!ended && concealed_run_ < max_conceal_frames_) {
+        if (concealed_run_ == 0) {
+            stats_.underruns++;
+        }
+        concealed_run_++;
+        stats_.concealed_frames++;
+        return kJitterBufferConceal;
+    }
+    state_ = kStateBuffering;
+    concealed_run_ = 0;
+    late_debt_ = 0;
+    return kJitterBufferWait;
+}
+
+int64_t JitterBuffer::GetTimeoutUs(int64_t now_us) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (state_ != kStateBuffering || buffering_since_us_ == 0) {
+        return -1;
+    }
+    int64_t deadline_us = buffering_since_us_ + TargetMs() * 1000LL;
+    return std::max<int64_t>(deadline_us - now_us, 0);
+}
+
+void JitterBuffer::Reset() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    state_ = kStateBuffering;
+    concealed_run_ = 0;
+    late_debt_ = 0;
+    end_of_stream_ = false;
+    buffering_since_us_ = 0;
+    last_arrival_us_ = 0;
+}
+
+JitterBufferStats JitterBuffer::GetStats() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    JitterBufferStats stats = stats_;
+    stats.target_ms = TargetMs();
+    stats.jitter_ms = jitter_us_ / 1000;
+    return stats;
+}
@@ -0,0 +1,83 @@
+#ifndef JITTER_BUFFER_H
+#define JITTER_BUFFER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+/*
+ * Playout policy for the downlink decode queue.
+ *
+ * The packets themselves stay in the decode queue, this class only decides when the
+ * opus codec task may take one out:
+ *   - after an underrun it waits until the queue holds the target playout delay
+ *     (or the first packet has waited that long, so short sounds still play)
+ *   - while playing, an empty queue is bridged with concealed frames (Opus PLC)
+ *     for a few frames before falling back to buffering
+ *   - no concealment once the stream has ended: after OnEndOfStream() (the server
+ *     finished a sentence or stopped speaking), or once the next packet is overdue by
+ *     more than the target delay, the queue just plays out and the next packet rebuffers
+ *   - packets that arrive late for slots already concealed are dropped while newer
+ *     ones are queued behind them, so the playout delay does not grow with every
+ *     underrun
+ *
+ * The target delay grows and shrinks with the measured arrival jitter, the new
+ * target takes effect at the next rebuffer so playback is never cut.
+ */
+
+enum JitterBufferAction {
+    kJitterBufferWait,
+    kJitterBufferDecode,
+    kJitterBufferConceal,
+    kJitterBufferDrop,      // take the oldest packet out and discard it, its slot was concealed
+};
+
+struct JitterBufferStats {
+    uint32_t depth = 0;
+    uint32_t target_ms = 0;
+    uint32_t jitter_ms = 0;
+    uint32_t late_packets = 0;      // arrived after their slot had been concealed
+    uint32_t dropped_packets = 0;   // late packets discarded to keep the playout delay
+    uint32_t concealed_frames = 0;
+    uint32_t underruns = 0;
+};
+
+class JitterBuffer {
+public:
+    JitterBuffer();
+
+    // Producer side, called for every packet pushed to the decode queue
+    void OnArrival(int64_t now_us, int frame_duration_ms);
+    // Producer side, the server sent the last packet of a sentence or stopped speaking
+    void OnEndOfStream();
+    // Consumer side, depth is the number of packets in the decode queue
+    JitterBufferAction OnPlayout(size_t depth, bool playback_empty, int64_t now_us);
+    // Microseconds until OnPlayout may change its mind without a new packet, -1 if never
+    int64_t GetTimeoutUs(int64_t now_us);
+    void Reset();
+    JitterBufferStats GetStats();
+
+private:
+    enum State {
+        kStateBuffering,
+        kStatePlaying,
+    };
+
+    std::mutex mutex_;
+    State state_ = kStateBuffering;
+    int base_target_ms_;
+    int max_target_ms_;
+    int max_conceal_frames_;
+    int frame_duration_ms_;
+    int64_t last_arrival_us_ = 0;
+    int64_t buffering_since_us_ = 0;
+    int32_t jitter_us_ = 0;
+    int concealed_run_ = 0;
+    int late_debt_ = 0;             // concealed slots whose packets may still arrive
+    bool end_of_stream_ = false;
+    JitterBufferStats stats_;
+
+    int TargetMs() const;
+};
+
+#endif // JITTER_BUFFER_H
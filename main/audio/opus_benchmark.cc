@@ -0,0 +1,61 @@
+#include "opus_benchmark.h"
+
+#include <algorithm>
+#include <cmath>
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <opus_encoder.h>
+
+#define TAG "OpusBenchmark"
+
+static std::vector<int16_t> SpeechLikeSignal(size_t samples) {
+    std::vector<int16_t> pcm(samples);
+    uint32_t noise = 12345;
+    for (size_t i = 0; i < samples; i++) {
+        double t = i / 16000.0;
+        double envelope = 0.5 + 0.5 * sin(2 * M_PI * 4 * t);
+        double voice = 0;
+        for (int harmonic = 1; harmonic <= 8; harmonic++) {
+            voice += sin(2 * M_PI * 150 * harmonic * t) / harmonic;
+        }
+        noise = noise * 1103515245 + 12345;
+        int dither = (int)((noise >> 16) & 0x1FF) - 256;
+        pcm[i] = (int16_t)(6000 * envelope * voice / 2 + dither);
+    }
+    return pcm;
+}
+
+std::vector<OpusBenchmarkResult> RunOpusEncodeBenchmark(int frame_duration_ms, int frames,
+    int min_complexity, int max_complexity) {
+    std::vector<OpusBenchmarkResult> results;
+    size_t frame_samples = 16000 / 1000 * frame_duration_ms;
+    auto signal = SpeechLikeSignal(frame_samples * frames);
+    std::vector<int16_t> pcm;
+    std::vector<uint8_t> opus;
+    pcm.reserve(frame_samples);
+
+    for (int complexity = min_complexity; complexity <= max_complexity; complexity++) {
+        OpusEncoderWrapper encoder(16000, 1, frame_duration_ms);
+        encoder.SetComplexity(complexity);
+        encoder.SetDtx(false);
+        int64_t total_us = 0;
+        int64_t max_us = 0;
+        for (int frame = 0; frame < frames; frame++) {
+            pcm.assign(signal.begin() + frame * frame_samples, signal.begin() + (frame + 1) * frame_samples);
+            int64_t start = esp_timer_get_time();
+            encoder.Encode(std::move(pcm), opus);
+            int64_t us = esp_timer_get_time() - start;
+            total_us += us;
+            max_us = std::max(max_us, us);
+        }
+        OpusBenchmarkResult result;
+        result.complexity = complexity;
+        result.avg_us = frames > 0 ? total_us / frames : 0;
+        result.max_us = max_us;
+        result.avg_share_percent = result.avg_us * 100 / (frame_duration_ms * 1000);
+        ESP_LOGI(TAG, "%d ms frames, complexity %d: avg %lu us, max %lu us, %d%% of the frame",
+            frame_duration_ms, complexity, result.avg_us, result.max_us, result.avg_share_percent);
+        results.push_back(result);
+    }
+    return results;
+}
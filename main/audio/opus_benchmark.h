@@ -0,0 +1,27 @@
+#ifndef OPUS_BENCHMARK_H
+#define OPUS_BENCHMARK_H
+
+#include <cstdint>
+#include <vector>
+
+/*
+ * Opus encode time per complexity, measured on the device.
+ *
+ * Encodes a fixed speech-like signal (harmonics of a 150 Hz voice with a 4 Hz syllable
+ * envelope and low noise) at 16 kHz mono with DTX off, once per complexity. The
+ * averages are what OpusGovernor's thresholds (share of the frame duration) should be
+ * checked against. Run it while the audio pipeline is idle; the opus codec task has a
+ * higher priority and its encodes would otherwise show up as preemption.
+ */
+
+struct OpusBenchmarkResult {
+    int complexity;
+    uint32_t avg_us;
+    uint32_t max_us;
+    int avg_share_percent;      // of the frame duration
+};
+
+std::vector<OpusBenchmarkResult> RunOpusEncodeBenchmark(int frame_duration_ms, int frames,
+    int min_complexity = 0, int max_complexity = 10);
+
+#endif // OPUS_BENCHMARK_H
@@ -0,0 +1,98 @@
+#include "opus_governor.h"
+
+#include <algorithm>
+
+#define GOVERNOR_WINDOW_US          (2 * 1000 * 1000)
+#define GOVERNOR_MIN_FRAMES         10
+// Encode time as a share of the frame duration, in percent
+#define GOVERNOR_AVG_HIGH           35
+#define GOVERNOR_AVG_LOW            15
+#define GOVERNOR_PEAK_HIGH          80
+#define GOVERNOR_HEADROOM_WINDOWS   3
+
+OpusGovernor::OpusGovernor(int frame_duration_ms, int min_complexity, int max_complexity)
+    : frame_us_(frame_duration_ms * 1000),
+      min_complexity_(std::clamp(min_complexity, 0, 10)),
+      max_complexity_(std::clamp(max_complexity, min_complexity_, 10)) {
+    state_.complexity = min_complexity_;
+}
+
+void OpusGovernor::OnEncode(int64_t encode_us) {
+    encode_sum_us_ += encode_us;
+    encode_count_++;
+    encode_max_us_ = std::max<uint32_t>(encode_max_us_, encode_us);
+}
+
+void OpusGovernor::OnQueueDepth(size_t depth, size_t capacity) {
+    queue_max_depth_ = std::max<uint32_t>(queue_max_depth_, depth);
+    if (depth >= capacity) {
+        queue_full_ = true;
+    }
+}
+
+bool OpusGovernor::Update(int64_t now_us) {
+    if (window_start_us_ == 0) {
+        window_start_us_ = now_us;
+        return false;
+    }
+    if (now_us - window_start_us_ < GOVERNOR_WINDOW_US || encode_count_ < GOVERNOR_MIN_FRAMES) {
+        return false;
+    }
+
+    uint32_t avg_us = encode_sum_us_ / encode_count_;
+    state_.avg_encode_us = avg_us;
+    state_.max_encode_us = encode_max_us_;
+    state_.frames = encode_count_;
+    state_.max_queue_depth = queue_max_depth_;
+    int avg_share = avg_us * 100 / frame_us_;
+    int peak_share = encode_max_us_ * 100 / frame_us_;
+
+    bool pressure = avg_share > GOVERNOR_AVG_HIGH || peak_share > GOVERNOR_PEAK_HIGH || queue_full_;
+    bool headroom = !pressure && avg_share < GOVERNOR_AVG_LOW;
+
+    int complexity = state_.complexity;
+    if (pressure) {
+        headroom_windows_ = 0;
+        complexity = std::max(min_complexity_, complexity - 2);
+    } else if (headroom) {
+        if (++headroom_windows_ >= GOVERNOR_HEADROOM_WINDOWS) {
+            headroom_windows_ = 0;
+            complexity = std::min(max_complexity_, complexity + 1);
+        }
+    } else {
+        headroom_windows_ = 0;
+    }
+
+    window_start_us_ = now_us;
+    encode_sum_us_ = 0;
+    encode_count_ = 0;
+    encode_max_us_ = 0;
+    queue_max_depth_ = 0;
+    queue_full_ = false;
+
+    if (complexity == state_.complexity) {
+        return false;
+    }
+    state_.complexity = complexity;
+    return true;
+}
+
+void OpusGovernor::SetFrameDuration(int frame_duration_ms) {
+    frame_us_ = frame_duration_ms * 1000;
+    window_start_us_ = 0;
+    encode_sum_us_ = 0;
+    encode_count_ = 0;
+    encode_max_us_ = 0;
+    queue_max_depth_ = 0;
+    queue_full_ = false;
+    headroom_windows_ = 0;
+}
+
+bool OpusGovernor::SetVoiceActive(bool voice) {
+    bool dtx = !voice;
+    if (dtx == state_.dtx) {
+        return false;
+    }
+    state_.dtx = dtx;
+    return true;
+}
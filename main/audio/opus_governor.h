@@ -0,0 +1,69 @@
+#ifndef OPUS_GOVERNOR_H
+#define OPUS_GOVERNOR_H
+
+#include <cstddef>
+#include <cstdint>
+
+/*
+ * Adaptive Opus encoder complexity.
+ *
+ * The opus codec task reports the time every encode took and the encode queue
+ * depth; once per window the governor compares the average and worst encode time
+ * against the frame duration and checks whether the queue filled up, i.e. the task
+ * fell a whole frame behind. Uplink drops are not an input: they reflect the
+ * network, and lowering the complexity would not relieve them. Under pressure the
+ * complexity drops by two steps at once, with headroom for several consecutive
+ * windows it rises by one, so overloads are left quickly and the encoder creeps
+ * back up.
+ *
+ * Bitrate is not governed. esp-opus-encoder's OpusEncoderWrapper keeps the encoder
+ * handle private and exposes only complexity and DTX, so OPUS_SET_BITRATE would need
+ * a second encoder wrapper over libopus. On the uplink DTX is the lever: silence,
+ * most of a conversation, costs almost nothing.
+ *
+ * DTX follows the AFE voice activity: on during silence, off while speaking. The
+ * caller reports speech when no VAD is running, which keeps DTX off.
+ */
+
+struct OpusGovernorState {
+    int complexity = 0;
+    bool dtx = false;
+    uint32_t avg_encode_us = 0;     // last window
+    uint32_t max_encode_us = 0;
+    uint32_t frames = 0;
+    uint32_t max_queue_depth = 0;
+};
+
+class OpusGovernor {
+public:
+    // Complexities are clamped to 0..10, and max to at least min
+    OpusGovernor(int frame_duration_ms, int min_complexity, int max_complexity);
+
+    // Called by the opus codec task after every encode
+    void OnEncode(int64_t encode_us);
+    // Called by the opus codec task with the encode queue depth; a full queue is pressure
+    void OnQueueDepth(size_t depth, size_t capacity);
+    // Returns true when the complexity changed
+    bool Update(int64_t now_us);
+    // Returns true when DTX has to be switched
+    bool SetVoiceActive(bool voice);
+    // Encode times of the old frame size are discarded
+    void SetFrameDuration(int frame_duration_ms);
+
+    const OpusGovernorState& state() const { return state_; }
+
+private:
+    int frame_us_;
+    int min_complexity_;
+    int max_complexity_;
+    int64_t window_start_us_ = 0;
+    int64_t encode_sum_us_ = 0;
+    uint32_t encode_count_ = 0;
+    uint32_t encode_max_us_ = 0;
+    uint32_t queue_max_depth_ = 0;
+    bool queue_full_ = false;
+    int headroom_windows_ = 0;
+    OpusGovernorState state_;
+};
+
+#endif // OPUS_GOVERNOR_H
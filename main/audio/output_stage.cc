@@ -0,0 +1,95 @@
+#include "output_stage.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+int32_t OutputStage::VolumeGain(int volume) {
+    volume = std::min(std::max(volume, 0), 100);
+    return volume * volume * kUnity / 10000;
+}
+
+// Gains below are Q14 with 16 fractional bits for the interpolation, at most 2^30
+
+static inline void StoreSample(int16_t& out, int16_t in, int32_t gain) {
+    int32_t value = (in * (gain >> 16)) >> 14;
+    out = (int16_t)std::min(std::max(value, (int32_t)INT16_MIN), (int32_t)INT16_MAX);
+}
+
+// Left-justified 32-bit slot: the gain keeps 16 bits, so the product loses nothing. The
+// gain never exceeds unity, so the result is at most INT16_MIN * 65536 in magnitude.
+static inline void StoreSample(int32_t& out, int16_t in, int32_t gain) {
+    out = in * (gain >> 14);
+}
+
+// Q14 gain interpolated linearly from gain_from at in[0] towards gain_to after the last sample
+template <typename T>
+static void ApplyRamp(const int16_t* in, T* out, size_t samples, int32_t gain_from, int32_t gain_to) {
+    if (samples == 0) {
+        return;
+    }
+    int32_t gain = gain_from << 16;
+    int32_t step = (int32_t)(((int64_t)(gain_to - gain_from) << 16) / (int64_t)samples);
+    for (size_t i = 0; i < samples; i++) {
+        StoreSample(out[i], in[i], gain);
+        gain += step;
+    }
+}
+
+template <typename T>
+void OutputStage::ProcessFrame(const int16_t* data, T* out, size_t samples, int volume, int sample_rate) {
+    if (samples == 0) {
+        return;
+    }
+    int32_t target = VolumeGain(volume);
+    int32_t start = volume_gain_ < 0 ? target : volume_gain_;
+    volume_gain_ = target;
+
+    // Look-ahead: the frame peak at the louder end of the volume ramp
+    int32_t loudest = std::max(start, target);
+    int32_t peak = 0;
+    for (size_t i = 0; i < samples; i++) {
+        peak = std::max(peak, std::abs((int32_t)data[i]));
+    }
+    int32_t scaled_peak = (peak * loudest) >> 14;
+    int32_t needed = scaled_peak > kCeiling ? (kCeiling << 14) / scaled_peak : kUnity;
+
+    // Attack: samples before the first one over the ceiling are safe at any gain up to
+    // loudest, so the limiter ramps down from where the last frame ended and only has to
+    // reach needed there. A frame that starts over the ceiling steps at its first sample.
+    size_t attack = 0;
+    if (needed < limiter_gain_) {
+        while (((std::abs((int32_t)data[attack]) * loudest) >> 14) <= kCeiling) {
+            attack++;
+        }
+    }
+
+    // Release by kUnity every kReleaseMs, never above what this frame allows
+    int32_t release_samples = std::max(1, sample_rate * kReleaseMs / 1000);
+    int32_t release = (int32_t)((int64_t)kUnity * samples / release_samples);
+    int32_t limit_start = attack > 0 ? limiter_gain_ : std::min(limiter_gain_, needed);
+    int32_t limit_end = std::min(limiter_gain_ + release, needed);
+    limiter_gain_ = limit_end;
+
+    int32_t gain_start = (start * limit_start) >> 14;
+    int32_t gain_end = (target * limit_end) >> 14;
+    if (gain_start == kUnity && gain_end == kUnity && (const void*)data == (const void*)out) {
+        return;
+    }
+
+    if (attack > 0) {
+        int32_t volume_at_attack = start + (int32_t)((int64_t)(target - start) * attack / samples);
+        int32_t gain_attack = (volume_at_attack * needed) >> 14;
+        ApplyRamp(data, out, attack, gain_start, gain_attack);
+        ApplyRamp(data + attack, out + attack, samples - attack, gain_attack, gain_end);
+    } else {
+        ApplyRamp(data, out, samples, gain_start, gain_end);
+    }
+}
+
+void OutputStage::Process(int16_t* data, size_t samples, int volume, int sample_rate) {
+    ProcessFrame(data, data, samples, volume, sample_rate);
+}
+
+void OutputStage::Process(const int16_t* in, int32_t* out, size_t samples, int volume, int sample_rate) {
+    ProcessFrame(in, out, samples, volume, sample_rate);
+}
@@ -0,0 +1,52 @@
+#ifndef OUTPUT_STAGE_H
+#define OUTPUT_STAGE_H
+
+#include <cstddef>
+#include <cstdint>
+
+/*
+ * Gain stage in front of the codec output, run by AudioCodec::OutputData() on every
+ * played frame.
+ *
+ * Volume: codecs without a hardware volume (software_volume_) scale in software. A
+ * volume change does not jump the gain, it is interpolated sample by sample across the
+ * next frame, so there is no zipper noise.
+ *
+ * Limiter: the whole frame is known before anything is written, so its peak is the
+ * look-ahead. When the peak would exceed the ceiling (-1 dBFS) the limiter gain ramps
+ * down from where the previous frame ended and reaches the reduction the loudest sample
+ * needs by the first sample over the ceiling, then releases slowly over the following
+ * frames. The applied gain is interpolated linearly between endpoints that each keep
+ * their part of the frame under the ceiling, so nothing clips.
+ *
+ * Gains are Q14, the per sample loop is a multiply, a shift and a saturation without
+ * branches. Frames at unity gain with no limiting are left untouched. Codecs with a
+ * wider output slot take the 32-bit variant, which keeps the gain's fractional bits.
+ */
+class OutputStage {
+public:
+    static constexpr int32_t kUnity = 1 << 14;
+    static constexpr int32_t kCeiling = 29204;      // -1 dBFS
+    static constexpr int kReleaseMs = 250;          // limiter, from full reduction back to unity
+
+    // volume 0-100, the gain follows the same square law as the codec volume
+    static int32_t VolumeGain(int volume);
+
+    // sample_rate counts interleaved samples, i.e. rate * channels
+    void Process(int16_t* data, size_t samples, int volume, int sample_rate);
+    // Same, into the left-justified 32-bit I2S slot: the gain is applied at 32-bit
+    // resolution instead of rounding each sample back to 16 bits
+    void Process(const int16_t* in, int32_t* out, size_t samples, int volume, int sample_rate);
+
+    // Current limiter gain reduction, Q14
+    int32_t limiter_gain() const { return limiter_gain_; }
+
+private:
+    int32_t volume_gain_ = -1;  // last frame end, -1: not started
+    int32_t limiter_gain_ = kUnity;
+
+    template <typename T>
+    void ProcessFrame(const int16_t* data, T* out, size_t samples, int volume, int sample_rate);
+};
+
+#endif // OUTPUT_STAGE_H
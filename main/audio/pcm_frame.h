@@ -0,0 +1,67 @@
+#ifndef PCM_FRAME_H
+#define PCM_FRAME_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+/*
+ * A processed 16kHz mono PCM frame, shared read-only between the Opus encoder and the
+ * PCM taps (AudioService::AddPcmTap).
+ *
+ * Frames come from AudioBufferPool::AcquireFrame() and are handed around as PcmFrameRef,
+ * an intrusive reference count. Copying a ref shares the samples, the last ref going away
+ * returns the frame to the pool, so adding a consumer costs neither a copy nor an allocation.
+ */
+struct PcmFrame {
+    std::vector<int16_t> pcm;
+    uint32_t capture_time_ms = 0;   // when the frame was read from the microphone
+    std::atomic<uint32_t> refs{0};
+};
+
+class PcmFrameRef {
+public:
+    PcmFrameRef() = default;
+    explicit PcmFrameRef(PcmFrame* frame) : frame_(frame) {
+        if (frame_ != nullptr) {
+            frame_->refs.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    PcmFrameRef(const PcmFrameRef& other) : PcmFrameRef(other.frame_) {}
+    PcmFrameRef(PcmFrameRef&& other) noexcept : frame_(other.frame_) {
+        other.frame_ = nullptr;
+    }
+    PcmFrameRef& operator=(PcmFrameRef other) noexcept {
+        std::swap(frame_, other.frame_);
+        return *this;
+    }
+    ~PcmFrameRef() {
+        reset();
+    }
+
+    void reset() {
+        if (frame_ != nullptr && frame_->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            Release(frame_);
+        }
+        frame_ = nullptr;
+    }
+
+    explicit operator bool() const { return frame_ != nullptr; }
+    const PcmFrame* operator->() const { return frame_; }
+    const int16_t* data() const { return frame_->pcm.data(); }
+    size_t size() const { return frame_->pcm.size(); }
+    bool unique() const { return frame_ != nullptr && frame_->refs.load(std::memory_order_acquire) == 1; }
+
+    // Write access for the producer, only while nobody else holds the frame
+    PcmFrame* mutable_frame() { return unique() ? frame_ : nullptr; }
+
+private:
+    PcmFrame* frame_ = nullptr;
+
+    // Back to AudioBufferPool, or delete for heap fallbacks
+    static void Release(PcmFrame* frame);
+};
+
+#endif // PCM_FRAME_H
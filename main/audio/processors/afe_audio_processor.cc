@@ -1,5 +1,7 @@
 #include "afe_audio_processor.h"
+#include "audio_trace.h"
 #include <esp_log.h>
+#include <algorithm>
 
 #define PROCESSOR_RUNNING 0x01
 
@@ -13,9 +15,7 @@ AfeAudioProcessor::AfeAudioProcessor()
 void AfeAudioProcessor::Initialize(AudioCodec* codec, int frame_duration_ms, srmodel_list_t* models_list) {
     codec_ = codec;
     frame_samples_ = frame_duration_ms * 16000 / 1000;
-
-    // Pre-allocate output buffer capacity
-    output_buffer_.reserve(frame_samples_);
+    vad_transitions_ = metrics_register("afe.vad_transitions", METRIC_COUNTER);
 
     int ref_num = codec_->input_reference() ? 1 : 0;
 
@@ -63,9 +63,15 @@ void AfeAudioProcessor::Initialize(AudioCodec* codec, int frame_duration_ms, srm
     afe_config->aec_init = false;
     afe_config->vad_init = true;
 #endif
+    vad_enabled_ = afe_config->vad_init;
 
     afe_iface_ = esp_afe_handle_from_config(afe_config);
     afe_data_ = afe_iface_->create_from_config(afe_config);
+
+    // Ring and output frame sized for the longest frame duration plus one fetched block
+    size_t max_frame_samples = std::max<size_t>(frame_samples_, 60 * 16000 / 1000);
+    rechunker_.Initialize(max_frame_samples + afe_iface_->get_fetch_chunksize(afe_data_), frame_samples_, max_frame_samples);
+    output_frame_.reserve(max_frame_samples);
     
     xTaskCreate([](void* arg) {
         auto this_ = (AfeAudioProcessor*)arg;
@@ -92,9 +98,15 @@ void AfeAudioProcessor::Feed(std::vector<int16_t>&& data) {
     if (afe_data_ == nullptr) {
         return;
     }
+    AUDIO_TRACE(AUDIO_TRACE_AFE_FEED, feed_count_++);
     afe_iface_->feed(afe_data_, data.data());
 }
 
+void AfeAudioProcessor::SetFrameDuration(int frame_duration_ms) {
+    // Picked up by the re-chunker with the next fetched block
+    frame_samples_ = frame_duration_ms * 16000 / 1000;
+}
+
 void AfeAudioProcessor::Start() {
     xEventGroupSetBits(event_group_, PROCESSOR_RUNNING);
 }
@@ -137,36 +149,34 @@ void AfeAudioProcessor::AudioProcessorTask() {
             }
             continue;
         }
+        AUDIO_TRACE(AUDIO_TRACE_AFE_FETCH, fetch_count_++);
 
         // VAD state change
         if (vad_state_change_callback_) {
             if (res->vad_state == VAD_SPEECH && !is_speaking_) {
                 is_speaking_ = true;
+                metric_inc(vad_transitions_);
                 vad_state_change_callback_(true);
             } else if (res->vad_state == VAD_SILENCE && is_speaking_) {
                 is_speaking_ = false;
+                metric_inc(vad_transitions_);
                 vad_state_change_callback_(false);
             }
         }
 
         if (output_callback_) {
             size_t samples = res->data_size / sizeof(int16_t);
-            
-            // Add data to buffer
-            output_buffer_.insert(output_buffer_.end(), res->data, res->data + samples);
-            
-            // Output complete frames when buffer has enough data
-            while (output_buffer_.size() >= frame_samples_) {
-                if (output_buffer_.size() == frame_samples_) {
-                    // If buffer size equals frame size, move the entire buffer
-                    output_callback_(std::move(output_buffer_));
-                    output_buffer_.clear();
-                    output_buffer_.reserve(frame_samples_);
-                } else {
-                    // If buffer size exceeds frame size, copy one frame and remove it
-                    output_callback_(std::vector<int16_t>(output_buffer_.begin(), output_buffer_.begin() + frame_samples_));
-                    output_buffer_.erase(output_buffer_.begin(), output_buffer_.begin() + frame_samples_);
-                }
+            rechunker_.SetFrameSize(frame_samples_);
+            rechunker_.Push(res->data, samples);
+
+            // Complete frames are copied once, from the ring into output_frame_. The callback takes
+            // the samples and hands back a buffer of at least the same capacity.
+            while (rechunker_.size() >= rechunker_.frame_size()) {
+                size_t frame_samples = rechunker_.frame_size();
+                output_frame_.resize(frame_samples);
+                rechunker_.Copy(output_frame_.data(), frame_samples);
+                rechunker_.Skip(frame_samples);
+                output_callback_(std::move(output_frame_));
             }
         }
     }
@@ -177,11 +187,13 @@ void AfeAudioProcessor::EnableDeviceAec(bool enable) {
 #if CONFIG_USE_DEVICE_AEC
         afe_iface_->disable_vad(afe_data_);
         afe_iface_->enable_aec(afe_data_);
+        vad_enabled_ = false;
 #else
         ESP_LOGE(TAG, "Device AEC is not supported");
 #endif
     } else {
         afe_iface_->disable_aec(afe_data_);
         afe_iface_->enable_vad(afe_data_);
+        vad_enabled_ = true;
     }
 }
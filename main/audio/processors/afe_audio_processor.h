@@ -8,10 +8,13 @@
 
 #include <string>
 #include <vector>
+#include <atomic>
 #include <functional>
 
 #include "audio_processor.h"
+#include "frame_rechunker.h"
 #include "audio_codec.h"
+#include "metrics.h"
 
 class AfeAudioProcessor : public AudioProcessor {
 public:
@@ -26,7 +29,9 @@ public:
     void OnOutput(std::function<void(std::vector<int16_t>&& data)> callback) override;
     void OnVadStateChange(std::function<void(bool speaking)> callback) override;
     size_t GetFeedSize() override;
+    void SetFrameDuration(int frame_duration_ms) override;
     void EnableDeviceAec(bool enable) override;
+    bool IsVadEnabled() override { return vad_enabled_; }
 
 private:
     EventGroupHandle_t event_group_ = nullptr;
@@ -35,9 +40,14 @@ private:
     std::function<void(std::vector<int16_t>&& data)> output_callback_;
     std::function<void(bool speaking)> vad_state_change_callback_;
     AudioCodec* codec_ = nullptr;
-    int frame_samples_ = 0;
+    std::atomic<size_t> frame_samples_{0};
     bool is_speaking_ = false;
-    std::vector<int16_t> output_buffer_;
+    bool vad_enabled_ = false;
+    FrameRechunker<int16_t> rechunker_;
+    std::vector<int16_t> output_frame_;
+    uint16_t feed_count_ = 0;
+    uint16_t fetch_count_ = 0;
+    metric_t* vad_transitions_ = nullptr;
 
     void AudioProcessorTask();
 };
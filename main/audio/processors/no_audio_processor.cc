@@ -15,11 +15,11 @@ void NoAudioProcessor::Feed(std::vector<int16_t>&& data) {
 
     if (codec_->input_channels() == 2) {
         // If input channels is 2, we need to fetch the left channel data
-        auto mono_data = std::vector<int16_t>(data.size() / 2);
-        for (size_t i = 0, j = 0; i < mono_data.size(); ++i, j += 2) {
-            mono_data[i] = data[j];
+        mono_buffer_.resize(data.size() / 2);
+        for (size_t i = 0, j = 0; i < mono_buffer_.size(); ++i, j += 2) {
+            mono_buffer_[i] = data[j];
         }
-        output_callback_(std::move(mono_data));
+        output_callback_(std::move(mono_buffer_));
     } else {
         output_callback_(std::move(data));
     }
@@ -45,6 +45,11 @@ void NoAudioProcessor::OnVadStateChange(std::function<void(bool speaking)> callb
     vad_state_change_callback_ = callback;
 }
 
+void NoAudioProcessor::SetFrameDuration(int frame_duration_ms) {
+    // Every feed becomes one output frame, so the next read already has the new size
+    frame_samples_ = frame_duration_ms * 16000 / 1000;
+}
+
 size_t NoAudioProcessor::GetFeedSize() {
     if (!codec_) {
         return 0;
@@ -2,6 +2,7 @@
 #define DUMMY_AUDIO_PROCESSOR_H
 
 #include <vector>
+#include <atomic>
 #include <functional>
 
 #include "audio_processor.h"
@@ -20,11 +21,14 @@ public:
     void OnOutput(std::function<void(std::vector<int16_t>&& data)> callback) override;
     void OnVadStateChange(std::function<void(bool speaking)> callback) override;
     size_t GetFeedSize() override;
+    void SetFrameDuration(int frame_duration_ms) override;
     void EnableDeviceAec(bool enable) override;
+    bool IsVadEnabled() override { return false; }
 
 private:
     AudioCodec* codec_ = nullptr;
-    int frame_samples_ = 0;
+    std::atomic<int> frame_samples_{0};
+    std::vector<int16_t> mono_buffer_;
     std::function<void(std::vector<int16_t>&& data)> output_callback_;
     std::function<void(bool speaking)> vad_state_change_callback_;
     bool is_running_ = false;
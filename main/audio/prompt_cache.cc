@@ -0,0 +1,201 @@
+#include "prompt_cache.h"
+
+#include <cstring>
+
+#include <esp_log.h>
+#include <esp_heap_caps.h>
+#include <opus_decoder.h>
+#include <opus_resampler.h>
+
+#define TAG "PromptCache"
+
+// Prompts are encoded with 60 ms frames, see scripts/mp3_to_ogg.sh
+#define PROMPT_FRAME_DURATION_MS 60
+
+PromptCache::~PromptCache() {
+    for (auto& pcm : pcms_) {
+        heap_caps_free(pcm->samples);
+    }
+}
+
+void PromptCache::Initialize(int output_sample_rate, size_t pcm_budget_bytes) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    output_sample_rate_ = output_sample_rate;
+    pcm_budget_bytes_ = pcm_budget_bytes;
+}
+
+const PromptIndex* PromptCache::GetIndex(std::string_view ogg) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& index : indexes_) {
+        if (index->data == ogg.data() && index->size == ogg.size()) {
+            return index.get();
+        }
+    }
+    auto index = std::make_unique<PromptIndex>();
+    if (!ParseOgg(ogg, *index)) {
+        ESP_LOGW(TAG, "Not an OGG/Opus stream, size=%u", (unsigned int)ogg.size());
+        return nullptr;
+    }
+    ESP_LOGI(TAG, "Indexed prompt: %u packets, sample_rate=%d", (unsigned int)index->packets.size(), index->sample_rate);
+    indexes_.push_back(std::move(index));
+    return indexes_.back().get();
+}
+
+const PromptPcm* PromptCache::GetPcm(std::string_view ogg) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& pcm : pcms_) {
+        if (pcm->data == ogg.data()) {
+            return pcm.get();
+        }
+    }
+    return nullptr;
+}
+
+bool PromptCache::Preload(std::string_view ogg) {
+    if (GetPcm(ogg) != nullptr) {
+        return true;
+    }
+    const PromptIndex* index = GetIndex(ogg);
+    if (index == nullptr || index->packets.empty() || output_sample_rate_ == 0) {
+        return false;
+    }
+
+    OpusDecoderWrapper decoder(index->sample_rate, 1, PROMPT_FRAME_DURATION_MS);
+    OpusResampler resampler;
+    bool resample = index->sample_rate != output_sample_rate_;
+    if (resample) {
+        resampler.Configure(index->sample_rate, output_sample_rate_);
+    }
+
+    // Sized for full frames up front, so the PSRAM buffer is allocated exactly once
+    int frame_samples = index->sample_rate * PROMPT_FRAME_DURATION_MS / 1000;
+    size_t max_count = index->packets.size() * (resample ? resampler.GetOutputSamples(frame_samples) : frame_samples);
+    size_t bytes = max_count * sizeof(int16_t);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (pcm_bytes_ + bytes > pcm_budget_bytes_) {
+            ESP_LOGW(TAG, "PCM cache budget exceeded, %u + %u bytes", (unsigned int)pcm_bytes_, (unsigned int)bytes);
+            return false;
+        }
+        pcm_bytes_ += bytes;
+    }
+    auto samples = static_cast<int16_t*>(heap_caps_malloc(bytes, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT));
+    if (samples == nullptr) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pcm_bytes_ -= bytes;
+        ESP_LOGW(TAG, "Failed to allocate %u bytes for a prompt", (unsigned int)bytes);
+        return false;
+    }
+
+    size_t count = 0;
+    std::vector<uint8_t> opus;
+    std::vector<int16_t> pcm;
+    for (const auto& packet : index->packets) {
+        const uint8_t* payload = reinterpret_cast<const uint8_t*>(ogg.data()) + packet.offset;
+        opus.assign(payload, payload + packet.size);
+        if (!decoder.Decode(std::move(opus), pcm)) {
+            continue;
+        }
+        size_t n = resample ? resampler.GetOutputSamples(pcm.size()) : pcm.size();
+        if (count + n > max_count) {
+            break;
+        }
+        if (resample) {
+            resampler.Process(pcm.data(), pcm.size(), samples + count);
+        } else {
+            memcpy(samples + count, pcm.data(), n * sizeof(int16_t));
+        }
+        count += n;
+    }
+
+    auto entry = std::make_unique<PromptPcm>();
+    entry->data = ogg.data();
+    entry->samples = samples;
+    entry->count = count;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    pcms_.push_back(std::move(entry));
+    ESP_LOGI(TAG, "Preloaded prompt: %u samples, cache %u / %u bytes", (unsigned int)count,
+        (unsigned int)pcm_bytes_, (unsigned int)pcm_budget_bytes_);
+    return true;
+}
+
+bool PromptCache::ParseOgg(std::string_view ogg, PromptIndex& index) {
+    const uint8_t* buf = reinterpret_cast<const uint8_t*>(ogg.data());
+    size_t size = ogg.size();
+    size_t offset = 0;
+
+    auto find_page = [&](size_t start)->size_t {
+        for (size_t i = start; i + 4 <= size; ++i) {
+            if (buf[i] == 'O' && buf[i+1] == 'g' && buf[i+2] == 'g' && buf[i+3] == 'S') return i;
+        }
+        return static_cast<size_t>(-1);
+    };
+
+    index.data = ogg.data();
+    index.size = size;
+    bool seen_head = false;
+    bool seen_tags = false;
+
+    while (true) {
+        size_t pos = find_page(offset);
+        if (pos == static_cast<size_t>(-1)) break;
+        offset = pos;
+        if (offset + 27 > size) break;
+
+        const uint8_t* page = buf + offset;
+        uint8_t page_segments = page[26];
+        size_t seg_table_off = offset + 27;
+        if (seg_table_off + page_segments > size) break;
+
+        size_t body_size = 0;
+        for (size_t i = 0; i < page_segments; ++i) body_size += page[27 + i];
+
+        size_t body_off = seg_table_off + page_segments;
+        if (body_off + body_size > size) break;
+
+        // Parse packets using lacing
+        size_t cur = body_off;
+        size_t seg_idx = 0;
+        while (seg_idx < page_segments) {
+            size_t pkt_len = 0;
+            size_t pkt_start = cur;
+            bool continued = false;
+            do {
+                uint8_t l = page[27 + seg_idx++];
+                pkt_len += l;
+                cur += l;
+                continued = (l == 255);
+            } while (continued && seg_idx < page_segments);
+
+            if (pkt_len == 0) continue;
+            const uint8_t* pkt_ptr = buf + pkt_start;
+
+            if (!seen_head) {
+                // OpusHead结构：[0-7] "OpusHead", [8] version, [9] channel_count, [10-11] pre_skip
+                // [12-15] input_sample_rate, [16-17] output_gain, [18] mapping_family
+                if (pkt_len >= 19 && std::memcmp(pkt_ptr, "OpusHead", 8) == 0) {
+                    seen_head = true;
+                    index.sample_rate = pkt_ptr[12] | (pkt_ptr[13] << 8) |
+                                        (pkt_ptr[14] << 16) | (pkt_ptr[15] << 24);
+                }
+                continue;
+            }
+            if (!seen_tags) {
+                // Expect OpusTags in second packet
+                if (pkt_len >= 8 && std::memcmp(pkt_ptr, "OpusTags", 8) == 0) {
+                    seen_tags = true;
+                }
+                continue;
+            }
+
+            // Audio packet (Opus)
+            if (pkt_len <= UINT16_MAX) {
+                index.packets.push_back({static_cast<uint32_t>(pkt_start), static_cast<uint16_t>(pkt_len)});
+            }
+        }
+
+        offset = body_off + body_size;
+    }
+    return seen_head;
+}
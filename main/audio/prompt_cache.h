@@ -0,0 +1,68 @@
+#ifndef PROMPT_CACHE_H
+#define PROMPT_CACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <vector>
+
+/*
+ * Cache for the built-in OGG/Opus prompts played by AudioService::PlaySound().
+ *
+ * Every asset is parsed once: the packet offsets are kept in a PromptIndex, so later
+ * plays skip the OggS page scan. Hot prompts can additionally be decoded ahead of time
+ * (Preload) into PCM at the codec output rate in PSRAM, those start playing without
+ * going through the decode queue, the jitter buffer or the Opus decoder.
+ *
+ * Assets are embedded in flash and never move, entries are keyed by their address and
+ * live as long as the cache, so returned pointers stay valid.
+ */
+
+struct PromptPacket {
+    uint32_t offset;
+    uint16_t size;
+};
+
+struct PromptIndex {
+    const char* data = nullptr;
+    size_t size = 0;
+    int sample_rate = 16000;
+    std::vector<PromptPacket> packets;
+};
+
+struct PromptPcm {
+    const char* data = nullptr;     // asset key
+    int16_t* samples = nullptr;     // PSRAM, at the output sample rate
+    size_t count = 0;
+};
+
+class PromptCache {
+public:
+    PromptCache() = default;
+    ~PromptCache();
+    PromptCache(const PromptCache&) = delete;
+    PromptCache& operator=(const PromptCache&) = delete;
+
+    void Initialize(int output_sample_rate, size_t pcm_budget_bytes);
+
+    // Indexes the asset on first use, nullptr when it is not a valid OGG/Opus stream
+    const PromptIndex* GetIndex(std::string_view ogg);
+    // nullptr when the prompt has not been preloaded
+    const PromptPcm* GetPcm(std::string_view ogg);
+    // Decodes the prompt into the PCM cache. Blocking, call from a low priority task.
+    bool Preload(std::string_view ogg);
+
+private:
+    std::mutex mutex_;
+    int output_sample_rate_ = 0;
+    size_t pcm_budget_bytes_ = 0;
+    size_t pcm_bytes_ = 0;
+    std::vector<std::unique_ptr<PromptIndex>> indexes_;
+    std::vector<std::unique_ptr<PromptPcm>> pcms_;
+
+    static bool ParseOgg(std::string_view ogg, PromptIndex& index);
+};
+
+#endif // PROMPT_CACHE_H
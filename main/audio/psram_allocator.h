@@ -0,0 +1,91 @@
+#ifndef PSRAM_ALLOCATOR_H
+#define PSRAM_ALLOCATOR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+#include <esp_heap_caps.h>
+
+/*
+ * std allocator for large, long lived audio buffers. Prefers PSRAM and falls back to
+ * internal RAM on boards without it.
+ */
+template <typename T>
+struct PsramAllocator {
+    typedef T value_type;
+
+    PsramAllocator() = default;
+    template <typename U>
+    PsramAllocator(const PsramAllocator<U>&) {}
+
+    T* allocate(size_t n) {
+        void* p = heap_caps_malloc(n * sizeof(T), MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+        if (p == nullptr) {
+            p = heap_caps_malloc(n * sizeof(T), MALLOC_CAP_8BIT);
+        }
+        if (p == nullptr) {
+            throw std::bad_alloc();
+        }
+        return static_cast<T*>(p);
+    }
+
+    void deallocate(T* p, size_t) {
+        heap_caps_free(p);
+    }
+};
+
+template <typename T, typename U>
+bool operator==(const PsramAllocator<T>&, const PsramAllocator<U>&) { return true; }
+template <typename T, typename U>
+bool operator!=(const PsramAllocator<T>&, const PsramAllocator<U>&) { return false; }
+
+/*
+ * std allocator whose heap caps are chosen at runtime, for pooled buffers placed by
+ * configuration. A default constructed one allocates from the default heap like
+ * std::allocator. Any instance frees any buffer, so they all compare equal and the caps
+ * travel with the buffer on move and swap.
+ */
+template <typename T>
+struct HeapCapsAllocator {
+    typedef T value_type;
+    typedef std::true_type propagate_on_container_copy_assignment;
+    typedef std::true_type propagate_on_container_move_assignment;
+    typedef std::true_type propagate_on_container_swap;
+    typedef std::true_type is_always_equal;
+
+    uint32_t caps = MALLOC_CAP_DEFAULT;
+
+    HeapCapsAllocator() = default;
+    explicit HeapCapsAllocator(uint32_t heap_caps) : caps(heap_caps) {}
+    template <typename U>
+    HeapCapsAllocator(const HeapCapsAllocator<U>& other) : caps(other.caps) {}
+
+    T* allocate(size_t n) {
+        void* p = heap_caps_malloc(n * sizeof(T), caps);
+        if (p == nullptr && caps != MALLOC_CAP_DEFAULT) {
+            p = heap_caps_malloc(n * sizeof(T), MALLOC_CAP_DEFAULT);
+        }
+        if (p == nullptr) {
+            throw std::bad_alloc();
+        }
+        return static_cast<T*>(p);
+    }
+
+    void deallocate(T* p, size_t) {
+        heap_caps_free(p);
+    }
+};
+
+template <typename T, typename U>
+bool operator==(const HeapCapsAllocator<T>&, const HeapCapsAllocator<U>&) { return true; }
+template <typename T, typename U>
+bool operator!=(const HeapCapsAllocator<T>&, const HeapCapsAllocator<U>&) { return false; }
+
+// PCM of AudioTask and payload of AudioStreamPacket, placed by AudioBufferPool
+typedef std::vector<int16_t, HeapCapsAllocator<int16_t>> AudioPcmBuffer;
+typedef std::vector<uint8_t, HeapCapsAllocator<uint8_t>> AudioPayloadBuffer;
+
+#endif // PSRAM_ALLOCATOR_H
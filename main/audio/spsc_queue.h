@@ -0,0 +1,243 @@
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#include "audio_trace.h"
+
+/*
+ * Fixed-capacity, lock-free single-producer / single-consumer ring queue.
+ *
+ * Exactly one task may call Push() and exactly one task may call Pop() at a time.
+ * Instead of a shared condition variable, each side can register a FreeRTOS task
+ * that gets a notification bit (eSetBits) when the other side makes progress:
+ *   - the consumer task is notified after every Push()
+ *   - the producer task is notified after every Pop()
+ *
+ * Clear() may be called from any task. It marks everything pushed so far as stale
+ * and wakes the consumer, which drops those items on its next Pop() or DropStale(),
+ * so the consumer remains the only task touching the head of the ring. Until then
+ * size() and empty() already leave the stale items out, while full() and Push() still
+ * count them, since their slots are not free yet; the drain notifies the producer like
+ * a Pop().
+ *
+ * WaitForSpace() may be called by several producer tasks at once (producers that
+ * serialize Push() with their own mutex), up to kMaxSpaceWaiters of them. Any task may
+ * wait, e.g. the application task in PlaySound(): the wakeup uses the task notification
+ * index SPSC_QUEUE_SPACE_NOTIFY_INDEX, which is reserved for it, so the caller's own
+ * notifications on index 0 are neither consumed nor disturbed.
+ *
+ * With SetTracePoint(), pushes and pops are recorded in the audio trace as
+ * point / point + 1 with the slot sequence number as id, so every item can be
+ * followed through the queue.
+ */
+
+#define SPSC_QUEUE_SPACE_NOTIFY_INDEX 1
+#define SPSC_QUEUE_SPACE_NOTIFY_BIT (1UL << 0)
+
+static_assert(configTASK_NOTIFICATION_ARRAY_ENTRIES > SPSC_QUEUE_SPACE_NOTIFY_INDEX,
+    "SpscQueue::WaitForSpace needs CONFIG_FREERTOS_TASK_NOTIFICATION_ARRAY_ENTRIES >= 2");
+
+template <typename T, size_t Capacity>
+class SpscQueue {
+public:
+    static_assert(Capacity > 0, "SpscQueue capacity must be positive");
+
+    SpscQueue() = default;
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    static constexpr size_t capacity() { return Capacity; }
+    static constexpr int kMaxSpaceWaiters = 4;
+
+    void SetConsumerTask(TaskHandle_t task, uint32_t notify_bits) {
+        consumer_bits_.store(notify_bits, std::memory_order_relaxed);
+        consumer_task_.store(task, std::memory_order_release);
+    }
+
+    void SetProducerTask(TaskHandle_t task, uint32_t notify_bits) {
+        producer_bits_.store(notify_bits, std::memory_order_relaxed);
+        producer_task_.store(task, std::memory_order_release);
+    }
+
+    // push_point is recorded on Push(), push_point + 1 on Pop()
+    void SetTracePoint(uint16_t push_point) {
+        trace_point_ = push_point;
+    }
+
+    // Producer side. Returns false (and leaves item untouched) when the queue is full.
+    bool Push(T&& item) {
+        uint32_t tail = tail_.load(std::memory_order_relaxed);
+        uint32_t head = head_.load(std::memory_order_acquire);
+        if (tail - head >= Capacity) {
+            return false;
+        }
+        slots_[tail & kMask] = std::move(item);
+        tail_.store(tail + 1, std::memory_order_release);
+        if (trace_point_ != kNoTrace) {
+            AUDIO_TRACE(trace_point_, tail);
+        }
+        Notify(consumer_task_, consumer_bits_);
+        return true;
+    }
+
+    // Consumer side. Returns false when there is nothing to pop.
+    bool Pop(T& item) {
+        uint32_t head = head_.load(std::memory_order_relaxed);
+        bool drained = DrainStale(head);
+        uint32_t tail = tail_.load(std::memory_order_acquire);
+        if (head == tail) {
+            if (drained) {
+                head_.store(head, std::memory_order_release);
+                NotifyProducers();
+            }
+            return false;
+        }
+        item = std::move(slots_[head & kMask]);
+        slots_[head & kMask] = T();
+        head_.store(head + 1, std::memory_order_release);
+        if (trace_point_ != kNoTrace) {
+            AUDIO_TRACE(trace_point_ + 1, head);
+        }
+        NotifyProducers();
+        return true;
+    }
+
+    // Consumer side. Frees the slots of items discarded by Clear() without popping, for a
+    // consumer that may not pop for a while (e.g. while its jitter buffer is filling up)
+    void DropStale() {
+        uint32_t head = head_.load(std::memory_order_relaxed);
+        if (DrainStale(head)) {
+            head_.store(head, std::memory_order_release);
+            NotifyProducers();
+        }
+    }
+
+    // Any task. Items already queued are discarded by the consumer on its next Pop().
+    void Clear() {
+        flush_mark_.store(tail_.load(std::memory_order_acquire), std::memory_order_relaxed);
+        flush_pending_.store(true, std::memory_order_release);
+        // Let the consumer free the slots now rather than on its next wakeup
+        Notify(consumer_task_, consumer_bits_);
+    }
+
+    // Producer side. Blocks until there is room or the timeout expires.
+    bool WaitForSpace(TickType_t ticks_to_wait) {
+        if (!full()) {
+            return true;
+        }
+        // Registered before the check below, so a Pop() in between still notifies us
+        TaskHandle_t self = xTaskGetCurrentTaskHandle();
+        int slot = AddSpaceWaiter(self);
+        TickType_t start = xTaskGetTickCount();
+        while (full()) {
+            TickType_t elapsed = xTaskGetTickCount() - start;
+            if (ticks_to_wait != portMAX_DELAY && elapsed >= ticks_to_wait) {
+                break;
+            }
+            TickType_t remaining = ticks_to_wait == portMAX_DELAY ? portMAX_DELAY : ticks_to_wait - elapsed;
+            if (slot < 0) {
+                // More waiters than slots, poll
+                vTaskDelay(1);
+                continue;
+            }
+            xTaskNotifyWaitIndexed(SPSC_QUEUE_SPACE_NOTIFY_INDEX, 0, SPSC_QUEUE_SPACE_NOTIFY_BIT, nullptr, remaining);
+        }
+        if (slot >= 0) {
+            space_waiters_[slot].store(nullptr, std::memory_order_release);
+        }
+        return !full();
+    }
+
+    size_t size() const {
+        uint32_t head = head_.load(std::memory_order_acquire);
+        if (flush_pending_.load(std::memory_order_acquire)) {
+            uint32_t mark = flush_mark_.load(std::memory_order_relaxed);
+            if (int32_t(mark - head) > 0) {
+                head = mark;
+            }
+        }
+        return tail_.load(std::memory_order_acquire) - head;
+    }
+
+    bool empty() const { return size() == 0; }
+    // Same test as Push(), stale items occupy their slots until the consumer drains them
+    bool full() const {
+        return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire) >= Capacity;
+    }
+
+private:
+    static constexpr size_t RoundUpPow2(size_t v) {
+        size_t p = 1;
+        while (p < v) {
+            p <<= 1;
+        }
+        return p;
+    }
+    static constexpr size_t kSlots = RoundUpPow2(Capacity);
+    static constexpr uint32_t kMask = kSlots - 1;
+    static constexpr uint16_t kNoTrace = 0xFFFF;
+
+    // head_ is only written by the consumer, tail_ only by the producer.
+    alignas(4) std::atomic<uint32_t> head_{0};
+    alignas(4) std::atomic<uint32_t> tail_{0};
+    std::atomic<bool> flush_pending_{false};
+    std::atomic<uint32_t> flush_mark_{0};
+    std::atomic<TaskHandle_t> consumer_task_{nullptr};
+    std::atomic<uint32_t> consumer_bits_{0};
+    std::atomic<TaskHandle_t> producer_task_{nullptr};
+    std::atomic<uint32_t> producer_bits_{0};
+    std::atomic<TaskHandle_t> space_waiters_[kMaxSpaceWaiters] = {};
+    uint16_t trace_point_ = kNoTrace;
+    std::array<T, kSlots> slots_{};
+
+    bool DrainStale(uint32_t& head) {
+        if (!flush_pending_.exchange(false, std::memory_order_acq_rel)) {
+            return false;
+        }
+        uint32_t mark = flush_mark_.load(std::memory_order_relaxed);
+        bool drained = false;
+        while (int32_t(mark - head) > 0) {
+            slots_[head & kMask] = T();
+            head++;
+            drained = true;
+        }
+        return drained;
+    }
+
+    int AddSpaceWaiter(TaskHandle_t task) {
+        for (int i = 0; i < kMaxSpaceWaiters; i++) {
+            TaskHandle_t expected = nullptr;
+            if (space_waiters_[i].compare_exchange_strong(expected, task, std::memory_order_acq_rel)) {
+                return i;
+            }
+        }
+        return -1;
+    }
+
+    void NotifyProducers() {
+        Notify(producer_task_, producer_bits_);
+        for (auto& waiter : space_waiters_) {
+            TaskHandle_t handle = waiter.load(std::memory_order_acquire);
+            if (handle != nullptr) {
+                xTaskNotifyIndexed(handle, SPSC_QUEUE_SPACE_NOTIFY_INDEX, SPSC_QUEUE_SPACE_NOTIFY_BIT, eSetBits);
+            }
+        }
+    }
+
+    static void Notify(const std::atomic<TaskHandle_t>& task, const std::atomic<uint32_t>& bits) {
+        TaskHandle_t handle = task.load(std::memory_order_acquire);
+        if (handle != nullptr) {
+            xTaskNotify(handle, bits.load(std::memory_order_relaxed), eSetBits);
+        }
+    }
+};
+
+#endif // SPSC_QUEUE_H
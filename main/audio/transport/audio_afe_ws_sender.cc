@@ -1,10 +1,16 @@
 #include "audio_uploader.h"
 #include "audio_service.h"
+#include "audio_trace.h"
+#include "ws_transport.h"
+#include "metrics.h"
+#include "opus_benchmark.h"
 #include "boards/common/wifi_connect.h"
 #include "boards/common/board.h"
 #include <esp_log.h>
+#include <cJSON.h>
 #include <memory>
 #include <string>
+#include <cstring>
 
 #define TAG "AFE_WS_SENDER"
 
@@ -33,11 +39,125 @@ void audio_afe_ws_send(const int16_t *data, int samples) {
     audio_uploader_send(data, samples);
 }
 
-// 挂载到 AudioService 的 AFE输出回调
+#if CONFIG_AUDIO_TRACE
+// 在独立任务中导出延迟追踪，避免阻塞 WebSocket 事件任务
+static void audio_trace_dump_task(void* arg) {
+    bool to_ws = arg != nullptr;
+    if (to_ws && !ws_transport_mux_enabled()) {
+        // 追踪通道需要服务端同意复用，否则改走串口
+        ESP_LOGW(TAG, "Channel mux not negotiated, dumping audio trace to UART");
+        to_ws = false;
+    }
+    if (to_ws) {
+        std::vector<uint8_t> dump;
+        audio_trace_dump([](const void* data, size_t len, void* arg) {
+            auto out = static_cast<std::vector<uint8_t>*>(arg);
+            auto bytes = static_cast<const uint8_t*>(data);
+            out->insert(out->end(), bytes, bytes + len);
+        }, &dump);
+        int ret = ws_transport_send_chunked(WS_CHANNEL_TRACE, dump.data(), dump.size(), pdMS_TO_TICKS(5000));
+        ESP_LOGI(TAG, "Audio trace dumped to websocket: %u bytes, ret=%d", (unsigned int)dump.size(), ret);
+    } else {
+        audio_trace_dump_uart();
+    }
+    vTaskDelete(NULL);
+}
+#endif
+
+// 在独立任务中发送指标快照，避免阻塞 WebSocket 事件任务
+static void metrics_snapshot_task(void* arg) {
+    std::vector<uint8_t> snapshot(metrics_snapshot_size());
+    size_t len = metrics_snapshot(snapshot.data(), snapshot.size());
+    if (!ws_transport_mux_enabled()) {
+        ESP_LOGW(TAG, "Channel mux not negotiated, metrics snapshot not sent");
+    } else if (len > 0) {
+        ws_transport_send_chunked(WS_CHANNEL_METRICS, snapshot.data(), len, pdMS_TO_TICKS(1000));
+    }
+    vTaskDelete(NULL);
+}
+
+#if CONFIG_AUDIO_OPUS_BENCH_COMMAND
+// 在独立任务中测量各 complexity 的 Opus 编码耗时，结果以文本 JSON 回复：
+//   {"type":"opus_bench","frame_duration":60,"results":[{"complexity":0,"avg_us":..,"max_us":..,"share":..},...]}
+#define OPUS_BENCH_FRAMES       50
+
+static void opus_bench_task(void* arg) {
+    int frame_duration_ms = (int)(intptr_t)arg;
+    auto results = RunOpusEncodeBenchmark(frame_duration_ms, OPUS_BENCH_FRAMES);
+    std::string reply = "{\"type\":\"opus_bench\",\"frame_duration\":" + std::to_string(frame_duration_ms) + ",\"results\":[";
+    for (size_t i = 0; i < results.size(); i++) {
+        auto& result = results[i];
+        reply += (i > 0 ? ",{" : "{");
+        reply += "\"complexity\":" + std::to_string(result.complexity);
+        reply += ",\"avg_us\":" + std::to_string(result.avg_us);
+        reply += ",\"max_us\":" + std::to_string(result.max_us);
+        reply += ",\"share\":" + std::to_string(result.avg_share_percent) + "}";
+    }
+    reply += "]}";
+    ws_transport_send_text(reply.data(), reply.size(), pdMS_TO_TICKS(1000));
+    vTaskDelete(NULL);
+}
+#endif
+
+// 处理服务端的 JSON 控制消息，返回 true 表示已处理：
+//   {"type":"audio_trace","action":"dump"|"uart"}
+//   {"type":"metrics"}
+//   {"type":"tts","state":"sentence_end"|"stop"}  下行语音流结束，抖动缓冲不再做丢包补偿
+//   {"type":"opus_bench","frame_duration":60}     Opus 编码耗时测量 (opus_benchmark.h，需 CONFIG_AUDIO_OPUS_BENCH_COMMAND)
+static bool handle_json_command(const char* data, size_t len) {
+    if (len == 0 || data[0] != '{') {
+        return false;
+    }
+    cJSON* root = cJSON_ParseWithLength(data, len);
+    if (root == nullptr) {
+        return false;
+    }
+    bool handled = false;
+    auto type = cJSON_GetObjectItem(root, "type");
+    if (cJSON_IsString(type) && strcmp(type->valuestring, "audio_trace") == 0) {
+        handled = true;
+#if CONFIG_AUDIO_TRACE
+        auto action = cJSON_GetObjectItem(root, "action");
+        bool to_ws = !(cJSON_IsString(action) && strcmp(action->valuestring, "uart") == 0);
+        xTaskCreate(audio_trace_dump_task, "audio_trace", 4096, to_ws ? (void*)1 : nullptr, 2, nullptr);
+#else
+        ESP_LOGW(TAG, "Audio trace requested but CONFIG_AUDIO_TRACE is disabled");
+#endif
+    } else if (cJSON_IsString(type) && strcmp(type->valuestring, "metrics") == 0) {
+        handled = true;
+        xTaskCreate(metrics_snapshot_task, "metrics", 3072, nullptr, 2, nullptr);
+    } else if (cJSON_IsString(type) && strcmp(type->valuestring, "opus_bench") == 0) {
+        handled = true;
+#if CONFIG_AUDIO_OPUS_BENCH_COMMAND
+        auto duration = cJSON_GetObjectItem(root, "frame_duration");
+        int current_ms = g_service ? g_service->frame_duration_ms() : OPUS_FRAME_DURATION_MS;
+        int frame_duration_ms = cJSON_IsNumber(duration) ? duration->valueint : current_ms;
+        if (frame_duration_ms != 10 && frame_duration_ms != 20 && frame_duration_ms != 40 && frame_duration_ms != 60) {
+            frame_duration_ms = current_ms;
+        }
+        // 栈与 opus_codec 任务相同；优先级低于它，运行中的编码会打断测量，应在空闲时请求
+        xTaskCreate(opus_bench_task, "opus_bench", 2048 * 13, (void*)(intptr_t)frame_duration_ms, 1, nullptr);
+#else
+        ESP_LOGW(TAG, "Opus benchmark requested but CONFIG_AUDIO_OPUS_BENCH_COMMAND is disabled");
+#endif
+    } else if (cJSON_IsString(type) && strcmp(type->valuestring, "tts") == 0) {
+        auto state = cJSON_GetObjectItem(root, "state");
+        if (cJSON_IsString(state) && (strcmp(state->valuestring, "sentence_end") == 0 || strcmp(state->valuestring, "stop") == 0)) {
+            handled = true;
+            if (g_service) {
+                g_service->EndDecodeStream();
+            }
+        }
+    }
+    cJSON_Delete(root);
+    return handled;
+}
+
+// 挂载为 AudioService 的 PCM 分接点，与编码器共享同一帧，不再额外拷贝
 void audio_afe_ws_hook(AudioService* service) {
     g_service = service;
-    service->SetAfeOutputCallback([](std::vector<int16_t>&& pcm) {
-        audio_afe_ws_send(pcm.data(), pcm.size());
+    service->AddPcmTap([](const PcmFrameRef& frame) {
+        audio_afe_ws_send(frame.data(), frame.size());
     });
 }
 
@@ -62,9 +182,10 @@ void audio_afe_ws_attach_downlink(AudioService* service) {
             return;
         }
 
-        auto packet = std::make_unique<AudioStreamPacket>();
+        auto packet = AudioBufferPool::GetInstance().AcquirePacket();
         packet->sample_rate = 24000;                 // 匹配硬件输出采样率，避免重采样
-        packet->frame_duration = OPUS_FRAME_DURATION_MS;
+        // 帧长双向一致：默认 CONFIG_AUDIO_FRAME_DURATION_MS，服务端可在 uplink_hello 回复中切换
+        packet->frame_duration = g_service->frame_duration_ms();
         packet->payload.assign(data, data + len);
 
         if (!g_service->PushPacketToDecodeQueue(std::move(packet), false)) {
@@ -72,9 +193,20 @@ void audio_afe_ws_attach_downlink(AudioService* service) {
         }
     });
 
+    // 上行帧长：hello 中上报当前值，服务端可在回复中要求切换
+    audio_uploader_set_frame_duration(service->frame_duration_ms());
+    audio_uploader_set_frame_duration_cb([](int frame_duration_ms) {
+        if (g_service && g_service->SetFrameDuration(frame_duration_ms)) {
+            audio_uploader_set_frame_duration(frame_duration_ms);
+        }
+    });
+
     audio_uploader_set_text_cb([](const char* data, size_t len) {
         ESP_LOGI(TAG, "WS text: %.*s", (int)len, data);
-        
+        if (handle_json_command(data, len)) {
+            return;
+        }
+
         // Handle volume control from server (numeric string "0"-"100")
         if (len > 0 && len < 4) { // Volume string shouldn't be long
             std::string text(data, len);
@@ -1,155 +1,289 @@
 #include "audio_uploader.h"
 #include <stdio.h>
 #include <string.h>
+#include <arpa/inet.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
-#include "freertos/queue.h"
+#include "freertos/ringbuf.h"
 #include "esp_log.h"
-#include "esp_websocket_client.h"
+#include "esp_timer.h"
+#include "cJSON.h"
+#include "ws_transport.h"
+#include "audio_trace.h"
+#include "metrics.h"
 
 // ---------------- 配置 ----------------
-#define WEBSOCKET_URI           "ws://118.195.133.25:8080/esp32"
+// 连接由 ws_transport 统一管理，本模块只负责音频通道和控制消息
 #define TAG                     "WS_UPLOADER"
 
-// 队列深度：Opus 60ms帧，150帧约9秒。
-#define SEND_QUEUE_LEN          150 
+// 发送环形缓冲区：预分配，入队只做一次 memcpy，不再每包 malloc/free
+// Opus 60ms帧几十字节，16KB 可缓存数秒；PCM 帧 1920 字节时约 8 帧
+#define SEND_RING_SIZE          (16 * 1024)
+// 环形缓冲区剩余空间低于此值时丢弃新包（保留余量，等价于原来的“队列剩余<5”）
+#define SEND_RING_RESERVE       512
 #define WS_SEND_TIMEOUT_MS      1000
 
+// 批量上行：把 N 帧（或时间窗口内的帧）合并为一条 WebSocket 二进制消息
+// 消息格式：[len_hi][len_lo][payload] 重复 N 次，len 为大端 uint16
+// CONFIG_AUDIO_UPLINK_BATCH_FRAMES 为 1 时保持原格式，每帧单独发送
+#define UPLINK_BATCH_FRAMES     CONFIG_AUDIO_UPLINK_BATCH_FRAMES
+#ifdef CONFIG_AUDIO_UPLINK_BATCH_TIMEOUT_MS
+#define UPLINK_BATCH_TIMEOUT_MS CONFIG_AUDIO_UPLINK_BATCH_TIMEOUT_MS
+#else
+#define UPLINK_BATCH_TIMEOUT_MS 0
+#endif
+#define UPLINK_BATCH_BUF_SIZE   WS_TRANSPORT_CHUNK_SIZE
+#define UPLINK_STATS_INTERVAL_MS 10000
+
 // ---------------- 状态管理 ----------------
-static esp_websocket_client_handle_t ws_client = NULL;
-static QueueHandle_t send_queue = NULL;
+static RingbufHandle_t send_ring = NULL;
 static TaskHandle_t send_task_handle = NULL;
 
 // 使用 volatile bool 避免多线程锁竞争
 static volatile bool is_connected = false;
 
+// 上行帧头协商结果，每次重连后重新协商
+static volatile bool uplink_header_enabled = false;
+static uint16_t uplink_sequence = 0;
+
 static audio_uploader_binary_cb_t binary_cb = NULL;
 static audio_uploader_text_cb_t text_cb = NULL;
+static audio_uploader_frame_duration_cb_t frame_duration_cb = NULL;
 
-typedef struct {
-    size_t len;
-    uint8_t* buf; 
-} queue_item_t;
+// 当前上行帧长，写入 uplink_hello
+static volatile int frame_duration_ms = 60;
 
-// ---------------- WebSocket 事件处理 ----------------
-static void websocket_event_handler(void *handler_args, esp_event_base_t base, int32_t event_id, void *event_data) {
-    esp_websocket_event_data_t *data = (esp_websocket_event_data_t *)event_data;
+// 批量发送缓冲区，仅发送任务访问
+static uint8_t batch_buf[UPLINK_BATCH_BUF_SIZE];
+static size_t batch_len = 0;
+static int batch_frames = 0;
+static TickType_t batch_deadline = 0;
 
-    switch (event_id) {
-        case WEBSOCKET_EVENT_CONNECTED:
-            ESP_LOGI(TAG, "WebSocket Connected!");
-            is_connected = true;
-            break;
+// 统计：帧数 / WebSocket 消息数 / 字节数
+static uint32_t stat_frames = 0;
+static uint32_t stat_messages = 0;
+static uint32_t stat_bytes = 0;
+static uint32_t stat_dropped = 0;
 
-        case WEBSOCKET_EVENT_DISCONNECTED:
-            ESP_LOGW(TAG, "WebSocket Disconnected!");
-            is_connected = false;
-            break;
+// 运行时指标 (metrics.h)，服务端可通过 {"type":"metrics"} 拉取
+static metric_t* metric_sent_frames = NULL;
+static metric_t* metric_sent_bytes = NULL;
+static metric_t* metric_dropped = NULL;         // 断连/发送失败丢弃的帧
+static metric_t* metric_ring_full = NULL;       // 环形缓冲区满丢弃的帧
+static metric_t* metric_send_us = NULL;
 
-        case WEBSOCKET_EVENT_DATA:
-            if (data->op_code == WS_TRANSPORT_OPCODES_BINARY) {
-                if (binary_cb) binary_cb((const uint8_t*)data->data_ptr, data->data_len);
-            } else if (data->op_code == WS_TRANSPORT_OPCODES_TEXT) {
-                if (text_cb) text_cb((const char*)data->data_ptr, data->data_len);
-            }
-            break;
+// ---------------- 上行帧头 / 通道复用协商 ----------------
+static void send_uplink_hello() {
+    char hello[160];
+    int len = snprintf(hello, sizeof(hello), "{\"type\":\"uplink_hello\",\"uplink_header\":%d,\"mux\":%d,"
+        "\"flags\":\"vad\",\"frame_duration\":%d,\"frame_durations\":[10,20,40,60]}",
+        AUDIO_UPLINK_HEADER_VERSION, WS_MUX_VERSION, frame_duration_ms);
+    ws_transport_send_text(hello, len, pdMS_TO_TICKS(WS_SEND_TIMEOUT_MS));
+}
 
-        case WEBSOCKET_EVENT_ERROR:
-            ESP_LOGE(TAG, "WebSocket Error!");
-            break;
+// 服务端确认帧头版本，返回 true 表示已处理该消息
+static bool handle_uplink_hello(const char* data, size_t len) {
+    if (len == 0 || data[0] != '{') {
+        return false;
+    }
+    cJSON* root = cJSON_ParseWithLength(data, len);
+    if (root == NULL) {
+        return false;
     }
+    bool handled = false;
+    cJSON* type = cJSON_GetObjectItem(root, "type");
+    if (cJSON_IsString(type) && strcmp(type->valuestring, "uplink_hello") == 0) {
+        cJSON* version = cJSON_GetObjectItem(root, "uplink_header");
+        uplink_header_enabled = cJSON_IsNumber(version) && version->valueint == AUDIO_UPLINK_HEADER_VERSION;
+        ESP_LOGI(TAG, "Uplink frame header %s", uplink_header_enabled ? "enabled" : "disabled");
+        // 服务端未回复 mux 时保持裸帧格式 (二进制即音频)
+        cJSON* mux = cJSON_GetObjectItem(root, "mux");
+        ws_transport_set_mux(cJSON_IsNumber(mux) && mux->valueint == WS_MUX_VERSION);
+        cJSON* duration = cJSON_GetObjectItem(root, "frame_duration");
+        if (cJSON_IsNumber(duration) && duration->valueint != frame_duration_ms && frame_duration_cb) {
+            frame_duration_cb(duration->valueint);
+        }
+        handled = true;
+    }
+    cJSON_Delete(root);
+    return handled;
+}
+
+// ---------------- 连接事件 ----------------
+static void on_transport_state(bool connected) {
+    is_connected = connected;
+    if (connected) {
+        uplink_header_enabled = false;
+        send_uplink_hello();
+    }
+}
+
+static void on_transport_text(const char* data, size_t len) {
+    if (handle_uplink_hello(data, len)) {
+        return;
+    }
+    if (text_cb) text_cb(data, len);
+}
+
+static void on_audio_down(const uint8_t* data, size_t len) {
+    if (binary_cb) binary_cb(data, len);
 }
 
 // 🔥 新增：清空队列
 // 当网络断开时，必须清空积压的旧数据，否则重连后你会听到几秒前的录音，产生巨大延迟
 static void clear_queue() {
-    queue_item_t item;
-    int dropped_count = 0;
-    while (xQueueReceive(send_queue, &item, 0) == pdTRUE) {
-        if (item.buf) free(item.buf);
+    size_t len;
+    void* item;
+    int dropped_count = batch_frames;
+    while ((item = xRingbufferReceive(send_ring, &len, 0)) != NULL) {
+        vRingbufferReturnItem(send_ring, item);
         dropped_count++;
     }
+    batch_len = 0;
+    batch_frames = 0;
+    metric_add(metric_dropped, dropped_count);
     if (dropped_count > 0) {
         ESP_LOGW(TAG, "网络中断，丢弃积压音频包: %d 个", dropped_count);
     }
 }
 
+// 发送一条 WebSocket 二进制消息，失败时触发熔断
+static void send_message(const uint8_t* data, size_t len, int frames) {
+    if (!is_connected || !ws_transport_is_connected()) {
+        // 如果未连接或连接未就绪，直接丢弃
+        stat_dropped += frames;
+        metric_add(metric_dropped, frames);
+        return;
+    }
+
+    static uint16_t trace_id = 0;
+    int64_t send_start = esp_timer_get_time();
+    AUDIO_TRACE(AUDIO_TRACE_WS_SEND_START, trace_id);
+    int ret = ws_transport_send(WS_CHANNEL_AUDIO_UP, data, len, pdMS_TO_TICKS(WS_SEND_TIMEOUT_MS));
+    AUDIO_TRACE(AUDIO_TRACE_WS_SEND_END, trace_id);
+    trace_id++;
+    metric_observe(metric_send_us, esp_timer_get_time() - send_start);
+
+    // 🔥 核心修复：发送失败时的熔断机制
+    if (ret < 0) {
+        ESP_LOGE(TAG, "发送失败 (ret=%d)，暂停发送等待重连...", ret);
+
+        // A. 强制标记断开，阻止新数据入队
+        is_connected = false;
+
+        // B. 清空所有积压数据 (避免延迟)
+        stat_dropped += frames;
+        metric_add(metric_dropped, frames);
+        clear_queue();
+
+        // C. 🔥 强制休眠 2 秒！
+        // 这是解决刷屏的关键。给底层 Wi-Fi 协议栈时间去扫描和重连，
+        // 避免 CPU 被死循环占满导致 Wi-Fi 无法恢复。
+        vTaskDelay(pdMS_TO_TICKS(2000));
+        return;
+    }
+
+    stat_frames += frames;
+    stat_messages++;
+    stat_bytes += len;
+    metric_add(metric_sent_frames, frames);
+    metric_add(metric_sent_bytes, len);
+}
+
+static void flush_batch() {
+    if (batch_frames == 0) {
+        return;
+    }
+    // 先清空批次状态，send_message 失败时会再次清理
+    size_t len = batch_len;
+    int frames = batch_frames;
+    batch_len = 0;
+    batch_frames = 0;
+    send_message(batch_buf, len, frames);
+}
+
+static void append_batch(const uint8_t* data, size_t len) {
+    if (batch_len + 2 + len > sizeof(batch_buf)) {
+        flush_batch();
+    }
+    if (2 + len > sizeof(batch_buf) || len > 0xFFFF) {
+        // 单帧超过批量缓冲区（如大块 PCM），按原格式单独发送
+        send_message(data, len, 1);
+        return;
+    }
+    if (batch_frames == 0) {
+        batch_deadline = xTaskGetTickCount() + pdMS_TO_TICKS(UPLINK_BATCH_TIMEOUT_MS);
+    }
+    batch_buf[batch_len++] = (uint8_t)(len >> 8);
+    batch_buf[batch_len++] = (uint8_t)(len & 0xFF);
+    memcpy(batch_buf + batch_len, data, len);
+    batch_len += len;
+    batch_frames++;
+    if (batch_frames >= UPLINK_BATCH_FRAMES) {
+        flush_batch();
+    }
+}
+
+static void log_stats(TickType_t* last_log) {
+    TickType_t now = xTaskGetTickCount();
+    if (now - *last_log < pdMS_TO_TICKS(UPLINK_STATS_INTERVAL_MS)) {
+        return;
+    }
+    uint32_t seconds = (now - *last_log) * portTICK_PERIOD_MS / 1000;
+    if (stat_frames > 0 || stat_dropped > 0) {
+        ESP_LOGI(TAG, "uplink: %lu frames/s, %lu msgs/s, %lu B/s, dropped %lu",
+            stat_frames / seconds, stat_messages / seconds, stat_bytes / seconds, stat_dropped);
+    }
+    stat_frames = stat_messages = stat_bytes = stat_dropped = 0;
+    *last_log = now;
+}
+
 // ---------------- 发送任务 (消费者) ----------------
 static void audio_send_task(void* arg) {
-    queue_item_t item;
-    
+    TickType_t last_log = xTaskGetTickCount();
+
     while (true) {
-        // 1. 等待数据
-        if (xQueueReceive(send_queue, &item, portMAX_DELAY) == pdTRUE) {
-            
-            // 2. 检查连接状态
-            // 增加 esp_websocket_client_is_connected 检查，确保底层连接完全就绪
-            if (is_connected && ws_client != NULL && esp_websocket_client_is_connected(ws_client)) {
-                
-                int ret = esp_websocket_client_send_bin(ws_client, (const char*)item.buf, item.len, pdMS_TO_TICKS(WS_SEND_TIMEOUT_MS));
-                
-                // 🔥 核心修复：发送失败时的熔断机制
-                if (ret < 0) {
-                    ESP_LOGE(TAG, "发送失败 (ret=%d)，暂停发送等待重连...", ret);
-                    
-                    // A. 强制标记断开，阻止新数据入队
-                    is_connected = false; 
-                    
-                    // B. 释放当前包内存
-                    if (item.buf) {
-                        free(item.buf); 
-                        item.buf = NULL; // 避免悬空指针
-                    }
-
-                    // C. 清空所有积压队列 (避免延迟和内存泄漏)
-                    clear_queue();
-
-                    // D. 🔥 强制休眠 2 秒！
-                    // 这是解决刷屏的关键。给底层 Wi-Fi 协议栈时间去扫描和重连，
-                    // 避免 CPU 被死循环占满导致 Wi-Fi 无法恢复。
-                    vTaskDelay(pdMS_TO_TICKS(2000));
-                    continue; // 跳过本次循环剩余部分，进入下一轮等待
-                }
-            } else {
-                // 如果未连接或连接未就绪，直接丢弃当前包
-                // ESP_LOGW(TAG, "WebSocket not connected or not ready, dropping audio packet.");
-                if (item.buf) {
-                    free(item.buf);
-                    item.buf = NULL;
-                }
-            }
-            
-            // 正常发送成功，释放内存
-            if (item.buf) {
-                free(item.buf);
-                item.buf = NULL;
-            }
+        // 1. 等待数据；有未发出的批次时最多等到批次截止时间
+        TickType_t wait = portMAX_DELAY;
+        if (batch_frames > 0) {
+            TickType_t now = xTaskGetTickCount();
+            wait = (int32_t)(batch_deadline - now) > 0 ? batch_deadline - now : 0;
+        }
+
+        size_t len = 0;
+        uint8_t* item = (uint8_t*)xRingbufferReceive(send_ring, &len, wait);
+        if (item == NULL) {
+            flush_batch();
+        } else if (UPLINK_BATCH_FRAMES <= 1) {
+            send_message(item, len, 1);
+            vRingbufferReturnItem(send_ring, item);
+        } else {
+            append_batch(item, len);
+            vRingbufferReturnItem(send_ring, item);
         }
+
+        log_stats(&last_log);
     }
 }
 
 // ---------------- 公共接口 ----------------
 
 void audio_uploader_init(void) {
-    if (send_queue == NULL) {
-        send_queue = xQueueCreate(SEND_QUEUE_LEN, sizeof(queue_item_t));
-    }
-
-    esp_websocket_client_config_t config = {
-        .uri = WEBSOCKET_URI,
-        .reconnect_timeout_ms = 3000,   // 3秒重连
-        .network_timeout_ms = 5000,     // 5秒超时
-        .buffer_size = 4096,
-        .disable_auto_reconnect = false,
-        .keep_alive_enable = true,
-        .keep_alive_idle = 4,           // 激进的保活检测：4秒无数据就检测
-        .keep_alive_interval = 4,
-        .keep_alive_count = 2
-    };
-
-    ws_client = esp_websocket_client_init(&config);
-    esp_websocket_register_events(ws_client, WEBSOCKET_EVENT_ANY, websocket_event_handler, NULL);
-    esp_websocket_client_start(ws_client);
+    if (send_ring == NULL) {
+        send_ring = xRingbufferCreate(SEND_RING_SIZE, RINGBUF_TYPE_NOSPLIT);
+    }
+    if (metric_sent_frames == NULL) {
+        metric_sent_frames = metrics_register("uplink.sent_frames", METRIC_COUNTER);
+        metric_sent_bytes = metrics_register("uplink.sent_bytes", METRIC_COUNTER);
+        metric_dropped = metrics_register("uplink.dropped_frames", METRIC_COUNTER);
+        metric_ring_full = metrics_register("uplink.ring_full_frames", METRIC_COUNTER);
+        metric_send_us = metrics_register("uplink.send_us", METRIC_HISTOGRAM);
+    }
+
+    ws_transport_add_state_cb(on_transport_state);
+    ws_transport_set_text_cb(on_transport_text);
+    ws_transport_set_channel_cb(WS_CHANNEL_AUDIO_DOWN, on_audio_down);
+    ws_transport_init();
 
     if (send_task_handle == NULL) {
         xTaskCreate(audio_send_task, "ws_send_task", 4096, NULL, 5, &send_task_handle);
@@ -158,25 +292,52 @@ void audio_uploader_init(void) {
 
 void audio_uploader_send_bytes(const uint8_t *data, size_t len) {
     // 1. 快速检查：断连时直接丢弃，不进队列
-    if (!is_connected || data == NULL || len == 0) {
+    if (!is_connected || send_ring == NULL || data == NULL || len == 0 || len > WS_TRANSPORT_CHUNK_SIZE) {
         return;
     }
 
-    // 2. 队列满时丢弃最新的（保最新）
-    if (uxQueueSpacesAvailable(send_queue) < 5) {
+    // 2. 缓冲区快满时丢弃最新的（保最新）
+    if (xRingbufferGetCurFreeSize(send_ring) < len + SEND_RING_RESERVE) {
         // ESP_LOGW(TAG, "队列满，丢包"); // 注释掉减少日志干扰
+        metric_inc(metric_ring_full);
         return;
     }
 
-    uint8_t* buf_copy = (uint8_t*)malloc(len);
-    if (!buf_copy) return;
-    memcpy(buf_copy, data, len);
+    // 3. 拷贝进预分配的环形缓冲区，不阻塞
+    xRingbufferSend(send_ring, data, len, 0);
+}
+
+void audio_uploader_send_frame(const uint8_t *data, size_t len, uint32_t timestamp_ms,
+                               uint16_t frame_duration_ms, bool voice) {
+    // 序号在丢弃前递增，服务端据此区分丢包和静音
+    uint16_t sequence = uplink_sequence++;
+    if (!uplink_header_enabled) {
+        audio_uploader_send_bytes(data, len);
+        return;
+    }
+    size_t total = sizeof(audio_uplink_header_t) + len;
+    if (!is_connected || send_ring == NULL || data == NULL || len == 0 || total > WS_TRANSPORT_CHUNK_SIZE) {
+        return;
+    }
 
-    queue_item_t item = { .len = len, .buf = buf_copy };
+    if (xRingbufferGetCurFreeSize(send_ring) < total + SEND_RING_RESERVE) {
+        metric_inc(metric_ring_full);
+        return;
+    }
 
-    if (xQueueSend(send_queue, &item, 0) != pdTRUE) {
-        free(buf_copy);
+    // 直接在环形缓冲区中组帧，避免额外拷贝
+    audio_uplink_header_t* header = NULL;
+    if (xRingbufferSendAcquire(send_ring, (void**)&header, total, 0) != pdTRUE) {
+        return;
     }
+    header->version = AUDIO_UPLINK_HEADER_VERSION;
+    header->flags = voice ? AUDIO_UPLINK_FLAG_VOICE : 0;
+    header->sequence = htons(sequence);
+    header->timestamp = htonl(timestamp_ms);
+    header->frame_duration = htons(frame_duration_ms);
+    header->payload_size = htons((uint16_t)len);
+    memcpy(header->payload, data, len);
+    xRingbufferSendComplete(send_ring, header);
 }
 
 // 兼容接口：如果还想发 PCM，封装一下即可
@@ -190,4 +351,12 @@ void audio_uploader_set_binary_cb(audio_uploader_binary_cb_t cb) {
 
 void audio_uploader_set_text_cb(audio_uploader_text_cb_t cb) {
     text_cb = cb;
+}
+
+void audio_uploader_set_frame_duration_cb(audio_uploader_frame_duration_cb_t cb) {
+    frame_duration_cb = cb;
+}
+
+void audio_uploader_set_frame_duration(int duration_ms) {
+    frame_duration_ms = duration_ms;
 }
\ No newline at end of file
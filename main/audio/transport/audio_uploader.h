@@ -14,17 +14,49 @@ void audio_uploader_init(void);
 
 // 发送二进制数据 (Opus包或PCM)
 // 内部会自动处理内存拷贝和队列管理，网络断开时会自动丢弃
+// CONFIG_AUDIO_UPLINK_BATCH_FRAMES > 1 时多帧合并为一条消息：
+//   [len_hi][len_lo][payload] [len_hi][len_lo][payload] ...  (len 为大端 uint16)
 void audio_uploader_send_bytes(const uint8_t *data, size_t len);
 
 // 发送 PCM 数据 (兼容旧接口)
 void audio_uploader_send(const int16_t *data, int samples);
 
+// ---------------- 上行帧头 ----------------
+// 连接建立后设备发送 {"type":"uplink_hello","uplink_header":1,...}，
+// 服务端回复 {"type":"uplink_hello","uplink_header":1} 后，每个 Opus 帧前加上以下帧头；
+// 未协商成功时保持原来的裸 Opus 格式。所有多字节字段为大端。
+// 同一条 hello 还携带 "mux":WS_MUX_VERSION，服务端回复中带相同的 "mux" 才启用通道复用 (ws_transport.h)。
+#define AUDIO_UPLINK_HEADER_VERSION     1
+#define AUDIO_UPLINK_FLAG_VOICE         (1 << 0)   // VAD 检测到人声
+
+typedef struct {
+    uint8_t version;            // AUDIO_UPLINK_HEADER_VERSION
+    uint8_t flags;              // AUDIO_UPLINK_FLAG_*
+    uint16_t sequence;          // 每帧递增，回绕；上行丢弃的帧也占用序号
+    uint32_t timestamp;         // 采集时间 (ms, 设备启动后单调时钟)
+    uint16_t frame_duration;    // 帧长 (ms)
+    uint16_t payload_size;      // Opus 数据长度
+    uint8_t payload[];
+} __attribute__((packed)) audio_uplink_header_t;
+
+// 发送一帧 Opus 数据，协商成功时自动加上帧头
+void audio_uploader_send_frame(const uint8_t *data, size_t len, uint32_t timestamp_ms,
+                               uint16_t frame_duration_ms, bool voice);
+
+// ---------------- 帧长协商 ----------------
+// uplink_hello 携带当前帧长和支持的帧长：
+//   {"type":"uplink_hello",...,"frame_duration":60,"frame_durations":[10,20,40,60]}
+// 服务端回复中带 "frame_duration" 时通过回调切换帧长；下行 Opus 包按同一帧长解码。
+void audio_uploader_set_frame_duration(int frame_duration_ms);
+
 // 回调函数定义
 typedef void (*audio_uploader_binary_cb_t)(const uint8_t *data, size_t len);
 typedef void (*audio_uploader_text_cb_t)(const char *data, size_t len);
+typedef void (*audio_uploader_frame_duration_cb_t)(int frame_duration_ms);
 
 void audio_uploader_set_binary_cb(audio_uploader_binary_cb_t cb);
 void audio_uploader_set_text_cb(audio_uploader_text_cb_t cb);
+void audio_uploader_set_frame_duration_cb(audio_uploader_frame_duration_cb_t cb);
 
 #ifdef __cplusplus
 }
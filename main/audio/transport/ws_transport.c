@@ -0,0 +1,407 @@
+#include "ws_transport.h"
+#include <string.h>
+#include <stdatomic.h>
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_websocket_client.h"
+#include "esp_timer.h"
+
+#define TAG                     "WS_TRANSPORT"
+
+// ---------------- 发送调度 ----------------
+// 两个优先级：控制/音频为高优先级，视频为低优先级。
+//   1. 严格优先级：有高优先级消息在等待时，低优先级分块不会去抢发送锁
+//   2. 令牌桶：视频只能使用上行总带宽减去音频实际占用后剩余的部分
+#define UPLINK_KBPS             CONFIG_WS_TRANSPORT_UPLINK_KBPS
+#define VIDEO_BUCKET_BYTES      (2 * WS_TRANSPORT_CHUNK_SIZE)
+#define AUDIO_RATE_WINDOW_US    (500 * 1000)
+#define STATS_INTERVAL_US       (10 * 1000 * 1000)
+
+static esp_websocket_client_handle_t ws_client = NULL;
+static SemaphoreHandle_t send_mutex = NULL;
+static volatile bool is_connected = false;
+// 复用格式协商结果，每次连接状态变化都恢复为裸帧格式
+static volatile bool mux_enabled = false;
+
+// 发送暂存区：头部 + 一个分块，受 send_mutex 保护
+static uint8_t tx_buf[WS_MUX_HEADER_SIZE + WS_TRANSPORT_CHUNK_SIZE];
+
+// 等待发送的高优先级消息数
+static atomic_int high_waiting = 0;
+
+// 视频令牌桶 (字节)，仅在持有 send_mutex 时修改
+static int64_t video_tokens = VIDEO_BUCKET_BYTES;
+static int64_t bucket_update_us = 0;
+static uint32_t audio_window_bytes = 0;
+static int64_t audio_window_start_us = 0;
+static uint32_t audio_kbps = 0;
+
+// 每个优先级的排队时延统计 (调用发送到真正开始发送)
+typedef struct {
+    uint32_t count;
+    uint32_t bytes;
+    int64_t total_wait_us;
+    int64_t max_wait_us;
+} class_stats_t;
+static class_stats_t class_stats[WS_CLASS_MAX] = { 0 };
+static int64_t stats_start_us = 0;
+
+// 接收拼接区：仅 WebSocket 事件任务访问
+#define RX_BUF_SIZE             (WS_MUX_HEADER_SIZE + WS_TRANSPORT_CHUNK_SIZE)
+static uint8_t rx_buf[RX_BUF_SIZE];
+static size_t rx_len = 0;
+static uint8_t rx_op = 0;
+static bool rx_overflow = false;
+
+static ws_transport_data_cb_t channel_cbs[WS_CHANNEL_MAX] = { 0 };
+static ws_transport_text_cb_t text_cb = NULL;
+static ws_transport_state_cb_t state_cbs[WS_TRANSPORT_MAX_STATE_CBS] = { 0 };
+
+static void notify_state(bool connected) {
+    for (int i = 0; i < WS_TRANSPORT_MAX_STATE_CBS; i++) {
+        if (state_cbs[i]) state_cbs[i](connected);
+    }
+}
+
+// ---------------- WebSocket 事件处理 ----------------
+// 一条完整消息：文本交给控制回调，二进制按协商格式分发
+static void dispatch_message(uint8_t op_code, const uint8_t *msg, size_t len) {
+    if (op_code == WS_TRANSPORT_OPCODES_TEXT) {
+        if (text_cb) text_cb((const char *)msg, len);
+        return;
+    }
+    if (!mux_enabled) {
+        // 裸帧格式：二进制消息即下行音频
+        if (channel_cbs[WS_CHANNEL_AUDIO_DOWN]) channel_cbs[WS_CHANNEL_AUDIO_DOWN](msg, len);
+        return;
+    }
+    if (len < WS_MUX_HEADER_SIZE) {
+        return;
+    }
+    uint8_t channel = msg[0];
+    if (channel < WS_CHANNEL_MAX && channel_cbs[channel]) {
+        channel_cbs[channel](msg + WS_MUX_HEADER_SIZE, len - WS_MUX_HEADER_SIZE);
+    }
+}
+
+static void handle_data(const esp_websocket_event_data_t *data) {
+    const uint8_t *ptr = (const uint8_t *)data->data_ptr;
+    size_t len = data->data_len > 0 ? data->data_len : 0;
+    bool frame_done = data->payload_offset + data->data_len >= data->payload_len;
+
+    if (data->op_code == WS_TRANSPORT_OPCODES_TEXT || data->op_code == WS_TRANSPORT_OPCODES_BINARY) {
+        if (data->payload_offset == 0) {
+            // 常见情况：整条消息在一个事件里，直接回调不拷贝
+            if (frame_done && data->fin) {
+                dispatch_message(data->op_code, ptr, len);
+                return;
+            }
+            rx_op = data->op_code;
+            rx_len = 0;
+            rx_overflow = false;
+        }
+    } else if (data->op_code != WS_TRANSPORT_OPCODES_CONT) {
+        // PING / PONG / CLOSE 由 esp_websocket_client 处理
+        return;
+    }
+    if (rx_op == 0) {
+        return;
+    }
+
+    if (rx_len + len > RX_BUF_SIZE) {
+        rx_overflow = true;
+    } else if (!rx_overflow && len > 0) {
+        memcpy(rx_buf + rx_len, ptr, len);
+        rx_len += len;
+    }
+    if (!frame_done || !data->fin) {
+        return;
+    }
+    if (rx_overflow) {
+        ESP_LOGW(TAG, "Dropped oversized message (op %d, > %d bytes)", rx_op, RX_BUF_SIZE);
+    } else {
+        dispatch_message(rx_op, rx_buf, rx_len);
+    }
+    rx_op = 0;
+    rx_len = 0;
+    rx_overflow = false;
+}
+
+static void websocket_event_handler(void *handler_args, esp_event_base_t base, int32_t event_id, void *event_data) {
+    esp_websocket_event_data_t *data = (esp_websocket_event_data_t *)event_data;
+
+    switch (event_id) {
+        case WEBSOCKET_EVENT_CONNECTED:
+            ESP_LOGI(TAG, "WebSocket Connected!");
+            is_connected = true;
+            mux_enabled = false;
+            rx_op = 0;
+            rx_len = 0;
+            notify_state(true);
+            break;
+
+        case WEBSOCKET_EVENT_DISCONNECTED:
+            ESP_LOGW(TAG, "WebSocket Disconnected!");
+            is_connected = false;
+            mux_enabled = false;
+            notify_state(false);
+            break;
+
+        case WEBSOCKET_EVENT_DATA:
+            handle_data(data);
+            break;
+
+        case WEBSOCKET_EVENT_ERROR:
+            ESP_LOGE(TAG, "WebSocket Error!");
+            break;
+    }
+}
+
+// ---------------- 公共接口 ----------------
+
+void ws_transport_init(void) {
+    if (ws_client != NULL) {
+        return;
+    }
+    send_mutex = xSemaphoreCreateMutex();
+
+    esp_websocket_client_config_t config = {
+        .uri = CONFIG_WS_TRANSPORT_URI,
+        .reconnect_timeout_ms = 3000,   // 3秒重连
+        .network_timeout_ms = 5000,     // 5秒超时
+        .buffer_size = RX_BUF_SIZE,     // 一条复用消息 (头部 + 一个分块) 可在一个事件内收完
+        .disable_auto_reconnect = false,
+        .keep_alive_enable = true,
+        .keep_alive_idle = 4,           // 激进的保活检测：4秒无数据就检测
+        .keep_alive_interval = 4,
+        .keep_alive_count = 2
+    };
+
+    ws_client = esp_websocket_client_init(&config);
+    esp_websocket_register_events(ws_client, WEBSOCKET_EVENT_ANY, websocket_event_handler, NULL);
+    esp_websocket_client_start(ws_client);
+}
+
+bool ws_transport_is_connected(void) {
+    // 增加 esp_websocket_client_is_connected 检查，确保底层连接完全就绪
+    return is_connected && ws_client != NULL && esp_websocket_client_is_connected(ws_client);
+}
+
+void ws_transport_set_mux(bool enabled) {
+    if (enabled != mux_enabled) {
+        ESP_LOGI(TAG, "Channel mux %s", enabled ? "enabled" : "disabled");
+    }
+    mux_enabled = enabled;
+}
+
+bool ws_transport_mux_enabled(void) {
+    return mux_enabled;
+}
+
+static ws_class_t channel_class(ws_channel_t channel) {
+    switch (channel) {
+    case WS_CHANNEL_VIDEO:
+    case WS_CHANNEL_TRACE:
+    case WS_CHANNEL_METRICS:
+        return WS_CLASS_LOW;
+    default:
+        return WS_CLASS_HIGH;
+    }
+}
+
+// 持有 send_mutex 时调用
+static void refill_video_tokens(int64_t now) {
+    if (now - audio_window_start_us >= AUDIO_RATE_WINDOW_US) {
+        uint32_t kbps = (uint64_t)audio_window_bytes * 8 * 1000 / (now - audio_window_start_us);
+        audio_kbps = (audio_kbps * 3 + kbps) / 4;
+        audio_window_bytes = 0;
+        audio_window_start_us = now;
+    }
+    int32_t video_kbps = UPLINK_KBPS - (int32_t)audio_kbps;
+    if (video_kbps < UPLINK_KBPS / 10) {
+        video_kbps = UPLINK_KBPS / 10;
+    }
+    if (bucket_update_us != 0) {
+        // kbps * us / 8000 = bytes
+        video_tokens += (now - bucket_update_us) * video_kbps / 8000;
+        if (video_tokens > VIDEO_BUCKET_BYTES) {
+            video_tokens = VIDEO_BUCKET_BYTES;
+        }
+    }
+    bucket_update_us = now;
+}
+
+static void log_stats(int64_t now) {
+    if (stats_start_us == 0) {
+        stats_start_us = now;
+        return;
+    }
+    if (now - stats_start_us < STATS_INTERVAL_US) {
+        return;
+    }
+    static const char* names[WS_CLASS_MAX] = { "audio", "video" };
+    for (int i = 0; i < WS_CLASS_MAX; i++) {
+        class_stats_t* st = &class_stats[i];
+        if (st->count > 0) {
+            ESP_LOGI(TAG, "%s: %lu msgs, %lu kbps, queueing avg %d ms max %d ms", names[i], st->count,
+                (uint32_t)((uint64_t)st->bytes * 8 * 1000 / (now - stats_start_us)),
+                (int)(st->total_wait_us / st->count / 1000), (int)(st->max_wait_us / 1000));
+        }
+    }
+    memset(class_stats, 0, sizeof(class_stats));
+    stats_start_us = now;
+}
+
+// 获取发送锁；低优先级消息先让路给等待中的高优先级消息，再等待令牌
+static bool acquire_send_slot(ws_class_t cls, size_t len, TickType_t timeout) {
+    TickType_t start = xTaskGetTickCount();
+    if (cls == WS_CLASS_HIGH) {
+        atomic_fetch_add(&high_waiting, 1);
+        bool ok = xSemaphoreTake(send_mutex, timeout) == pdTRUE;
+        atomic_fetch_sub(&high_waiting, 1);
+        return ok;
+    }
+
+    while (true) {
+        TickType_t elapsed = xTaskGetTickCount() - start;
+        if (elapsed >= timeout) {
+            return false;
+        }
+        if (atomic_load(&high_waiting) > 0) {
+            vTaskDelay(1);
+            continue;
+        }
+        if (xSemaphoreTake(send_mutex, timeout - elapsed) != pdTRUE) {
+            return false;
+        }
+        if (atomic_load(&high_waiting) > 0) {
+            xSemaphoreGive(send_mutex);
+            continue;
+        }
+        refill_video_tokens(esp_timer_get_time());
+        if (video_tokens >= (int64_t)len) {
+            return true;
+        }
+        // 令牌不足：按视频可用带宽估算等待时间
+        int32_t video_kbps = UPLINK_KBPS - (int32_t)audio_kbps;
+        if (video_kbps < UPLINK_KBPS / 10) {
+            video_kbps = UPLINK_KBPS / 10;
+        }
+        int64_t wait_us = ((int64_t)len - video_tokens) * 8000 / video_kbps;
+        xSemaphoreGive(send_mutex);
+        vTaskDelay(pdMS_TO_TICKS(wait_us / 1000) + 1);
+    }
+}
+
+static int send_message(ws_channel_t channel, uint8_t flags, const uint8_t *data, size_t len, TickType_t timeout) {
+    if (!ws_transport_is_connected()) {
+        return -1;
+    }
+    // 裸帧格式下只有上行音频有对应的格式，其余通道不占用发送锁和令牌
+    if (!mux_enabled && channel != WS_CHANNEL_AUDIO_UP) {
+        return -1;
+    }
+    ws_class_t cls = channel_class(channel);
+    int64_t enqueue_us = esp_timer_get_time();
+    if (!acquire_send_slot(cls, len + WS_MUX_HEADER_SIZE, timeout)) {
+        return -1;
+    }
+    int64_t now = esp_timer_get_time();
+
+    // 协商结果可能在排队期间被重连清除，持锁后再确定格式
+    int ret;
+    size_t bytes;
+    if (mux_enabled) {
+        tx_buf[0] = (uint8_t)channel;
+        tx_buf[1] = flags;
+        memcpy(tx_buf + WS_MUX_HEADER_SIZE, data, len);
+        bytes = len + WS_MUX_HEADER_SIZE;
+        ret = esp_websocket_client_send_bin(ws_client, (const char *)tx_buf, bytes, timeout);
+    } else if (channel == WS_CHANNEL_AUDIO_UP) {
+        bytes = len;
+        ret = esp_websocket_client_send_bin(ws_client, (const char *)data, bytes, timeout);
+    } else {
+        xSemaphoreGive(send_mutex);
+        return -1;
+    }
+
+    if (ret >= 0) {
+        if (cls == WS_CLASS_HIGH) {
+            audio_window_bytes += bytes;
+        } else {
+            video_tokens -= bytes;
+        }
+        class_stats_t* st = &class_stats[cls];
+        int64_t wait_us = now - enqueue_us;
+        st->count++;
+        st->bytes += bytes;
+        st->total_wait_us += wait_us;
+        if (wait_us > st->max_wait_us) {
+            st->max_wait_us = wait_us;
+        }
+    }
+    log_stats(now);
+    xSemaphoreGive(send_mutex);
+    return ret;
+}
+
+int ws_transport_send(ws_channel_t channel, const uint8_t *data, size_t len, TickType_t timeout) {
+    if (len > WS_TRANSPORT_CHUNK_SIZE) {
+        ESP_LOGE(TAG, "Message too large for channel %d: %u", channel, (unsigned int)len);
+        return -1;
+    }
+    return send_message(channel, WS_MUX_FLAG_FIRST | WS_MUX_FLAG_LAST, data, len, timeout);
+}
+
+int ws_transport_send_chunked(ws_channel_t channel, const uint8_t *data, size_t len, TickType_t timeout) {
+    size_t offset = 0;
+    do {
+        size_t chunk = len - offset;
+        if (chunk > WS_TRANSPORT_CHUNK_SIZE) {
+            chunk = WS_TRANSPORT_CHUNK_SIZE;
+        }
+        uint8_t flags = 0;
+        if (offset == 0) flags |= WS_MUX_FLAG_FIRST;
+        if (offset + chunk == len) flags |= WS_MUX_FLAG_LAST;
+        // 每块之间释放锁并重新排队，等待中的音频消息会先发送
+        int ret = send_message(channel, flags, data + offset, chunk, timeout);
+        if (ret < 0) {
+            return ret;
+        }
+        offset += chunk;
+    } while (offset < len);
+    return (int)len;
+}
+
+int ws_transport_send_text(const char *data, size_t len, TickType_t timeout) {
+    if (!ws_transport_is_connected()) {
+        return -1;
+    }
+    if (!acquire_send_slot(WS_CLASS_HIGH, len, timeout)) {
+        return -1;
+    }
+    int ret = esp_websocket_client_send_text(ws_client, data, len, timeout);
+    xSemaphoreGive(send_mutex);
+    return ret;
+}
+
+void ws_transport_set_channel_cb(ws_channel_t channel, ws_transport_data_cb_t cb) {
+    if (channel < WS_CHANNEL_MAX) {
+        channel_cbs[channel] = cb;
+    }
+}
+
+void ws_transport_set_text_cb(ws_transport_text_cb_t cb) {
+    text_cb = cb;
+}
+
+void ws_transport_add_state_cb(ws_transport_state_cb_t cb) {
+    for (int i = 0; i < WS_TRANSPORT_MAX_STATE_CBS; i++) {
+        if (state_cbs[i] == NULL || state_cbs[i] == cb) {
+            state_cbs[i] = cb;
+            return;
+        }
+    }
+    ESP_LOGE(TAG, "Too many state callbacks");
+}
@@ -0,0 +1,86 @@
+#ifndef WS_TRANSPORT_H
+#define WS_TRANSPORT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "freertos/FreeRTOS.h"
+
+// 单一 WebSocket 连接，承载音频上行/下行、JSON 控制消息，以及协商后的视频/追踪/指标
+//
+// 默认 (未协商) 为原来的裸帧格式：二进制消息即音频 (上行 Opus / 下行 Opus)，文本消息即控制。
+// 设备在 uplink_hello 中携带 "mux":WS_MUX_VERSION，服务端回复同样的字段后切换为复用格式，
+// 每次重连都回到裸帧格式重新协商：
+//
+// 二进制消息格式：[channel][flags][payload]
+//   channel: ws_channel_t
+//   flags:   WS_MUX_FLAG_*，大块数据（视频帧）被拆成多条消息，FIRST/LAST 标记边界
+// 文本消息即控制通道 (JSON / 音量字符串)，不加前缀。
+// 裸帧格式下只能发送 WS_CHANNEL_AUDIO_UP，其余二进制通道的发送返回 -1。
+//
+// 接收：一条消息可能被 esp_websocket_client 拆成多个事件 (payload_offset / payload_len)，
+// 也可能是多个 WebSocket 分片 (CONT + fin)；此处拼接完整后再回调，
+// 超过 WS_MUX_HEADER_SIZE + WS_TRANSPORT_CHUNK_SIZE 的消息被丢弃。
+//
+// 发送调度：控制/音频为高优先级，视频为低优先级。大块数据按 WS_TRANSPORT_CHUNK_SIZE 拆分，
+// 每块都重新排队；有高优先级消息等待时低优先级分块让路，音频最多等待一个正在发送的分块。
+// 视频另受令牌桶限速，只使用 CONFIG_WS_TRANSPORT_UPLINK_KBPS 减去音频实际占用的带宽。
+// 每个优先级的排队时延每 10 秒打印一次。
+
+typedef enum {
+    WS_CHANNEL_CONTROL = 0,
+    WS_CHANNEL_AUDIO_UP = 1,
+    WS_CHANNEL_AUDIO_DOWN = 2,
+    WS_CHANNEL_VIDEO = 3,
+    WS_CHANNEL_TRACE = 4,   // 音频延迟追踪导出 (audio_trace.h)
+    WS_CHANNEL_METRICS = 5, // 运行时指标快照 (metrics.h)
+    WS_CHANNEL_MAX,
+} ws_channel_t;
+
+typedef enum {
+    WS_CLASS_HIGH = 0,      // 控制、音频
+    WS_CLASS_LOW = 1,       // 视频、追踪导出、指标快照
+    WS_CLASS_MAX,
+} ws_class_t;
+
+#define WS_MUX_FLAG_FIRST           (1 << 0)
+#define WS_MUX_FLAG_LAST            (1 << 1)
+#define WS_MUX_HEADER_SIZE          2
+#define WS_MUX_VERSION              1
+
+// 单条消息最大负载；更大的数据请用 ws_transport_send_chunked
+#define WS_TRANSPORT_CHUNK_SIZE     4096
+
+typedef void (*ws_transport_data_cb_t)(const uint8_t *data, size_t len);
+typedef void (*ws_transport_text_cb_t)(const char *data, size_t len);
+typedef void (*ws_transport_state_cb_t)(bool connected);
+
+// 建立连接，可重复调用
+void ws_transport_init(void);
+bool ws_transport_is_connected(void);
+
+// 服务端同意复用后调用；连接断开或重连时自动恢复为裸帧格式
+void ws_transport_set_mux(bool enabled);
+bool ws_transport_mux_enabled(void);
+
+// 发送一条完整消息，len 不超过 WS_TRANSPORT_CHUNK_SIZE，返回值同 esp_websocket_client_send_bin
+int ws_transport_send(ws_channel_t channel, const uint8_t *data, size_t len, TickType_t timeout);
+// 拆分发送大块数据，分块之间让出连接给其他通道
+int ws_transport_send_chunked(ws_channel_t channel, const uint8_t *data, size_t len, TickType_t timeout);
+int ws_transport_send_text(const char *data, size_t len, TickType_t timeout);
+
+void ws_transport_set_channel_cb(ws_channel_t channel, ws_transport_data_cb_t cb);
+void ws_transport_set_text_cb(ws_transport_text_cb_t cb);
+// 连接状态监听，最多 WS_TRANSPORT_MAX_STATE_CBS 个
+#define WS_TRANSPORT_MAX_STATE_CBS  4
+void ws_transport_add_state_cb(ws_transport_state_cb_t cb);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,166 @@
+#include "wake_word_preroll.h"
+#include "audio_service.h"
+
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <esp_heap_caps.h>
+#include <opus_encoder.h>
+
+#include <cassert>
+
+#define TAG "WakeWordPreroll"
+
+// Keep about 2 seconds of audio before the wake word fires
+#define PREROLL_DURATION_MS 2000
+#define PREROLL_FRAME_SAMPLES (16000 * OPUS_FRAME_DURATION_MS / 1000)
+// Room for one more detection chunk (30 ms, 512 samples) on top of the pre-roll
+#define PREROLL_RING_SAMPLES (16000 * PREROLL_DURATION_MS / 1000 + 1024)
+#define PREROLL_PACKETS (PREROLL_RING_SAMPLES / PREROLL_FRAME_SAMPLES + 1)
+#define PREROLL_PACKET_BYTES 512
+#define PREROLL_ENCODE_STACK_SIZE (4096 * 7)
+
+WakeWordPreroll::WakeWordPreroll() {
+    pcm_.Initialize(PREROLL_RING_SAMPLES, PREROLL_FRAME_SAMPLES, PREROLL_FRAME_SAMPLES);
+    packets_.resize(PREROLL_PACKETS);
+    for (auto& packet : packets_) {
+        packet.reserve(PREROLL_PACKET_BYTES);
+    }
+}
+
+WakeWordPreroll::~WakeWordPreroll() {
+    if (encode_task_ != nullptr) {
+        vTaskDelete(encode_task_);
+    }
+    if (encode_task_stack_ != nullptr) {
+        heap_caps_free(encode_task_stack_);
+    }
+    if (encode_task_buffer_ != nullptr) {
+        heap_caps_free(encode_task_buffer_);
+    }
+}
+
+void WakeWordPreroll::Store(const int16_t* data, size_t samples) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    pcm_.Push(data, samples);
+#if CONFIG_WAKE_WORD_PREROLL_INCREMENTAL
+    if (pcm_.size() >= pcm_.frame_size()) {
+        StartEncodeTask();
+        xTaskNotifyGive(encode_task_);
+    }
+#endif
+}
+
+void WakeWordPreroll::Encode() {
+    std::lock_guard<std::mutex> lock(mutex_);
+#if !CONFIG_WAKE_WORD_PREROLL_INCREMENTAL
+    // Packets of an earlier, unfinished burst are stale
+    packet_head_ = 0;
+    packet_count_ = 0;
+#endif
+    flush_requested_ = true;
+    flush_done_ = false;
+    flush_start_us_ = esp_timer_get_time();
+    first_packet_pending_ = true;
+    StartEncodeTask();
+    xTaskNotifyGive(encode_task_);
+}
+
+bool WakeWordPreroll::GetOpus(std::vector<uint8_t>& opus) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cv_.wait(lock, [this]() {
+        return packet_count_ > 0 || flush_done_;
+    });
+    if (packet_count_ == 0) {
+        // End of the pre-roll, ready for the next wake word
+        flush_requested_ = false;
+        flush_done_ = false;
+        opus.clear();
+        return false;
+    }
+    auto& packet = packets_[packet_head_];
+    opus.assign(packet.begin(), packet.end());
+    packet_head_ = (packet_head_ + 1) % packets_.size();
+    packet_count_--;
+    if (first_packet_pending_) {
+        first_packet_pending_ = false;
+        ESP_LOGI(TAG, "First wake word packet ready %ld ms after detection",
+            (long)((esp_timer_get_time() - flush_start_us_) / 1000));
+    }
+    return true;
+}
+
+// Called with mutex_ held
+void WakeWordPreroll::StartEncodeTask() {
+    if (encode_task_ != nullptr) {
+        return;
+    }
+    if (encode_task_stack_ == nullptr) {
+        encode_task_stack_ = (StackType_t*)heap_caps_malloc(PREROLL_ENCODE_STACK_SIZE, MALLOC_CAP_SPIRAM);
+        assert(encode_task_stack_ != nullptr);
+    }
+    if (encode_task_buffer_ == nullptr) {
+        encode_task_buffer_ = (StaticTask_t*)heap_caps_malloc(sizeof(StaticTask_t), MALLOC_CAP_INTERNAL);
+        assert(encode_task_buffer_ != nullptr);
+    }
+    encode_task_ = xTaskCreateStatic([](void* arg) {
+        ((WakeWordPreroll*)arg)->EncodeTask();
+    }, "encode_wake_word", PREROLL_ENCODE_STACK_SIZE, this, 2, encode_task_stack_, encode_task_buffer_);
+}
+
+// Called with mutex_ held, the oldest packet is overwritten when the ring is full
+void WakeWordPreroll::PushPacket(const std::vector<uint8_t>& opus) {
+    if (packet_count_ == packets_.size()) {
+        packet_head_ = (packet_head_ + 1) % packets_.size();
+        packet_count_--;
+    }
+    auto& packet = packets_[(packet_head_ + packet_count_) % packets_.size()];
+    packet.assign(opus.begin(), opus.end());
+    packet_count_++;
+}
+
+void WakeWordPreroll::EncodeTask() {
+    auto encoder = std::make_unique<OpusEncoderWrapper>(16000, 1, OPUS_FRAME_DURATION_MS);
+    encoder->SetComplexity(0); // 0 is the fastest
+    std::vector<int16_t> frame;
+    std::vector<uint8_t> opus;
+    frame.reserve(PREROLL_FRAME_SAMPLES);
+    opus.reserve(PREROLL_PACKET_BYTES);
+
+    while (true) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        int packets = 0;
+        while (true) {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+#if CONFIG_WAKE_WORD_PREROLL_INCREMENTAL
+                bool drain = true;
+#else
+                bool drain = flush_requested_;
+#endif
+                if (!drain || pcm_.size() < pcm_.frame_size()) {
+                    if (flush_requested_ && !flush_done_) {
+                        // The partial frame left over is dropped, like the encoder's own buffering did
+                        pcm_.Clear();
+                        flush_done_ = true;
+                        cv_.notify_all();
+                        ESP_LOGI(TAG, "Wake word audio ready: %u packets, %d encoded after detection in %ld ms",
+                            (unsigned int)packet_count_, packets, (long)((esp_timer_get_time() - flush_start_us_) / 1000));
+                    }
+                    break;
+                }
+                frame.resize(pcm_.frame_size());
+                pcm_.Copy(frame.data(), frame.size());
+                pcm_.Skip(frame.size());
+            }
+
+            if (encoder->Encode(std::move(frame), opus)) {
+                std::lock_guard<std::mutex> lock(mutex_);
+                PushPacket(opus);
+                if (flush_requested_) {
+                    packets++;
+                    cv_.notify_all();
+                }
+            }
+        }
+    }
+}
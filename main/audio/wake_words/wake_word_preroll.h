@@ -0,0 +1,63 @@
+#ifndef WAKE_WORD_PREROLL_H
+#define WAKE_WORD_PREROLL_H
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include "frame_rechunker.h"
+#include "psram_allocator.h"
+
+/*
+ * The audio around the wake word, sent to the server ahead of the conversation
+ * (CONFIG_SEND_WAKE_WORD_DATA), e.g. to recognize who is speaking.
+ *
+ * The detection task stores the last two seconds of 16kHz PCM in a fixed PSRAM ring,
+ * without allocating per chunk. An encoder task turns complete frames into Opus packets,
+ * kept in a fixed ring of reusable packet buffers:
+ *   - by default in one burst after Encode(), as before
+ *   - with CONFIG_WAKE_WORD_PREROLL_INCREMENTAL continuously while listening, so when the
+ *     wake word fires only the last partial frame is left and the first packet ships at once
+ */
+class WakeWordPreroll {
+public:
+    WakeWordPreroll();
+    ~WakeWordPreroll();
+    WakeWordPreroll(const WakeWordPreroll&) = delete;
+    WakeWordPreroll& operator=(const WakeWordPreroll&) = delete;
+
+    // Detection task, every fetched chunk
+    void Store(const int16_t* data, size_t samples);
+    // Wake word detected: hand out the buffered audio, GetOpus() then returns it packet by packet
+    void Encode();
+    // Blocks until a packet is ready, returns false after the last one
+    bool GetOpus(std::vector<uint8_t>& opus);
+
+private:
+    typedef std::vector<uint8_t, PsramAllocator<uint8_t>> Packet;
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    FrameRechunker<int16_t, PsramAllocator<int16_t>> pcm_;
+    std::vector<Packet> packets_;
+    size_t packet_head_ = 0;
+    size_t packet_count_ = 0;
+    bool flush_requested_ = false;
+    bool flush_done_ = false;
+    int64_t flush_start_us_ = 0;
+    bool first_packet_pending_ = false;
+
+    TaskHandle_t encode_task_ = nullptr;
+    StaticTask_t* encode_task_buffer_ = nullptr;
+    StackType_t* encode_task_stack_ = nullptr;
+
+    void StartEncodeTask();
+    void EncodeTask();
+    void PushPacket(const std::vector<uint8_t>& opus);
+};
+
+#endif // WAKE_WORD_PREROLL_H
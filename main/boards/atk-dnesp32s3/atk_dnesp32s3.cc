@@ -125,9 +125,9 @@ private:
         config.frame_size = FRAMESIZE_VGA;       /* QQVGA-UXGA, For ESP32, do not use sizes above QVGA when not JPEG. The performance of the ESP32-S series has improved a lot, but JPEG mode always gives better frame rates */
 
         config.jpeg_quality = 15;                 /* 0-63, for OV series camera sensors, lower number means higher quality */
-        config.fb_count = 2;                      /* When jpeg mode is used, if fb_count more than one, the driver will work in continuous mode */
+        config.fb_count = 4;                      /* Filling, held by the driver as the latest, queued and being sent by the video stream pipeline */
         config.fb_location = CAMERA_FB_IN_PSRAM;
-        config.grab_mode = CAMERA_GRAB_WHEN_EMPTY;
+        config.grab_mode = CAMERA_GRAB_LATEST;    /* Always hand out the newest frame, no throwaway grab needed */
 
         esp_err_t err = esp_camera_init(&config); // 测试相机是否存在
         if (err != ESP_OK) {
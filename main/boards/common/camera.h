@@ -2,6 +2,16 @@
 #define CAMERA_H
 
 #include <string>
+#include <cstddef>
+#include <cstdint>
+
+// A frame handed out by Camera::AcquireFrame(), owned by the caller until ReleaseFrame()
+struct CameraFrame {
+    const uint8_t* data = nullptr;
+    size_t len = 0;
+    int64_t timestamp_us = 0;   // capture time (esp_timer clock)
+    void* handle = nullptr;     // driver buffer
+};
 
 class Camera {
 public:
@@ -11,6 +21,13 @@ public:
     virtual bool SetVFlip(bool enabled) = 0;
     virtual std::string Explain(const std::string& question) = 0;
     virtual const uint8_t* GetFrameJpeg(size_t* length) { return nullptr; }
+    // Zero-copy frame handoff for streaming, several frames may be held at once
+    virtual bool AcquireFrame(CameraFrame& frame) { return false; }
+    virtual void ReleaseFrame(CameraFrame& frame) {}
+    // Runtime stream tuning, the frame size cannot exceed the one the camera was initialized with
+    virtual bool GetStreamFormat(int& width, int& height, int& jpeg_quality) { return false; }
+    virtual bool SetJpegQuality(int jpeg_quality) { return false; }
+    virtual bool SetFrameSize(int width, int height) { return false; }
 };
 
 #endif // CAMERA_H
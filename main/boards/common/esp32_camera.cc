@@ -10,6 +10,8 @@
 #define TAG "Esp32Camera"
 
 Esp32Camera::Esp32Camera(const camera_config_t& config) {
+    grab_latest_ = config.grab_mode == CAMERA_GRAB_LATEST;
+
     // camera init
     esp_err_t err = esp_camera_init(&config); // 配置上面定义的参数
     if (err != ESP_OK) {
@@ -42,7 +44,8 @@ bool Esp32Camera::Capture() {
     }
 
     auto start_time = esp_timer_get_time();
-    int frames_to_get = 2;
+    // In CAMERA_GRAB_WHEN_EMPTY mode the first buffer may be stale, drop it
+    int frames_to_get = grab_latest_ ? 1 : 2;
     // Try to get a stable frame
     for (int i = 0; i < frames_to_get; i++) {
         if (fb_ != nullptr) {
@@ -130,3 +133,68 @@ const uint8_t* Esp32Camera::GetFrameJpeg(size_t* length) {
     }
     return nullptr;
 }
+
+bool Esp32Camera::AcquireFrame(CameraFrame& frame) {
+    camera_fb_t* fb = esp_camera_fb_get();
+    if (fb == nullptr) {
+        ESP_LOGE(TAG, "Camera capture failed");
+        return false;
+    }
+    frame.data = fb->buf;
+    frame.len = fb->len;
+    frame.timestamp_us = (int64_t)fb->timestamp.tv_sec * 1000000 + fb->timestamp.tv_usec;
+    frame.handle = fb;
+    return true;
+}
+
+void Esp32Camera::ReleaseFrame(CameraFrame& frame) {
+    if (frame.handle != nullptr) {
+        esp_camera_fb_return(static_cast<camera_fb_t*>(frame.handle));
+        frame.handle = nullptr;
+        frame.data = nullptr;
+        frame.len = 0;
+    }
+}
+
+bool Esp32Camera::GetStreamFormat(int& width, int& height, int& jpeg_quality) {
+    sensor_t *s = esp_camera_sensor_get();
+    if (s == nullptr || s->pixformat != PIXFORMAT_JPEG) {
+        return false;
+    }
+    width = resolution[s->status.framesize].width;
+    height = resolution[s->status.framesize].height;
+    jpeg_quality = s->status.quality;
+    return true;
+}
+
+bool Esp32Camera::SetJpegQuality(int jpeg_quality) {
+    sensor_t *s = esp_camera_sensor_get();
+    if (s == nullptr) {
+        ESP_LOGE(TAG, "Failed to get camera sensor");
+        return false;
+    }
+    if (s->set_quality(s, jpeg_quality) != 0) {
+        ESP_LOGE(TAG, "Failed to set JPEG quality: %d", jpeg_quality);
+        return false;
+    }
+    return true;
+}
+
+bool Esp32Camera::SetFrameSize(int width, int height) {
+    sensor_t *s = esp_camera_sensor_get();
+    if (s == nullptr) {
+        ESP_LOGE(TAG, "Failed to get camera sensor");
+        return false;
+    }
+    for (int i = 0; i < FRAMESIZE_INVALID; i++) {
+        if (resolution[i].width == width && resolution[i].height == height) {
+            if (s->set_framesize(s, (framesize_t)i) != 0) {
+                ESP_LOGE(TAG, "Failed to set frame size %dx%d", width, height);
+                return false;
+            }
+            return true;
+        }
+    }
+    ESP_LOGE(TAG, "Unsupported frame size %dx%d", width, height);
+    return false;
+}
@@ -22,6 +22,7 @@ private:
     std::string explain_url_;
     std::string explain_token_;
     std::thread encoder_thread_;
+    bool grab_latest_ = false;
 
 public:
     Esp32Camera(const camera_config_t& config);
@@ -34,6 +35,11 @@ public:
     virtual bool SetVFlip(bool enabled) override;
     virtual std::string Explain(const std::string& question);
     virtual const uint8_t* GetFrameJpeg(size_t* length) override;
+    virtual bool AcquireFrame(CameraFrame& frame) override;
+    virtual void ReleaseFrame(CameraFrame& frame) override;
+    virtual bool GetStreamFormat(int& width, int& height, int& jpeg_quality) override;
+    virtual bool SetJpegQuality(int jpeg_quality) override;
+    virtual bool SetFrameSize(int width, int height) override;
 };
 
 #endif // ESP32_CAMERA_H
\ No newline at end of file
@@ -110,6 +110,8 @@ void SleepTimer::CheckTimer() {
             on_enter_deep_sleep_mode_();
         }
 
+        // Deep sleep skips the shutdown handlers, write pending settings first
+        Settings::Flush();
         esp_deep_sleep_start();
     }
 }
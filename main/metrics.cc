@@ -0,0 +1,129 @@
+#include "metrics.h"
+
+#include <cstring>
+#include <mutex>
+#include <esp_log.h>
+#include <esp_timer.h>
+
+#define TAG "Metrics"
+
+#define METRICS_MAX             128
+#define METRICS_MAX_HISTOGRAMS  16
+
+static metric_t metrics[METRICS_MAX];
+static uint32_t histogram_buckets[METRICS_MAX_HISTOGRAMS + 1][METRICS_HISTOGRAM_BUCKETS];
+static int metric_count = 0;
+static int histogram_count = 0;
+// Handed out when the table is full or the type does not match, updates go nowhere visible
+static metric_t scratch_metric = {"scratch", METRIC_HISTOGRAM, 0, 0, 0, histogram_buckets[METRICS_MAX_HISTOGRAMS]};
+static std::mutex registry_mutex;
+
+metric_t* metrics_register(const char* name, metric_type_t type) {
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    for (int i = 0; i < metric_count; i++) {
+        if (strcmp(metrics[i].name, name) == 0) {
+            if (metrics[i].type != type) {
+                // A counter or gauge has no buckets to observe into
+                ESP_LOGW(TAG, "Metric %s registered with another type, not recorded", name);
+                return &scratch_metric;
+            }
+            return &metrics[i];
+        }
+    }
+    if (metric_count >= METRICS_MAX || (type == METRIC_HISTOGRAM && histogram_count >= METRICS_MAX_HISTOGRAMS)) {
+        ESP_LOGE(TAG, "Metric table full, %s is not recorded", name);
+        return &scratch_metric;
+    }
+    metric_t* metric = &metrics[metric_count];
+    metric->name = name;
+    metric->type = type;
+    metric->buckets = type == METRIC_HISTOGRAM ? histogram_buckets[histogram_count++] : nullptr;
+    // Publish the entry only after it is complete, snapshots read metric_count without the lock
+    __atomic_store_n(&metric_count, metric_count + 1, __ATOMIC_RELEASE);
+    return metric;
+}
+
+static size_t metric_size(const metric_t& metric) {
+    size_t size = 2 + strlen(metric.name) + 8;
+    if (metric.type == METRIC_HISTOGRAM) {
+        size += 4 + METRICS_HISTOGRAM_BUCKETS * 4;
+    }
+    return size;
+}
+
+size_t metrics_snapshot_size(void) {
+    int count = __atomic_load_n(&metric_count, __ATOMIC_ACQUIRE);
+    size_t size = 12;
+    for (int i = 0; i < count; i++) {
+        size += metric_size(metrics[i]);
+    }
+    return size;
+}
+
+static uint8_t* put_u16(uint8_t* p, uint16_t v) {
+    p[0] = v & 0xFF;
+    p[1] = v >> 8;
+    return p + 2;
+}
+
+static uint8_t* put_u32(uint8_t* p, uint32_t v) {
+    p[0] = v & 0xFF;
+    p[1] = (v >> 8) & 0xFF;
+    p[2] = (v >> 16) & 0xFF;
+    p[3] = v >> 24;
+    return p + 4;
+}
+
+size_t metrics_snapshot(uint8_t* buf, size_t size) {
+    int count = __atomic_load_n(&metric_count, __ATOMIC_ACQUIRE);
+    size_t needed = 12;
+    for (int i = 0; i < count; i++) {
+        needed += metric_size(metrics[i]);
+    }
+    if (buf == nullptr || size < needed) {
+        return 0;
+    }
+
+    uint8_t* p = buf;
+    p = put_u32(p, METRICS_SNAPSHOT_MAGIC);
+    p = put_u16(p, METRICS_SNAPSHOT_VERSION);
+    p = put_u16(p, count);
+    p = put_u32(p, esp_timer_get_time() / 1000);
+    for (int i = 0; i < count; i++) {
+        const metric_t& metric = metrics[i];
+        size_t name_len = strlen(metric.name);
+        *p++ = metric.type;
+        *p++ = name_len;
+        memcpy(p, metric.name, name_len);
+        p += name_len;
+        p = put_u32(p, __atomic_load_n(&metric.value, __ATOMIC_RELAXED));
+        p = put_u32(p, __atomic_load_n(&metric.max, __ATOMIC_RELAXED));
+        if (metric.type == METRIC_HISTOGRAM) {
+            p = put_u32(p, __atomic_load_n(&metric.sum, __ATOMIC_RELAXED));
+            for (int b = 0; b < METRICS_HISTOGRAM_BUCKETS; b++) {
+                p = put_u32(p, __atomic_load_n(&metric.buckets[b], __ATOMIC_RELAXED));
+            }
+        }
+    }
+    return p - buf;
+}
+
+void metrics_log(void) {
+    int count = __atomic_load_n(&metric_count, __ATOMIC_ACQUIRE);
+    for (int i = 0; i < count; i++) {
+        const metric_t& metric = metrics[i];
+        uint32_t value = metric_get(&metric);
+        switch (metric.type) {
+        case METRIC_COUNTER:
+            ESP_LOGI(TAG, "%s: %lu", metric.name, value);
+            break;
+        case METRIC_GAUGE:
+            ESP_LOGI(TAG, "%s: %lu (peak %lu)", metric.name, value, metric.max);
+            break;
+        case METRIC_HISTOGRAM:
+            ESP_LOGI(TAG, "%s: n=%lu avg=%lu max=%lu", metric.name, value,
+                value > 0 ? metric.sum / value : 0, metric.max);
+            break;
+        }
+    }
+}
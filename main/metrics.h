@@ -0,0 +1,96 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Runtime metrics registry.
+ *
+ * Any module registers named counters, gauges and latency histograms once (usually
+ * into a static pointer) and updates them on the hot path with a single relaxed
+ * atomic operation. Registration never fails: when the table is full a shared
+ * scratch metric is returned, so callers need no NULL checks.
+ *
+ * metrics_snapshot() serializes every metric into a compact little-endian blob
+ * that the server pulls over the WebSocket with {"type":"metrics"}:
+ *   header: magic u32 "MTRC", version u16, count u16, uptime_ms u32
+ *   metric: type u8, name_len u8, name, value u32, max u32,
+ *           histograms only: sum u32, METRICS_HISTOGRAM_BUCKETS x u32
+ */
+
+typedef enum {
+    METRIC_COUNTER = 0,     // monotonically increasing
+    METRIC_GAUGE = 1,       // last value, max keeps the peak
+    METRIC_HISTOGRAM = 2,   // value = sample count, max = largest sample
+} metric_type_t;
+
+// Bucket i counts samples in [2^(i-1), 2^i), the last bucket everything above
+#define METRICS_HISTOGRAM_BUCKETS   20
+#define METRICS_SNAPSHOT_MAGIC      0x4352544D  // "MTRC"
+#define METRICS_SNAPSHOT_VERSION    1
+
+typedef struct {
+    const char *name;
+    uint8_t type;
+    uint32_t value;
+    uint32_t max;
+    uint32_t sum;
+    uint32_t *buckets;
+} metric_t;
+
+metric_t *metrics_register(const char *name, metric_type_t type);
+// Returns the snapshot size, or 0 when buf is too small (metrics_snapshot_size() tells how much is needed)
+size_t metrics_snapshot(uint8_t *buf, size_t size);
+size_t metrics_snapshot_size(void);
+// Logs every metric on one line per metric (debugging aid)
+void metrics_log(void);
+
+static inline void metric_add(metric_t *metric, uint32_t n) {
+    __atomic_fetch_add(&metric->value, n, __ATOMIC_RELAXED);
+}
+
+static inline void metric_inc(metric_t *metric) {
+    __atomic_fetch_add(&metric->value, 1, __ATOMIC_RELAXED);
+}
+
+static inline uint32_t metric_get(const metric_t *metric) {
+    return __atomic_load_n(&metric->value, __ATOMIC_RELAXED);
+}
+
+static inline void metric_update_max(metric_t *metric, uint32_t value) {
+    uint32_t max = __atomic_load_n(&metric->max, __ATOMIC_RELAXED);
+    while (value > max) {
+        // On failure max is reloaded with the current peak
+        if (__atomic_compare_exchange_n(&metric->max, &max, value, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+            break;
+        }
+    }
+}
+
+static inline void metric_set(metric_t *metric, uint32_t value) {
+    __atomic_store_n(&metric->value, value, __ATOMIC_RELAXED);
+    metric_update_max(metric, value);
+}
+
+static inline void metric_observe(metric_t *metric, uint32_t value) {
+    int bucket = value == 0 ? 0 : 32 - __builtin_clz(value);
+    if (bucket >= METRICS_HISTOGRAM_BUCKETS) {
+        bucket = METRICS_HISTOGRAM_BUCKETS - 1;
+    }
+    __atomic_fetch_add(&metric->buckets[bucket], 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&metric->sum, value, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&metric->value, 1, __ATOMIC_RELAXED);
+    metric_update_max(metric, value);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // METRICS_H
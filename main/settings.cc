@@ -1,88 +1,354 @@
 #include "settings.h"
+#include "metrics.h"
 
 #include <esp_log.h>
+#include <esp_system.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
 #include <nvs_flash.h>
 
+#include <map>
+#include <mutex>
+
 #define TAG "Settings"
 
-Settings::Settings(const std::string& ns, bool read_write) : ns_(ns), read_write_(read_write) {
-    nvs_open(ns.c_str(), read_write_ ? NVS_READWRITE : NVS_READONLY, &nvs_handle_);
-}
+#define SETTINGS_FLUSH_DELAY_MS CONFIG_SETTINGS_FLUSH_DELAY_MS
+#define SETTINGS_FLUSH_TASK_STACK_SIZE 3072
 
-Settings::~Settings() {
-    if (nvs_handle_ != 0) {
-        if (read_write_ && dirty_) {
-            ESP_ERROR_CHECK(nvs_commit(nvs_handle_));
+namespace {
+
+enum class ValueType : uint8_t {
+    Int,
+    Bool,
+    String,
+};
+
+struct CachedValue {
+    ValueType type = ValueType::Int;
+    bool present = false;   // false: not in NVS, reads return the default
+    bool dirty = false;     // changed in RAM, not written yet
+    int32_t number = 0;     // Int and Bool
+    std::string text;       // String
+};
+
+struct CachedNamespace {
+    nvs_handle_t handle = 0;
+    bool opened = false;
+    bool writable = false;
+    std::map<std::string, CachedValue> values;
+};
+
+/*
+ * The process-wide cache behind Settings, every method takes mutex_.
+ * Pending values are flushed by a low priority task of their own, the flush timer only
+ * wakes it: a flash write can take tens of milliseconds and must not hold up the other
+ * esp_timer callbacks. NVS errors are logged, values that failed to write stay pending.
+ */
+class SettingsCache {
+public:
+    static SettingsCache& GetInstance() {
+        static SettingsCache instance;
+        return instance;
+    }
+
+    bool Get(const std::string& ns, const std::string& key, ValueType type, CachedValue& value) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto& space = Open(ns, false);
+        auto it = space.values.find(key);
+        if (it == space.values.end() || (it->second.present && it->second.type != type && !it->second.dirty)) {
+            it = space.values.insert_or_assign(key, Load(space, key, type)).first;
         }
-        nvs_close(nvs_handle_);
+        if (!it->second.present || it->second.type != type) {
+            return false;
+        }
+        value = it->second;
+        return true;
     }
-}
 
-std::string Settings::GetString(const std::string& key, const std::string& default_value) {
-    if (nvs_handle_ == 0) {
-        return default_value;
+    void Set(const std::string& ns, const std::string& key, const CachedValue& value) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto& space = Open(ns, true);
+        if (space.handle == 0) {
+            return;
+        }
+        auto it = space.values.find(key);
+        if (it == space.values.end()) {
+            it = space.values.emplace(key, Load(space, key, value.type)).first;
+        }
+        auto& cached = it->second;
+        if (cached.present && cached.type == value.type && cached.number == value.number && cached.text == value.text) {
+            // Same value as in NVS or already pending
+            metric_inc(coalesced_);
+            return;
+        }
+        if (cached.dirty) {
+            metric_inc(coalesced_);
+        }
+        cached = value;
+        cached.present = true;
+        cached.dirty = true;
+        ScheduleFlush();
     }
 
-    size_t length = 0;
-    if (nvs_get_str(nvs_handle_, key.c_str(), nullptr, &length) != ESP_OK) {
-        return default_value;
+    void EraseKey(const std::string& ns, const std::string& key) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto& space = Open(ns, true);
+        if (space.handle == 0) {
+            return;
+        }
+        auto ret = nvs_erase_key(space.handle, key.c_str());
+        if (ret == ESP_OK || ret == ESP_ERR_NVS_NOT_FOUND) {
+            ret = nvs_commit(space.handle);
+        }
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to erase %s.%s: %s", ns.c_str(), key.c_str(), esp_err_to_name(ret));
+            // Read back from NVS next time, whatever the erase left there
+            space.values.erase(key);
+            return;
+        }
+        metric_inc(commits_);
+        space.values[key] = CachedValue();
+    }
+
+    void EraseAll(const std::string& ns) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto& space = Open(ns, true);
+        if (space.handle == 0) {
+            return;
+        }
+        auto ret = nvs_erase_all(space.handle);
+        if (ret == ESP_OK) {
+            ret = nvs_commit(space.handle);
+        }
+        space.values.clear();
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to erase namespace %s: %s", ns.c_str(), esp_err_to_name(ret));
+            return;
+        }
+        metric_inc(commits_);
+    }
+
+    void Flush() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        FlushLocked();
+    }
+
+    void Invalidate() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        esp_timer_stop(flush_timer_);
+        for (auto& [name, space] : namespaces_) {
+            if (space.handle != 0) {
+                nvs_close(space.handle);
+            }
+        }
+        namespaces_.clear();
+    }
+
+private:
+    std::mutex mutex_;
+    std::map<std::string, CachedNamespace> namespaces_;
+    esp_timer_handle_t flush_timer_ = nullptr;
+    TaskHandle_t flush_task_ = nullptr;
+    metric_t* writes_ = nullptr;
+    metric_t* commits_ = nullptr;
+    metric_t* coalesced_ = nullptr;
+
+    SettingsCache() {
+        writes_ = metrics_register("settings.nvs_writes", METRIC_COUNTER);
+        commits_ = metrics_register("settings.nvs_commits", METRIC_COUNTER);
+        coalesced_ = metrics_register("settings.coalesced", METRIC_COUNTER);
+
+        xTaskCreate([](void* arg) {
+            auto cache = (SettingsCache*)arg;
+            while (true) {
+                ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+                cache->Flush();
+            }
+        }, "settings_flush", SETTINGS_FLUSH_TASK_STACK_SIZE, this, 1, &flush_task_);
+
+        esp_timer_create_args_t flush_timer_args = {
+            .callback = [](void* arg) {
+                xTaskNotifyGive(((SettingsCache*)arg)->flush_task_);
+            },
+            .arg = this,
+            .dispatch_method = ESP_TIMER_TASK,
+            .name = "settings_flush",
+            .skip_unhandled_events = true,
+        };
+        ESP_ERROR_CHECK(esp_timer_create(&flush_timer_args, &flush_timer_));
+        // Pending changes survive esp_restart()
+        esp_register_shutdown_handler([]() {
+            SettingsCache::GetInstance().Flush();
+        });
     }
 
-    std::string value;
-    value.resize(length);
-    ESP_ERROR_CHECK(nvs_get_str(nvs_handle_, key.c_str(), value.data(), &length));
-    while (!value.empty() && value.back() == '\0') {
-        value.pop_back();
+    // Opens the namespace on first use, read-only namespaces are reopened for writing on the first write
+    CachedNamespace& Open(const std::string& ns, bool writable) {
+        auto& space = namespaces_[ns];
+        if (space.opened && (space.writable || !writable)) {
+            return space;
+        }
+        if (space.handle != 0) {
+            nvs_close(space.handle);
+            space.handle = 0;
+        }
+        space.opened = true;
+        space.writable = writable;
+        if (nvs_open(ns.c_str(), writable ? NVS_READWRITE : NVS_READONLY, &space.handle) != ESP_OK) {
+            // A read-only namespace that does not exist yet reads as empty
+            space.handle = 0;
+            if (writable) {
+                ESP_LOGE(TAG, "Failed to open namespace %s for writing", ns.c_str());
+            }
+        }
+        return space;
+    }
+
+    CachedValue Load(const CachedNamespace& space, const std::string& key, ValueType type) {
+        CachedValue value;
+        value.type = type;
+        if (space.handle == 0) {
+            return value;
+        }
+        switch (type) {
+        case ValueType::Int:
+            value.present = nvs_get_i32(space.handle, key.c_str(), &value.number) == ESP_OK;
+            break;
+        case ValueType::Bool: {
+            uint8_t number;
+            value.present = nvs_get_u8(space.handle, key.c_str(), &number) == ESP_OK;
+            value.number = number != 0;
+            break;
+        }
+        case ValueType::String: {
+            size_t length = 0;
+            if (nvs_get_str(space.handle, key.c_str(), nullptr, &length) != ESP_OK) {
+                break;
+            }
+            value.text.resize(length);
+            ESP_ERROR_CHECK(nvs_get_str(space.handle, key.c_str(), value.text.data(), &length));
+            while (!value.text.empty() && value.text.back() == '\0') {
+                value.text.pop_back();
+            }
+            value.present = true;
+            break;
+        }
+        }
+        return value;
     }
-    return value;
+
+    void ScheduleFlush() {
+        if (SETTINGS_FLUSH_DELAY_MS == 0) {
+            FlushLocked();
+            return;
+        }
+        // Restarted on every change, the flush follows the last one
+        esp_timer_stop(flush_timer_);
+        esp_timer_start_once(flush_timer_, SETTINGS_FLUSH_DELAY_MS * 1000);
+    }
+
+    void FlushLocked() {
+        for (auto& [name, space] : namespaces_) {
+            int written = 0;
+            for (auto& [key, value] : space.values) {
+                if (!value.dirty) {
+                    continue;
+                }
+                esp_err_t ret = ESP_OK;
+                switch (value.type) {
+                case ValueType::Int:
+                    ret = nvs_set_i32(space.handle, key.c_str(), value.number);
+                    break;
+                case ValueType::Bool:
+                    ret = nvs_set_u8(space.handle, key.c_str(), value.number ? 1 : 0);
+                    break;
+                case ValueType::String:
+                    ret = nvs_set_str(space.handle, key.c_str(), value.text.c_str());
+                    break;
+                }
+                if (ret != ESP_OK) {
+                    ESP_LOGE(TAG, "Failed to write %s.%s: %s", name.c_str(), key.c_str(), esp_err_to_name(ret));
+                    continue;
+                }
+                value.dirty = false;
+                metric_inc(writes_);
+                written++;
+            }
+            if (written > 0) {
+                esp_err_t ret = nvs_commit(space.handle);
+                if (ret != ESP_OK) {
+                    ESP_LOGE(TAG, "Failed to commit namespace %s: %s", name.c_str(), esp_err_to_name(ret));
+                    continue;
+                }
+                metric_inc(commits_);
+                ESP_LOGI(TAG, "Flushed %d values to namespace %s, %lu writes / %lu commits so far", written, name.c_str(),
+                    (unsigned long)metric_get(writes_), (unsigned long)metric_get(commits_));
+            }
+        }
+    }
+};
+
+} // namespace
+
+Settings::Settings(const std::string& ns, bool read_write) : ns_(ns), read_write_(read_write) {
+}
+
+Settings::~Settings() {
+}
+
+std::string Settings::GetString(const std::string& key, const std::string& default_value) {
+    CachedValue value;
+    if (!SettingsCache::GetInstance().Get(ns_, key, ValueType::String, value)) {
+        return default_value;
+    }
+    return value.text;
 }
 
 void Settings::SetString(const std::string& key, const std::string& value) {
     if (read_write_) {
-        ESP_ERROR_CHECK(nvs_set_str(nvs_handle_, key.c_str(), value.c_str()));
-        dirty_ = true;
+        CachedValue cached;
+        cached.type = ValueType::String;
+        cached.text = value;
+        SettingsCache::GetInstance().Set(ns_, key, cached);
     } else {
         ESP_LOGW(TAG, "Namespace %s is not open for writing", ns_.c_str());
     }
 }
 
 int32_t Settings::GetInt(const std::string& key, int32_t default_value) {
-    if (nvs_handle_ == 0) {
-        return default_value;
-    }
-
-    int32_t value;
-    if (nvs_get_i32(nvs_handle_, key.c_str(), &value) != ESP_OK) {
+    CachedValue value;
+    if (!SettingsCache::GetInstance().Get(ns_, key, ValueType::Int, value)) {
         return default_value;
     }
-    return value;
+    return value.number;
 }
 
 void Settings::SetInt(const std::string& key, int32_t value) {
     if (read_write_) {
-        ESP_ERROR_CHECK(nvs_set_i32(nvs_handle_, key.c_str(), value));
-        dirty_ = true;
+        CachedValue cached;
+        cached.type = ValueType::Int;
+        cached.number = value;
+        SettingsCache::GetInstance().Set(ns_, key, cached);
     } else {
         ESP_LOGW(TAG, "Namespace %s is not open for writing", ns_.c_str());
     }
 }
 
 bool Settings::GetBool(const std::string& key, bool default_value) {
-    if (nvs_handle_ == 0) {
+    CachedValue value;
+    if (!SettingsCache::GetInstance().Get(ns_, key, ValueType::Bool, value)) {
         return default_value;
     }
-
-    uint8_t value;
-    if (nvs_get_u8(nvs_handle_, key.c_str(), &value) != ESP_OK) {
-        return default_value;
-    }
-    return value != 0;
+    return value.number != 0;
 }
 
 void Settings::SetBool(const std::string& key, bool value) {
     if (read_write_) {
-        ESP_ERROR_CHECK(nvs_set_u8(nvs_handle_, key.c_str(), value ? 1 : 0));
-        dirty_ = true;
+        CachedValue cached;
+        cached.type = ValueType::Bool;
+        cached.number = value ? 1 : 0;
+        SettingsCache::GetInstance().Set(ns_, key, cached);
     } else {
         ESP_LOGW(TAG, "Namespace %s is not open for writing", ns_.c_str());
     }
@@ -90,10 +356,7 @@ void Settings::SetBool(const std::string& key, bool value) {
 
 void Settings::EraseKey(const std::string& key) {
     if (read_write_) {
-        auto ret = nvs_erase_key(nvs_handle_, key.c_str());
-        if (ret != ESP_ERR_NVS_NOT_FOUND) {
-            ESP_ERROR_CHECK(ret);
-        }
+        SettingsCache::GetInstance().EraseKey(ns_, key);
     } else {
         ESP_LOGW(TAG, "Namespace %s is not open for writing", ns_.c_str());
     }
@@ -101,8 +364,16 @@ void Settings::EraseKey(const std::string& key) {
 
 void Settings::EraseAll() {
     if (read_write_) {
-        ESP_ERROR_CHECK(nvs_erase_all(nvs_handle_));
+        SettingsCache::GetInstance().EraseAll(ns_);
     } else {
         ESP_LOGW(TAG, "Namespace %s is not open for writing", ns_.c_str());
     }
 }
+
+void Settings::Flush() {
+    SettingsCache::GetInstance().Flush();
+}
+
+void Settings::Invalidate() {
+    SettingsCache::GetInstance().Invalidate();
+}
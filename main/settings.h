@@ -4,6 +4,15 @@
 #include <string>
 #include <nvs_flash.h>
 
+/*
+ * Key-value settings in NVS, grouped by namespace.
+ *
+ * Settings objects are cheap views onto one process-wide cache: every namespace is
+ * opened once and stays open, values are read from NVS once and then served from RAM.
+ * Set*() only updates the cache, pending values are written and committed together
+ * CONFIG_SETTINGS_FLUSH_DELAY_MS after the last change, on Flush() and on esp_restart(),
+ * so a burst of changes costs a single flash write. Erase*() go to NVS at once.
+ */
 class Settings {
 public:
     Settings(const std::string& ns, bool read_write = false);
@@ -18,11 +27,14 @@ public:
     void EraseKey(const std::string& key);
     void EraseAll();
 
+    // Writes pending changes of every namespace to NVS now
+    static void Flush();
+    // Drops cached values and pending changes and closes the handles, before the NVS partition is erased
+    static void Invalidate();
+
 private:
     std::string ns_;
-    nvs_handle_t nvs_handle_ = 0;
     bool read_write_ = false;
-    bool dirty_ = false;
 };
 
 #endif
@@ -1,4 +1,5 @@
 #include "system_info.h"
+#include "metrics.h"
 
 #include <freertos/task.h>
 #include <esp_log.h>
@@ -144,8 +145,16 @@ void SystemInfo::PrintTaskList() {
     ESP_LOGI(TAG, "Task list: \n%s", buffer);
 }
 
-void SystemInfo::PrintHeapStats() {
-    int free_sram = heap_caps_get_free_size(MALLOC_CAP_INTERNAL);
-    int min_free_sram = heap_caps_get_minimum_free_size(MALLOC_CAP_INTERNAL);
-    ESP_LOGI(TAG, "free sram: %u minimal sram: %u", free_sram, min_free_sram);
+void SystemInfo::UpdateHeapMetrics() {
+    static metric_t* free_sram = metrics_register("heap.free_sram", METRIC_GAUGE);
+    static metric_t* min_free_sram = metrics_register("heap.min_free_sram", METRIC_GAUGE);
+    static metric_t* largest_sram = metrics_register("heap.largest_free_sram", METRIC_GAUGE);
+    static metric_t* free_psram = metrics_register("heap.free_psram", METRIC_GAUGE);
+    static metric_t* min_free_psram = metrics_register("heap.min_free_psram", METRIC_GAUGE);
+
+    metric_set(free_sram, heap_caps_get_free_size(MALLOC_CAP_INTERNAL));
+    metric_set(min_free_sram, heap_caps_get_minimum_free_size(MALLOC_CAP_INTERNAL));
+    metric_set(largest_sram, heap_caps_get_largest_free_block(MALLOC_CAP_INTERNAL));
+    metric_set(free_psram, heap_caps_get_free_size(MALLOC_CAP_SPIRAM));
+    metric_set(min_free_psram, heap_caps_get_minimum_free_size(MALLOC_CAP_SPIRAM));
 }
@@ -16,7 +16,8 @@ public:
     static std::string GetUserAgent();
     static esp_err_t PrintTaskCpuUsage(TickType_t xTicksToWait);
     static void PrintTaskList();
-    static void PrintHeapStats();
+    // Publishes heap levels and watermarks as metrics gauges (metrics.h)
+    static void UpdateHeapMetrics();
 };
 
 #endif // _SYSTEM_INFO_H_
@@ -0,0 +1,266 @@
+#include "task_profiler.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <esp_log.h>
+#include <esp_heap_caps.h>
+
+#define TAG "TaskProfiler"
+
+#define METRIC_NAME_SIZE (8 + configMAX_TASK_NAME_LEN)
+
+void TaskProfiler::Start(uint32_t interval_ms, int max_tasks) {
+    if (task_handle_ != nullptr) {
+        return;
+    }
+    interval_ms_ = interval_ms;
+    max_tasks_ = max_tasks;
+    hash_size_ = 1;
+    while (hash_size_ < max_tasks * 2) {
+        hash_size_ <<= 1;
+    }
+
+    // Everything the sampler touches is allocated here, sampling itself never allocates
+    status_ = (TaskStatus_t*)heap_caps_calloc(max_tasks, sizeof(TaskStatus_t), MALLOC_CAP_8BIT);
+    slots_ = (Slot*)heap_caps_calloc(max_tasks, sizeof(Slot), MALLOC_CAP_8BIT);
+    hash_ = (int16_t*)heap_caps_malloc(hash_size_ * sizeof(int16_t), MALLOC_CAP_8BIT);
+    names_ = (char*)heap_caps_calloc(max_tasks * 2, METRIC_NAME_SIZE, MALLOC_CAP_8BIT);
+    if (status_ == nullptr || slots_ == nullptr || hash_ == nullptr || names_ == nullptr) {
+        ESP_LOGE(TAG, "Failed to allocate profiler buffers");
+        heap_caps_free(status_);
+        heap_caps_free(slots_);
+        heap_caps_free(hash_);
+        heap_caps_free(names_);
+        status_ = nullptr;
+        slots_ = nullptr;
+        hash_ = nullptr;
+        names_ = nullptr;
+        return;
+    }
+    RebuildHash();
+
+    for (int core = 0; core < std::min(CONFIG_FREERTOS_NUMBER_OF_CORES, TASK_PROFILER_MAX_CORES); core++) {
+        char name[16];
+        snprintf(name, sizeof(name), "cpu.core%d", core);
+        core_metrics_[core] = metrics_register(MetricName("", name), METRIC_GAUGE);
+    }
+
+    xTaskCreate([](void* arg) {
+        auto profiler = (TaskProfiler*)arg;
+        profiler->ProfilerTask();
+        vTaskDelete(NULL);
+    }, "task_profiler", 3072, this, 1, &task_handle_);
+    ESP_LOGI(TAG, "Task profiler started, interval %lu ms, up to %d tasks", interval_ms_, max_tasks_);
+}
+
+void TaskProfiler::ProfilerTask() {
+    TickType_t last_wake = xTaskGetTickCount();
+    while (true) {
+        Sample();
+        vTaskDelayUntil(&last_wake, pdMS_TO_TICKS(interval_ms_));
+    }
+}
+
+const char* TaskProfiler::MetricName(const char* prefix, const char* task_name) {
+    char name[METRIC_NAME_SIZE];
+    snprintf(name, sizeof(name), "%s%s", prefix, task_name);
+    for (int i = 0; i < name_count_; i++) {
+        char* existing = names_ + i * METRIC_NAME_SIZE;
+        if (strcmp(existing, name) == 0) {
+            return existing;
+        }
+    }
+    if (name_count_ >= max_tasks_ * 2) {
+        return "task_profiler.overflow";
+    }
+    char* entry = names_ + name_count_++ * METRIC_NAME_SIZE;
+    strcpy(entry, name);
+    return entry;
+}
+
+static inline uint32_t HashHandle(TaskHandle_t handle) {
+    return ((uint32_t)(uintptr_t)handle >> 2) * 2654435761u;
+}
+
+int TaskProfiler::FindSlot(TaskHandle_t handle) {
+    uint32_t mask = hash_size_ - 1;
+    for (uint32_t i = HashHandle(handle) & mask; hash_[i] >= 0; i = (i + 1) & mask) {
+        if (slots_[hash_[i]].handle == handle) {
+            return hash_[i];
+        }
+    }
+    return -1;
+}
+
+void TaskProfiler::RebuildHash() {
+    uint32_t mask = hash_size_ - 1;
+    memset(hash_, 0xFF, hash_size_ * sizeof(int16_t));
+    for (int slot = 0; slot < max_tasks_; slot++) {
+        if (slots_[slot].handle == nullptr) {
+            continue;
+        }
+        uint32_t i = HashHandle(slots_[slot].handle) & mask;
+        while (hash_[i] >= 0) {
+            i = (i + 1) & mask;
+        }
+        hash_[i] = slot;
+    }
+}
+
+void TaskProfiler::Sample() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    configRUN_TIME_COUNTER_TYPE total_runtime;
+    UBaseType_t count = uxTaskGetSystemState(status_, max_tasks_, &total_runtime);
+    if (count == 0) {
+        ESP_LOGW(TAG, "More than %d tasks, increase the profiler task limit", max_tasks_);
+        return;
+    }
+    uint32_t elapsed = (uint32_t)total_runtime - last_total_runtime_;
+    last_total_runtime_ = total_runtime;
+    // The first pass only records the baseline run time counters
+    bool first = !primed_;
+    primed_ = true;
+
+    for (int slot = 0; slot < max_tasks_; slot++) {
+        slots_[slot].seen = 0;
+    }
+
+    int cores = std::min(CONFIG_FREERTOS_NUMBER_OF_CORES, TASK_PROFILER_MAX_CORES);
+    for (UBaseType_t i = 0; i < count; i++) {
+        const TaskStatus_t& status = status_[i];
+        int index = FindSlot(status.xHandle);
+        bool added = false;
+        if (index < 0) {
+            for (index = 0; index < max_tasks_ && slots_[index].handle != nullptr; index++) {
+            }
+            if (index == max_tasks_) {
+                continue;
+            }
+            Slot& slot = slots_[index];
+            memset(&slot, 0, sizeof(slot));
+            slot.handle = status.xHandle;
+            snprintf(slot.name, sizeof(slot.name), "%s", status.pcTaskName);
+            slot.cpu_metric = metrics_register(MetricName("cpu.", slot.name), METRIC_GAUGE);
+            slot.stack_metric = metrics_register(MetricName("stack.", slot.name), METRIC_GAUGE);
+            added = true;
+        }
+
+        Slot& slot = slots_[index];
+        slot.seen = 1;
+        uint32_t runtime = status.ulRunTimeCounter;
+        uint32_t percent = 0;
+        if (!added && !first && elapsed > 0) {
+            percent = std::min<uint32_t>((uint64_t)(runtime - slot.last_runtime) * 100 / elapsed, 100);
+        }
+        slot.last_runtime = runtime;
+        if (!first) {
+            slot.history[history_index_] = percent;
+        }
+        slot.stack_free = status.usStackHighWaterMark;
+#if CONFIG_FREERTOS_VTASKLIST_INCLUDE_COREID
+        slot.core = status.xCoreID == tskNO_AFFINITY ? -1 : status.xCoreID;
+#else
+        slot.core = -1;
+#endif
+        metric_set(slot.cpu_metric, percent);
+        metric_set(slot.stack_metric, slot.stack_free);
+
+        // Core load is whatever its idle task did not get
+        for (int core = 0; core < cores; core++) {
+            if (!first && !added && status.xHandle == xTaskGetIdleTaskHandleForCore(core)) {
+                core_history_[core][history_index_] = 100 - percent;
+                metric_set(core_metrics_[core], 100 - percent);
+            }
+        }
+    }
+
+    // Tasks that are gone free their slot, their gauges drop to zero
+    for (int slot = 0; slot < max_tasks_; slot++) {
+        if (slots_[slot].handle != nullptr && !slots_[slot].seen) {
+            metric_set(slots_[slot].cpu_metric, 0);
+            slots_[slot].handle = nullptr;
+        }
+    }
+    RebuildHash();
+    if (!first) {
+        history_index_ = (history_index_ + 1) % TASK_PROFILER_HISTORY;
+        samples_++;
+    }
+}
+
+uint8_t TaskProfiler::Average(const uint8_t* history, uint32_t count) {
+    if (count == 0) {
+        return 0;
+    }
+    uint32_t sum = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        sum += history[i];
+    }
+    return sum / count;
+}
+
+uint8_t TaskProfiler::Peak(const uint8_t* history, uint32_t count) {
+    uint8_t peak = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        peak = std::max(peak, history[i]);
+    }
+    return peak;
+}
+
+int TaskProfiler::GetTopTasks(TaskProfile* profiles, int max) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (slots_ == nullptr || samples_ == 0) {
+        return 0;
+    }
+    uint32_t window = std::min<uint32_t>(samples_, TASK_PROFILER_HISTORY);
+    uint32_t latest = (history_index_ + TASK_PROFILER_HISTORY - 1) % TASK_PROFILER_HISTORY;
+    int count = 0;
+    for (int i = 0; i < max_tasks_; i++) {
+        const Slot& slot = slots_[i];
+        if (slot.handle == nullptr) {
+            continue;
+        }
+        TaskProfile profile = {slot.name, slot.core, slot.history[latest],
+            Average(slot.history, window), Peak(slot.history, window), slot.stack_free};
+        // Insertion into the sorted output, lists are short
+        int pos = count < max ? count : max;
+        while (pos > 0 && profiles[pos - 1].avg_percent < profile.avg_percent) {
+            if (pos < max) {
+                profiles[pos] = profiles[pos - 1];
+            }
+            pos--;
+        }
+        if (pos < max) {
+            profiles[pos] = profile;
+            if (count < max) {
+                count++;
+            }
+        }
+    }
+    return count;
+}
+
+int TaskProfiler::GetCoreLoad(int core) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (core < 0 || core >= TASK_PROFILER_MAX_CORES || samples_ == 0) {
+        return -1;
+    }
+    return Average(core_history_[core], std::min<uint32_t>(samples_, TASK_PROFILER_HISTORY));
+}
+
+void TaskProfiler::Log(int top) {
+    TaskProfile profiles[16];
+    int count = GetTopTasks(profiles, std::min(top, 16));
+    if (count == 0) {
+        return;
+    }
+    for (int core = 0; core < std::min(CONFIG_FREERTOS_NUMBER_OF_CORES, TASK_PROFILER_MAX_CORES); core++) {
+        ESP_LOGI(TAG, "core%d load %d%% (rolling average)", core, GetCoreLoad(core));
+    }
+    for (int i = 0; i < count; i++) {
+        auto& p = profiles[i];
+        ESP_LOGI(TAG, "%-16s core %2d cpu %3d%% avg %3d%% peak %3d%% stack free %lu",
+            p.name, p.core, p.cpu_percent, p.avg_percent, p.peak_percent, p.stack_free);
+    }
+}
@@ -0,0 +1,91 @@
+#ifndef TASK_PROFILER_H
+#define TASK_PROFILER_H
+
+#include <cstdint>
+#include <mutex>
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#include "metrics.h"
+
+#define TASK_PROFILER_HISTORY   30      // samples kept per task / core
+#define TASK_PROFILER_MAX_CORES 2
+
+struct TaskProfile {
+    const char* name;
+    int core;                   // -1 when the task is not pinned or unknown
+    uint8_t cpu_percent;        // latest sample, percent of one core
+    uint8_t avg_percent;        // over the history window
+    uint8_t peak_percent;
+    uint32_t stack_free;        // high-water mark, bytes never used
+};
+
+/*
+ * Background CPU profiler.
+ *
+ * A low priority task samples uxTaskGetSystemState() every interval into buffers
+ * preallocated at Start(), matches tasks to the previous sample through a handle
+ * hash table, and keeps a rolling CPU% history per task and per core (derived from
+ * the idle tasks). Results are published as gauges in the metrics registry:
+ *   cpu.core<N>      load of core N in percent
+ *   cpu.<task>       CPU time of the task in percent of one core
+ *   stack.<task>     stack high-water mark in bytes
+ */
+class TaskProfiler {
+public:
+    static TaskProfiler& GetInstance() {
+        static TaskProfiler instance;
+        return instance;
+    }
+
+    void Start(uint32_t interval_ms, int max_tasks);
+    // Copies up to max entries sorted by CPU usage, returns the number copied
+    int GetTopTasks(TaskProfile* profiles, int max);
+    int GetCoreLoad(int core);
+    void Log(int top = 8);
+
+private:
+    TaskProfiler() = default;
+    TaskProfiler(const TaskProfiler&) = delete;
+    TaskProfiler& operator=(const TaskProfiler&) = delete;
+
+    struct Slot {
+        TaskHandle_t handle;
+        char name[configMAX_TASK_NAME_LEN];
+        int core;
+        uint32_t last_runtime;
+        uint32_t stack_free;
+        uint8_t history[TASK_PROFILER_HISTORY];
+        uint8_t seen;
+        metric_t* cpu_metric;
+        metric_t* stack_metric;
+    };
+
+    TaskHandle_t task_handle_ = nullptr;
+    uint32_t interval_ms_ = 0;
+    int max_tasks_ = 0;
+    int hash_size_ = 0;
+    TaskStatus_t* status_ = nullptr;
+    Slot* slots_ = nullptr;
+    int16_t* hash_ = nullptr;
+    char* names_ = nullptr;             // metric names, never reused for another task
+    int name_count_ = 0;
+    uint32_t last_total_runtime_ = 0;
+    bool primed_ = false;
+    uint32_t history_index_ = 0;
+    uint32_t samples_ = 0;
+    uint8_t core_history_[TASK_PROFILER_MAX_CORES][TASK_PROFILER_HISTORY] = {};
+    metric_t* core_metrics_[TASK_PROFILER_MAX_CORES] = {};
+    std::mutex mutex_;
+
+    void ProfilerTask();
+    void Sample();
+    int FindSlot(TaskHandle_t handle);
+    void RebuildHash();
+    const char* MetricName(const char* prefix, const char* task_name);
+    static uint8_t Average(const uint8_t* history, uint32_t count);
+    static uint8_t Peak(const uint8_t* history, uint32_t count);
+};
+
+#endif // TASK_PROFILER_H
@@ -0,0 +1,130 @@
+#include "video_rate_controller.h"
+
+#include <algorithm>
+
+#define WINDOW_US               (1000 * 1000)
+#define QUALITY_BEST            10
+#define QUALITY_WORST           40
+#define QUALITY_STEP_DOWN       4       // towards worse quality
+#define QUALITY_STEP_UP         2       // towards better quality
+#define OVER_BUDGET_PERCENT     115     // hysteresis band around the frame budget
+#define UNDER_BUDGET_PERCENT    70
+#define WINDOWS_TO_CHANGE       2
+#define RESOLUTION_COOLDOWN     3
+#define LINK_HEADROOM_PERCENT   80
+
+const VideoRateController::Resolution VideoRateController::kLadder[] = {
+    {320, 240},     // QVGA
+    {480, 320},     // HVGA
+    {640, 480},     // VGA
+    {800, 600},     // SVGA
+};
+const int VideoRateController::kLadderSize = sizeof(kLadder) / sizeof(kLadder[0]);
+
+VideoRateController::VideoRateController(int target_kbps, int target_fps, int initial_width, int initial_height, int initial_quality)
+    : target_kbps_(target_kbps), target_fps_(std::max(target_fps, 1)) {
+    // The sensor buffers are sized for the initial resolution, never go above it
+    max_level_ = 0;
+    for (int i = 0; i < kLadderSize; i++) {
+        if (kLadder[i].width <= initial_width && kLadder[i].height <= initial_height) {
+            max_level_ = i;
+        }
+    }
+    SetLevel(max_level_);
+    state_.jpeg_quality = std::clamp(initial_quality, QUALITY_BEST, QUALITY_WORST);
+}
+
+void VideoRateController::SetLevel(int level) {
+    state_.level = level;
+    state_.width = kLadder[level].width;
+    state_.height = kLadder[level].height;
+}
+
+void VideoRateController::OnFrameSent(size_t bytes, int64_t send_us, bool ok) {
+    if (!ok) {
+        // A failed send still shows how slow the link is
+        window_send_us_ += send_us;
+        return;
+    }
+    window_frames_++;
+    window_bytes_ += bytes;
+    window_send_us_ += send_us;
+}
+
+bool VideoRateController::Update(int64_t now_us) {
+    if (window_start_us_ == 0) {
+        window_start_us_ = now_us;
+        return false;
+    }
+    int64_t elapsed_us = now_us - window_start_us_;
+    if (elapsed_us < WINDOW_US) {
+        return false;
+    }
+
+    state_.fps = window_frames_ * 1000000LL / elapsed_us;
+    state_.kbps = window_bytes_ * 8 * 1000LL / elapsed_us;
+    if (window_send_us_ > 0 && window_bytes_ > 0) {
+        uint32_t link_kbps = window_bytes_ * 8 * 1000LL / window_send_us_;
+        state_.link_kbps = state_.link_kbps == 0 ? link_kbps : (state_.link_kbps * 3 + link_kbps) / 4;
+    }
+    state_.avg_frame_bytes = window_frames_ > 0 ? window_bytes_ / window_frames_ : 0;
+
+    uint32_t budget_kbps = target_kbps_;
+    if (state_.link_kbps > 0) {
+        budget_kbps = std::min<uint32_t>(budget_kbps, state_.link_kbps * LINK_HEADROOM_PERCENT / 100);
+    }
+    state_.budget_frame_bytes = budget_kbps * 1000 / 8 / target_fps_;
+
+    window_start_us_ = now_us;
+    window_frames_ = 0;
+    window_bytes_ = 0;
+    window_send_us_ = 0;
+
+    if (cooldown_windows_ > 0) {
+        cooldown_windows_--;
+        return false;
+    }
+    if (state_.avg_frame_bytes == 0) {
+        return false;
+    }
+
+    int direction = 0;
+    if (state_.avg_frame_bytes * 100 > state_.budget_frame_bytes * OVER_BUDGET_PERCENT) {
+        direction = -1;
+    } else if (state_.avg_frame_bytes * 100 < state_.budget_frame_bytes * UNDER_BUDGET_PERCENT) {
+        direction = 1;
+    }
+    if (direction == 0 || direction != pending_direction_) {
+        pending_direction_ = direction;
+        pending_windows_ = direction == 0 ? 0 : 1;
+        return false;
+    }
+    if (++pending_windows_ < WINDOWS_TO_CHANGE) {
+        return false;
+    }
+    pending_windows_ = 0;
+
+    if (direction < 0) {
+        if (state_.jpeg_quality < QUALITY_WORST) {
+            state_.jpeg_quality = std::min(state_.jpeg_quality + QUALITY_STEP_DOWN, QUALITY_WORST);
+        } else if (state_.level > 0) {
+            SetLevel(state_.level - 1);
+            // A smaller picture at moderate quality, then fine-tune again
+            state_.jpeg_quality = (QUALITY_BEST + QUALITY_WORST) / 2;
+            cooldown_windows_ = RESOLUTION_COOLDOWN;
+        } else {
+            return false;
+        }
+    } else {
+        if (state_.jpeg_quality > QUALITY_BEST) {
+            state_.jpeg_quality = std::max(state_.jpeg_quality - QUALITY_STEP_UP, QUALITY_BEST);
+        } else if (state_.level < max_level_) {
+            SetLevel(state_.level + 1);
+            state_.jpeg_quality = QUALITY_WORST - QUALITY_STEP_DOWN;
+            cooldown_windows_ = RESOLUTION_COOLDOWN;
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
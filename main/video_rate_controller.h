@@ -0,0 +1,68 @@
+#ifndef VIDEO_RATE_CONTROLLER_H
+#define VIDEO_RATE_CONTROLLER_H
+
+#include <cstddef>
+#include <cstdint>
+
+/*
+ * Closed-loop rate controller for the MJPEG video stream.
+ *
+ * Every window it compares the measured frame sizes against the per-frame budget
+ * derived from the target bitrate, the target fps and the throughput the link
+ * actually achieved while sending. When frames are too large it first lowers
+ * the JPEG quality and then steps down the resolution; when there is headroom it
+ * walks back up in the opposite order. A change is only made after the same
+ * verdict in consecutive windows, and resolution changes have a cool-down.
+ */
+
+struct VideoRateState {
+    int level = 0;                  // index into the resolution ladder, 0 is the smallest
+    int width = 0;
+    int height = 0;
+    int jpeg_quality = 0;           // sensor scale, lower is better
+    uint32_t fps = 0;               // frames sent in the last window
+    uint32_t kbps = 0;              // bitrate sent in the last window
+    uint32_t link_kbps = 0;         // bytes / time spent sending, smoothed
+    uint32_t avg_frame_bytes = 0;
+    uint32_t budget_frame_bytes = 0;
+};
+
+class VideoRateController {
+public:
+    struct Resolution {
+        int width;
+        int height;
+    };
+
+    VideoRateController(int target_kbps, int target_fps, int initial_width, int initial_height, int initial_quality);
+
+    // Called for every frame handed to the network
+    void OnFrameSent(size_t bytes, int64_t send_us, bool ok);
+    // Called periodically, returns true when quality or resolution changed
+    bool Update(int64_t now_us);
+
+    const VideoRateState& state() const { return state_; }
+    int frame_interval_ms() const { return 1000 / target_fps_; }
+
+private:
+    static const Resolution kLadder[];
+    static const int kLadderSize;
+
+    int target_kbps_;
+    int target_fps_;
+    int max_level_;
+    int pending_direction_ = 0;     // -1 shrink, +1 grow
+    int pending_windows_ = 0;
+    int cooldown_windows_ = 0;
+
+    int64_t window_start_us_ = 0;
+    uint32_t window_frames_ = 0;
+    uint64_t window_bytes_ = 0;
+    int64_t window_send_us_ = 0;
+
+    VideoRateState state_;
+
+    void SetLevel(int level);
+};
+
+#endif // VIDEO_RATE_CONTROLLER_H
@@ -1,39 +1,41 @@
 #include "video_stream.h"
+#include "video_rate_controller.h"
 #include "board.h"
 #include "audio/audio_codec.h"
 #include "esp_log.h"
+#include "ws_transport.h"
 #include "esp_websocket_client.h"
+#include "metrics.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/queue.h"
+#include "esp_timer.h"
+#include <algorithm>
+#include <memory>
 
 #define TAG "VideoStream"
 
-static esp_websocket_client_handle_t client = nullptr;
-static bool is_connected = false;
+// 视频连接：
+//   CONFIG_VIDEO_STREAM_URI 非空时单独连接检测服务器，每条二进制消息是一帧完整 JPEG
+//   (boards/samples/detect_from_rk3568.py 的格式)；
+//   为空时走共享连接的 WS_CHANNEL_VIDEO 通道，需要服务端在 uplink_hello 中同意复用。
+// 音量等控制消息由音频模块统一处理，视频连接只发送不接收。
+#define VIDEO_WS_BUFFER_SIZE    4096
+
+static esp_websocket_client_handle_t video_client = nullptr;
+static volatile bool video_connected = false;
 
 static void websocket_event_handler(void *handler_args, esp_event_base_t base, int32_t event_id, void *event_data) {
-    esp_websocket_event_data_t *data = (esp_websocket_event_data_t *)event_data;
     switch (event_id) {
         case WEBSOCKET_EVENT_CONNECTED:
             ESP_LOGI(TAG, "WEBSOCKET_EVENT_CONNECTED");
-            is_connected = true;
+            video_connected = true;
             break;
         case WEBSOCKET_EVENT_DISCONNECTED:
             ESP_LOGW(TAG, "WEBSOCKET_EVENT_DISCONNECTED");
-            is_connected = false;
+            video_connected = false;
             Board::GetInstance().GetDisplay()->ShowNotification("视频连接断开", 2000);
             break;
-        case WEBSOCKET_EVENT_DATA:
-            if (data->op_code == WS_TRANSPORT_OPCODES_TEXT && data->data_len > 0 && data->data_ptr) {
-                std::string volume_str(data->data_ptr, data->data_len);
-                int volume = atoi(volume_str.c_str());
-                ESP_LOGI(TAG, "Received volume from server: %d", volume);
-                auto codec = Board::GetInstance().GetAudioCodec();
-                if (codec) {
-                    codec->SetOutputVolume(volume);
-                }
-            }
-            break;
         case WEBSOCKET_EVENT_ERROR:
             ESP_LOGE(TAG, "WEBSOCKET_EVENT_ERROR");
             Board::GetInstance().GetDisplay()->ShowNotification("视频连接错误", 2000);
@@ -41,79 +43,235 @@ static void websocket_event_handler(void *handler_args, esp_event_base_t base, i
     }
 }
 
-static void video_stream_task(void *pvParameters) {
-    Camera* camera = Board::GetInstance().GetCamera();
-    if (!camera) {
-        ESP_LOGE(TAG, "Camera not found");
-        vTaskDelete(NULL);
-        return;
+static void on_transport_state(bool connected) {
+    if (!connected) {
+        Board::GetInstance().GetDisplay()->ShowNotification("视频连接断开", 2000);
+    }
+}
+
+// ---------------- 采集 / 发送流水线 ----------------
+// 采集任务把 camera 帧缓冲的所有权通过深度为 1 的队列交给发送任务，
+// 网络跟不上时丢弃队列中最旧的帧，采集与发送互不阻塞。
+
+#define FRAME_QUEUE_LEN         1
+#define STATS_INTERVAL_US       (5 * 1000 * 1000)
+
+struct PipelineFrame {
+    CameraFrame frame;
+    int64_t queued_us;
+};
+
+static QueueHandle_t frame_queue = nullptr;
+
+// 自适应帧率：发送失败时由发送任务调大，采集任务按此间隔采集
+static const int MIN_DELAY_MS = 50;    // ~20 FPS
+static const int MAX_DELAY_MS = 200;   // ~5 FPS
+static volatile int current_delay = MIN_DELAY_MS;
+// 码率控制器给出的目标帧间隔
+static volatile int target_interval_ms = MIN_DELAY_MS;
+
+// 统计，仅用于日志
+static volatile uint32_t stat_captured = 0;
+static volatile uint32_t stat_dropped = 0;
+
+// 运行时指标 (metrics.h)
+static metric_t* metric_captured = nullptr;
+static metric_t* metric_sent = nullptr;
+static metric_t* metric_dropped = nullptr;
+static metric_t* metric_send_us = nullptr;
+static metric_t* metric_fps = nullptr;
+static metric_t* metric_frame_bytes = nullptr;
+
+static bool stream_connected() {
+    if (video_client != nullptr) {
+        return video_connected && esp_websocket_client_is_connected(video_client);
+    }
+    return ws_transport_is_connected() && ws_transport_mux_enabled();
+}
+
+static int send_frame(const uint8_t* data, size_t len) {
+    if (video_client != nullptr) {
+        return esp_websocket_client_send_bin(video_client, (const char*)data, len, pdMS_TO_TICKS(500));
     }
+    // 按块发送，音频帧可以插在分块之间
+    return ws_transport_send_chunked(WS_CHANNEL_VIDEO, data, len, pdMS_TO_TICKS(500));
+}
+
+static void video_capture_task(void *pvParameters) {
+    Camera* camera = static_cast<Camera*>(pvParameters);
 
-    // 自适应帧率控制变量
-    const int MIN_DELAY_MS = 50;    // ~20 FPS
-    const int MAX_DELAY_MS = 200;   // ~5 FPS
-    int current_delay = MIN_DELAY_MS;
+    while (1) {
+        if (!stream_connected()) {
+            // 未连接时，等待较长时间；断连时重置延迟
+            current_delay = MIN_DELAY_MS;
+            vTaskDelay(pdMS_TO_TICKS(100));
+            continue;
+        }
+
+        TickType_t start = xTaskGetTickCount();
+        PipelineFrame item = {};
+        if (!camera->AcquireFrame(item.frame)) {
+            vTaskDelay(pdMS_TO_TICKS(current_delay));
+            continue;
+        }
+        item.queued_us = esp_timer_get_time();
+        stat_captured++;
+        metric_inc(metric_captured);
+
+        // 队列满说明网络落后，丢弃最旧的帧，保留最新的
+        if (xQueueSend(frame_queue, &item, 0) != pdTRUE) {
+            PipelineFrame old;
+            if (xQueueReceive(frame_queue, &old, 0) == pdTRUE) {
+                camera->ReleaseFrame(old.frame);
+                stat_dropped++;
+                metric_inc(metric_dropped);
+            }
+            if (xQueueSend(frame_queue, &item, 0) != pdTRUE) {
+                camera->ReleaseFrame(item.frame);
+                stat_dropped++;
+                metric_inc(metric_dropped);
+            }
+        }
+
+        vTaskDelayUntil(&start, pdMS_TO_TICKS(std::max<int>(current_delay, target_interval_ms)));
+    }
+}
+
+static void video_send_task(void *pvParameters) {
+    Camera* camera = static_cast<Camera*>(pvParameters);
     int error_count = 0;
     const int ERROR_THRESHOLD = 3;
 
+    uint32_t sent = 0;
+    int64_t capture_latency_us = 0;     // 采集 -> 入队
+    int64_t queue_latency_us = 0;       // 入队 -> 开始发送
+    int64_t send_latency_us = 0;        // 发送耗时
+    int64_t last_stats_us = esp_timer_get_time();
+
+    // 闭环码率控制：按目标码率/帧率调整 JPEG 质量和分辨率
+    std::unique_ptr<VideoRateController> rate_controller;
+    int width, height, jpeg_quality;
+    if (camera->GetStreamFormat(width, height, jpeg_quality)) {
+        rate_controller = std::make_unique<VideoRateController>(CONFIG_VIDEO_STREAM_TARGET_KBPS,
+            CONFIG_VIDEO_STREAM_TARGET_FPS, width, height, jpeg_quality);
+        target_interval_ms = rate_controller->frame_interval_ms();
+    }
+
     while (1) {
-        // 使用 API 检查连接状态
-        if (esp_websocket_client_is_connected(client) && is_connected) {
-            if (camera->Capture()) {
-                size_t len = 0;
-                const uint8_t* data = camera->GetFrameJpeg(&len);
-                if (data && len > 0) {
-                    int ret = esp_websocket_client_send_bin(client, (const char*)data, len, pdMS_TO_TICKS(500));
-                    if (ret < 0) {
-                         // 仅在非连续错误时打印错误日志，避免刷屏
-                         if (error_count == 0) {
-                            ESP_LOGE(TAG, "Failed to send video frame, ret=%d", ret);
-                         }
-                         error_count++;
-
-                         // 如果连续出错，降低帧率
-                         if (error_count > ERROR_THRESHOLD) {
-                             current_delay = std::min(current_delay * 2, MAX_DELAY_MS);
-                             ESP_LOGW(TAG, "High error rate, decreasing FPS. Delay: %d ms", current_delay);
-                             error_count = 0; // 重置计数
-                         }
-                         
-                         // 如果发送失败且API显示未连接，强制等待更久
-                         if (!esp_websocket_client_is_connected(client)) {
-                             ESP_LOGW(TAG, "Connection lost detected during send, pausing...");
-                             continue;
-                         }
-                    } else {
-                         // 发送成功，逐渐恢复帧率
-                         if (current_delay > MIN_DELAY_MS) {
-                             current_delay = std::max(current_delay - 10, MIN_DELAY_MS);
-                         }
-                         error_count = 0;
-                    }
+        PipelineFrame item;
+        if (xQueueReceive(frame_queue, &item, pdMS_TO_TICKS(1000)) == pdTRUE) {
+            int64_t send_start = esp_timer_get_time();
+            int ret = -1;
+            bool attempted = stream_connected();
+            if (attempted) {
+                ret = send_frame(item.frame.data, item.frame.len);
+            }
+            int64_t send_end = esp_timer_get_time();
+            if (rate_controller && attempted) {
+                rate_controller->OnFrameSent(item.frame.len, send_end - send_start, ret >= 0);
+            }
+            camera->ReleaseFrame(item.frame);
+
+            if (ret < 0) {
+                // 仅在非连续错误时打印错误日志，避免刷屏
+                if (error_count == 0) {
+                    ESP_LOGE(TAG, "Failed to send video frame, ret=%d", ret);
+                }
+                error_count++;
+
+                // 如果连续出错，降低帧率
+                if (error_count > ERROR_THRESHOLD) {
+                    current_delay = std::min(current_delay * 2, MAX_DELAY_MS);
+                    ESP_LOGW(TAG, "High error rate, decreasing FPS. Delay: %d ms", current_delay);
+                    error_count = 0; // 重置计数
+                }
+            } else {
+                // 发送成功，逐渐恢复帧率
+                if (current_delay > MIN_DELAY_MS) {
+                    current_delay = std::max(current_delay - 10, MIN_DELAY_MS);
+                }
+                error_count = 0;
+                sent++;
+                if (item.frame.timestamp_us > 0) {
+                    capture_latency_us += item.queued_us - item.frame.timestamp_us;
                 }
+                queue_latency_us += send_start - item.queued_us;
+                send_latency_us += send_end - send_start;
+                metric_inc(metric_sent);
+                metric_observe(metric_send_us, send_end - send_start);
+                metric_set(metric_frame_bytes, item.frame.len);
             }
-        } else {
-             // 未连接时，等待较长时间
-             // 断连时重置延迟
-             current_delay = MIN_DELAY_MS;
-             continue;
         }
-        vTaskDelay(pdMS_TO_TICKS(current_delay)); 
+
+        int64_t now = esp_timer_get_time();
+        if (rate_controller && rate_controller->Update(now)) {
+            auto& state = rate_controller->state();
+            bool resized = state.width != width || state.height != height;
+            if (resized && camera->SetFrameSize(state.width, state.height)) {
+                width = state.width;
+                height = state.height;
+            }
+            camera->SetJpegQuality(state.jpeg_quality);
+            ESP_LOGI(TAG, "Rate control: %dx%d quality=%d (avg %lu B, budget %lu B, link %lu kbps)",
+                state.width, state.height, state.jpeg_quality, state.avg_frame_bytes, state.budget_frame_bytes, state.link_kbps);
+        }
+
+        if (now - last_stats_us >= STATS_INTERVAL_US) {
+            if (stat_captured > 0) {
+                int elapsed_ms = (now - last_stats_us) / 1000;
+                metric_set(metric_fps, sent * 1000 / elapsed_ms);
+                uint32_t n = std::max<uint32_t>(sent, 1);
+                ESP_LOGI(TAG, "capture %.1f fps, send %.1f fps, dropped %lu, latency capture %d ms / queue %d ms / send %d ms",
+                    stat_captured * 1000.0f / elapsed_ms, sent * 1000.0f / elapsed_ms, stat_dropped,
+                    (int)(capture_latency_us / n / 1000), (int)(queue_latency_us / n / 1000), (int)(send_latency_us / n / 1000));
+                if (rate_controller) {
+                    auto& state = rate_controller->state();
+                    ESP_LOGI(TAG, "Rate control: %dx%d quality=%d, %lu kbps / link %lu kbps",
+                        state.width, state.height, state.jpeg_quality, state.kbps, state.link_kbps);
+                }
+            }
+            stat_captured = 0;
+            stat_dropped = 0;
+            sent = 0;
+            capture_latency_us = queue_latency_us = send_latency_us = 0;
+            last_stats_us = now;
+        }
     }
 }
 
-void start_video_stream(const std::string& url) {
-    esp_websocket_client_config_t websocket_cfg = {};
-    websocket_cfg.uri = url.c_str();
-    websocket_cfg.reconnect_timeout_ms = 10000;
-    websocket_cfg.network_timeout_ms = 20000;
-    websocket_cfg.buffer_size = 20 * 1024; // 20KB RX buffer
-    websocket_cfg.disable_auto_reconnect = false;
+void start_video_stream() {
+    Camera* camera = Board::GetInstance().GetCamera();
+    if (!camera) {
+        ESP_LOGE(TAG, "Camera not found");
+        return;
+    }
+
+    const char* uri = CONFIG_VIDEO_STREAM_URI;
+    if (uri[0] != '\0') {
+        esp_websocket_client_config_t websocket_cfg = {};
+        websocket_cfg.uri = uri;
+        websocket_cfg.reconnect_timeout_ms = 10000;
+        websocket_cfg.network_timeout_ms = 20000;
+        // 只发送：JPEG 由客户端按 buffer_size 分片发送，接收只有控制帧
+        websocket_cfg.buffer_size = VIDEO_WS_BUFFER_SIZE;
+        websocket_cfg.disable_auto_reconnect = false;
 
-    client = esp_websocket_client_init(&websocket_cfg);
-    esp_websocket_register_events(client, WEBSOCKET_EVENT_ANY, websocket_event_handler, (void *)client);
+        video_client = esp_websocket_client_init(&websocket_cfg);
+        esp_websocket_register_events(video_client, WEBSOCKET_EVENT_ANY, websocket_event_handler, nullptr);
+        esp_websocket_client_start(video_client);
+    } else {
+        // 共享连接由 ws_transport 在 WiFi 就绪后建立 (见 audio_uploader_init)
+        ws_transport_add_state_cb(on_transport_state);
+    }
 
-    esp_websocket_client_start(client);
+    metric_captured = metrics_register("video.captured_frames", METRIC_COUNTER);
+    metric_sent = metrics_register("video.sent_frames", METRIC_COUNTER);
+    metric_dropped = metrics_register("video.dropped_frames", METRIC_COUNTER);
+    metric_send_us = metrics_register("video.send_us", METRIC_HISTOGRAM);
+    metric_fps = metrics_register("video.send_fps", METRIC_GAUGE);
+    metric_frame_bytes = metrics_register("video.frame_bytes", METRIC_GAUGE);
 
-    xTaskCreate(video_stream_task, "video_stream", 4096, NULL, 2, NULL);
+    frame_queue = xQueueCreate(FRAME_QUEUE_LEN, sizeof(PipelineFrame));
+    xTaskCreate(video_capture_task, "video_capture", 4096, camera, 2, NULL);
+    xTaskCreate(video_send_task, "video_send", 4096, camera, 2, NULL);
 }
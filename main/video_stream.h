@@ -1,8 +1,7 @@
 #ifndef VIDEO_STREAM_H
 #define VIDEO_STREAM_H
 
-#include <string>
-
-void start_video_stream(const std::string& url);
+// 发送摄像头 JPEG 帧：连接 CONFIG_VIDEO_STREAM_URI，为空时走共享的 ws_transport 连接
+void start_video_stream();
 
 #endif
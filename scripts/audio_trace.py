@@ -0,0 +1,134 @@
+import argparse
+import json
+import struct
+import sys
+
+
+'''
+  Convert an audio latency trace dump (CONFIG_AUDIO_TRACE) into a Chrome trace
+  (chrome://tracing, Perfetto) and print per-stage latency percentiles.
+
+  Input is either the raw binary received on the WebSocket trace channel
+  (channel 4, without the 2 byte mux header) or a console log containing
+  the "AUDIO_TRACE <hex>" lines printed by the "uart" dump.
+'''
+
+MAGIC = 0x43525441
+HEADER = struct.Struct('<IHHI')
+RECORD = struct.Struct('<IHH')
+
+POINTS = [
+    'i2s_read_start', 'i2s_read_end',
+    'afe_feed', 'afe_fetch',
+    'encode_queue_push', 'encode_queue_pop',
+    'encode_start', 'encode_end',
+    'ws_send_start', 'ws_send_end',
+    'decode_queue_push', 'decode_queue_pop',
+    'decode_start', 'decode_end',
+    'playback_queue_push', 'playback_queue_pop',
+    'output_start', 'output_end',
+]
+
+# (stage name, begin point, end point), ids of both points refer to the same frame
+STAGES = [
+    ('i2s_read', 0, 1),
+    ('encode_queue', 4, 5),
+    ('encode', 6, 7),
+    ('ws_send', 8, 9),
+    ('decode_queue', 10, 11),
+    ('decode', 12, 13),
+    ('playback_queue', 14, 15),
+    ('output', 16, 17),
+]
+INSTANTS = {2: 'afe_feed', 3: 'afe_fetch'}
+
+
+def load(path):
+    with open(path, 'rb') as f:
+        data = f.read()
+    if len(data) >= 4 and struct.unpack_from('<I', data)[0] == MAGIC:
+        return data
+    # Console log: collect the hex payload of the AUDIO_TRACE lines
+    blob = bytearray()
+    for line in data.decode('utf-8', errors='ignore').splitlines():
+        index = line.find('AUDIO_TRACE ')
+        if index < 0:
+            continue
+        payload = line[index + len('AUDIO_TRACE '):].strip()
+        if payload in ('BEGIN', 'END'):
+            continue
+        blob += bytes.fromhex(payload)
+    return bytes(blob)
+
+
+def parse(data):
+    magic, version, record_size, count = HEADER.unpack_from(data)
+    if magic != MAGIC:
+        sys.exit('not an audio trace dump')
+    if version != 1 or record_size != RECORD.size:
+        sys.exit(f'unsupported trace version {version} / record size {record_size}')
+    records = []
+    offset = HEADER.size
+    last = None
+    base = 0
+    for _ in range(count):
+        if offset + RECORD.size > len(data):
+            break
+        ts, point, frame = RECORD.unpack_from(data, offset)
+        offset += RECORD.size
+        # Timestamps are 32 bit microseconds and wrap after ~71 minutes
+        if last is not None and ts < last and last - ts > 0x80000000:
+            base += 1 << 32
+        last = ts
+        records.append((base + ts, point, frame))
+    return records
+
+
+def percentile(values, p):
+    index = min(len(values) - 1, int(round(p / 100.0 * (len(values) - 1))))
+    return values[index]
+
+
+def main(path, output):
+    records = parse(load(path))
+    print(f'{len(records)} records')
+
+    events = []
+    latencies = {}
+    stage_tid = {name: i for i, (name, _, _) in enumerate(STAGES)}
+    for name, begin, end in STAGES:
+        pending = {}
+        for ts, point, frame in records:
+            if point == begin:
+                pending[frame] = ts
+            elif point == end and frame in pending:
+                start = pending.pop(frame)
+                latencies.setdefault(name, []).append(ts - start)
+                events.append({'name': name, 'ph': 'X', 'pid': 0, 'tid': stage_tid[name],
+                               'ts': start, 'dur': ts - start, 'args': {'frame': frame}})
+    for ts, point, frame in records:
+        if point in INSTANTS:
+            events.append({'name': INSTANTS[point], 'ph': 'i', 's': 't', 'pid': 0,
+                           'tid': len(STAGES) + point, 'ts': ts, 'args': {'frame': frame}})
+        elif point >= len(POINTS):
+            print(f'unknown trace point {point}')
+
+    with open(output, 'w') as f:
+        json.dump({'traceEvents': events, 'displayTimeUnit': 'ms'}, f)
+    print(f'Chrome trace written to {output}')
+
+    print(f'{"stage":<16}{"count":>8}{"p50":>10}{"p90":>10}{"p99":>10}{"max":>10}  (us)')
+    for name, _, _ in STAGES:
+        values = sorted(latencies.get(name, []))
+        if not values:
+            continue
+        print(f'{name:<16}{len(values):>8}{percentile(values, 50):>10}{percentile(values, 90):>10}'
+              f'{percentile(values, 99):>10}{values[-1]:>10}')
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(description='Audio latency trace converter')
+    parser.add_argument('input', help='binary dump or console log')
+    parser.add_argument('-o', '--output', default='audio_trace.json', help='Chrome trace JSON output')
+    args = parser.parse_args()
+    main(args.input, args.output)
@@ -0,0 +1,74 @@
+import argparse
+import struct
+import sys
+
+
+'''
+  Decode a runtime metrics snapshot (main/metrics.h), as received on the
+  WebSocket metrics channel (channel 5, without the 2 byte mux header)
+  after sending {"type":"metrics"}.
+'''
+
+MAGIC = 0x4352544D
+HISTOGRAM_BUCKETS = 20
+TYPES = {0: 'counter', 1: 'gauge', 2: 'histogram'}
+
+
+def histogram_percentile(buckets, count, p):
+    # Bucket i holds samples below 2^i, report the bucket upper bound
+    target = count * p / 100.0
+    seen = 0
+    for i, n in enumerate(buckets):
+        seen += n
+        if seen >= target and n > 0:
+            return 1 << i
+    return 1 << (len(buckets) - 1)
+
+
+def parse(data):
+    magic, version, count, uptime_ms = struct.unpack_from('<IHHI', data)
+    if magic != MAGIC:
+        sys.exit('not a metrics snapshot')
+    if version != 1:
+        sys.exit(f'unsupported snapshot version {version}')
+    offset = 12
+    metrics = []
+    for _ in range(count):
+        kind, name_len = struct.unpack_from('<BB', data, offset)
+        offset += 2
+        name = data[offset:offset + name_len].decode()
+        offset += name_len
+        value, peak = struct.unpack_from('<II', data, offset)
+        offset += 8
+        metric = {'name': name, 'type': TYPES.get(kind, kind), 'value': value, 'max': peak}
+        if kind == 2:
+            metric['sum'] = struct.unpack_from('<I', data, offset)[0]
+            offset += 4
+            metric['buckets'] = list(struct.unpack_from(f'<{HISTOGRAM_BUCKETS}I', data, offset))
+            offset += HISTOGRAM_BUCKETS * 4
+        metrics.append(metric)
+    return uptime_ms, metrics
+
+
+def main(path):
+    with open(path, 'rb') as f:
+        uptime_ms, metrics = parse(f.read())
+    print(f'uptime {uptime_ms / 1000:.1f} s, {len(metrics)} metrics')
+    for m in metrics:
+        if m['type'] == 'counter':
+            print(f'{m["name"]:<28}{m["value"]:>12}')
+        elif m['type'] == 'gauge':
+            print(f'{m["name"]:<28}{m["value"]:>12}  peak {m["max"]}')
+        else:
+            n = m['value']
+            avg = m['sum'] // n if n else 0
+            p50 = histogram_percentile(m['buckets'], n, 50) if n else 0
+            p99 = histogram_percentile(m['buckets'], n, 99) if n else 0
+            print(f'{m["name"]:<28}{n:>12}  avg {avg} p50<{p50} p99<{p99} max {m["max"]}')
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(description='Metrics snapshot decoder')
+    parser.add_argument('input', help='binary snapshot')
+    args = parser.parse_args()
+    main(args.input)
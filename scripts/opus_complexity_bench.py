@@ -0,0 +1,90 @@
+# Benchmark the Opus encode cost of each complexity level on 60 ms frames
+#
+# The firmware encodes 16 kHz mono in 60 ms frames (OPUS_FRAME_DURATION_MS), the
+# opus governor moves between CONFIG_AUDIO_OPUS_COMPLEXITY_MIN and _MAX at runtime.
+# Host timings are not device timings, but the relative cost between levels and the
+# packet sizes carry over and help choosing the range.
+#
+#   python opus_complexity_bench.py [speech.wav]
+#
+# Without an input file a synthetic voiced signal with pauses is used.
+import argparse
+import math
+import time
+import wave
+
+import numpy as np
+import opuslib
+
+SAMPLE_RATE = 16000
+FRAME_MS = 60
+FRAME_SAMPLES = SAMPLE_RATE * FRAME_MS // 1000
+
+
+def load_pcm(path):
+    with wave.open(path, 'rb') as f:
+        if f.getsampwidth() != 2:
+            raise SystemExit('16 bit PCM WAV expected')
+        pcm = np.frombuffer(f.readframes(f.getnframes()), dtype=np.int16)
+        if f.getnchannels() > 1:
+            pcm = pcm.reshape(-1, f.getnchannels())[:, 0]
+        if f.getframerate() != SAMPLE_RATE:
+            # Linear interpolation is good enough for a cost benchmark
+            duration = len(pcm) / f.getframerate()
+            x = np.linspace(0, len(pcm) - 1, int(duration * SAMPLE_RATE))
+            pcm = np.interp(x, np.arange(len(pcm)), pcm).astype(np.int16)
+    return pcm
+
+
+def synthetic_pcm(seconds=20):
+    t = np.arange(int(seconds * SAMPLE_RATE)) / SAMPLE_RATE
+    pitch = 140 + 30 * np.sin(2 * math.pi * 0.7 * t)
+    phase = 2 * math.pi * np.cumsum(pitch) / SAMPLE_RATE
+    voiced = sum(np.sin(k * phase) / k for k in range(1, 12))
+    # 1.5 s of speech, 0.5 s of near silence
+    envelope = (np.mod(t, 2.0) < 1.5).astype(float) * 0.9 + 0.02
+    noise = np.random.default_rng(1).normal(0, 0.01, len(t))
+    return (np.clip(voiced * 0.2 * envelope + noise, -1, 1) * 32767).astype(np.int16)
+
+
+def bench(pcm, complexity, repeat):
+    frames = [pcm[i:i + FRAME_SAMPLES].tobytes() for i in range(0, len(pcm) - FRAME_SAMPLES + 1, FRAME_SAMPLES)]
+    best = None
+    total_bytes = 0
+    for _ in range(repeat):
+        encoder = opuslib.Encoder(SAMPLE_RATE, 1, opuslib.APPLICATION_VOIP)
+        encoder.complexity = complexity
+        times = []
+        total_bytes = 0
+        for frame in frames:
+            start = time.perf_counter()
+            packet = encoder.encode(frame, FRAME_SAMPLES)
+            times.append(time.perf_counter() - start)
+            total_bytes += len(packet)
+        times.sort()
+        run = (sum(times) / len(times), times[int(len(times) * 0.99)])
+        if best is None or run[0] < best[0]:
+            best = run
+    kbps = total_bytes * 8 / (len(frames) * FRAME_MS)
+    return best[0], best[1], kbps
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Opus encode cost per complexity level')
+    parser.add_argument('input', nargs='?', help='WAV file, 16 bit')
+    parser.add_argument('--repeat', type=int, default=3, help='runs per level, the fastest is reported')
+    args = parser.parse_args()
+
+    pcm = load_pcm(args.input) if args.input else synthetic_pcm()
+    print(f'{len(pcm) / SAMPLE_RATE:.1f} s of audio, {FRAME_MS} ms frames')
+    print(f'{"complexity":>10}{"avg us":>10}{"p99 us":>10}{"% of frame":>12}{"relative":>10}{"kbps":>8}')
+    baseline = None
+    for complexity in range(11):
+        avg, p99, kbps = bench(pcm, complexity, args.repeat)
+        baseline = baseline or avg
+        print(f'{complexity:>10}{avg * 1e6:>10.0f}{p99 * 1e6:>10.0f}{avg * 1e5 / FRAME_MS:>11.2f}%'
+              f'{avg / baseline:>10.2f}{kbps:>8.1f}')
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,22 @@
+#ifndef HOST_BOARD_H
+#define HOST_BOARD_H
+
+class AudioCodec;
+
+// The part of Board the audio pipeline uses, tests install the codec
+class Board {
+public:
+    static Board& GetInstance() {
+        static Board instance;
+        return instance;
+    }
+
+    AudioCodec* GetAudioCodec() { return audio_codec_; }
+    // Host only
+    void SetAudioCodec(AudioCodec* codec) { audio_codec_ = codec; }
+
+private:
+    AudioCodec* audio_codec_ = nullptr;
+};
+
+#endif // HOST_BOARD_H
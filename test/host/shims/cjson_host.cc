@@ -0,0 +1,385 @@
+#include "cJSON.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+namespace {
+
+cJSON* NewItem(int type) {
+    auto item = static_cast<cJSON*>(calloc(1, sizeof(cJSON)));
+    item->type = type;
+    return item;
+}
+
+char* Duplicate(const std::string& text) {
+    auto copy = static_cast<char*>(malloc(text.size() + 1));
+    memcpy(copy, text.c_str(), text.size() + 1);
+    return copy;
+}
+
+void Append(cJSON* parent, cJSON* item) {
+    if (parent->child == nullptr) {
+        parent->child = item;
+        item->prev = item;
+        return;
+    }
+    cJSON* last = parent->child->prev;
+    last->next = item;
+    item->prev = last;
+    parent->child->prev = item;
+}
+
+class Parser {
+public:
+    Parser(const char* text, size_t length) : p_(text), end_(text + length) {}
+
+    cJSON* ParseDocument() {
+        cJSON* item = ParseValue();
+        SkipSpace();
+        if (item != nullptr && p_ != end_ && *p_ != '\0') {
+            cJSON_Delete(item);
+            return nullptr;
+        }
+        return item;
+    }
+
+private:
+    const char* p_;
+    const char* end_;
+
+    void SkipSpace() {
+        while (p_ < end_ && (*p_ == ' ' || *p_ == '\t' || *p_ == '\n' || *p_ == '\r')) {
+            p_++;
+        }
+    }
+
+    bool Match(const char* literal) {
+        size_t length = strlen(literal);
+        if ((size_t)(end_ - p_) < length || strncmp(p_, literal, length) != 0) {
+            return false;
+        }
+        p_ += length;
+        return true;
+    }
+
+    bool ParseString(std::string& out) {
+        if (p_ >= end_ || *p_ != '"') {
+            return false;
+        }
+        p_++;
+        while (p_ < end_ && *p_ != '"') {
+            char c = *p_++;
+            if (c != '\\') {
+                out += c;
+                continue;
+            }
+            if (p_ >= end_) {
+                return false;
+            }
+            char escaped = *p_++;
+            switch (escaped) {
+            case 'n': out += '\n'; break;
+            case 't': out += '\t'; break;
+            case 'r': out += '\r'; break;
+            case 'b': out += '\b'; break;
+            case 'f': out += '\f'; break;
+            case 'u': {
+                if (end_ - p_ < 4) {
+                    return false;
+                }
+                unsigned code = strtoul(std::string(p_, 4).c_str(), nullptr, 16);
+                p_ += 4;
+                if (code < 0x80) {
+                    out += (char)code;
+                } else if (code < 0x800) {
+                    out += (char)(0xC0 | (code >> 6));
+                    out += (char)(0x80 | (code & 0x3F));
+                } else {
+                    out += (char)(0xE0 | (code >> 12));
+                    out += (char)(0x80 | ((code >> 6) & 0x3F));
+                    out += (char)(0x80 | (code & 0x3F));
+                }
+                break;
+            }
+            default: out += escaped; break;
+            }
+        }
+        if (p_ >= end_) {
+            return false;
+        }
+        p_++;
+        return true;
+    }
+
+    cJSON* ParseValue() {
+        SkipSpace();
+        if (p_ >= end_) {
+            return nullptr;
+        }
+        if (*p_ == '{' || *p_ == '[') {
+            bool object = *p_ == '{';
+            char close = object ? '}' : ']';
+            p_++;
+            cJSON* container = NewItem(object ? cJSON_Object : cJSON_Array);
+            SkipSpace();
+            if (p_ < end_ && *p_ == close) {
+                p_++;
+                return container;
+            }
+            while (true) {
+                std::string name;
+                if (object) {
+                    SkipSpace();
+                    if (!ParseString(name)) {
+                        break;
+                    }
+                    SkipSpace();
+                    if (p_ >= end_ || *p_++ != ':') {
+                        break;
+                    }
+                }
+                cJSON* child = ParseValue();
+                if (child == nullptr) {
+                    break;
+                }
+                if (object) {
+                    child->string = Duplicate(name);
+                }
+                Append(container, child);
+                SkipSpace();
+                if (p_ < end_ && *p_ == ',') {
+                    p_++;
+                    continue;
+                }
+                if (p_ < end_ && *p_ == close) {
+                    p_++;
+                    return container;
+                }
+                break;
+            }
+            cJSON_Delete(container);
+            return nullptr;
+        }
+        if (*p_ == '"') {
+            std::string text;
+            if (!ParseString(text)) {
+                return nullptr;
+            }
+            cJSON* item = NewItem(cJSON_String);
+            item->valuestring = Duplicate(text);
+            return item;
+        }
+        if (Match("true")) {
+            return NewItem(cJSON_True);
+        }
+        if (Match("false")) {
+            return NewItem(cJSON_False);
+        }
+        if (Match("null")) {
+            return NewItem(cJSON_NULL);
+        }
+        char* number_end = nullptr;
+        std::string number(p_, std::min<size_t>(end_ - p_, 64));
+        double value = strtod(number.c_str(), &number_end);
+        if (number_end == number.c_str()) {
+            return nullptr;
+        }
+        p_ += number_end - number.c_str();
+        return cJSON_CreateNumber(value);
+    }
+};
+
+void Print(const cJSON* item, std::string& out) {
+    auto quote = [&out](const char* text) {
+        out += '"';
+        for (const char* c = text; *c != '\0'; c++) {
+            if (*c == '"' || *c == '\\') {
+                out += '\\';
+            }
+            out += *c;
+        }
+        out += '"';
+    };
+    switch (item->type & 0xFF) {
+    case cJSON_False: out += "false"; break;
+    case cJSON_True: out += "true"; break;
+    case cJSON_NULL: out += "null"; break;
+    case cJSON_Number: {
+        char buffer[32];
+        if (item->valuedouble == (double)item->valueint) {
+            snprintf(buffer, sizeof(buffer), "%d", item->valueint);
+        } else {
+            snprintf(buffer, sizeof(buffer), "%g", item->valuedouble);
+        }
+        out += buffer;
+        break;
+    }
+    case cJSON_String: quote(item->valuestring); break;
+    case cJSON_Array:
+    case cJSON_Object: {
+        bool object = item->type == cJSON_Object;
+        out += object ? '{' : '[';
+        for (const cJSON* child = item->child; child != nullptr; child = child->next) {
+            if (child != item->child) {
+                out += ',';
+            }
+            if (object) {
+                quote(child->string);
+                out += ':';
+            }
+            Print(child, out);
+        }
+        out += object ? '}' : ']';
+        break;
+    }
+    }
+}
+
+} // namespace
+
+extern "C" {
+
+cJSON* cJSON_ParseWithLength(const char* value, size_t length) {
+    if (value == nullptr) {
+        return nullptr;
+    }
+    return Parser(value, length).ParseDocument();
+}
+
+cJSON* cJSON_Parse(const char* value) {
+    return value != nullptr ? cJSON_ParseWithLength(value, strlen(value)) : nullptr;
+}
+
+void cJSON_Delete(cJSON* item) {
+    while (item != nullptr) {
+        cJSON* next = item->next;
+        cJSON_Delete(item->child);
+        free(item->valuestring);
+        free(item->string);
+        free(item);
+        item = next;
+    }
+}
+
+char* cJSON_PrintUnformatted(const cJSON* item) {
+    if (item == nullptr) {
+        return nullptr;
+    }
+    std::string out;
+    Print(item, out);
+    return Duplicate(out);
+}
+
+void cJSON_free(void* object) {
+    free(object);
+}
+
+cJSON* cJSON_GetObjectItem(const cJSON* object, const char* name) {
+    if (object == nullptr || name == nullptr) {
+        return nullptr;
+    }
+    for (cJSON* child = object->child; child != nullptr; child = child->next) {
+        if (child->string != nullptr && strcasecmp(child->string, name) == 0) {
+            return child;
+        }
+    }
+    return nullptr;
+}
+
+int cJSON_GetArraySize(const cJSON* array) {
+    int size = 0;
+    for (cJSON* child = array != nullptr ? array->child : nullptr; child != nullptr; child = child->next) {
+        size++;
+    }
+    return size;
+}
+
+cJSON* cJSON_GetArrayItem(const cJSON* array, int index) {
+    cJSON* child = array != nullptr ? array->child : nullptr;
+    while (child != nullptr && index-- > 0) {
+        child = child->next;
+    }
+    return child;
+}
+
+char* cJSON_GetStringValue(const cJSON* item) {
+    return cJSON_IsString(item) ? item->valuestring : nullptr;
+}
+
+double cJSON_GetNumberValue(const cJSON* item) {
+    return cJSON_IsNumber(item) ? item->valuedouble : NAN;
+}
+
+cJSON_bool cJSON_IsFalse(const cJSON* item) { return item != nullptr && (item->type & 0xFF) == cJSON_False; }
+cJSON_bool cJSON_IsTrue(const cJSON* item) { return item != nullptr && (item->type & 0xFF) == cJSON_True; }
+cJSON_bool cJSON_IsBool(const cJSON* item) { return item != nullptr && (item->type & (cJSON_True | cJSON_False)) != 0; }
+cJSON_bool cJSON_IsNull(const cJSON* item) { return item != nullptr && (item->type & 0xFF) == cJSON_NULL; }
+cJSON_bool cJSON_IsNumber(const cJSON* item) { return item != nullptr && (item->type & 0xFF) == cJSON_Number; }
+cJSON_bool cJSON_IsString(const cJSON* item) { return item != nullptr && (item->type & 0xFF) == cJSON_String; }
+cJSON_bool cJSON_IsArray(const cJSON* item) { return item != nullptr && (item->type & 0xFF) == cJSON_Array; }
+cJSON_bool cJSON_IsObject(const cJSON* item) { return item != nullptr && (item->type & 0xFF) == cJSON_Object; }
+
+cJSON* cJSON_CreateObject(void) {
+    return NewItem(cJSON_Object);
+}
+
+cJSON* cJSON_CreateArray(void) {
+    return NewItem(cJSON_Array);
+}
+
+cJSON* cJSON_CreateNumber(double number) {
+    cJSON* item = NewItem(cJSON_Number);
+    item->valuedouble = number;
+    item->valueint = number >= 2147483647.0 ? 2147483647 : number <= -2147483648.0 ? (-2147483647 - 1) : (int)number;
+    return item;
+}
+
+cJSON* cJSON_CreateString(const char* string) {
+    cJSON* item = NewItem(cJSON_String);
+    item->valuestring = Duplicate(string);
+    return item;
+}
+
+cJSON* cJSON_CreateBool(cJSON_bool boolean) {
+    return NewItem(boolean ? cJSON_True : cJSON_False);
+}
+
+cJSON_bool cJSON_AddItemToArray(cJSON* array, cJSON* item) {
+    if (array == nullptr || item == nullptr) {
+        return 0;
+    }
+    Append(array, item);
+    return 1;
+}
+
+cJSON_bool cJSON_AddItemToObject(cJSON* object, const char* name, cJSON* item) {
+    if (object == nullptr || name == nullptr || item == nullptr) {
+        return 0;
+    }
+    free(item->string);
+    item->string = Duplicate(name);
+    Append(object, item);
+    return 1;
+}
+
+cJSON* cJSON_AddStringToObject(cJSON* object, const char* name, const char* string) {
+    cJSON* item = cJSON_CreateString(string);
+    cJSON_AddItemToObject(object, name, item);
+    return item;
+}
+
+cJSON* cJSON_AddNumberToObject(cJSON* object, const char* name, double number) {
+    cJSON* item = cJSON_CreateNumber(number);
+    cJSON_AddItemToObject(object, name, item);
+    return item;
+}
+
+cJSON* cJSON_AddBoolToObject(cJSON* object, const char* name, cJSON_bool boolean) {
+    cJSON* item = cJSON_CreateBool(boolean);
+    cJSON_AddItemToObject(object, name, item);
+    return item;
+}
+
+} // extern "C"
@@ -0,0 +1,20 @@
+#ifndef HOST_DRIVER_I2S_COMMON_H
+#define HOST_DRIVER_I2S_COMMON_H
+
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// There is no I2S on the host, codecs are FileAudioCodec or test doubles
+typedef struct i2s_channel_obj_t* i2s_chan_handle_t;
+
+esp_err_t i2s_channel_enable(i2s_chan_handle_t handle);
+esp_err_t i2s_channel_disable(i2s_chan_handle_t handle);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // HOST_DRIVER_I2S_COMMON_H
@@ -0,0 +1,9 @@
+#ifndef HOST_ESP_EVENT_BASE_H
+#define HOST_ESP_EVENT_BASE_H
+
+#include <stdint.h>
+
+typedef const char* esp_event_base_t;
+typedef void (*esp_event_handler_t)(void* handler_args, esp_event_base_t base, int32_t event_id, void* event_data);
+
+#endif // HOST_ESP_EVENT_BASE_H
@@ -0,0 +1,472 @@
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include "esp_system.h"
+#include "nvs_flash.h"
+#include "driver/i2s_common.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdarg>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// ---------------- esp_err / esp_log ----------------
+
+extern "C" const char* esp_err_to_name(esp_err_t code) {
+    switch (code) {
+    case ESP_OK: return "ESP_OK";
+    case ESP_FAIL: return "ESP_FAIL";
+    case ESP_ERR_NO_MEM: return "ESP_ERR_NO_MEM";
+    case ESP_ERR_INVALID_ARG: return "ESP_ERR_INVALID_ARG";
+    case ESP_ERR_INVALID_STATE: return "ESP_ERR_INVALID_STATE";
+    case ESP_ERR_INVALID_SIZE: return "ESP_ERR_INVALID_SIZE";
+    case ESP_ERR_NOT_FOUND: return "ESP_ERR_NOT_FOUND";
+    case ESP_ERR_TIMEOUT: return "ESP_ERR_TIMEOUT";
+    case ESP_ERR_NVS_NOT_INITIALIZED: return "ESP_ERR_NVS_NOT_INITIALIZED";
+    case ESP_ERR_NVS_NOT_FOUND: return "ESP_ERR_NVS_NOT_FOUND";
+    case ESP_ERR_NVS_TYPE_MISMATCH: return "ESP_ERR_NVS_TYPE_MISMATCH";
+    case ESP_ERR_NVS_READ_ONLY: return "ESP_ERR_NVS_READ_ONLY";
+    case ESP_ERR_NVS_NOT_ENOUGH_SPACE: return "ESP_ERR_NVS_NOT_ENOUGH_SPACE";
+    case ESP_ERR_NVS_INVALID_HANDLE: return "ESP_ERR_NVS_INVALID_HANDLE";
+    default: return "UNKNOWN ERROR";
+    }
+}
+
+namespace {
+
+std::mutex log_mutex;
+std::map<std::string, esp_log_level_t> log_levels;
+
+esp_log_level_t DefaultLogLevel() {
+    static esp_log_level_t level = []() {
+        const char* env = getenv("HOST_LOG_LEVEL");
+        return env != nullptr ? (esp_log_level_t)atoi(env) : ESP_LOG_WARN;
+    }();
+    return level;
+}
+
+} // namespace
+
+extern "C" void esp_log_level_set(const char* tag, esp_log_level_t level) {
+    std::lock_guard<std::mutex> lock(log_mutex);
+    log_levels[tag] = level;
+}
+
+extern "C" void host_log(esp_log_level_t level, const char* tag, const char* format, ...) {
+    std::lock_guard<std::mutex> lock(log_mutex);
+    auto it = log_levels.find(tag);
+    if (level > (it != log_levels.end() ? it->second : DefaultLogLevel())) {
+        return;
+    }
+    static const char letters[] = "NEWIDV";
+    fprintf(stderr, "%c (%lld) %s: ", letters[level], (long long)(esp_timer_get_time() / 1000), tag);
+    va_list args;
+    va_start(args, format);
+    vfprintf(stderr, format, args);
+    va_end(args);
+    fputc('\n', stderr);
+}
+
+// ---------------- esp_timer ----------------
+
+struct HostTimer {
+    esp_timer_create_args_t args;
+    bool active = false;
+    uint64_t period_us = 0;     // 0: one shot
+    int64_t due_us = 0;
+};
+
+namespace {
+
+std::mutex timer_mutex;
+std::condition_variable timer_cv;
+std::vector<HostTimer*> timers;
+bool timer_task_started = false;
+const auto start_time = std::chrono::steady_clock::now();
+
+void TimerTask(void* arg) {
+    std::unique_lock<std::mutex> lock(timer_mutex);
+    while (true) {
+        HostTimer* next = nullptr;
+        for (auto timer : timers) {
+            if (timer->active && (next == nullptr || timer->due_us < next->due_us)) {
+                next = timer;
+            }
+        }
+        if (next == nullptr) {
+            timer_cv.wait(lock);
+            continue;
+        }
+        int64_t now = esp_timer_get_time();
+        if (next->due_us > now) {
+            timer_cv.wait_for(lock, std::chrono::microseconds(next->due_us - now));
+            continue;
+        }
+        if (next->period_us > 0) {
+            next->due_us += next->period_us;
+            if (next->args.skip_unhandled_events && next->due_us <= now) {
+                next->due_us = now + next->period_us;
+            }
+        } else {
+            next->active = false;
+        }
+        auto callback = next->args.callback;
+        void* callback_arg = next->args.arg;
+        lock.unlock();
+        callback(callback_arg);
+        lock.lock();
+    }
+}
+
+esp_err_t StartTimer(esp_timer_handle_t timer, uint64_t timeout_us, uint64_t period_us) {
+    {
+        std::lock_guard<std::mutex> lock(timer_mutex);
+        if (timer->active) {
+            return ESP_ERR_INVALID_STATE;
+        }
+        timer->active = true;
+        timer->period_us = period_us;
+        timer->due_us = esp_timer_get_time() + timeout_us;
+        if (!timer_task_started) {
+            timer_task_started = true;
+            xTaskCreate(TimerTask, "esp_timer", 4096, nullptr, 22, nullptr);
+        }
+    }
+    timer_cv.notify_all();
+    return ESP_OK;
+}
+
+} // namespace
+
+extern "C" {
+
+int64_t esp_timer_get_time(void) {
+    auto elapsed = std::chrono::steady_clock::now() - start_time;
+    return std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+}
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t* args, esp_timer_handle_t* out_handle) {
+    if (args == nullptr || args->callback == nullptr || out_handle == nullptr) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    auto timer = new HostTimer();
+    timer->args = *args;
+    std::lock_guard<std::mutex> lock(timer_mutex);
+    timers.push_back(timer);
+    *out_handle = timer;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us) {
+    return StartTimer(timer, timeout_us, 0);
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period) {
+    return StartTimer(timer, period, period);
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer) {
+    std::lock_guard<std::mutex> lock(timer_mutex);
+    if (!timer->active) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    timer->active = false;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_delete(esp_timer_handle_t timer) {
+    std::lock_guard<std::mutex> lock(timer_mutex);
+    if (timer->active) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    timers.erase(std::remove(timers.begin(), timers.end(), timer), timers.end());
+    delete timer;
+    return ESP_OK;
+}
+
+bool esp_timer_is_active(esp_timer_handle_t timer) {
+    std::lock_guard<std::mutex> lock(timer_mutex);
+    return timer->active;
+}
+
+// ---------------- esp_heap_caps ----------------
+
+void* heap_caps_malloc(size_t size, uint32_t caps) {
+    return malloc(size);
+}
+
+void* heap_caps_calloc(size_t n, size_t size, uint32_t caps) {
+    return calloc(n, size);
+}
+
+void* heap_caps_realloc(void* ptr, size_t size, uint32_t caps) {
+    return realloc(ptr, size);
+}
+
+void heap_caps_free(void* ptr) {
+    free(ptr);
+}
+
+size_t heap_caps_get_free_size(uint32_t caps) {
+    return 8 * 1024 * 1024;
+}
+
+size_t heap_caps_get_largest_free_block(uint32_t caps) {
+    return 4 * 1024 * 1024;
+}
+
+// ---------------- esp_system ----------------
+
+static std::mutex shutdown_mutex;
+static std::vector<shutdown_handler_t> shutdown_handlers;
+
+esp_err_t esp_register_shutdown_handler(shutdown_handler_t handler) {
+    std::lock_guard<std::mutex> lock(shutdown_mutex);
+    shutdown_handlers.push_back(handler);
+    return ESP_OK;
+}
+
+esp_err_t esp_unregister_shutdown_handler(shutdown_handler_t handler) {
+    std::lock_guard<std::mutex> lock(shutdown_mutex);
+    auto it = std::find(shutdown_handlers.begin(), shutdown_handlers.end(), handler);
+    if (it == shutdown_handlers.end()) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    shutdown_handlers.erase(it);
+    return ESP_OK;
+}
+
+void host_run_shutdown_handlers(void) {
+    std::vector<shutdown_handler_t> handlers;
+    {
+        std::lock_guard<std::mutex> lock(shutdown_mutex);
+        handlers = shutdown_handlers;
+    }
+    for (auto handler : handlers) {
+        handler();
+    }
+}
+
+void esp_restart(void) {
+    host_run_shutdown_handlers();
+    exit(0);
+}
+
+uint32_t esp_get_free_heap_size(void) {
+    return heap_caps_get_free_size(MALLOC_CAP_DEFAULT);
+}
+
+// ---------------- i2s ----------------
+
+esp_err_t i2s_channel_enable(i2s_chan_handle_t handle) {
+    return ESP_OK;
+}
+
+esp_err_t i2s_channel_disable(i2s_chan_handle_t handle) {
+    return ESP_OK;
+}
+
+} // extern "C"
+
+// ---------------- nvs ----------------
+
+namespace {
+
+struct NvsValue {
+    enum Type { I32, U8, Str } type;
+    int32_t number = 0;
+    std::string text;
+};
+
+struct NvsHandle {
+    std::string ns;
+    bool writable;
+};
+
+std::mutex nvs_mutex;
+std::map<std::string, std::map<std::string, NvsValue>> nvs_store;
+std::map<nvs_handle_t, NvsHandle> nvs_handles;
+nvs_handle_t nvs_next_handle = 1;
+host_nvs_stats_t nvs_stats = {};
+esp_err_t nvs_write_error = ESP_OK;
+std::string nvs_last_commit_task;
+
+// Called with nvs_mutex held
+esp_err_t Lookup(nvs_handle_t handle, const char* key, NvsValue::Type type, NvsValue** value) {
+    auto it = nvs_handles.find(handle);
+    if (it == nvs_handles.end()) {
+        return ESP_ERR_NVS_INVALID_HANDLE;
+    }
+    auto& space = nvs_store[it->second.ns];
+    auto entry = space.find(key);
+    if (entry == space.end() || entry->second.type != type) {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    *value = &entry->second;
+    return ESP_OK;
+}
+
+esp_err_t Store(nvs_handle_t handle, const char* key, const NvsValue& value) {
+    std::lock_guard<std::mutex> lock(nvs_mutex);
+    auto it = nvs_handles.find(handle);
+    if (it == nvs_handles.end()) {
+        return ESP_ERR_NVS_INVALID_HANDLE;
+    }
+    if (!it->second.writable) {
+        return ESP_ERR_NVS_READ_ONLY;
+    }
+    if (nvs_write_error != ESP_OK) {
+        return nvs_write_error;
+    }
+    nvs_store[it->second.ns][key] = value;
+    nvs_stats.writes++;
+    return ESP_OK;
+}
+
+} // namespace
+
+extern "C" {
+
+esp_err_t nvs_flash_init(void) {
+    return ESP_OK;
+}
+
+esp_err_t nvs_flash_erase(void) {
+    std::lock_guard<std::mutex> lock(nvs_mutex);
+    nvs_store.clear();
+    return ESP_OK;
+}
+
+esp_err_t nvs_open(const char* name, nvs_open_mode_t open_mode, nvs_handle_t* out_handle) {
+    std::lock_guard<std::mutex> lock(nvs_mutex);
+    if (open_mode == NVS_READONLY && nvs_store.find(name) == nvs_store.end()) {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    nvs_store[name];
+    nvs_handle_t handle = nvs_next_handle++;
+    nvs_handles[handle] = {name, open_mode == NVS_READWRITE};
+    *out_handle = handle;
+    return ESP_OK;
+}
+
+void nvs_close(nvs_handle_t handle) {
+    std::lock_guard<std::mutex> lock(nvs_mutex);
+    nvs_handles.erase(handle);
+}
+
+esp_err_t nvs_get_i32(nvs_handle_t handle, const char* key, int32_t* out_value) {
+    std::lock_guard<std::mutex> lock(nvs_mutex);
+    NvsValue* value = nullptr;
+    esp_err_t ret = Lookup(handle, key, NvsValue::I32, &value);
+    if (ret == ESP_OK) {
+        *out_value = value->number;
+    }
+    return ret;
+}
+
+esp_err_t nvs_get_u8(nvs_handle_t handle, const char* key, uint8_t* out_value) {
+    std::lock_guard<std::mutex> lock(nvs_mutex);
+    NvsValue* value = nullptr;
+    esp_err_t ret = Lookup(handle, key, NvsValue::U8, &value);
+    if (ret == ESP_OK) {
+        *out_value = (uint8_t)value->number;
+    }
+    return ret;
+}
+
+esp_err_t nvs_get_str(nvs_handle_t handle, const char* key, char* out_value, size_t* length) {
+    std::lock_guard<std::mutex> lock(nvs_mutex);
+    NvsValue* value = nullptr;
+    esp_err_t ret = Lookup(handle, key, NvsValue::Str, &value);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    size_t needed = value->text.size() + 1;
+    if (out_value == nullptr) {
+        *length = needed;
+        return ESP_OK;
+    }
+    if (*length < needed) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    memcpy(out_value, value->text.c_str(), needed);
+    *length = needed;
+    return ESP_OK;
+}
+
+esp_err_t nvs_set_i32(nvs_handle_t handle, const char* key, int32_t value) {
+    return Store(handle, key, {NvsValue::I32, value, ""});
+}
+
+esp_err_t nvs_set_u8(nvs_handle_t handle, const char* key, uint8_t value) {
+    return Store(handle, key, {NvsValue::U8, value, ""});
+}
+
+esp_err_t nvs_set_str(nvs_handle_t handle, const char* key, const char* value) {
+    return Store(handle, key, {NvsValue::Str, 0, value});
+}
+
+esp_err_t nvs_erase_key(nvs_handle_t handle, const char* key) {
+    std::lock_guard<std::mutex> lock(nvs_mutex);
+    auto it = nvs_handles.find(handle);
+    if (it == nvs_handles.end()) {
+        return ESP_ERR_NVS_INVALID_HANDLE;
+    }
+    return nvs_store[it->second.ns].erase(key) > 0 ? ESP_OK : ESP_ERR_NVS_NOT_FOUND;
+}
+
+esp_err_t nvs_erase_all(nvs_handle_t handle) {
+    std::lock_guard<std::mutex> lock(nvs_mutex);
+    auto it = nvs_handles.find(handle);
+    if (it == nvs_handles.end()) {
+        return ESP_ERR_NVS_INVALID_HANDLE;
+    }
+    nvs_store[it->second.ns].clear();
+    return ESP_OK;
+}
+
+esp_err_t nvs_commit(nvs_handle_t handle) {
+    std::lock_guard<std::mutex> lock(nvs_mutex);
+    if (nvs_handles.find(handle) == nvs_handles.end()) {
+        return ESP_ERR_NVS_INVALID_HANDLE;
+    }
+    if (nvs_write_error != ESP_OK) {
+        return nvs_write_error;
+    }
+    nvs_stats.commits++;
+    nvs_last_commit_task = pcTaskGetName(nullptr);
+    return ESP_OK;
+}
+
+host_nvs_stats_t host_nvs_get_stats(void) {
+    std::lock_guard<std::mutex> lock(nvs_mutex);
+    return nvs_stats;
+}
+
+void host_nvs_reset(void) {
+    std::lock_guard<std::mutex> lock(nvs_mutex);
+    nvs_store.clear();
+    nvs_stats = {};
+    nvs_write_error = ESP_OK;
+    nvs_last_commit_task.clear();
+}
+
+void host_nvs_fail_writes(esp_err_t error) {
+    std::lock_guard<std::mutex> lock(nvs_mutex);
+    nvs_write_error = error;
+}
+
+const char* host_nvs_last_commit_task(void) {
+    std::lock_guard<std::mutex> lock(nvs_mutex);
+    return nvs_last_commit_task.c_str();
+}
+
+} // extern "C"
@@ -0,0 +1,27 @@
+#ifndef HOST_ESP_SYSTEM_H
+#define HOST_ESP_SYSTEM_H
+
+#include <stdint.h>
+
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef void (*shutdown_handler_t)(void);
+
+esp_err_t esp_register_shutdown_handler(shutdown_handler_t handler);
+esp_err_t esp_unregister_shutdown_handler(shutdown_handler_t handler);
+// Runs the shutdown handlers and exits the process
+void esp_restart(void);
+uint32_t esp_get_free_heap_size(void);
+
+// Host only: runs the shutdown handlers without exiting, as esp_restart() would
+void host_run_shutdown_handlers(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // HOST_ESP_SYSTEM_H
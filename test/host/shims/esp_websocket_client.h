@@ -0,0 +1,101 @@
+#ifndef HOST_ESP_WEBSOCKET_CLIENT_H
+#define HOST_ESP_WEBSOCKET_CLIENT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+#include "esp_event_base.h"
+#include "freertos/FreeRTOS.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Fake esp_websocket_client. Nothing goes on the network: sent messages are recorded,
+ * and the test connects, disconnects and delivers server messages through the
+ * host_ws_* hooks. Received messages are split into buffer_size fragments with
+ * payload_len/payload_offset set the way the real client reports them.
+ */
+
+typedef struct host_ws_client* esp_websocket_client_handle_t;
+
+typedef enum {
+    WEBSOCKET_EVENT_ANY = -1,
+    WEBSOCKET_EVENT_ERROR = 0,
+    WEBSOCKET_EVENT_CONNECTED,
+    WEBSOCKET_EVENT_DISCONNECTED,
+    WEBSOCKET_EVENT_DATA,
+    WEBSOCKET_EVENT_CLOSED,
+    WEBSOCKET_EVENT_BEFORE_CONNECT,
+    WEBSOCKET_EVENT_MAX,
+} esp_websocket_event_id_t;
+
+typedef enum {
+    WS_TRANSPORT_OPCODES_CONT = 0x00,
+    WS_TRANSPORT_OPCODES_TEXT = 0x01,
+    WS_TRANSPORT_OPCODES_BINARY = 0x02,
+    WS_TRANSPORT_OPCODES_CLOSE = 0x08,
+    WS_TRANSPORT_OPCODES_PING = 0x09,
+    WS_TRANSPORT_OPCODES_PONG = 0x0a,
+} ws_transport_opcodes_t;
+
+typedef struct {
+    const char* data_ptr;
+    int data_len;
+    bool fin;
+    uint8_t op_code;
+    esp_websocket_client_handle_t client;
+    void* user_context;
+    int payload_len;
+    int payload_offset;
+} esp_websocket_event_data_t;
+
+typedef struct {
+    const char* uri;
+    const char* headers;
+    int reconnect_timeout_ms;
+    int network_timeout_ms;
+    int buffer_size;
+    bool disable_auto_reconnect;
+    bool keep_alive_enable;
+    int keep_alive_idle;
+    int keep_alive_interval;
+    int keep_alive_count;
+} esp_websocket_client_config_t;
+
+esp_websocket_client_handle_t esp_websocket_client_init(const esp_websocket_client_config_t* config);
+esp_err_t esp_websocket_register_events(esp_websocket_client_handle_t client, esp_websocket_event_id_t event,
+    esp_event_handler_t handler, void* handler_args);
+esp_err_t esp_websocket_client_start(esp_websocket_client_handle_t client);
+esp_err_t esp_websocket_client_stop(esp_websocket_client_handle_t client);
+esp_err_t esp_websocket_client_destroy(esp_websocket_client_handle_t client);
+bool esp_websocket_client_is_connected(esp_websocket_client_handle_t client);
+int esp_websocket_client_send_bin(esp_websocket_client_handle_t client, const char* data, int len, TickType_t timeout);
+int esp_websocket_client_send_text(esp_websocket_client_handle_t client, const char* data, int len, TickType_t timeout);
+
+// Test hooks, they act on the most recently initialized client
+const char* host_ws_uri(void);
+int host_ws_buffer_size(void);
+void host_ws_set_connected(bool connected);
+// Delivers one server message as WEBSOCKET_EVENT_DATA fragments of at most buffer_size bytes
+void host_ws_receive(int op_code, const void* data, size_t len);
+// Delivers one server message as WebSocket fragments of frame_size bytes: the first frame
+// carries op_code, the rest are CONT frames, fin is set on the last one
+void host_ws_receive_fragmented(int op_code, const void* data, size_t len, size_t frame_size);
+// Every send_bin/send_text blocks this long, to model the uplink
+void host_ws_set_send_delay_us(uint32_t delay_us);
+size_t host_ws_sent_count(void);
+// esp_timer_get_time() when the index-th message was sent, or -1
+int64_t host_ws_sent_time_us(size_t index);
+// Copies the index-th sent message into out, returns its full length or -1
+int host_ws_sent_at(size_t index, int* op_code, void* out, size_t capacity);
+void host_ws_clear_sent(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // HOST_ESP_WEBSOCKET_CLIENT_H
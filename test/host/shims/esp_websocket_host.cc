@@ -0,0 +1,199 @@
+#include "esp_websocket_client.h"
+#include "esp_timer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct host_ws_client {
+    std::string uri;
+    int buffer_size = 1024;
+    esp_event_handler_t handler = nullptr;
+    void* handler_args = nullptr;
+    bool started = false;
+    bool connected = false;
+};
+
+namespace {
+
+struct SentMessage {
+    int op_code;
+    std::vector<uint8_t> data;
+    int64_t time_us;
+};
+
+std::mutex sent_mutex;
+std::vector<SentMessage> sent;
+host_ws_client* current_client = nullptr;
+uint32_t send_delay_us = 0;
+
+const char* const kEventBase = "WEBSOCKET_EVENTS";
+
+void Dispatch(host_ws_client* client, int32_t event_id, esp_websocket_event_data_t* data) {
+    if (client->handler != nullptr) {
+        client->handler(client->handler_args, kEventBase, event_id, data);
+    }
+}
+
+int Send(host_ws_client* client, int op_code, const char* data, int len) {
+    if (client == nullptr || !client->connected) {
+        return -1;
+    }
+    if (send_delay_us > 0) {
+        std::this_thread::sleep_for(std::chrono::microseconds(send_delay_us));
+    }
+    std::lock_guard<std::mutex> lock(sent_mutex);
+    sent.push_back({op_code, std::vector<uint8_t>(data, data + len), esp_timer_get_time()});
+    return len;
+}
+
+// One WebSocket frame, reported in buffer_size pieces like the real client's read loop
+void DeliverFrame(host_ws_client* client, int op_code, const char* bytes, size_t len, bool fin) {
+    size_t offset = 0;
+    do {
+        size_t chunk = std::min(len - offset, (size_t)client->buffer_size);
+        esp_websocket_event_data_t event = {};
+        event.client = client;
+        event.data_ptr = bytes + offset;
+        event.data_len = (int)chunk;
+        event.op_code = (uint8_t)op_code;
+        event.payload_len = (int)len;
+        event.payload_offset = (int)offset;
+        event.fin = fin;
+        Dispatch(client, WEBSOCKET_EVENT_DATA, &event);
+        offset += chunk;
+    } while (offset < len);
+}
+
+} // namespace
+
+extern "C" {
+
+esp_websocket_client_handle_t esp_websocket_client_init(const esp_websocket_client_config_t* config) {
+    auto client = new host_ws_client();
+    client->uri = config->uri != nullptr ? config->uri : "";
+    if (config->buffer_size > 0) {
+        client->buffer_size = config->buffer_size;
+    }
+    current_client = client;
+    return client;
+}
+
+esp_err_t esp_websocket_register_events(esp_websocket_client_handle_t client, esp_websocket_event_id_t event,
+    esp_event_handler_t handler, void* handler_args) {
+    client->handler = handler;
+    client->handler_args = handler_args;
+    return ESP_OK;
+}
+
+esp_err_t esp_websocket_client_start(esp_websocket_client_handle_t client) {
+    client->started = true;
+    return ESP_OK;
+}
+
+esp_err_t esp_websocket_client_stop(esp_websocket_client_handle_t client) {
+    client->started = false;
+    return ESP_OK;
+}
+
+esp_err_t esp_websocket_client_destroy(esp_websocket_client_handle_t client) {
+    if (current_client == client) {
+        current_client = nullptr;
+    }
+    delete client;
+    return ESP_OK;
+}
+
+bool esp_websocket_client_is_connected(esp_websocket_client_handle_t client) {
+    return client != nullptr && client->connected;
+}
+
+int esp_websocket_client_send_bin(esp_websocket_client_handle_t client, const char* data, int len, TickType_t timeout) {
+    return Send(client, WS_TRANSPORT_OPCODES_BINARY, data, len);
+}
+
+int esp_websocket_client_send_text(esp_websocket_client_handle_t client, const char* data, int len, TickType_t timeout) {
+    return Send(client, WS_TRANSPORT_OPCODES_TEXT, data, len);
+}
+
+const char* host_ws_uri(void) {
+    return current_client != nullptr ? current_client->uri.c_str() : nullptr;
+}
+
+int host_ws_buffer_size(void) {
+    return current_client != nullptr ? current_client->buffer_size : 0;
+}
+
+void host_ws_set_connected(bool connected) {
+    host_ws_client* client = current_client;
+    if (client == nullptr || !client->started || client->connected == connected) {
+        return;
+    }
+    client->connected = connected;
+    esp_websocket_event_data_t data = {};
+    data.client = client;
+    Dispatch(client, connected ? WEBSOCKET_EVENT_CONNECTED : WEBSOCKET_EVENT_DISCONNECTED, &data);
+}
+
+void host_ws_receive(int op_code, const void* data, size_t len) {
+    host_ws_client* client = current_client;
+    if (client == nullptr || !client->connected) {
+        return;
+    }
+    DeliverFrame(client, op_code, static_cast<const char*>(data), len, true);
+}
+
+void host_ws_receive_fragmented(int op_code, const void* data, size_t len, size_t frame_size) {
+    host_ws_client* client = current_client;
+    if (client == nullptr || !client->connected) {
+        return;
+    }
+    auto bytes = static_cast<const char*>(data);
+    size_t offset = 0;
+    do {
+        size_t frame = std::min(len - offset, frame_size);
+        DeliverFrame(client, offset == 0 ? op_code : WS_TRANSPORT_OPCODES_CONT, bytes + offset, frame,
+            offset + frame == len);
+        offset += frame;
+    } while (offset < len);
+}
+
+void host_ws_set_send_delay_us(uint32_t delay_us) {
+    send_delay_us = delay_us;
+}
+
+size_t host_ws_sent_count(void) {
+    std::lock_guard<std::mutex> lock(sent_mutex);
+    return sent.size();
+}
+
+int64_t host_ws_sent_time_us(size_t index) {
+    std::lock_guard<std::mutex> lock(sent_mutex);
+    return index < sent.size() ? sent[index].time_us : -1;
+}
+
+int host_ws_sent_at(size_t index, int* op_code, void* out, size_t capacity) {
+    std::lock_guard<std::mutex> lock(sent_mutex);
+    if (index >= sent.size()) {
+        return -1;
+    }
+    const SentMessage& message = sent[index];
+    if (op_code != nullptr) {
+        *op_code = message.op_code;
+    }
+    if (out != nullptr) {
+        memcpy(out, message.data.data(), std::min(capacity, message.data.size()));
+    }
+    return (int)message.data.size();
+}
+
+void host_ws_clear_sent(void) {
+    std::lock_guard<std::mutex> lock(sent_mutex);
+    sent.clear();
+}
+
+} // extern "C"
@@ -0,0 +1,16 @@
+#ifndef HOST_ESP_WN_MODELS_H
+#define HOST_ESP_WN_MODELS_H
+
+#include "esp_wn_iface.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+const esp_wn_iface_t* esp_wn_handle_from_name(const char* model_name);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // HOST_ESP_WN_MODELS_H
@@ -0,0 +1,32 @@
+#ifndef HOST_FREERTOS_H
+#define HOST_FREERTOS_H
+
+/*
+ * FreeRTOS on POSIX threads, just enough of the API for the audio pipeline.
+ * Ticks are milliseconds. See freertos_posix.cc.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#include "sdkconfig.h"
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t StackType_t;
+
+#define pdFALSE                 ((BaseType_t)0)
+#define pdTRUE                  ((BaseType_t)1)
+#define pdFAIL                  pdFALSE
+#define pdPASS                  pdTRUE
+#define portMAX_DELAY           ((TickType_t)0xffffffffUL)
+#define configTICK_RATE_HZ      1000
+#define portTICK_PERIOD_MS      ((TickType_t)1000 / configTICK_RATE_HZ)
+#define pdMS_TO_TICKS(ms)       ((TickType_t)(((TickType_t)(ms) * configTICK_RATE_HZ) / 1000))
+#define tskNO_AFFINITY          0x7fffffff
+// CONFIG_FREERTOS_TASK_NOTIFICATION_ARRAY_ENTRIES in sdkconfig.defaults
+#define configTASK_NOTIFICATION_ARRAY_ENTRIES 2
+
+#endif // HOST_FREERTOS_H
@@ -0,0 +1,33 @@
+#ifndef HOST_FREERTOS_RINGBUF_H
+#define HOST_FREERTOS_RINGBUF_H
+
+#include "freertos/FreeRTOS.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ESP-IDF ring buffer, only RINGBUF_TYPE_NOSPLIT. Items cost their size rounded up to
+// 4 bytes plus an 8 byte header, as on the target.
+typedef struct HostRingbuf* RingbufHandle_t;
+
+typedef enum {
+    RINGBUF_TYPE_NOSPLIT = 0,
+    RINGBUF_TYPE_ALLOWSPLIT,
+    RINGBUF_TYPE_BYTEBUF,
+} RingbufferType_t;
+
+RingbufHandle_t xRingbufferCreate(size_t size, RingbufferType_t type);
+void vRingbufferDelete(RingbufHandle_t ring);
+BaseType_t xRingbufferSend(RingbufHandle_t ring, const void* data, size_t size, TickType_t ticks_to_wait);
+BaseType_t xRingbufferSendAcquire(RingbufHandle_t ring, void** item, size_t size, TickType_t ticks_to_wait);
+BaseType_t xRingbufferSendComplete(RingbufHandle_t ring, void* item);
+void* xRingbufferReceive(RingbufHandle_t ring, size_t* size, TickType_t ticks_to_wait);
+void vRingbufferReturnItem(RingbufHandle_t ring, void* item);
+size_t xRingbufferGetCurFreeSize(RingbufHandle_t ring);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // HOST_FREERTOS_RINGBUF_H
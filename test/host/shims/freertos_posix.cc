@@ -0,0 +1,398 @@
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/event_groups.h"
+#include "freertos/semphr.h"
+#include "freertos/ringbuf.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Handles are never freed, so a stale handle is still safe to notify
+struct HostTask {
+    std::string name;
+    std::mutex mutex;
+    std::condition_variable cv;
+    uint32_t value[configTASK_NOTIFICATION_ARRAY_ENTRIES] = {};
+    bool pending[configTASK_NOTIFICATION_ARRAY_ENTRIES] = {};
+    bool finished = false;
+};
+
+struct HostEventGroup {
+    std::mutex mutex;
+    std::condition_variable cv;
+    EventBits_t bits = 0;
+};
+
+struct HostSemaphore {
+    std::mutex mutex;
+    std::condition_variable cv;
+    UBaseType_t count = 0;
+    UBaseType_t max_count = 1;
+};
+
+struct HostRingbufItem {
+    std::vector<uint8_t> data;
+    bool complete = false;
+};
+
+struct HostRingbuf {
+    std::mutex mutex;
+    std::condition_variable cv;
+    size_t size = 0;
+    size_t used = 0;
+    std::deque<HostRingbufItem> items;
+    size_t received = 0;    // items handed out by xRingbufferReceive and not returned yet
+};
+
+namespace {
+
+std::mutex tasks_mutex;
+std::condition_variable tasks_exit_cv;
+std::vector<HostTask*> tasks;
+thread_local HostTask* current_task = nullptr;
+
+const auto start_time = std::chrono::steady_clock::now();
+
+// Waits on cv until pred() holds, ticks of portMAX_DELAY wait forever
+template <typename Lock, typename Predicate>
+bool WaitTicks(std::condition_variable& cv, Lock& lock, TickType_t ticks, Predicate pred) {
+    if (ticks == portMAX_DELAY) {
+        cv.wait(lock, pred);
+        return true;
+    }
+    return cv.wait_for(lock, std::chrono::milliseconds(ticks * portTICK_PERIOD_MS), pred);
+}
+
+HostTask* RegisterTask(const char* name) {
+    auto task = new HostTask();
+    task->name = name != nullptr ? name : "";
+    std::lock_guard<std::mutex> lock(tasks_mutex);
+    tasks.push_back(task);
+    return task;
+}
+
+size_t ItemCost(size_t size) {
+    return ((size + 3) & ~(size_t)3) + 8;
+}
+
+} // namespace
+
+extern "C" {
+
+BaseType_t xTaskCreate(TaskFunction_t function, const char* name, uint32_t stack_depth, void* arg,
+    UBaseType_t priority, TaskHandle_t* created_task) {
+    HostTask* task = RegisterTask(name);
+    if (created_task != nullptr) {
+        *created_task = task;
+    }
+    std::thread([task, function, arg]() {
+        current_task = task;
+        function(arg);
+        {
+            std::lock_guard<std::mutex> lock(tasks_mutex);
+            task->finished = true;
+        }
+        tasks_exit_cv.notify_all();
+    }).detach();
+    return pdPASS;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t function, const char* name, uint32_t stack_depth, void* arg,
+    UBaseType_t priority, TaskHandle_t* created_task, BaseType_t core) {
+    return xTaskCreate(function, name, stack_depth, arg, priority, created_task);
+}
+
+TaskHandle_t xTaskCreateStatic(TaskFunction_t function, const char* name, uint32_t stack_depth, void* arg,
+    UBaseType_t priority, StackType_t* stack, StaticTask_t* task_buffer) {
+    TaskHandle_t task = nullptr;
+    xTaskCreate(function, name, stack_depth, arg, priority, &task);
+    return task;
+}
+
+void vTaskDelete(TaskHandle_t task) {
+    // The thread ends when the task function returns
+}
+
+void vTaskDelay(TickType_t ticks) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(ticks * portTICK_PERIOD_MS));
+}
+
+TickType_t xTaskGetTickCount(void) {
+    auto elapsed = std::chrono::steady_clock::now() - start_time;
+    return (TickType_t)std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count() / portTICK_PERIOD_MS;
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void) {
+    if (current_task == nullptr) {
+        // A thread that was not created by xTaskCreate, e.g. the test runner
+        current_task = RegisterTask("host");
+    }
+    return current_task;
+}
+
+const char* pcTaskGetName(TaskHandle_t task) {
+    if (task == nullptr) {
+        task = xTaskGetCurrentTaskHandle();
+    }
+    return task->name.c_str();
+}
+
+BaseType_t xTaskNotifyIndexed(TaskHandle_t task, UBaseType_t index, uint32_t value, eNotifyAction action) {
+    BaseType_t result = pdPASS;
+    {
+        std::lock_guard<std::mutex> lock(task->mutex);
+        switch (action) {
+        case eNoAction:
+            break;
+        case eSetBits:
+            task->value[index] |= value;
+            break;
+        case eIncrement:
+            task->value[index]++;
+            break;
+        case eSetValueWithOverwrite:
+            task->value[index] = value;
+            break;
+        case eSetValueWithoutOverwrite:
+            if (task->pending[index]) {
+                result = pdFAIL;
+            } else {
+                task->value[index] = value;
+            }
+            break;
+        }
+        task->pending[index] = true;
+    }
+    task->cv.notify_all();
+    return result;
+}
+
+BaseType_t xTaskNotifyWaitIndexed(UBaseType_t index, uint32_t bits_to_clear_on_entry, uint32_t bits_to_clear_on_exit,
+    uint32_t* notification_value, TickType_t ticks_to_wait) {
+    HostTask* task = xTaskGetCurrentTaskHandle();
+    std::unique_lock<std::mutex> lock(task->mutex);
+    if (!task->pending[index]) {
+        task->value[index] &= ~bits_to_clear_on_entry;
+    }
+    bool notified = WaitTicks(task->cv, lock, ticks_to_wait, [task, index]() { return task->pending[index]; });
+    if (notification_value != nullptr) {
+        *notification_value = task->value[index];
+    }
+    if (!notified) {
+        return pdFALSE;
+    }
+    task->value[index] &= ~bits_to_clear_on_exit;
+    task->pending[index] = false;
+    return pdTRUE;
+}
+
+BaseType_t xTaskNotify(TaskHandle_t task, uint32_t value, eNotifyAction action) {
+    return xTaskNotifyIndexed(task, 0, value, action);
+}
+
+BaseType_t xTaskNotifyWait(uint32_t bits_to_clear_on_entry, uint32_t bits_to_clear_on_exit,
+    uint32_t* notification_value, TickType_t ticks_to_wait) {
+    return xTaskNotifyWaitIndexed(0, bits_to_clear_on_entry, bits_to_clear_on_exit, notification_value, ticks_to_wait);
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task) {
+    return xTaskNotify(task, 0, eIncrement);
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear_count_on_exit, TickType_t ticks_to_wait) {
+    HostTask* task = xTaskGetCurrentTaskHandle();
+    std::unique_lock<std::mutex> lock(task->mutex);
+    WaitTicks(task->cv, lock, ticks_to_wait, [task]() { return task->value[0] != 0; });
+    uint32_t value = task->value[0];
+    if (value != 0) {
+        task->value[0] = clear_count_on_exit ? 0 : value - 1;
+    }
+    task->pending[0] = false;
+    return value;
+}
+
+bool host_task_wait_exit(const char* name, uint32_t timeout_ms) {
+    std::unique_lock<std::mutex> lock(tasks_mutex);
+    return tasks_exit_cv.wait_for(lock, std::chrono::milliseconds(timeout_ms), [name]() {
+        for (auto task : tasks) {
+            if (task->name == name && !task->finished) {
+                return false;
+            }
+        }
+        return true;
+    });
+}
+
+EventGroupHandle_t xEventGroupCreate(void) {
+    return new HostEventGroup();
+}
+
+void vEventGroupDelete(EventGroupHandle_t group) {
+    delete group;
+}
+
+EventBits_t xEventGroupSetBits(EventGroupHandle_t group, EventBits_t bits) {
+    EventBits_t result;
+    {
+        std::lock_guard<std::mutex> lock(group->mutex);
+        group->bits |= bits;
+        result = group->bits;
+    }
+    group->cv.notify_all();
+    return result;
+}
+
+EventBits_t xEventGroupClearBits(EventGroupHandle_t group, EventBits_t bits) {
+    std::lock_guard<std::mutex> lock(group->mutex);
+    EventBits_t previous = group->bits;
+    group->bits &= ~bits;
+    return previous;
+}
+
+EventBits_t xEventGroupGetBits(EventGroupHandle_t group) {
+    std::lock_guard<std::mutex> lock(group->mutex);
+    return group->bits;
+}
+
+EventBits_t xEventGroupWaitBits(EventGroupHandle_t group, EventBits_t bits, BaseType_t clear_on_exit,
+    BaseType_t wait_for_all, TickType_t ticks_to_wait) {
+    std::unique_lock<std::mutex> lock(group->mutex);
+    auto satisfied = [group, bits, wait_for_all]() {
+        return wait_for_all ? (group->bits & bits) == bits : (group->bits & bits) != 0;
+    };
+    bool ok = WaitTicks(group->cv, lock, ticks_to_wait, satisfied);
+    EventBits_t result = group->bits;
+    if (ok && clear_on_exit) {
+        group->bits &= ~bits;
+    }
+    return result;
+}
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t max_count, UBaseType_t initial_count) {
+    auto semaphore = new HostSemaphore();
+    semaphore->max_count = max_count;
+    semaphore->count = initial_count;
+    return semaphore;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void) {
+    return xSemaphoreCreateCounting(1, 1);
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void) {
+    return xSemaphoreCreateCounting(1, 0);
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t semaphore) {
+    delete semaphore;
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticks_to_wait) {
+    std::unique_lock<std::mutex> lock(semaphore->mutex);
+    if (!WaitTicks(semaphore->cv, lock, ticks_to_wait, [semaphore]() { return semaphore->count > 0; })) {
+        return pdFALSE;
+    }
+    semaphore->count--;
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore) {
+    {
+        std::lock_guard<std::mutex> lock(semaphore->mutex);
+        if (semaphore->count >= semaphore->max_count) {
+            return pdFALSE;
+        }
+        semaphore->count++;
+    }
+    semaphore->cv.notify_one();
+    return pdTRUE;
+}
+
+RingbufHandle_t xRingbufferCreate(size_t size, RingbufferType_t type) {
+    if (type != RINGBUF_TYPE_NOSPLIT) {
+        return nullptr;
+    }
+    auto ring = new HostRingbuf();
+    ring->size = size;
+    return ring;
+}
+
+void vRingbufferDelete(RingbufHandle_t ring) {
+    delete ring;
+}
+
+BaseType_t xRingbufferSendAcquire(RingbufHandle_t ring, void** item, size_t size, TickType_t ticks_to_wait) {
+    std::unique_lock<std::mutex> lock(ring->mutex);
+    size_t cost = ItemCost(size);
+    if (!WaitTicks(ring->cv, lock, ticks_to_wait, [ring, cost]() { return ring->used + cost <= ring->size; })) {
+        return pdFALSE;
+    }
+    ring->used += cost;
+    ring->items.emplace_back();
+    ring->items.back().data.resize(size);
+    *item = ring->items.back().data.data();
+    return pdTRUE;
+}
+
+BaseType_t xRingbufferSendComplete(RingbufHandle_t ring, void* item) {
+    {
+        std::lock_guard<std::mutex> lock(ring->mutex);
+        for (auto& entry : ring->items) {
+            if (entry.data.data() == item) {
+                entry.complete = true;
+            }
+        }
+    }
+    ring->cv.notify_all();
+    return pdTRUE;
+}
+
+BaseType_t xRingbufferSend(RingbufHandle_t ring, const void* data, size_t size, TickType_t ticks_to_wait) {
+    void* item = nullptr;
+    if (xRingbufferSendAcquire(ring, &item, size, ticks_to_wait) != pdTRUE) {
+        return pdFALSE;
+    }
+    memcpy(item, data, size);
+    return xRingbufferSendComplete(ring, item);
+}
+
+void* xRingbufferReceive(RingbufHandle_t ring, size_t* size, TickType_t ticks_to_wait) {
+    std::unique_lock<std::mutex> lock(ring->mutex);
+    auto ready = [ring]() {
+        return ring->items.size() > ring->received && ring->items[ring->received].complete;
+    };
+    if (!WaitTicks(ring->cv, lock, ticks_to_wait, ready)) {
+        return nullptr;
+    }
+    auto& entry = ring->items[ring->received++];
+    *size = entry.data.size();
+    return entry.data.data();
+}
+
+void vRingbufferReturnItem(RingbufHandle_t ring, void* item) {
+    {
+        std::lock_guard<std::mutex> lock(ring->mutex);
+        // Items are returned in the order they were received
+        if (ring->received == 0 || ring->items.front().data.data() != item) {
+            return;
+        }
+        ring->used -= ItemCost(ring->items.front().data.size());
+        ring->items.pop_front();
+        ring->received--;
+    }
+    ring->cv.notify_all();
+}
+
+size_t xRingbufferGetCurFreeSize(RingbufHandle_t ring) {
+    std::lock_guard<std::mutex> lock(ring->mutex);
+    return ring->size - ring->used;
+}
+
+} // extern "C"
@@ -0,0 +1,27 @@
+#ifndef HOST_MODEL_PATH_H
+#define HOST_MODEL_PATH_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// No speech models on the host: esp_srmodel_init() and esp_srmodel_filter() find nothing
+typedef struct {
+    char** model_name;
+    char** model_info;
+    void** model_data;
+    int num;
+} srmodel_list_t;
+
+#define ESP_WN_PREFIX "wn"
+#define ESP_MN_PREFIX "mn"
+
+srmodel_list_t* esp_srmodel_init(const char* partition_label);
+void esp_srmodel_deinit(srmodel_list_t* models);
+char* esp_srmodel_filter(srmodel_list_t* models, const char* keyword1, const char* keyword2);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // HOST_MODEL_PATH_H
@@ -0,0 +1,51 @@
+#ifndef HOST_NVS_H
+#define HOST_NVS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// NVS in RAM: set_* go to a pending copy of the namespace, nvs_commit() publishes it
+typedef uint32_t nvs_handle_t;
+
+typedef enum {
+    NVS_READONLY,
+    NVS_READWRITE,
+} nvs_open_mode_t;
+
+esp_err_t nvs_open(const char* name, nvs_open_mode_t open_mode, nvs_handle_t* out_handle);
+void nvs_close(nvs_handle_t handle);
+esp_err_t nvs_get_i32(nvs_handle_t handle, const char* key, int32_t* out_value);
+esp_err_t nvs_get_u8(nvs_handle_t handle, const char* key, uint8_t* out_value);
+esp_err_t nvs_get_str(nvs_handle_t handle, const char* key, char* out_value, size_t* length);
+esp_err_t nvs_set_i32(nvs_handle_t handle, const char* key, int32_t value);
+esp_err_t nvs_set_u8(nvs_handle_t handle, const char* key, uint8_t value);
+esp_err_t nvs_set_str(nvs_handle_t handle, const char* key, const char* value);
+esp_err_t nvs_erase_key(nvs_handle_t handle, const char* key);
+esp_err_t nvs_erase_all(nvs_handle_t handle);
+esp_err_t nvs_commit(nvs_handle_t handle);
+
+// Host only: counters and fault injection for tests
+typedef struct {
+    uint32_t writes;    // successful nvs_set_* calls
+    uint32_t commits;   // successful nvs_commit calls
+} host_nvs_stats_t;
+
+host_nvs_stats_t host_nvs_get_stats(void);
+// Drops every namespace and resets the counters
+void host_nvs_reset(void);
+// The next nvs_set_* / nvs_commit calls fail with error until set back to ESP_OK
+void host_nvs_fail_writes(esp_err_t error);
+// Name of the task that ran the last nvs_commit(), "" before the first one
+const char* host_nvs_last_commit_task(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // HOST_NVS_H
@@ -0,0 +1,29 @@
+#ifndef HOST_OPUS_DECODER_H
+#define HOST_OPUS_DECODER_H
+
+#include <cstdint>
+#include <vector>
+
+/*
+ * Host stand-in for esp-opus-encoder's OpusDecoderWrapper, the inverse of the host
+ * OpusEncoderWrapper. An empty packet is a lost packet and decodes to one frame of
+ * silence, like Opus PLC without a history.
+ */
+class OpusDecoderWrapper {
+public:
+    OpusDecoderWrapper(int sample_rate, int channels, int duration_ms = 60);
+    ~OpusDecoderWrapper();
+
+    bool Decode(std::vector<uint8_t>&& opus, std::vector<int16_t>& pcm);
+    void ResetState();
+
+    inline int sample_rate() const { return sample_rate_; }
+    inline int duration_ms() const { return duration_ms_; }
+
+private:
+    int sample_rate_;
+    int duration_ms_;
+    int frame_size_;
+};
+
+#endif // HOST_OPUS_DECODER_H
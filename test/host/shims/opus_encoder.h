@@ -0,0 +1,45 @@
+#ifndef HOST_OPUS_ENCODER_H
+#define HOST_OPUS_ENCODER_H
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+/*
+ * Host stand-in for esp-opus-encoder's OpusEncoderWrapper, same interface.
+ *
+ * libopus is not available offline, so a "packet" is the frame's PCM as little endian
+ * bytes. That keeps the pipeline bit exact end to end, which the tests rely on, but it
+ * says nothing about Opus encode time or bit rate.
+ */
+class OpusEncoderWrapper {
+public:
+    OpusEncoderWrapper(int sample_rate, int channels, int duration_ms = 60);
+    ~OpusEncoderWrapper();
+
+    inline int sample_rate() const { return sample_rate_; }
+    inline int duration_ms() const { return duration_ms_; }
+    inline int complexity() const { return complexity_; }
+    inline bool dtx() const { return dtx_; }
+
+    void SetDtx(bool enable);
+    void SetComplexity(int complexity);
+    void Encode(std::vector<int16_t>&& pcm, std::function<void(std::vector<uint8_t>&& opus)> handler);
+    bool Encode(std::vector<int16_t>&& pcm, std::vector<uint8_t>& opus);
+    bool IsBufferEmpty() const { return in_buffer_.empty(); }
+    void ResetState();
+
+private:
+    int sample_rate_;
+    int duration_ms_;
+    int frame_size_;
+    int complexity_ = 0;
+    bool dtx_ = false;
+    std::vector<int16_t> in_buffer_;
+};
+
+// Host only: every Encode() of a complete frame sleeps this long, to stand in for the
+// device's encode time where the timing of the caller matters. 0 (the default) disables it.
+void host_opus_set_encode_us(uint32_t us);
+
+#endif // HOST_OPUS_ENCODER_H
@@ -0,0 +1,123 @@
+#include "opus_encoder.h"
+#include "opus_decoder.h"
+#include "opus_resampler.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <thread>
+
+namespace {
+
+std::atomic<uint32_t> encode_us{0};
+
+void ModelEncodeTime() {
+    uint32_t us = encode_us.load();
+    if (us > 0) {
+        std::this_thread::sleep_for(std::chrono::microseconds(us));
+    }
+}
+
+} // namespace
+
+void host_opus_set_encode_us(uint32_t us) {
+    encode_us = us;
+}
+
+OpusEncoderWrapper::OpusEncoderWrapper(int sample_rate, int channels, int duration_ms)
+    : sample_rate_(sample_rate), duration_ms_(duration_ms) {
+    frame_size_ = sample_rate / 1000 * channels * duration_ms;
+}
+
+OpusEncoderWrapper::~OpusEncoderWrapper() {
+}
+
+void OpusEncoderWrapper::SetDtx(bool enable) {
+    dtx_ = enable;
+}
+
+void OpusEncoderWrapper::SetComplexity(int complexity) {
+    complexity_ = complexity;
+}
+
+void OpusEncoderWrapper::Encode(std::vector<int16_t>&& pcm, std::function<void(std::vector<uint8_t>&& opus)> handler) {
+    in_buffer_.insert(in_buffer_.end(), pcm.begin(), pcm.end());
+    while (in_buffer_.size() >= (size_t)frame_size_) {
+        std::vector<uint8_t> opus(frame_size_ * sizeof(int16_t));
+        memcpy(opus.data(), in_buffer_.data(), opus.size());
+        in_buffer_.erase(in_buffer_.begin(), in_buffer_.begin() + frame_size_);
+        ModelEncodeTime();
+        if (handler) {
+            handler(std::move(opus));
+        }
+    }
+}
+
+bool OpusEncoderWrapper::Encode(std::vector<int16_t>&& pcm, std::vector<uint8_t>& opus) {
+    if (pcm.size() != (size_t)frame_size_) {
+        return false;
+    }
+    ModelEncodeTime();
+    opus.resize(pcm.size() * sizeof(int16_t));
+    memcpy(opus.data(), pcm.data(), opus.size());
+    return true;
+}
+
+void OpusEncoderWrapper::ResetState() {
+    in_buffer_.clear();
+}
+
+OpusDecoderWrapper::OpusDecoderWrapper(int sample_rate, int channels, int duration_ms)
+    : sample_rate_(sample_rate), duration_ms_(duration_ms) {
+    frame_size_ = sample_rate / 1000 * channels * duration_ms;
+}
+
+OpusDecoderWrapper::~OpusDecoderWrapper() {
+}
+
+bool OpusDecoderWrapper::Decode(std::vector<uint8_t>&& opus, std::vector<int16_t>& pcm) {
+    if (opus.empty()) {
+        pcm.assign(frame_size_, 0);
+        return true;
+    }
+    if (opus.size() % sizeof(int16_t) != 0) {
+        return false;
+    }
+    pcm.resize(opus.size() / sizeof(int16_t));
+    memcpy(pcm.data(), opus.data(), opus.size());
+    return true;
+}
+
+void OpusDecoderWrapper::ResetState() {
+}
+
+OpusResampler::OpusResampler() {
+}
+
+OpusResampler::~OpusResampler() {
+}
+
+void OpusResampler::Configure(int input_sample_rate, int output_sample_rate) {
+    input_sample_rate_ = input_sample_rate;
+    output_sample_rate_ = output_sample_rate;
+}
+
+int OpusResampler::GetOutputSamples(int input_samples) const {
+    if (input_sample_rate_ == 0) {
+        return input_samples;
+    }
+    return (int)((int64_t)input_samples * output_sample_rate_ / input_sample_rate_);
+}
+
+void OpusResampler::Process(const int16_t* input, int input_samples, int16_t* output) {
+    int output_samples = GetOutputSamples(input_samples);
+    for (int i = 0; i < output_samples; i++) {
+        // Position in the input in 16.16 fixed point
+        int64_t position = ((int64_t)i * input_sample_rate_ << 16) / output_sample_rate_;
+        int index = (int)(position >> 16);
+        int fraction = (int)(position & 0xFFFF);
+        int a = input[index];
+        int b = index + 1 < input_samples ? input[index + 1] : a;
+        output[i] = (int16_t)(a + (((b - a) * fraction) >> 16));
+    }
+}
@@ -0,0 +1,28 @@
+#ifndef HOST_OPUS_RESAMPLER_H
+#define HOST_OPUS_RESAMPLER_H
+
+#include <cstdint>
+
+/*
+ * Host stand-in for esp-opus-encoder's OpusResampler, same interface. Linear
+ * interpolation instead of the Opus/silk resampler, good enough for sample counts and
+ * levels, not for spectral checks.
+ */
+class OpusResampler {
+public:
+    OpusResampler();
+    ~OpusResampler();
+
+    void Configure(int input_sample_rate, int output_sample_rate);
+    void Process(const int16_t* input, int input_samples, int16_t* output);
+    int GetOutputSamples(int input_samples) const;
+
+    int input_sample_rate() const { return input_sample_rate_; }
+    int output_sample_rate() const { return output_sample_rate_; }
+
+private:
+    int input_sample_rate_ = 0;
+    int output_sample_rate_ = 0;
+};
+
+#endif // HOST_OPUS_RESAMPLER_H
@@ -0,0 +1,82 @@
+#ifndef HOST_SDKCONFIG_H
+#define HOST_SDKCONFIG_H
+
+/*
+ * Kconfig values for the host build, the defaults of main/Kconfig.projbuild unless noted.
+ * Every value can be overridden per target with a compile definition.
+ */
+
+#define CONFIG_IDF_TARGET_LINUX 1
+
+#ifndef CONFIG_AUDIO_FRAME_DURATION_MS
+#define CONFIG_AUDIO_FRAME_DURATION_MS 60
+#endif
+
+#ifndef CONFIG_AUDIO_BUFFER_POOL_TASKS
+#define CONFIG_AUDIO_BUFFER_POOL_TASKS 8
+#endif
+#ifndef CONFIG_AUDIO_BUFFER_POOL_FRAMES
+#define CONFIG_AUDIO_BUFFER_POOL_FRAMES 4
+#endif
+#ifndef CONFIG_AUDIO_BUFFER_POOL_PACKETS
+#define CONFIG_AUDIO_BUFFER_POOL_PACKETS 48
+#endif
+#ifndef CONFIG_AUDIO_BUFFER_POOL_PACKET_BYTES
+#define CONFIG_AUDIO_BUFFER_POOL_PACKET_BYTES 320
+#endif
+
+// The host has "PSRAM", so the prompt cache is built
+#ifndef CONFIG_AUDIO_PROMPT_PCM_CACHE
+#define CONFIG_AUDIO_PROMPT_PCM_CACHE 1
+#endif
+#ifndef CONFIG_AUDIO_PROMPT_PCM_CACHE_KB
+#define CONFIG_AUDIO_PROMPT_PCM_CACHE_KB 1024
+#endif
+#ifndef CONFIG_AUDIO_MIXER_DUCKING_PERCENT
+#define CONFIG_AUDIO_MIXER_DUCKING_PERCENT 30
+#endif
+
+#ifndef CONFIG_AUDIO_JITTER_TARGET_MS
+#define CONFIG_AUDIO_JITTER_TARGET_MS 120
+#endif
+#ifndef CONFIG_AUDIO_JITTER_MAX_MS
+#define CONFIG_AUDIO_JITTER_MAX_MS 600
+#endif
+#ifndef CONFIG_AUDIO_JITTER_MAX_CONCEAL_FRAMES
+#define CONFIG_AUDIO_JITTER_MAX_CONCEAL_FRAMES 2
+#endif
+
+#ifndef CONFIG_AUDIO_OPUS_GOVERNOR
+#define CONFIG_AUDIO_OPUS_GOVERNOR 1
+#endif
+#ifndef CONFIG_AUDIO_OPUS_COMPLEXITY_MIN
+#define CONFIG_AUDIO_OPUS_COMPLEXITY_MIN 0
+#endif
+#ifndef CONFIG_AUDIO_OPUS_COMPLEXITY_MAX
+#define CONFIG_AUDIO_OPUS_COMPLEXITY_MAX 5
+#endif
+
+#ifndef CONFIG_AUDIO_UPLINK_BATCH_FRAMES
+#define CONFIG_AUDIO_UPLINK_BATCH_FRAMES 1
+#endif
+
+#ifndef CONFIG_WS_TRANSPORT_URI
+#define CONFIG_WS_TRANSPORT_URI "ws://127.0.0.1:8080/esp32"
+#endif
+#ifndef CONFIG_WS_TRANSPORT_UPLINK_KBPS
+#define CONFIG_WS_TRANSPORT_UPLINK_KBPS 4000
+#endif
+
+// Enabled on the host, so the trace ring is built and tested
+#ifndef CONFIG_AUDIO_TRACE
+#define CONFIG_AUDIO_TRACE 1
+#endif
+#ifndef CONFIG_AUDIO_TRACE_RING_ORDER
+#define CONFIG_AUDIO_TRACE_RING_ORDER 12
+#endif
+
+#ifndef CONFIG_SETTINGS_FLUSH_DELAY_MS
+#define CONFIG_SETTINGS_FLUSH_DELAY_MS 2000
+#endif
+
+#endif // HOST_SDKCONFIG_H
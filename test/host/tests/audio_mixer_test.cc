@@ -0,0 +1,170 @@
+// AudioMixer against a floating point reference of the same mix: per lane gains, ducking,
+// the gain ramps between frames and the final saturation.
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "audio_mixer.h"
+#include "host_test_util.h"
+
+using namespace host_test;
+
+namespace {
+
+constexpr int kRate = 16000;
+constexpr size_t kFrame = kRate * 60 / 1000;
+
+// Gain of one lane across a frame, ramping linearly from start to end like the mixer
+struct LaneGain {
+    double start;
+    double end;
+};
+
+std::vector<int16_t> ReferenceMix(const std::vector<const std::vector<int16_t>*>& inputs,
+                                  const std::vector<LaneGain>& gains, size_t samples) {
+    std::vector<int16_t> out(samples);
+    for (size_t i = 0; i < samples; i++) {
+        double sum = 0;
+        for (size_t lane = 0; lane < inputs.size(); lane++) {
+            if (inputs[lane] == nullptr) {
+                continue;
+            }
+            double gain = gains[lane].start + (gains[lane].end - gains[lane].start) * i / samples;
+            sum += (*inputs[lane])[i] * gain / AudioMixer::kUnity;
+        }
+        out[i] = (int16_t)std::min(std::max(std::round(sum), (double)INT16_MIN), (double)INT16_MAX);
+    }
+    return out;
+}
+
+std::vector<int16_t> Noise(std::mt19937& rng, size_t samples, int amplitude) {
+    std::uniform_int_distribution<int> dist(-amplitude, amplitude);
+    std::vector<int16_t> out(samples);
+    for (auto& sample : out) {
+        sample = dist(rng);
+    }
+    return out;
+}
+
+// Every lane truncates its Q14 product (1 LSB) and the ramped gain truncates its
+// interpolation (up to 1 LSB more), so three lanes stay within 6 LSB of the reference
+constexpr int kTolerance = 6;
+
+int MaxError(const std::vector<int16_t>& actual, const std::vector<int16_t>& expected) {
+    int error = 0;
+    for (size_t i = 0; i < actual.size(); i++) {
+        error = std::max(error, std::abs(actual[i] - expected[i]));
+    }
+    return error;
+}
+
+TEST(AudioMixerTest, SpeechAloneAtUnityIsBitExact) {
+    AudioMixer mixer;
+    mixer.Initialize(kFrame);
+    auto speech = Sine(kRate, 440, 60, 20000);
+    auto frame = speech;
+    const int16_t* inputs[kMixerLaneCount] = {frame.data(), nullptr, nullptr};
+    mixer.Mix(inputs, frame.data(), frame.size());
+    EXPECT_EQ(frame, speech);
+}
+
+TEST(AudioMixerTest, SteadyGainsMatchTheReference) {
+    std::mt19937 rng(7);
+    AudioMixer mixer;
+    mixer.Initialize(kFrame);
+    mixer.SetDucking(AudioMixer::kUnity);
+    const int32_t gains[kMixerLaneCount] = {12000, 9000, 4000};
+    for (int lane = 0; lane < kMixerLaneCount; lane++) {
+        mixer.SetGain((AudioMixerLane)lane, gains[lane]);
+    }
+    auto speech = Noise(rng, kFrame, 9000);
+    auto prompt = Noise(rng, kFrame, 9000);
+    auto tone = Sine(kRate, 1000, 60, 6000);
+    const int16_t* inputs[kMixerLaneCount] = {speech.data(), prompt.data(), tone.data()};
+    std::vector<int16_t> out(kFrame);
+
+    // The first frame ramps from unity, the second one is steady
+    mixer.Mix(inputs, out.data(), kFrame);
+    mixer.Mix(inputs, out.data(), kFrame);
+    auto expected = ReferenceMix({&speech, &prompt, &tone},
+        {{(double)gains[0], (double)gains[0]}, {(double)gains[1], (double)gains[1]}, {(double)gains[2], (double)gains[2]}}, kFrame);
+    EXPECT_LE(MaxError(out, expected), kTolerance);
+}
+
+TEST(AudioMixerTest, DuckingRampsSpeechDownAndBackUp) {
+    constexpr int32_t kDucking = AudioMixer::kUnity / 4;
+    AudioMixer mixer;
+    mixer.Initialize(kFrame);
+    mixer.SetDucking(kDucking);
+    auto speech = Sine(kRate, 300, 60, 16000);
+    auto prompt = Sine(kRate, 1200, 60, 4000);
+    std::vector<int16_t> out(kFrame);
+
+    const int16_t* with_prompt[kMixerLaneCount] = {speech.data(), prompt.data(), nullptr};
+    mixer.Mix(with_prompt, out.data(), kFrame);
+    auto expected = ReferenceMix({&speech, &prompt}, {{AudioMixer::kUnity, kDucking}, {AudioMixer::kUnity, AudioMixer::kUnity}}, kFrame);
+    EXPECT_LE(MaxError(out, expected), kTolerance) << "ducking in";
+
+    mixer.Mix(with_prompt, out.data(), kFrame);
+    expected = ReferenceMix({&speech, &prompt}, {{kDucking, kDucking}, {AudioMixer::kUnity, AudioMixer::kUnity}}, kFrame);
+    EXPECT_LE(MaxError(out, expected), kTolerance) << "ducked";
+
+    // The prompt ends, speech comes back over the next frame
+    const int16_t* speech_only[kMixerLaneCount] = {speech.data(), nullptr, nullptr};
+    mixer.Mix(speech_only, out.data(), kFrame);
+    expected = ReferenceMix({&speech}, {{kDucking, AudioMixer::kUnity}}, kFrame);
+    EXPECT_LE(MaxError(out, expected), kTolerance) << "ducking out";
+}
+
+TEST(AudioMixerTest, SumSaturatesInsteadOfWrapping) {
+    AudioMixer mixer;
+    mixer.Initialize(kFrame);
+    mixer.SetDucking(AudioMixer::kUnity);
+    auto loud = Sine(kRate, 200, 60, 30000);
+    const int16_t* inputs[kMixerLaneCount] = {loud.data(), loud.data(), loud.data()};
+    std::vector<int16_t> out(kFrame);
+    mixer.Mix(inputs, out.data(), kFrame);
+    auto expected = ReferenceMix({&loud, &loud, &loud},
+        {{AudioMixer::kUnity, AudioMixer::kUnity}, {AudioMixer::kUnity, AudioMixer::kUnity}, {AudioMixer::kUnity, AudioMixer::kUnity}}, kFrame);
+    EXPECT_LE(MaxError(out, expected), kTolerance);
+    EXPECT_EQ(*std::max_element(out.begin(), out.end()), INT16_MAX);
+    EXPECT_EQ(*std::min_element(out.begin(), out.end()), INT16_MIN);
+}
+
+TEST(AudioMixerTest, OutputMayAliasTheSpeechInput) {
+    std::mt19937 rng(3);
+    AudioMixer mixer;
+    mixer.Initialize(kFrame);
+    mixer.SetDucking(AudioMixer::kUnity / 2);
+    auto speech = Noise(rng, kFrame, 12000);
+    auto tone = Sine(kRate, 800, 60, 6000);
+    auto frame = speech;
+    const int16_t* inputs[kMixerLaneCount] = {frame.data(), nullptr, tone.data()};
+    mixer.Mix(inputs, frame.data(), kFrame);
+    auto expected = ReferenceMix({&speech, nullptr, &tone},
+        {{AudioMixer::kUnity, AudioMixer::kUnity / 2}, {0, 0}, {AudioMixer::kUnity, AudioMixer::kUnity}}, kFrame);
+    EXPECT_LE(MaxError(frame, expected), kTolerance);
+}
+
+TEST(AudioMixerTest, GainChangesAreClickFree) {
+    AudioMixer mixer;
+    mixer.Initialize(kFrame);
+    std::vector<int16_t> dc(kFrame, 16000);
+    std::vector<int16_t> out(kFrame);
+    const int16_t* inputs[kMixerLaneCount] = {dc.data(), nullptr, nullptr};
+    mixer.SetGain(kMixerLaneSpeech, 0);
+    mixer.Mix(inputs, out.data(), kFrame);
+    // Unity to silence across the frame: monotone, in steps of about 16000 / kFrame
+    for (size_t i = 1; i < kFrame; i++) {
+        ASSERT_LE(out[i], out[i - 1]);
+        ASSERT_LE(out[i - 1] - out[i], 16000 / (int)kFrame + 2);
+    }
+    mixer.Mix(inputs, out.data(), kFrame);
+    EXPECT_EQ(*std::max_element(out.begin(), out.end()), 0);
+}
+
+} // namespace
@@ -0,0 +1,177 @@
+// End to end: FileAudioCodec -> AudioService (NoAudioProcessor) -> uplink over the fake
+// websocket, and server packets -> jitter buffer -> decoder -> mixer -> output WAV.
+// The host Opus codec is a PCM pass-through, so samples can be compared exactly.
+
+#include <gtest/gtest.h>
+
+#include <mutex>
+
+#include <board.h>
+
+#include "audio_buffer_pool.h"
+#include "audio_service.h"
+#include "audio_uploader.h"
+#include "file_audio_codec.h"
+#include "host_test_util.h"
+
+using namespace host_test;
+
+namespace {
+
+constexpr int kSampleRate = 16000;
+constexpr int kFrameSamples = kSampleRate / 1000 * OPUS_FRAME_DURATION_MS;
+
+class AudioPipelineTest : public ::testing::Test {
+protected:
+    static void SetUpTestSuite() {
+        input_path_ = TempPath("pipeline_in.wav");
+        output_path_ = TempPath("pipeline_out.wav");
+        WriteWav(input_path_, Sine(kSampleRate, 440, 2000), kSampleRate);
+
+        // Never deleted: tasks and timers of the service outlive the test cases
+        codec_ = new FileAudioCodec(input_path_, output_path_, kSampleRate, true, true);
+        Board::GetInstance().SetAudioCodec(codec_);
+        service_ = new AudioService();
+        service_->Initialize(codec_);
+        service_->Start();
+
+        audio_uploader_init();
+        host_ws_set_connected(true);
+    }
+
+    static std::string input_path_;
+    static std::string output_path_;
+    static FileAudioCodec* codec_;
+    static AudioService* service_;
+};
+
+std::string AudioPipelineTest::input_path_;
+std::string AudioPipelineTest::output_path_;
+FileAudioCodec* AudioPipelineTest::codec_ = nullptr;
+AudioService* AudioPipelineTest::service_ = nullptr;
+
+TEST_F(AudioPipelineTest, SendsHelloOnConnect) {
+    bool hello = false;
+    for (auto& message : SentMessages()) {
+        std::string text(message.data.begin(), message.data.end());
+        if (message.op_code == WS_TRANSPORT_OPCODES_TEXT && text.find("\"uplink_hello\"") != std::string::npos) {
+            hello = true;
+        }
+    }
+    EXPECT_TRUE(hello);
+}
+
+TEST_F(AudioPipelineTest, UplinksMicrophoneFrames) {
+    host_ws_clear_sent();
+    service_->EnableVoiceProcessing(true);
+    ASSERT_TRUE(WaitFor([] { return SentOnChannel(WS_CHANNEL_AUDIO_UP).size() >= 5; }, 3000));
+    service_->EnableVoiceProcessing(false);
+
+    // Without a negotiated uplink header every message is one bare encoded frame
+    auto frames = SentOnChannel(WS_CHANNEL_AUDIO_UP);
+    for (auto& frame : frames) {
+        ASSERT_EQ(frame.size(), kFrameSamples * sizeof(int16_t));
+    }
+    auto pcm = reinterpret_cast<const int16_t*>(frames[1].data());
+    double rms = Rms(pcm, kFrameSamples);
+    EXPECT_GT(rms, 8000 / sqrt(2) * 0.9);
+    EXPECT_LT(rms, 8000 / sqrt(2) * 1.1);
+}
+
+TEST_F(AudioPipelineTest, PlaysServerPackets) {
+    uint32_t played = Metric("audio.playback_frames");
+    auto tone = Sine(kSampleRate, 1000, OPUS_FRAME_DURATION_MS * 10, 12000);
+    for (size_t offset = 0; offset < tone.size(); offset += kFrameSamples) {
+        auto packet = AudioStreamPacketPtr(new AudioStreamPacket());
+        packet->sample_rate = kSampleRate;
+        packet->frame_duration = OPUS_FRAME_DURATION_MS;
+        packet->payload.resize(kFrameSamples * sizeof(int16_t));
+        memcpy(packet->payload.data(), tone.data() + offset, packet->payload.size());
+        ASSERT_TRUE(service_->PushPacketToDecodeQueue(std::move(packet), true));
+    }
+    ASSERT_TRUE(WaitFor([played] { return Metric("audio.playback_frames") >= played + 10; }, 5000));
+    ASSERT_TRUE(WaitFor([] { return service_->IsIdle(); }, 2000));
+
+    codec_->EnableOutput(false);
+    auto output = ReadWav(output_path_);
+    codec_->EnableOutput(true);
+    ASSERT_GE(output.size(), tone.size());
+
+    // The tone comes out unchanged, somewhere after the jitter buffer's prefill silence
+    auto first = std::find_if(output.begin(), output.end(), [](int16_t s) { return s != 0; });
+    ASSERT_NE(first, output.end());
+    size_t start = first - output.begin() - 1;
+    ASSERT_LE(start + tone.size(), output.size());
+    size_t mismatches = 0;
+    for (size_t i = 0; i < tone.size(); i++) {
+        mismatches += output[start + i] != tone[i];
+    }
+    EXPECT_EQ(mismatches, 0u);
+}
+
+// The BOOT button loopback: every recorded frame is played back, none is lost to the slots
+// the decode queue still holds for packets discarded by Clear()
+TEST_F(AudioPipelineTest, AudioTestingPlaysEveryRecordedFrame) {
+    uint32_t encoded = Metric("audio.encode_frames");
+    service_->EnableAudioTesting(true);
+    WaitFor([] { return false; }, 600);
+    // Let the codec task finish the frame in flight
+    ASSERT_TRUE(WaitFor([&] { return Metric("audio.encode_frames") > encoded; }, 1000));
+    WaitFor([] { return false; }, 100);
+    uint32_t recorded = Metric("audio.encode_frames") - encoded;
+    uint32_t played = Metric("audio.decode_frames");
+    service_->EnableAudioTesting(false);
+    ASSERT_TRUE(WaitFor([&] { return Metric("audio.decode_frames") >= played + recorded; }, 5000))
+        << Metric("audio.decode_frames") - played << " of " << recorded << " frames played";
+}
+
+TEST_F(AudioPipelineTest, SharedFramesSurviveTheEncoder) {
+    // A tap keeps refs to the processor's frames while the encoder consumes them
+    std::mutex mutex;
+    std::vector<PcmFrameRef> held;
+    std::vector<std::vector<int16_t>> copies;
+    int tap = service_->AddPcmTap([&](const PcmFrameRef& frame) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (held.size() < 3) {
+            held.push_back(frame);
+            copies.emplace_back(frame.data(), frame.data() + frame.size());
+        }
+    });
+    auto frame_stats = AudioBufferPool::GetInstance().GetFrameStats();
+    host_ws_clear_sent();
+    service_->EnableVoiceProcessing(true);
+    ASSERT_TRUE(WaitFor([] { return SentOnChannel(WS_CHANNEL_AUDIO_UP).size() >= 10; }, 3000));
+    service_->EnableVoiceProcessing(false);
+    service_->RemovePcmTap(tap);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    ASSERT_EQ(held.size(), 3u);
+    for (size_t i = 0; i < held.size(); i++) {
+        ASSERT_EQ(held[i].size(), (size_t)kFrameSamples);
+        EXPECT_TRUE(std::equal(copies[i].begin(), copies[i].end(), held[i].data())) << "frame " << i << " changed";
+    }
+    held.clear();
+    // Frames take the processor's buffer instead of a copy, their capacity stays the same
+    EXPECT_EQ(AudioBufferPool::GetInstance().GetFrameStats().buffer_reallocs, frame_stats.buffer_reallocs);
+}
+
+TEST_F(AudioPipelineTest, PooledBuffersStayInThePoolMemory) {
+    const uint32_t caps = MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT;
+    auto& pool = AudioBufferPool::GetInstance();
+    auto task = pool.AcquireTask();
+    auto packet = pool.AcquirePacket();
+    EXPECT_EQ(task->pcm.get_allocator().caps, caps);
+    EXPECT_EQ(packet->payload.get_allocator().caps, caps);
+    EXPECT_GE(packet->payload.capacity(), (size_t)CONFIG_AUDIO_BUFFER_POOL_PACKET_BYTES);
+
+    // A buffer from the default heap moved in is replaced when the object is recycled
+    task->pcm = AudioPcmBuffer(16);
+    AudioTask* recycled = task.get();
+    task.reset();
+    task = pool.AcquireTask();
+    ASSERT_EQ(task.get(), recycled);
+    EXPECT_EQ(task->pcm.get_allocator().caps, caps);
+    EXPECT_TRUE(task->pcm.empty());
+}
+
+} // namespace
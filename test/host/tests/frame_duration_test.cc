@@ -0,0 +1,118 @@
+// Uplink latency against packet rate for every supported frame duration: the service is
+// switched at runtime like a server uplink_hello reply does, and every frame's capture
+// time (uplink header) is compared with the time it reached the websocket.
+
+#include <gtest/gtest.h>
+
+#include <arpa/inet.h>
+
+#include <algorithm>
+
+#include <board.h>
+
+#include "audio_service.h"
+#include "audio_uploader.h"
+#include "file_audio_codec.h"
+#include "host_test_util.h"
+
+using namespace host_test;
+
+namespace {
+
+constexpr int kSampleRate = 16000;
+constexpr int kMeasureMs = 1500;
+
+struct Measurement {
+    double packets_per_second;
+    int64_t p50_ms;
+    int64_t max_ms;
+    size_t frames;
+};
+
+class FrameDurationTest : public ::testing::TestWithParam<int> {
+protected:
+    static void SetUpTestSuite() {
+        std::string input_path = TempPath("frame_duration_in.wav");
+        WriteWav(input_path, Sine(kSampleRate, 440, 2000), kSampleRate);
+        // Never deleted: tasks and timers of the service outlive the test cases
+        codec_ = new FileAudioCodec(input_path, TempPath("frame_duration_out.wav"), kSampleRate, true, true);
+        Board::GetInstance().SetAudioCodec(codec_);
+        service_ = new AudioService();
+        service_->Initialize(codec_);
+        service_->Start();
+
+        audio_uploader_init();
+        host_ws_set_connected(true);
+        std::string hello = "{\"type\":\"uplink_hello\",\"uplink_header\":1}";
+        host_ws_receive(WS_TRANSPORT_OPCODES_TEXT, hello.data(), hello.size());
+    }
+
+    // Frames of the given duration sent within the measuring window
+    static Measurement Measure(int frame_duration_ms) {
+        service_->SetFrameDuration(frame_duration_ms);
+        audio_uploader_set_frame_duration(frame_duration_ms);
+        service_->EnableVoiceProcessing(true);
+        // Let frames of the previous duration drain
+        WaitFor([] { return false; }, 200);
+        host_ws_clear_sent();
+        WaitFor([] { return false; }, kMeasureMs);
+        service_->EnableVoiceProcessing(false);
+
+        std::vector<int64_t> latencies_ms;
+        int64_t first_us = -1, last_us = -1;
+        for (auto& message : SentMessages()) {
+            if (message.op_code != WS_TRANSPORT_OPCODES_BINARY || message.data.size() < sizeof(audio_uplink_header_t)) {
+                continue;
+            }
+            auto header = reinterpret_cast<const audio_uplink_header_t*>(message.data.data());
+            if (ntohs(header->frame_duration) != frame_duration_ms) {
+                continue;
+            }
+            latencies_ms.push_back(message.time_us / 1000 - (int64_t)ntohl(header->timestamp));
+            if (first_us < 0) {
+                first_us = message.time_us;
+            }
+            last_us = message.time_us;
+        }
+        Measurement result = {};
+        result.frames = latencies_ms.size();
+        if (latencies_ms.size() < 2) {
+            return result;
+        }
+        std::sort(latencies_ms.begin(), latencies_ms.end());
+        result.p50_ms = latencies_ms[latencies_ms.size() / 2];
+        result.max_ms = latencies_ms.back();
+        result.packets_per_second = (latencies_ms.size() - 1) * 1e6 / (last_us - first_us);
+        return result;
+    }
+
+    static FileAudioCodec* codec_;
+    static AudioService* service_;
+};
+
+FileAudioCodec* FrameDurationTest::codec_ = nullptr;
+AudioService* FrameDurationTest::service_ = nullptr;
+
+TEST_P(FrameDurationTest, LatencyAgainstPacketRate) {
+    int frame_duration_ms = GetParam();
+    Measurement m = Measure(frame_duration_ms);
+    // 12 byte uplink header, 8 byte masked WebSocket header, 40 bytes of TCP/IP per packet
+    int overhead_bps = (int)(m.packets_per_second * (sizeof(audio_uplink_header_t) + 8 + 40) * 8);
+    printf("[ LATENCY  ] %2d ms frames: %.1f packets/s, %.1f kbps framing overhead, capture to send "
+        "p50 %lld ms, max %lld ms (%zu frames)\n", frame_duration_ms, m.packets_per_second, overhead_bps / 1000.0,
+        (long long)m.p50_ms, (long long)m.max_ms, m.frames);
+    RecordProperty("packets_per_second", (int)m.packets_per_second);
+    RecordProperty("p50_ms", (int)m.p50_ms);
+
+    ASSERT_GE(m.frames, (size_t)(kMeasureMs / frame_duration_ms / 2));
+    double expected_rate = 1000.0 / frame_duration_ms;
+    EXPECT_NEAR(m.packets_per_second, expected_rate, expected_rate * 0.15);
+    // A frame leaves once it is complete: its own duration plus processing
+    EXPECT_GE(m.p50_ms, frame_duration_ms - 2);
+    EXPECT_LE(m.p50_ms, frame_duration_ms + 15);
+}
+
+INSTANTIATE_TEST_SUITE_P(Durations, FrameDurationTest, ::testing::Values(10, 20, 40, 60),
+    [](const ::testing::TestParamInfo<int>& info) { return std::to_string(info.param) + "ms"; });
+
+} // namespace
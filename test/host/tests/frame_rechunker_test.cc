@@ -0,0 +1,135 @@
+// FrameRechunker: sample exact re-chunking across wraps and frame size changes, overflow
+// accounting, and the cost against the vector insert / erase it replaced in AfeAudioProcessor.
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "frame_rechunker.h"
+
+namespace {
+
+std::vector<int16_t> Ramp(size_t count, int16_t start = 0) {
+    std::vector<int16_t> samples(count);
+    for (size_t i = 0; i < count; i++) {
+        samples[i] = (int16_t)(start + i);
+    }
+    return samples;
+}
+
+TEST(FrameRechunkerTest, ReassemblesTheStreamExactly) {
+    // AFE fetch chunks of 512 into 60 ms frames, the AfeAudioProcessor sizing
+    FrameRechunker<int16_t> rechunker;
+    rechunker.Initialize(960 + 512, 960);
+    auto input = Ramp(512 * 200);
+    std::vector<int16_t> output;
+    size_t frames = 0;
+    for (size_t offset = 0; offset < input.size(); offset += 512) {
+        rechunker.Push(input.data() + offset, 512);
+        frames += rechunker.Drain([&](const int16_t* frame, size_t count) {
+            EXPECT_EQ(count, 960u);
+            output.insert(output.end(), frame, frame + count);
+        });
+    }
+    EXPECT_EQ(frames, input.size() / 960);
+    ASSERT_EQ(output.size(), frames * 960);
+    EXPECT_TRUE(std::equal(output.begin(), output.end(), input.begin()));
+    EXPECT_EQ(rechunker.size(), input.size() - output.size());
+    EXPECT_EQ(rechunker.dropped(), 0u);
+}
+
+TEST(FrameRechunkerTest, RandomBlocksAndFrameSizeChanges) {
+    std::mt19937 random(7);
+    const size_t kSizes[] = {160, 320, 640, 960};
+    FrameRechunker<int16_t> rechunker;
+    rechunker.Initialize(960 + 1024, 320, 960);
+
+    std::vector<int16_t> input, output;
+    int16_t next = 0;
+    for (int round = 0; round < 5000; round++) {
+        if (round % 50 == 0) {
+            ASSERT_TRUE(rechunker.SetFrameSize(kSizes[random() % 4]));
+        }
+        auto block = Ramp(1 + random() % 1024, next);
+        next += block.size();
+        input.insert(input.end(), block.begin(), block.end());
+        rechunker.Push(block.data(), block.size());
+        size_t frame_size = rechunker.frame_size();
+        rechunker.Drain([&](const int16_t* frame, size_t count) {
+            EXPECT_EQ(count, frame_size);
+            output.insert(output.end(), frame, frame + count);
+        });
+    }
+    EXPECT_EQ(rechunker.dropped(), 0u);
+    ASSERT_EQ(output.size() + rechunker.size(), input.size());
+    EXPECT_TRUE(std::equal(output.begin(), output.end(), input.begin()));
+}
+
+TEST(FrameRechunkerTest, OverflowKeepsTheLatestSamples) {
+    FrameRechunker<int16_t> rechunker;
+    rechunker.Initialize(1000, 2000, 1000);
+    EXPECT_FALSE(rechunker.SetFrameSize(2000));
+    EXPECT_FALSE(rechunker.SetFrameSize(0));
+    ASSERT_TRUE(rechunker.SetFrameSize(1000));
+    rechunker.SetFrameSize(1000);
+
+    auto input = Ramp(2500);
+    rechunker.Push(input.data(), 700);
+    rechunker.Push(input.data() + 700, 1800);
+    EXPECT_EQ(rechunker.dropped(), 1500u);
+    EXPECT_EQ(rechunker.size(), 1000u);
+    std::vector<int16_t> latest(1000);
+    rechunker.Copy(latest.data(), latest.size());
+    EXPECT_TRUE(std::equal(latest.begin(), latest.end(), input.begin() + 1500));
+}
+
+// Consumes a frame the way the processor output callback does, opaque to the optimizer
+__attribute__((noinline)) int64_t Consume(const std::vector<int16_t>& frame) {
+    return frame[frame.size() / 2] + (int64_t)(uintptr_t)frame.data();
+}
+
+TEST(FrameRechunkerTest, BenchmarkAgainstVectorEraseFront) {
+    constexpr size_t kChunk = 512;
+    constexpr size_t kFrame = 960;
+    constexpr int kChunks = 200000;
+    auto chunk = Ramp(kChunk);
+    int64_t sink = 0;
+
+    // Frames are copied into a reused output buffer, as AfeAudioProcessor does now
+    auto start = std::chrono::steady_clock::now();
+    FrameRechunker<int16_t> rechunker;
+    rechunker.Initialize(kFrame + kChunk, kFrame);
+    std::vector<int16_t> output_frame(kFrame);
+    for (int i = 0; i < kChunks; i++) {
+        rechunker.Push(chunk.data(), kChunk);
+        rechunker.Drain([&](const int16_t* frame, size_t count) {
+            memcpy(output_frame.data(), frame, count * sizeof(int16_t));
+            sink += Consume(output_frame);
+        });
+    }
+    double ring_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / kChunks;
+
+    // The previous AfeAudioProcessor::AudioProcessorTask: append, then a new vector per frame and erase the front
+    start = std::chrono::steady_clock::now();
+    std::vector<int16_t> output_buffer;
+    for (int i = 0; i < kChunks; i++) {
+        output_buffer.insert(output_buffer.end(), chunk.begin(), chunk.end());
+        while (output_buffer.size() >= kFrame) {
+            std::vector<int16_t> frame(output_buffer.begin(), output_buffer.begin() + kFrame);
+            sink += Consume(frame);
+            output_buffer.erase(output_buffer.begin(), output_buffer.begin() + kFrame);
+        }
+    }
+    double vector_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / kChunks;
+
+    printf("[ BENCH    ] %zu-sample chunks into %zu-sample frames: ring %.0f ns/chunk, vector insert/erase %.0f ns/chunk\n",
+        kChunk, kFrame, ring_ns, vector_ns);
+    RecordProperty("ring_ns_per_chunk", (int)ring_ns);
+    RecordProperty("vector_ns_per_chunk", (int)vector_ns);
+    EXPECT_NE(sink, 0);
+}
+
+} // namespace
@@ -0,0 +1,15 @@
+// gtest main for the host tests. FreeRTOS tasks are detached threads that never return
+// (like on the device), so the process exits without running static destructors under them.
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <unistd.h>
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    int result = RUN_ALL_TESTS();
+    fflush(stdout);
+    fflush(stderr);
+    _exit(result);
+}
@@ -0,0 +1,177 @@
+#ifndef HOST_TEST_UTIL_H
+#define HOST_TEST_UTIL_H
+
+// Helpers shared by the host tests: WAV files, the fake websocket and the metrics registry
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <esp_websocket_client.h>
+
+#include "metrics.h"
+#include "ws_transport.h"
+
+namespace host_test {
+
+inline std::string TempPath(const std::string& name) {
+    const char* dir = getenv("TMPDIR");
+    return std::string(dir != nullptr ? dir : "/tmp") + "/xiaozhi_host_" + name;
+}
+
+inline std::vector<int16_t> Sine(int sample_rate, int freq_hz, int duration_ms, int amplitude = 8000) {
+    std::vector<int16_t> samples(sample_rate / 1000 * duration_ms);
+    for (size_t i = 0; i < samples.size(); i++) {
+        samples[i] = (int16_t)(amplitude * sin(2 * M_PI * freq_hz * i / sample_rate));
+    }
+    return samples;
+}
+
+inline void WriteWav(const std::string& path, const std::vector<int16_t>& samples, int sample_rate, int channels = 1) {
+    FILE* file = fopen(path.c_str(), "wb");
+    uint32_t data_bytes = samples.size() * sizeof(int16_t);
+    uint32_t riff_size = 36 + data_bytes;
+    uint16_t format = 1, bits = 16, block_align = channels * 2, channel_count = channels;
+    uint32_t fmt_size = 16, rate = sample_rate, byte_rate = sample_rate * block_align;
+    fwrite("RIFF", 1, 4, file);
+    fwrite(&riff_size, 4, 1, file);
+    fwrite("WAVEfmt ", 1, 8, file);
+    fwrite(&fmt_size, 4, 1, file);
+    fwrite(&format, 2, 1, file);
+    fwrite(&channel_count, 2, 1, file);
+    fwrite(&rate, 4, 1, file);
+    fwrite(&byte_rate, 4, 1, file);
+    fwrite(&block_align, 2, 1, file);
+    fwrite(&bits, 2, 1, file);
+    fwrite("data", 1, 4, file);
+    fwrite(&data_bytes, 4, 1, file);
+    fwrite(samples.data(), sizeof(int16_t), samples.size(), file);
+    fclose(file);
+}
+
+// Samples of a canonical 44-byte header WAV as written by FileAudioCodec
+inline std::vector<int16_t> ReadWav(const std::string& path) {
+    std::vector<int16_t> samples;
+    FILE* file = fopen(path.c_str(), "rb");
+    if (file == nullptr) {
+        return samples;
+    }
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    if (size > 44) {
+        samples.resize((size - 44) / sizeof(int16_t));
+        fseek(file, 44, SEEK_SET);
+        size_t read = fread(samples.data(), sizeof(int16_t), samples.size(), file);
+        samples.resize(read);
+    }
+    fclose(file);
+    return samples;
+}
+
+inline double Rms(const int16_t* samples, size_t count) {
+    double sum = 0;
+    for (size_t i = 0; i < count; i++) {
+        sum += (double)samples[i] * samples[i];
+    }
+    return count > 0 ? sqrt(sum / count) : 0;
+}
+
+// Polls cond every millisecond until it holds or timeout_ms passes
+inline bool WaitFor(const std::function<bool()>& cond, int timeout_ms) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+    while (!cond()) {
+        if (std::chrono::steady_clock::now() > deadline) {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+}
+
+inline uint32_t Metric(const char* name, metric_type_t type = METRIC_COUNTER) {
+    return metric_get(metrics_register(name, type));
+}
+
+// OGG/Opus container around the given packets, as PromptCache parses it: an OpusHead page,
+// an OpusTags page, then one page per packet. Checksums are left zero, nothing checks them.
+inline std::string OggOpus(const std::vector<std::vector<uint8_t>>& packets, int sample_rate) {
+    std::string ogg;
+    uint32_t sequence = 0;
+    auto page = [&](const uint8_t* data, size_t size) {
+        std::string header("OggS", 4);
+        header.append(22, '\0');
+        memcpy(&header[18], &sequence, 4);
+        sequence++;
+        std::string lacing;
+        size_t left = size;
+        do {
+            uint8_t segment = left >= 255 ? 255 : left;
+            lacing.push_back((char)segment);
+            left -= segment;
+            if (segment < 255) {
+                break;
+            }
+        } while (true);
+        header.push_back((char)lacing.size());
+        ogg += header + lacing;
+        ogg.append(reinterpret_cast<const char*>(data), size);
+    };
+    uint8_t head[19] = {'O', 'p', 'u', 's', 'H', 'e', 'a', 'd', 1, 1};
+    memcpy(head + 12, &sample_rate, 4);
+    page(head, sizeof(head));
+    uint8_t tags[16] = {'O', 'p', 'u', 's', 'T', 'a', 'g', 's'};
+    page(tags, sizeof(tags));
+    for (auto& packet : packets) {
+        page(packet.data(), packet.size());
+    }
+    return ogg;
+}
+
+struct SentMessage {
+    int op_code;
+    std::vector<uint8_t> data;
+    int64_t time_us;
+};
+
+inline std::vector<SentMessage> SentMessages() {
+    std::vector<SentMessage> messages;
+    for (size_t i = 0; i < host_ws_sent_count(); i++) {
+        SentMessage message;
+        int len = host_ws_sent_at(i, &message.op_code, nullptr, 0);
+        message.data.resize(len);
+        host_ws_sent_at(i, nullptr, message.data.data(), message.data.size());
+        message.time_us = host_ws_sent_time_us(i);
+        messages.push_back(std::move(message));
+    }
+    return messages;
+}
+
+// Binary messages sent on one channel, without the mux header. Until the server accepts the
+// mux every binary message is uplink audio.
+inline std::vector<std::vector<uint8_t>> SentOnChannel(ws_channel_t channel) {
+    std::vector<std::vector<uint8_t>> payloads;
+    bool mux = ws_transport_mux_enabled();
+    for (auto& message : SentMessages()) {
+        if (message.op_code != WS_TRANSPORT_OPCODES_BINARY) {
+            continue;
+        }
+        if (!mux) {
+            if (channel == WS_CHANNEL_AUDIO_UP) {
+                payloads.push_back(message.data);
+            }
+        } else if (message.data.size() >= WS_MUX_HEADER_SIZE && message.data[0] == channel) {
+            payloads.emplace_back(message.data.begin() + WS_MUX_HEADER_SIZE, message.data.end());
+        }
+    }
+    return payloads;
+}
+
+} // namespace host_test
+
+#endif // HOST_TEST_UTIL_H
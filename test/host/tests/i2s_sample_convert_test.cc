@@ -0,0 +1,121 @@
+// I2S sample conversion used by NoAudioCodec: bit-exact against the per-sample loops it
+// replaced, and the cost of the reused slot buffers against a vector allocated per call.
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "i2s_sample_convert.h"
+
+namespace {
+
+// The original NoAudioCodec::Write() loop, at a given volume
+void ReferenceToI2s(const int16_t* data, int32_t* buffer, int samples, int volume) {
+    int32_t volume_factor = pow(double(volume) / 100.0, 2) * 65536;
+    for (int i = 0; i < samples; i++) {
+        int64_t temp = int64_t(data[i]) * volume_factor;
+        if (temp > INT32_MAX) {
+            buffer[i] = INT32_MAX;
+        } else if (temp < INT32_MIN) {
+            buffer[i] = INT32_MIN;
+        } else {
+            buffer[i] = static_cast<int32_t>(temp);
+        }
+    }
+}
+
+// The original NoAudioCodec::Read() loop
+void ReferenceFromI2s(const int32_t* bit32_buffer, int16_t* dest, int samples) {
+    for (int i = 0; i < samples; i++) {
+        int32_t value = bit32_buffer[i] >> 12;
+        dest[i] = (value > INT16_MAX) ? INT16_MAX : (value < -INT16_MAX) ? -INT16_MAX : (int16_t)value;
+    }
+}
+
+// Keeps the optimizer from dropping the converted samples
+__attribute__((noinline)) void Consume(const void* data, size_t size) {
+    asm volatile("" : : "r"(data), "r"(size) : "memory");
+}
+
+TEST(I2sSampleConvertTest, ToI2sMatchesTheFullVolumeLoopForEveryInput) {
+    // The volume moved to OutputStage, so the driver only ever sees the old unity path
+    std::vector<int16_t> in;
+    for (int32_t v = INT16_MIN; v <= INT16_MAX; v++) {
+        in.push_back((int16_t)v);
+    }
+    std::vector<int32_t> expected(in.size()), actual(in.size());
+    ReferenceToI2s(in.data(), expected.data(), in.size(), 100);
+    ConvertToI2s(in.data(), actual.data(), in.size());
+    EXPECT_EQ(actual, expected);
+}
+
+TEST(I2sSampleConvertTest, FromI2sMatchesTheOldLoop) {
+    std::vector<int32_t> in = {INT32_MIN, INT32_MIN + 1, INT32_MAX, INT32_MAX - 1, 0, -1, 1,
+                               -4096, 4095, 4096, -4097, (INT16_MAX + 1) << 12, -(INT16_MAX << 12) - 1};
+    std::mt19937 rng(1);
+    for (int i = 0; i < 1000000; i++) {
+        in.push_back((int32_t)rng());
+    }
+    std::vector<int16_t> expected(in.size()), actual(in.size());
+    ReferenceFromI2s(in.data(), expected.data(), in.size());
+    ConvertFromI2s(in.data(), actual.data(), in.size());
+    EXPECT_EQ(actual, expected);
+}
+
+TEST(I2sSampleConvertTest, RoundTripIsAShiftByFour) {
+    for (int32_t v = INT16_MIN; v <= INT16_MAX; v++) {
+        int16_t sample = v;
+        int32_t slot;
+        int16_t back;
+        ConvertToI2s(&sample, &slot, 1);
+        ConvertFromI2s(&slot, &back, 1);
+        int32_t expected = std::max(std::min(v * 16, (int32_t)INT16_MAX), (int32_t)-INT16_MAX);
+        ASSERT_EQ(back, expected) << v;
+    }
+}
+
+TEST(I2sSampleConvertTest, BenchmarkReusedBufferAgainstPerCallVector) {
+    // One 60 ms frame at 24 kHz, the largest the output path writes in one call
+    constexpr int kSamples = 24000 * 60 / 1000;
+    constexpr int kIterations = 20000;
+    std::vector<int16_t> pcm(kSamples);
+    for (int i = 0; i < kSamples; i++) {
+        pcm[i] = (int16_t)(8000 * std::sin(i * 0.05));
+    }
+
+    auto per_call = [&]() {
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < kIterations; i++) {
+            std::vector<int32_t> buffer(kSamples);
+            ReferenceToI2s(pcm.data(), buffer.data(), kSamples, 100);
+            Consume(buffer.data(), kSamples);
+        }
+        return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    };
+    auto reused = [&]() {
+        std::vector<int32_t> tx_buffer;
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < kIterations; i++) {
+            if (tx_buffer.size() < (size_t)kSamples) {
+                tx_buffer.resize(kSamples);
+            }
+            ConvertToI2s(pcm.data(), tx_buffer.data(), kSamples);
+            Consume(tx_buffer.data(), kSamples);
+        }
+        return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    };
+
+    per_call();  // warm up
+    double before = per_call() / kIterations;
+    double after = reused() / kIterations;
+    printf("write path, %d samples: per-call vector + saturating loop %.0f ns/frame, "
+           "reused buffer + shift %.0f ns/frame\n", kSamples, before, after);
+    // Only a sanity bound, host timings say nothing precise about the S3
+    EXPECT_LT(after, before * 2);
+}
+
+} // namespace
@@ -0,0 +1,225 @@
+// The audio input task must not touch the heap per frame: ReadAudioData reads, deinterleaves
+// and resamples through the scratch arena, and the processor output goes into pooled frames
+// and tasks. Counts operator new calls made by the "audio_input" task once it is warm.
+//
+// Also benchmarks the input task per 60 ms frame for a mono mic, two mics and mic + reference,
+// from the I2S read trace points, with the file codec reading as fast as it can.
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+#include <board.h>
+
+#include "audio_service.h"
+#include "audio_trace.h"
+#include "file_audio_codec.h"
+#include "host_test_util.h"
+
+using namespace host_test;
+
+namespace {
+
+std::atomic<bool> counting{false};
+std::atomic<uint32_t> input_task_allocations{0};
+thread_local bool in_operator_new = false;
+
+void CountAllocation() {
+    if (!counting.load(std::memory_order_relaxed) || in_operator_new) {
+        return;
+    }
+    in_operator_new = true;
+    if (strcmp(pcTaskGetName(nullptr), "audio_input") == 0) {
+        input_task_allocations++;
+    }
+    in_operator_new = false;
+}
+
+} // namespace
+
+void* operator new(size_t size) {
+    CountAllocation();
+    void* p = malloc(size != 0 ? size : 1);
+    if (p == nullptr) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+// Not inlined, so the compiler does not pair malloc() in operator new with this free()
+__attribute__((noinline)) void operator delete(void* p) noexcept {
+    free(p);
+}
+
+__attribute__((noinline)) void operator delete(void* p, size_t) noexcept {
+    free(p);
+}
+
+namespace {
+
+void StopService(AudioService* service) {
+    service->Stop();
+    ASSERT_TRUE(host_task_wait_exit("audio_input", 2000));
+    ASSERT_TRUE(host_task_wait_exit("audio_output", 2000));
+    ASSERT_TRUE(host_task_wait_exit("opus_codec", 2000));
+}
+
+std::vector<audio_trace_record_t> TraceRecords() {
+    std::vector<uint8_t> bytes;
+    audio_trace_dump([](const void* data, size_t len, void* arg) {
+        auto out = static_cast<std::vector<uint8_t>*>(arg);
+        auto begin = static_cast<const uint8_t*>(data);
+        out->insert(out->end(), begin, begin + len);
+    }, &bytes);
+    std::vector<audio_trace_record_t> records;
+    if (bytes.size() > sizeof(audio_trace_header_t)) {
+        records.resize((bytes.size() - sizeof(audio_trace_header_t)) / sizeof(audio_trace_record_t));
+        memcpy(records.data(), bytes.data() + sizeof(audio_trace_header_t), records.size() * sizeof(audio_trace_record_t));
+    }
+    return records;
+}
+
+uint32_t Median(std::vector<uint32_t> values) {
+    if (values.empty()) {
+        return 0;
+    }
+    std::nth_element(values.begin(), values.begin() + values.size() / 2, values.end());
+    return values[values.size() / 2];
+}
+
+// Stereo input read as two microphones, where the file codec would take the second as reference
+class TwoMicFileAudioCodec : public FileAudioCodec {
+public:
+    TwoMicFileAudioCodec(const std::string& input_path, const std::string& output_path)
+        : FileAudioCodec(input_path, output_path, 16000, false, true) {
+        input_reference_ = false;
+    }
+};
+
+struct InputBenchmark {
+    uint32_t read_us = 0;   // ReadAudioData: read, deinterleave, resample
+    uint32_t frame_us = 0;  // One pass of the input task, up to the next read
+    size_t frames = 0;
+};
+
+// Runs the input task flat out for kFrames frames and times it from the trace ring
+InputBenchmark RunInputBenchmark(AudioCodec* codec) {
+    constexpr uint32_t kFrames = 200;
+    Board::GetInstance().SetAudioCodec(codec);
+    auto service = new AudioService();
+    service->Initialize(codec);
+    service->Start();
+    service->EnableVoiceProcessing(true);
+
+    // Past the warm-up delay and the first pool acquisitions
+    uint32_t first = Metric("audio.input_frames");
+    EXPECT_TRUE(WaitFor([first] { return Metric("audio.input_frames") >= first + 10; }, 5000));
+    first = Metric("audio.input_frames");
+    EXPECT_TRUE(WaitFor([first] { return Metric("audio.input_frames") >= first + kFrames; }, 20000));
+    StopService(service);
+
+    // Ids are the input frame counter; the ring may also still hold the previous runs
+    std::vector<uint32_t> read_start(kFrames + 1, 0), read_end(kFrames + 1, 0);
+    for (auto& record : TraceRecords()) {
+        uint16_t index = (uint16_t)(record.id - (uint16_t)first);
+        if (index > kFrames) {
+            continue;
+        }
+        if (record.point == AUDIO_TRACE_I2S_READ_START) {
+            read_start[index] = record.timestamp_us;
+        } else if (record.point == AUDIO_TRACE_I2S_READ_END) {
+            read_end[index] = record.timestamp_us;
+        }
+    }
+    std::vector<uint32_t> reads, frames;
+    for (uint32_t i = 0; i < kFrames; i++) {
+        if (read_start[i] != 0 && read_end[i] >= read_start[i]) {
+            reads.push_back(read_end[i] - read_start[i]);
+        }
+        if (read_start[i] != 0 && read_start[i + 1] >= read_start[i]) {
+            frames.push_back(read_start[i + 1] - read_start[i]);
+        }
+    }
+    return { Median(reads), Median(frames), frames.size() };
+}
+
+void ReportInputBenchmark(const char* name, const InputBenchmark& result) {
+    constexpr int kFrameUs = 60 * 1000;
+    printf("[ BENCH    ] %-10s read %5u us  frame %5u us per 60 ms frame (%.2f%% of realtime, %zu frames)\n",
+        name, result.read_us, result.frame_us, 100.0 * result.frame_us / kFrameUs, result.frames);
+    ::testing::Test::RecordProperty(std::string(name) + "_read_us", (int)result.read_us);
+    ::testing::Test::RecordProperty(std::string(name) + "_frame_us", (int)result.frame_us);
+}
+
+std::string WriteInput(const char* name, int rate, int channels) {
+    auto mono = Sine(rate, 300, 1000);
+    std::vector<int16_t> samples(mono.size() * channels);
+    for (size_t i = 0; i < mono.size(); i++) {
+        for (int c = 0; c < channels; c++) {
+            samples[i * channels + c] = c == 0 ? mono[i] : mono[i] / 4;
+        }
+    }
+    auto path = TempPath(name);
+    WriteWav(path, samples, rate, channels);
+    return path;
+}
+
+// 48 kHz stereo (mic + reference): exercises deinterleave and both resamplers
+TEST(InputAllocationTest, SteadyStateInputIsAllocationFree) {
+    constexpr int kInputRate = 48000;
+    auto mono = Sine(kInputRate, 300, 3000);
+    std::vector<int16_t> stereo(mono.size() * 2);
+    for (size_t i = 0; i < mono.size(); i++) {
+        stereo[2 * i] = mono[i];
+        stereo[2 * i + 1] = mono[i] / 4;
+    }
+    auto input_path = TempPath("alloc_in.wav");
+    WriteWav(input_path, stereo, kInputRate, 2);
+
+    auto codec = new FileAudioCodec(input_path, TempPath("alloc_out.wav"), 16000, true, true);
+    Board::GetInstance().SetAudioCodec(codec);
+    auto service = new AudioService();
+    service->Initialize(codec);
+    service->Start();
+    service->EnableVoiceProcessing(true);
+
+    // Warm up: scratch buffers reach their size, the pools hand out their first items
+    uint32_t frames = Metric("audio.input_frames");
+    ASSERT_TRUE(WaitFor([frames] { return Metric("audio.input_frames") >= frames + 5; }, 3000));
+
+    frames = Metric("audio.input_frames");
+    counting = true;
+    ASSERT_TRUE(WaitFor([frames] { return Metric("audio.input_frames") >= frames + 20; }, 5000));
+    counting = false;
+
+    printf("[ ALLOC    ] %u allocations over %u input frames\n",
+        input_task_allocations.load(), Metric("audio.input_frames") - frames);
+    EXPECT_EQ(input_task_allocations.load(), 0u);
+    StopService(service);
+}
+
+// 24 kHz input, the common codec rate that still needs resampling to 16 kHz
+TEST(InputAllocationTest, InputBenchmark) {
+    constexpr int kInputRate = 24000;
+    auto mono = RunInputBenchmark(new FileAudioCodec(WriteInput("bench_mono.wav", kInputRate, 1),
+        TempPath("bench_mono_out.wav"), 16000, false, true));
+    auto two_mic = RunInputBenchmark(new TwoMicFileAudioCodec(WriteInput("bench_two_mic.wav", kInputRate, 2),
+        TempPath("bench_two_mic_out.wav")));
+    auto reference = RunInputBenchmark(new FileAudioCodec(WriteInput("bench_reference.wav", kInputRate, 2),
+        TempPath("bench_reference_out.wav"), 16000, false, true));
+
+    ReportInputBenchmark("mono", mono);
+    ReportInputBenchmark("two_mic", two_mic);
+    ReportInputBenchmark("reference", reference);
+    for (auto& result : { mono, two_mic, reference }) {
+        EXPECT_GT(result.frames, 100u);
+        // Far below the frame budget even on a loaded host
+        EXPECT_LT(result.frame_us, 60u * 1000 / 4);
+    }
+}
+
+} // namespace
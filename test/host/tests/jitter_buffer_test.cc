@@ -0,0 +1,203 @@
+// JitterBuffer replayed against packet arrival traces in virtual time: the opus codec loop
+// and a speaker that plays one frame per frame duration from a two frame playback queue,
+// like AudioService. Built with CONFIG_AUDIO_JITTER_MAX_CONCEAL_FRAMES=10 so the end of
+// stream rules, not the concealment cap, decide when concealment stops.
+//
+// JITTER_TRACE=<file> additionally replays a captured trace, one arrival time in ms per line.
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <random>
+#include <vector>
+
+#include "jitter_buffer.h"
+
+namespace {
+
+constexpr int kFrameMs = 60;
+constexpr int kPlaybackQueue = 2;
+
+struct Replay {
+    std::vector<int> played;            // packet ids in play order, -1 for a concealed frame
+    std::vector<int> latency_ms;        // per played packet, arrival to start of playback
+    std::vector<int> dropped;
+    int concealed = 0;
+};
+
+// arrivals[i] is the arrival time of packet i in ms, end_of_stream_ms (if >= 0) is when the
+// server reports the end of the stream
+Replay ReplayTrace(const std::vector<int>& arrivals, int end_of_stream_ms = -1, int tail_ms = 2000) {
+    JitterBuffer jitter;
+    Replay replay;
+    std::deque<int> decode_queue;
+    std::deque<int> playback_queue;
+    size_t next = 0;
+    int speaker_free_at = 0;
+    int end_ms = (arrivals.empty() ? 0 : arrivals.back()) + tail_ms;
+
+    for (int now = 0; now <= end_ms; now++) {
+        int64_t now_us = now * 1000LL;
+        while (next < arrivals.size() && arrivals[next] <= now) {
+            jitter.OnArrival(now_us, kFrameMs);
+            decode_queue.push_back(next++);
+        }
+        if (now == end_of_stream_ms) {
+            jitter.OnEndOfStream();
+        }
+
+        // Speaker, takes the next frame once the current one has played
+        if (now >= speaker_free_at && !playback_queue.empty()) {
+            int id = playback_queue.front();
+            playback_queue.pop_front();
+            replay.played.push_back(id);
+            if (id >= 0) {
+                replay.latency_ms.push_back(now - arrivals[id]);
+            }
+            speaker_free_at = now + kFrameMs;
+        }
+
+        // Opus codec task
+        while ((int)playback_queue.size() < kPlaybackQueue) {
+            auto action = jitter.OnPlayout(decode_queue.size(), playback_queue.empty(), now_us);
+            if (action == kJitterBufferDecode) {
+                playback_queue.push_back(decode_queue.front());
+                decode_queue.pop_front();
+            } else if (action == kJitterBufferConceal) {
+                playback_queue.push_back(-1);
+                replay.concealed++;
+            } else if (action == kJitterBufferDrop) {
+                replay.dropped.push_back(decode_queue.front());
+                decode_queue.pop_front();
+            } else {
+                break;
+            }
+        }
+    }
+    EXPECT_TRUE(decode_queue.empty());
+    return replay;
+}
+
+std::vector<int> Steady(int count, int start_ms = 0) {
+    std::vector<int> arrivals;
+    for (int i = 0; i < count; i++) {
+        arrivals.push_back(start_ms + i * kFrameMs);
+    }
+    return arrivals;
+}
+
+std::vector<int> PlayedPackets(const Replay& replay) {
+    std::vector<int> packets;
+    for (int id : replay.played) {
+        if (id >= 0) {
+            packets.push_back(id);
+        }
+    }
+    return packets;
+}
+
+TEST(JitterBufferTest, JitteryStreamLosesNothing) {
+    std::mt19937 rng(11);
+    std::uniform_int_distribution<int> jitter(0, 40);
+    auto arrivals = Steady(200);
+    for (auto& arrival : arrivals) {
+        arrival += jitter(rng);
+    }
+    std::sort(arrivals.begin(), arrivals.end());
+    auto replay = ReplayTrace(arrivals, arrivals.back());
+
+    // Concealment is decided when the playback queue runs empty, a frame before the speaker
+    // does, so the odd packet late by up to 40 ms can still cost a concealed frame
+    printf("0-40 ms jitter: %d concealed, %u dropped of %u packets\n", replay.concealed,
+        (unsigned int)replay.dropped.size(), (unsigned int)arrivals.size());
+    EXPECT_LE(replay.concealed, 2);
+    EXPECT_LE((int)replay.dropped.size(), replay.concealed);
+    EXPECT_EQ(PlayedPackets(replay).size() + replay.dropped.size(), arrivals.size());
+}
+
+TEST(JitterBufferTest, SignalledEndOfStreamIsNotConcealed) {
+    auto arrivals = Steady(20);
+    auto replay = ReplayTrace(arrivals, arrivals.back());
+    EXPECT_EQ(replay.concealed, 0);
+    EXPECT_EQ(PlayedPackets(replay).size(), 20u);
+}
+
+TEST(JitterBufferTest, LongSilenceEndsConcealment) {
+    // No end of stream message: concealment stops once nothing arrived for twice the target,
+    // far below the configured cap of 10 frames
+    auto replay = ReplayTrace(Steady(20));
+    EXPECT_LE(replay.concealed, 2);
+    EXPECT_EQ(PlayedPackets(replay).size(), 20u);
+}
+
+TEST(JitterBufferTest, LatePacketsAfterConcealmentAreDropped) {
+    // 30 packets on time, then a 100 ms stall that releases the held packets in one burst
+    auto arrivals = Steady(60);
+    for (int i = 30; i < 60; i++) {
+        arrivals[i] = std::max(arrivals[i], 30 * kFrameMs + 100);
+    }
+    auto replay = ReplayTrace(arrivals, arrivals.back());
+
+    ASSERT_GT(replay.concealed, 0);
+    // Only concealed slots are given up, the oldest of the burst. The last queued packet is
+    // always played, dropping it would run the queue dry again.
+    ASSERT_GE(replay.dropped.size(), 1u);
+    EXPECT_LE((int)replay.dropped.size(), replay.concealed);
+    for (size_t i = 0; i < replay.dropped.size(); i++) {
+        EXPECT_EQ(replay.dropped[i], 30 + (int)i);
+    }
+    auto packets = PlayedPackets(replay);
+    EXPECT_EQ(packets.size() + replay.dropped.size(), arrivals.size());
+    EXPECT_TRUE(std::is_sorted(packets.begin(), packets.end()));
+
+    // Without dropping, every concealed frame would stay in the playout delay
+    int before = replay.latency_ms[20];
+    int after = replay.latency_ms.back();
+    printf("stall of 100 ms: %d concealed, %d dropped, latency %d ms before, %d ms after\n",
+        replay.concealed, (int)replay.dropped.size(), before, after);
+    EXPECT_LE(after, before + (replay.concealed - (int)replay.dropped.size()) * kFrameMs + kFrameMs / 2);
+    EXPECT_LT(after, before + replay.concealed * kFrameMs);
+}
+
+TEST(JitterBufferTest, SingleLatePacketIsPlayedNotDropped) {
+    // One packet late on its own, the next ones on time: dropping it would underrun again
+    auto arrivals = Steady(40);
+    arrivals[20] += 150;
+    std::sort(arrivals.begin(), arrivals.end());
+    auto replay = ReplayTrace(arrivals, arrivals.back());
+    auto packets = PlayedPackets(replay);
+    EXPECT_EQ(packets.size() + replay.dropped.size(), arrivals.size());
+    EXPECT_LE((int)replay.dropped.size(), replay.concealed);
+}
+
+TEST(JitterBufferTest, ReplayCapturedTrace) {
+    const char* path = getenv("JITTER_TRACE");
+    if (path == nullptr) {
+        GTEST_SKIP() << "set JITTER_TRACE to a file with one arrival time in ms per line";
+    }
+    FILE* file = fopen(path, "r");
+    ASSERT_NE(file, nullptr);
+    std::vector<int> arrivals;
+    int ms;
+    while (fscanf(file, "%d", &ms) == 1) {
+        arrivals.push_back(ms);
+    }
+    fclose(file);
+    std::sort(arrivals.begin(), arrivals.end());
+    int start = arrivals.empty() ? 0 : arrivals.front();
+    for (auto& arrival : arrivals) {
+        arrival -= start;
+    }
+    auto replay = ReplayTrace(arrivals);
+    std::vector<int> latency = replay.latency_ms;
+    std::sort(latency.begin(), latency.end());
+    printf("%u packets: %u played, %d concealed, %u dropped, latency p50 %d ms p95 %d ms\n",
+        (unsigned int)arrivals.size(), (unsigned int)PlayedPackets(replay).size(), replay.concealed,
+        (unsigned int)replay.dropped.size(), latency.empty() ? 0 : latency[latency.size() / 2],
+        latency.empty() ? 0 : latency[latency.size() * 95 / 100]);
+}
+
+} // namespace
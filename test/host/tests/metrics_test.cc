@@ -0,0 +1,25 @@
+// Metrics registry: a name registered again with the same type is the same metric, with
+// another type it gets the scratch histogram, so observing into it never hits a null bucket
+// array and does not disturb the original.
+
+#include <gtest/gtest.h>
+
+#include "metrics.h"
+
+namespace {
+
+TEST(MetricsTest, ReRegisterWithAnotherType) {
+    metric_t* counter = metrics_register("test.frames", METRIC_COUNTER);
+    EXPECT_EQ(metrics_register("test.frames", METRIC_COUNTER), counter);
+    metric_inc(counter);
+
+    metric_t* histogram = metrics_register("test.frames", METRIC_HISTOGRAM);
+    ASSERT_NE(histogram, counter);
+    ASSERT_NE(histogram->buckets, nullptr);
+    metric_observe(histogram, 1234);
+    EXPECT_EQ(metric_get(counter), 1u);
+
+    EXPECT_NE(metrics_register("test.frames", METRIC_GAUGE), counter);
+}
+
+} // namespace
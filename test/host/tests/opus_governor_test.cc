@@ -0,0 +1,163 @@
+// OpusGovernor against a modelled encoder whose encode time grows with the complexity:
+// it settles on the highest complexity under the average threshold, backs off on peaks
+// and on a full encode queue, clamps its range and drives DTX from the VAD. Also runs the device encode benchmark,
+// which on the host only checks its shape (the Opus shim is a PCM pass-through).
+
+#include <gtest/gtest.h>
+
+#include "opus_benchmark.h"
+#include "opus_governor.h"
+
+namespace {
+
+const int kFrameMs = 20;
+const int64_t kWindowUs = 2 * 1000 * 1000;
+
+// Encode time of a 20 ms frame at a given complexity, by default 1.5 ms at 0 and +0.5 ms
+// per step: 15% of the frame (3 ms) is reached at complexity 3
+int64_t ModelEncodeUs(int complexity, int64_t base_us = 1500, int64_t step_us = 500) {
+    return base_us + complexity * step_us;
+}
+
+// Feeds one governor window of frames, returns whether the complexity changed
+bool RunWindow(OpusGovernor& governor, int64_t& now_us, int64_t base_us, int64_t step_us, int64_t peak_us = 0) {
+    int frames = kWindowUs / (kFrameMs * 1000);
+    for (int i = 0; i < frames; i++) {
+        int64_t us = ModelEncodeUs(governor.state().complexity, base_us, step_us);
+        governor.OnEncode(i == frames / 2 && peak_us > 0 ? peak_us : us);
+    }
+    now_us += kWindowUs;
+    return governor.Update(now_us);
+}
+
+TEST(OpusGovernorTest, ClimbsWhileEncodeTimeLeavesHeadroom) {
+    OpusGovernor governor(kFrameMs, 0, 10);
+    int64_t now_us = 1;
+    governor.Update(now_us);
+    for (int window = 0; window < 60; window++) {
+        RunWindow(governor, now_us, 1500, 500);
+    }
+    // Rises by one every three windows while the average stays under 15%, and stops at 3
+    EXPECT_EQ(governor.state().complexity, 3);
+    EXPECT_EQ(governor.state().avg_encode_us, (uint32_t)ModelEncodeUs(3));
+}
+
+TEST(OpusGovernorTest, BacksOffWhenEncodeGetsSlow) {
+    OpusGovernor governor(kFrameMs, 0, 10);
+    int64_t now_us = 1;
+    governor.Update(now_us);
+    for (int window = 0; window < 40; window++) {
+        RunWindow(governor, now_us, 500, 200);
+    }
+    int settled = governor.state().complexity;
+    ASSERT_GE(settled, 6);
+
+    // Something else steals the CPU: every encode takes 40% of the frame, two steps per window
+    EXPECT_TRUE(RunWindow(governor, now_us, 8000, 0));
+    EXPECT_EQ(governor.state().complexity, settled - 2);
+    EXPECT_TRUE(RunWindow(governor, now_us, 8000, 0));
+    EXPECT_EQ(governor.state().complexity, settled - 4);
+}
+
+TEST(OpusGovernorTest, BacksOffOnPeaks) {
+    OpusGovernor governor(kFrameMs, 0, 10);
+    int64_t now_us = 1;
+    governor.Update(now_us);
+    for (int window = 0; window < 40; window++) {
+        RunWindow(governor, now_us, 500, 200);
+    }
+    int settled = governor.state().complexity;
+    // A single encode over 80% of the frame is pressure even with a low average
+    EXPECT_TRUE(RunWindow(governor, now_us, 500, 200, 17000));
+    EXPECT_EQ(governor.state().complexity, settled - 2);
+}
+
+TEST(OpusGovernorTest, BacksOffWhenTheEncodeQueueFills) {
+    OpusGovernor governor(kFrameMs, 0, 10);
+    int64_t now_us = 1;
+    governor.Update(now_us);
+    for (int window = 0; window < 40; window++) {
+        governor.OnQueueDepth(1, 2);
+        RunWindow(governor, now_us, 500, 200);
+    }
+    int settled = governor.state().complexity;
+    ASSERT_GE(settled, 6);
+
+    // Encode time still looks fine, but the task fell a frame behind
+    governor.OnQueueDepth(2, 2);
+    EXPECT_TRUE(RunWindow(governor, now_us, 500, 200));
+    EXPECT_EQ(governor.state().complexity, settled - 2);
+    EXPECT_EQ(governor.state().max_queue_depth, 2u);
+
+    // Only counts for the window it happened in
+    EXPECT_FALSE(RunWindow(governor, now_us, 500, 200));
+    EXPECT_EQ(governor.state().complexity, settled - 2);
+    EXPECT_EQ(governor.state().max_queue_depth, 0u);
+}
+
+TEST(OpusGovernorTest, WaitsForAFullWindow) {
+    OpusGovernor governor(kFrameMs, 0, 10);
+    governor.Update(1);
+    for (int i = 0; i < 5; i++) {
+        governor.OnEncode(15000);
+    }
+    // Too few frames, even after the window elapsed
+    EXPECT_FALSE(governor.Update(1 + kWindowUs));
+    EXPECT_EQ(governor.state().frames, 0u);
+}
+
+TEST(OpusGovernorTest, ClampsTheRange) {
+    OpusGovernor inverted(kFrameMs, 7, 3);
+    EXPECT_EQ(inverted.state().complexity, 7);
+    int64_t now_us = 1;
+    inverted.Update(now_us);
+    for (int window = 0; window < 10; window++) {
+        RunWindow(inverted, now_us, 100, 0);
+    }
+    EXPECT_EQ(inverted.state().complexity, 7);
+
+    OpusGovernor wide(kFrameMs, -3, 15);
+    EXPECT_EQ(wide.state().complexity, 0);
+    now_us = 1;
+    wide.Update(now_us);
+    for (int window = 0; window < 60; window++) {
+        RunWindow(wide, now_us, 100, 0);
+    }
+    EXPECT_EQ(wide.state().complexity, 10);
+}
+
+TEST(OpusGovernorTest, FrameDurationChangeRestartsTheWindow) {
+    OpusGovernor governor(60, 0, 10);
+    governor.Update(1);
+    for (int i = 0; i < 20; i++) {
+        governor.OnEncode(5000);
+    }
+    // 5 ms is 8% of a 60 ms frame but 50% of a 10 ms one; the old samples must not count
+    governor.SetFrameDuration(10);
+    EXPECT_FALSE(governor.Update(1 + kWindowUs));
+    EXPECT_EQ(governor.state().frames, 0u);
+}
+
+TEST(OpusGovernorTest, DtxFollowsVoiceActivity) {
+    OpusGovernor governor(kFrameMs, 0, 10);
+    EXPECT_FALSE(governor.state().dtx);
+    EXPECT_FALSE(governor.SetVoiceActive(true));
+    EXPECT_TRUE(governor.SetVoiceActive(false));
+    EXPECT_TRUE(governor.state().dtx);
+    EXPECT_FALSE(governor.SetVoiceActive(false));
+    EXPECT_TRUE(governor.SetVoiceActive(true));
+    EXPECT_FALSE(governor.state().dtx);
+}
+
+TEST(OpusGovernorTest, BenchmarkCoversEveryComplexity) {
+    auto results = RunOpusEncodeBenchmark(kFrameMs, 10);
+    ASSERT_EQ(results.size(), 11u);
+    for (int complexity = 0; complexity <= 10; complexity++) {
+        EXPECT_EQ(results[complexity].complexity, complexity);
+        EXPECT_LE(results[complexity].avg_us, results[complexity].max_us);
+    }
+    printf("[ BENCH    ] host pass-through encoder, complexity 0: avg %lu us (not Opus, run "
+        "{\"type\":\"opus_bench\"} on the device with CONFIG_AUDIO_OPUS_BENCH_COMMAND)\n", (unsigned long)results[0].avg_us);
+}
+
+} // namespace
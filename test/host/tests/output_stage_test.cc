@@ -0,0 +1,166 @@
+// OutputStage: unity pass-through, the -1 dBFS ceiling, click-free volume ramps, limiter
+// attack and release, the volume curve, the 32-bit slot output, and the per-sample cost.
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+#include "host_test_util.h"
+#include "output_stage.h"
+
+using namespace host_test;
+
+namespace {
+
+constexpr int kRate = 16000;
+constexpr size_t kFrame = kRate * 60 / 1000;
+
+int32_t Peak(const std::vector<int16_t>& samples) {
+    int32_t peak = 0;
+    for (auto sample : samples) {
+        peak = std::max(peak, std::abs((int32_t)sample));
+    }
+    return peak;
+}
+
+TEST(OutputStageTest, QuietSignalAtFullVolumeIsUntouched) {
+    OutputStage stage;
+    auto input = Sine(kRate, 440, 60, 10000);
+    auto frame = input;
+    stage.Process(frame.data(), frame.size(), 100, kRate);
+    EXPECT_EQ(frame, input);
+    EXPECT_EQ(stage.limiter_gain(), OutputStage::kUnity);
+}
+
+TEST(OutputStageTest, FullScaleNeverExceedsTheCeiling) {
+    OutputStage stage;
+    for (int i = 0; i < 50; i++) {
+        auto frame = Sine(kRate, 1000, 60, 32767);
+        stage.Process(frame.data(), frame.size(), 100, kRate);
+        ASSERT_LE(Peak(frame), OutputStage::kCeiling) << "frame " << i;
+    }
+    EXPECT_LT(stage.limiter_gain(), OutputStage::kUnity);
+}
+
+TEST(OutputStageTest, VolumeChangeRampsAcrossTheFrame) {
+    OutputStage stage;
+    std::vector<int16_t> dc(kFrame, 10000);
+    auto frame = dc;
+    stage.Process(frame.data(), frame.size(), 0, kRate);
+    EXPECT_EQ(Peak(frame), 0);
+
+    frame = dc;
+    stage.Process(frame.data(), frame.size(), 100, kRate);
+    int32_t max_step = 0;
+    for (size_t i = 1; i < frame.size(); i++) {
+        ASSERT_GE(frame[i], frame[i - 1]) << "not monotone at " << i;
+        max_step = std::max(max_step, (int32_t)(frame[i] - frame[i - 1]));
+    }
+    EXPECT_EQ(frame.front(), 0);
+    EXPECT_GE(frame.back(), 9980);
+    // A jump would be 10000 LSB in one sample
+    EXPECT_LE(max_step, 12);
+}
+
+TEST(OutputStageTest, LimiterAttackRampsFromThePreviousFrame) {
+    OutputStage stage;
+    std::vector<int16_t> quiet(kFrame, 10000);
+    stage.Process(quiet.data(), quiet.size(), 100, kRate);
+    ASSERT_EQ(stage.limiter_gain(), OutputStage::kUnity);
+
+    // Quiet first half, full scale second half
+    std::vector<int16_t> frame(kFrame, 10000);
+    std::fill(frame.begin() + kFrame / 2, frame.end(), 32000);
+    stage.Process(frame.data(), frame.size(), 100, kRate);
+    // Continues at the gain the previous frame ended with, no step at the boundary
+    EXPECT_GE(frame.front(), 9995);
+    int32_t max_step = 0;
+    for (size_t i = 1; i < kFrame / 2; i++) {
+        ASSERT_LE(frame[i], frame[i - 1]) << "not monotone at " << i;
+        max_step = std::max(max_step, (int32_t)(frame[i - 1] - frame[i]));
+    }
+    // Spread over the quiet half, a step would be ~870 LSB in one sample
+    EXPECT_LE(max_step, 4);
+    EXPECT_LE(Peak(frame), OutputStage::kCeiling);
+    EXPECT_GE(Peak(frame), OutputStage::kCeiling - 10);
+}
+
+TEST(OutputStageTest, LimiterReleasesWithinTheReleaseTime) {
+    OutputStage stage;
+    auto loud = Sine(kRate, 1000, 60, 32767);
+    stage.Process(loud.data(), loud.size(), 100, kRate);
+    ASSERT_LT(stage.limiter_gain(), OutputStage::kUnity);
+
+    int frames = 0;
+    while (stage.limiter_gain() < OutputStage::kUnity && frames < 100) {
+        auto quiet = Sine(kRate, 440, 60, 1000);
+        stage.Process(quiet.data(), quiet.size(), 100, kRate);
+        frames++;
+    }
+    EXPECT_LE(frames * 60, OutputStage::kReleaseMs + 60);
+}
+
+TEST(OutputStageTest, SlotOutputKeepsTheGainResolution) {
+    // Unity is the plain left-justified conversion
+    OutputStage unity;
+    auto input = Sine(kRate, 440, 60, 10000);
+    std::vector<int32_t> slots(input.size());
+    unity.Process(input.data(), slots.data(), input.size(), 100, kRate);
+    for (size_t i = 0; i < input.size(); i++) {
+        ASSERT_EQ(slots[i], input[i] * 65536) << "sample " << i;
+    }
+
+    // A quiet signal at low volume: the 16-bit result rounds to a few levels, the slot
+    // keeps the exact product
+    OutputStage narrow, wide;
+    auto quiet = Sine(kRate, 440, 60, 300);
+    auto frame = quiet;
+    for (int i = 0; i < 2; i++) {
+        frame = quiet;
+        narrow.Process(frame.data(), frame.size(), 30, kRate);
+        wide.Process(quiet.data(), slots.data(), quiet.size(), 30, kRate);
+    }
+    double gain = OutputStage::VolumeGain(30) / (double)OutputStage::kUnity;
+    double narrow_error = 0, wide_error = 0;
+    for (size_t i = 0; i < quiet.size(); i++) {
+        double expected = quiet[i] * gain;
+        narrow_error = std::max(narrow_error, std::abs(frame[i] - expected));
+        wide_error = std::max(wide_error, std::abs(slots[i] / 65536.0 - expected));
+    }
+    EXPECT_GT(narrow_error, 0.5);
+    EXPECT_LT(wide_error, 0.01);
+}
+
+TEST(OutputStageTest, VolumeGainFollowsTheSquareLaw) {
+    for (int volume = 0; volume <= 100; volume++) {
+        double expected = pow(volume / 100.0, 2) * OutputStage::kUnity;
+        EXPECT_NEAR(OutputStage::VolumeGain(volume), expected, 1.0) << "volume " << volume;
+    }
+    EXPECT_EQ(OutputStage::VolumeGain(-5), 0);
+    EXPECT_EQ(OutputStage::VolumeGain(150), OutputStage::kUnity);
+}
+
+TEST(OutputStageTest, BenchmarkPerSample) {
+    OutputStage stage;
+    auto source = Sine(kRate, 440, 60, 30000);
+    std::vector<int16_t> frame(source.size());
+    constexpr int kFrames = 20000;
+    int64_t sink = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < kFrames; i++) {
+        frame = source;
+        // Alternate volumes, so every frame ramps and is limited
+        stage.Process(frame.data(), frame.size(), i % 2 ? 100 : 80, kRate);
+        sink += frame[i % frame.size()];
+    }
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() /
+        ((double)kFrames * frame.size());
+    printf("[ BENCH    ] ramp + limiter: %.2f ns/sample (includes the frame copy)\n", ns);
+    RecordProperty("ns_per_sample_x100", (int)(ns * 100));
+    EXPECT_NE(sink, INT64_MIN);
+}
+
+} // namespace
@@ -0,0 +1,120 @@
+// A long prompt plays from the asset without the heap growing: the prompt lane decodes one
+// packet at a time through reused buffers. Counts operator new calls made by the
+// "opus_codec" task and tracks the live heap of the whole process while a minute long
+// asset plays.
+
+#include <gtest/gtest.h>
+
+#include <malloc.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+#include <board.h>
+
+#include "audio_service.h"
+#include "file_audio_codec.h"
+#include "host_test_util.h"
+
+using namespace host_test;
+
+namespace {
+
+std::atomic<bool> counting{false};
+std::atomic<uint32_t> codec_task_allocations{0};
+std::atomic<int64_t> live_bytes{0};
+std::atomic<int64_t> peak_live_bytes{0};
+thread_local bool in_operator_new = false;
+
+void CountAllocation(void* p) {
+    int64_t live = live_bytes += malloc_usable_size(p);
+    if (!counting.load(std::memory_order_relaxed) || in_operator_new) {
+        return;
+    }
+    in_operator_new = true;
+    int64_t peak = peak_live_bytes.load(std::memory_order_relaxed);
+    while (live > peak && !peak_live_bytes.compare_exchange_weak(peak, live)) {
+    }
+    if (strcmp(pcTaskGetName(nullptr), "opus_codec") == 0) {
+        codec_task_allocations++;
+    }
+    in_operator_new = false;
+}
+
+} // namespace
+
+void* operator new(size_t size) {
+    void* p = malloc(size != 0 ? size : 1);
+    if (p == nullptr) {
+        throw std::bad_alloc();
+    }
+    CountAllocation(p);
+    return p;
+}
+
+// Not inlined, so the compiler does not pair malloc() in operator new with this free()
+__attribute__((noinline)) void operator delete(void* p) noexcept {
+    if (p != nullptr) {
+        live_bytes -= malloc_usable_size(p);
+    }
+    free(p);
+}
+
+__attribute__((noinline)) void operator delete(void* p, size_t) noexcept {
+    operator delete(p);
+}
+
+namespace {
+
+constexpr int kSampleRate = 16000;
+constexpr int kPromptFrameSamples = kSampleRate * 60 / 1000;
+
+std::string MakePrompt(int duration_ms) {
+    auto pcm = Sine(kSampleRate, 500, duration_ms, 6000);
+    std::vector<std::vector<uint8_t>> packets;
+    for (size_t offset = 0; offset + kPromptFrameSamples <= pcm.size(); offset += kPromptFrameSamples) {
+        auto bytes = reinterpret_cast<const uint8_t*>(pcm.data() + offset);
+        packets.emplace_back(bytes, bytes + kPromptFrameSamples * sizeof(int16_t));
+    }
+    return OggOpus(packets, kSampleRate);
+}
+
+TEST(PromptHeapTest, LongPromptPlaysWithoutGrowingTheHeap) {
+    // Not realtime: the output is written as fast as the pipeline produces it
+    auto input_path = TempPath("prompt_heap_in.wav");
+    WriteWav(input_path, std::vector<int16_t>(kSampleRate), kSampleRate);
+    auto codec = new FileAudioCodec(input_path, TempPath("prompt_heap_out.wav"), kSampleRate, false, true);
+    Board::GetInstance().SetAudioCodec(codec);
+    auto service = new AudioService();
+    service->Initialize(codec);
+    service->Start();
+
+    // Warm up: the prompt decoder is created and the scratch buffers reach their size
+    static const std::string warmup = MakePrompt(1200);
+    static const std::string asset = MakePrompt(60000);
+    uint32_t played = Metric("audio.playback_frames");
+    service->PlaySound(warmup);
+    ASSERT_TRUE(WaitFor([service] { return service->IsIdle(); }, 10000));
+    ASSERT_TRUE(WaitFor([played] { return Metric("audio.playback_frames") >= played + 20; }, 10000));
+
+    played = Metric("audio.playback_frames");
+    int64_t baseline = live_bytes.load();
+    peak_live_bytes = baseline;
+    counting = true;
+    service->PlaySound(asset);
+    ASSERT_TRUE(WaitFor([played] { return Metric("audio.playback_frames") >= played + 1000; }, 60000));
+    counting = false;
+
+    int64_t growth = peak_live_bytes.load() - baseline;
+    printf("[ HEAP     ] %u frames, asset %u bytes: %u allocations in opus_codec, peak live heap +%lld bytes\n",
+        Metric("audio.playback_frames") - played, (unsigned int)asset.size(), codec_task_allocations.load(),
+        (long long)growth);
+    EXPECT_EQ(codec_task_allocations.load(), 0u);
+    // Well below the asset, independent of its length
+    EXPECT_LT(growth, (int64_t)asset.size() / 20);
+}
+
+} // namespace
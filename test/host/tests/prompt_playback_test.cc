@@ -0,0 +1,103 @@
+// PlaySound() through the prompt lane: a caller blocked on a full prompt queue sleeps
+// instead of spinning, and is released by ResetDecoder().
+
+#include <gtest/gtest.h>
+
+#include <board.h>
+#include <pthread.h>
+#include <time.h>
+
+#include <atomic>
+#include <thread>
+
+#include "audio_service.h"
+#include "file_audio_codec.h"
+#include "host_test_util.h"
+
+using namespace host_test;
+
+namespace {
+
+constexpr int kSampleRate = 16000;
+constexpr int kPromptFrameSamples = kSampleRate * 60 / 1000;
+
+// Prompt of the given length in the host codec's packet format (raw PCM per 60 ms frame)
+std::string MakePrompt(int duration_ms, int amplitude) {
+    auto pcm = Sine(kSampleRate, 500, duration_ms, amplitude);
+    std::vector<std::vector<uint8_t>> packets;
+    for (size_t offset = 0; offset + kPromptFrameSamples <= pcm.size(); offset += kPromptFrameSamples) {
+        auto bytes = reinterpret_cast<const uint8_t*>(pcm.data() + offset);
+        packets.emplace_back(bytes, bytes + kPromptFrameSamples * sizeof(int16_t));
+    }
+    return OggOpus(packets, kSampleRate);
+}
+
+double ThreadCpuMs() {
+    timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+class PromptPlaybackTest : public ::testing::Test {
+protected:
+    static void SetUpTestSuite() {
+        input_path_ = TempPath("prompt_in.wav");
+        output_path_ = TempPath("prompt_out.wav");
+        WriteWav(input_path_, std::vector<int16_t>(kSampleRate), kSampleRate);
+
+        // Never deleted: tasks and timers of the service outlive the test cases
+        codec_ = new FileAudioCodec(input_path_, output_path_, kSampleRate, true, true);
+        Board::GetInstance().SetAudioCodec(codec_);
+        service_ = new AudioService();
+        service_->Initialize(codec_);
+        service_->Start();
+    }
+
+    static std::string input_path_;
+    static std::string output_path_;
+    static FileAudioCodec* codec_;
+    static AudioService* service_;
+};
+
+std::string PromptPlaybackTest::input_path_;
+std::string PromptPlaybackTest::output_path_;
+FileAudioCodec* PromptPlaybackTest::codec_ = nullptr;
+AudioService* PromptPlaybackTest::service_ = nullptr;
+
+TEST_F(PromptPlaybackTest, BlockedPlaySoundSleepsAndIsReleasedByResetDecoder) {
+    static const std::string prompt = MakePrompt(1200, 6000);
+
+    // One prompt playing and MAX_PROMPTS_IN_QUEUE waiting, each plays for over a second
+    for (int i = 0; i <= MAX_PROMPTS_IN_QUEUE; i++) {
+        service_->PlaySound(prompt);
+    }
+
+    std::atomic<bool> returned{false};
+    double cpu_ms = 0;
+    std::thread caller([&] {
+        double start = ThreadCpuMs();
+        service_->PlaySound(prompt);
+        cpu_ms = ThreadCpuMs() - start;
+        returned = true;
+    });
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(400));
+    EXPECT_FALSE(returned) << "the prompt queue should still be full";
+
+    auto reset = std::chrono::steady_clock::now();
+    service_->ResetDecoder();
+    EXPECT_TRUE(WaitFor([&] { return returned.load(); }, 1000));
+    auto released = std::chrono::steady_clock::now() - reset;
+    caller.join();
+
+    // Woken by the drain, not by its own polling timeout or a retry loop
+    EXPECT_LT(released, std::chrono::milliseconds(200));
+    EXPECT_LT(cpu_ms, 40.0) << "PlaySound() spun while the queue was full";
+    printf("blocked PlaySound: %.2f ms CPU over ~400 ms, released %lld ms after ResetDecoder\n", cpu_ms,
+        (long long)std::chrono::duration_cast<std::chrono::milliseconds>(released).count());
+
+    service_->ResetDecoder();
+    EXPECT_TRUE(WaitFor([] { return service_->IsIdle(); }, 2000));
+}
+
+} // namespace
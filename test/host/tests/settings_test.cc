@@ -0,0 +1,86 @@
+// Settings write-back cache: a burst of changes becomes one NVS commit, made by the flush
+// task rather than the esp_timer task, and NVS errors on flush and erase are logged
+// instead of aborting. Built with a 100 ms flush delay.
+
+#include <gtest/gtest.h>
+
+#include <nvs.h>
+
+#include "host_test_util.h"
+#include "settings.h"
+
+using namespace host_test;
+
+namespace {
+
+class SettingsTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        Settings::Invalidate();
+        host_nvs_reset();
+    }
+
+    void TearDown() override {
+        host_nvs_fail_writes(ESP_OK);
+    }
+
+    // Reads through a fresh cache, i.e. what is in NVS
+    static int32_t StoredInt(const char* ns, const char* key, int32_t default_value) {
+        Settings::Invalidate();
+        return Settings(ns).GetInt(key, default_value);
+    }
+};
+
+TEST_F(SettingsTest, BurstIsOneCommitOffTheTimerTask) {
+    Settings settings("audio", true);
+    for (int volume = 50; volume <= 70; volume++) {
+        settings.SetInt("volume", volume);
+    }
+    settings.SetBool("muted", true);
+    EXPECT_EQ(settings.GetInt("volume"), 70);
+    EXPECT_EQ(host_nvs_get_stats().commits, 0u);
+
+    ASSERT_TRUE(WaitFor([] { return host_nvs_get_stats().commits > 0; }, 2000));
+    auto stats = host_nvs_get_stats();
+    EXPECT_EQ(stats.commits, 1u);
+    EXPECT_EQ(stats.writes, 2u);
+    EXPECT_STREQ(host_nvs_last_commit_task(), "settings_flush");
+    EXPECT_EQ(StoredInt("audio", "volume", 0), 70);
+}
+
+TEST_F(SettingsTest, FailedWritesAreLoggedAndStayPending) {
+    Settings settings("audio", true);
+    host_nvs_fail_writes(ESP_ERR_NVS_NOT_ENOUGH_SPACE);
+    settings.SetInt("volume", 42);
+    Settings::Flush();
+    // Neither the explicit flush nor the delayed one gets through
+    EXPECT_FALSE(WaitFor([] { return host_nvs_get_stats().commits > 0; }, 300));
+    // Still served from RAM
+    EXPECT_EQ(settings.GetInt("volume"), 42);
+
+    host_nvs_fail_writes(ESP_OK);
+    Settings::Flush();
+    EXPECT_EQ(host_nvs_get_stats().commits, 1u);
+    EXPECT_EQ(StoredInt("audio", "volume", 0), 42);
+}
+
+TEST_F(SettingsTest, FailedEraseIsLogged) {
+    Settings settings("wifi", true);
+    settings.SetString("ssid", "home");
+    settings.SetInt("channel", 6);
+    Settings::Flush();
+    ASSERT_EQ(host_nvs_get_stats().commits, 1u);
+
+    host_nvs_fail_writes(ESP_ERR_NVS_NOT_ENOUGH_SPACE);
+    settings.EraseKey("ssid");
+    settings.EraseAll();
+    EXPECT_EQ(host_nvs_get_stats().commits, 1u);
+
+    host_nvs_fail_writes(ESP_OK);
+    settings.EraseAll();
+    EXPECT_EQ(host_nvs_get_stats().commits, 2u);
+    EXPECT_EQ(settings.GetString("ssid", "none"), "none");
+    EXPECT_EQ(StoredInt("wifi", "channel", -1), -1);
+}
+
+} // namespace
@@ -0,0 +1,372 @@
+// SpscQueue: the three views after Clear(), wakeups, concurrent WaitForSpace() callers,
+// a producer/consumer/clearer stress run, and a throughput comparison with a
+// std::deque + std::mutex + std::condition_variable queue.
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "spsc_queue.h"
+
+namespace {
+
+constexpr uint32_t kConsumerBit = 1 << 0;
+constexpr uint32_t kProducerBit = 1 << 1;
+
+TEST(SpscQueueTest, PushPopInOrder) {
+    SpscQueue<int, 3> queue;
+    EXPECT_TRUE(queue.empty());
+    for (int i = 0; i < 3; i++) {
+        EXPECT_TRUE(queue.Push(int(i)));
+    }
+    EXPECT_TRUE(queue.full());
+    EXPECT_FALSE(queue.Push(3));
+    int value = -1;
+    for (int i = 0; i < 3; i++) {
+        ASSERT_TRUE(queue.Pop(value));
+        EXPECT_EQ(value, i);
+    }
+    EXPECT_FALSE(queue.Pop(value));
+}
+
+TEST(SpscQueueTest, ClearIsConsistentBeforeAndAfterDrain) {
+    SpscQueue<int, 4> queue;
+    for (int i = 0; i < 4; i++) {
+        queue.Push(int(i));
+    }
+    queue.Clear();
+    // Nothing left to pop, but the slots are only freed by the consumer
+    EXPECT_EQ(queue.size(), 0u);
+    EXPECT_TRUE(queue.empty());
+    EXPECT_TRUE(queue.full());
+    EXPECT_FALSE(queue.Push(4));
+
+    int value = -1;
+    EXPECT_FALSE(queue.Pop(value));
+    EXPECT_FALSE(queue.full());
+    EXPECT_TRUE(queue.Push(5));
+    EXPECT_EQ(queue.size(), 1u);
+    ASSERT_TRUE(queue.Pop(value));
+    EXPECT_EQ(value, 5);
+}
+
+TEST(SpscQueueTest, ClearWakesConsumerAndDrainWakesWaiter) {
+    SpscQueue<int, 2> queue;
+    queue.Push(1);
+    queue.Push(2);
+
+    std::atomic<bool> consumer_ready{false};
+    std::atomic<bool> stop{false};
+    std::thread consumer([&] {
+        queue.SetConsumerTask(xTaskGetCurrentTaskHandle(), kConsumerBit);
+        consumer_ready = true;
+        while (!stop) {
+            // Only woken by notifications, never by polling
+            xTaskNotifyWait(0, kConsumerBit, nullptr, portMAX_DELAY);
+            int value;
+            while (queue.Pop(value)) {
+            }
+        }
+        queue.SetConsumerTask(nullptr, 0);
+    });
+    while (!consumer_ready) {
+        std::this_thread::yield();
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    std::thread clearer([&] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        queue.Clear();
+    });
+    // The queue stays full until the consumer drains it, which Clear() triggers
+    EXPECT_TRUE(queue.WaitForSpace(pdMS_TO_TICKS(2000)));
+    auto waited = std::chrono::steady_clock::now() - start;
+    EXPECT_LT(waited, std::chrono::milliseconds(500));
+    clearer.join();
+
+    stop = true;
+    queue.Push(0);
+    consumer.join();
+}
+
+TEST(SpscQueueTest, DropStaleFreesSlotsWithoutPopping) {
+    SpscQueue<int, 2> queue;
+    queue.Push(1);
+    queue.Push(2);
+    queue.Clear();
+    EXPECT_TRUE(queue.full());
+    queue.DropStale();
+    EXPECT_FALSE(queue.full());
+    EXPECT_TRUE(queue.Push(3));
+    int value = 0;
+    ASSERT_TRUE(queue.Pop(value));
+    EXPECT_EQ(value, 3);
+}
+
+// WaitForSpace() may run on any task, its wakeups must not touch the task's own notifications
+TEST(SpscQueueTest, WaitForSpaceLeavesCallerNotificationsAlone) {
+    SpscQueue<int, 1> queue;
+    queue.Push(1);
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+    xTaskNotify(self, kConsumerBit, eSetBits);
+
+    std::thread consumer([&] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        int value;
+        queue.Pop(value);
+    });
+    // A pending notification on index 0 neither ends the wait early nor gets consumed
+    EXPECT_TRUE(queue.WaitForSpace(pdMS_TO_TICKS(2000)));
+    EXPECT_FALSE(queue.full());
+    consumer.join();
+
+    uint32_t bits = 0;
+    EXPECT_EQ(xTaskNotifyWait(0, kConsumerBit, &bits, 0), pdTRUE);
+    EXPECT_EQ(bits, kConsumerBit);
+}
+
+TEST(SpscQueueTest, ConcurrentWaitersAreAllWoken) {
+    SpscQueue<int, 1> queue;
+    std::mutex producer_mutex;
+    queue.Push(-1);
+
+    constexpr int kProducers = 3;
+    constexpr int kItemsPerProducer = 200;
+    std::atomic<int> timeouts{0};
+    std::vector<std::thread> producers;
+    for (int p = 0; p < kProducers; p++) {
+        producers.emplace_back([&, p] {
+            for (int i = 0; i < kItemsPerProducer; i++) {
+                while (true) {
+                    {
+                        std::lock_guard<std::mutex> lock(producer_mutex);
+                        if (queue.Push(p * kItemsPerProducer + i)) {
+                            break;
+                        }
+                    }
+                    // A lost wakeup shows up as a timeout here
+                    if (!queue.WaitForSpace(pdMS_TO_TICKS(1000))) {
+                        timeouts++;
+                    }
+                }
+            }
+        });
+    }
+
+    int received = 0;
+    std::thread consumer([&] {
+        int value;
+        while (received < kProducers * kItemsPerProducer + 1) {
+            if (queue.Pop(value)) {
+                received++;
+            } else {
+                std::this_thread::sleep_for(std::chrono::microseconds(50));
+            }
+        }
+    });
+    for (auto& producer : producers) {
+        producer.join();
+    }
+    consumer.join();
+    EXPECT_EQ(received, kProducers * kItemsPerProducer + 1);
+    EXPECT_EQ(timeouts, 0);
+}
+
+TEST(SpscQueueTest, StressWithConcurrentClear) {
+    constexpr uint32_t kItems = 300000;
+    SpscQueue<uint32_t, 8> queue;
+    std::atomic<bool> consumer_ready{false};
+    std::atomic<bool> producer_done{false};
+    std::atomic<uint32_t> popped{0};
+    std::atomic<uint32_t> order_errors{0};
+
+    std::thread consumer([&] {
+        queue.SetConsumerTask(xTaskGetCurrentTaskHandle(), kConsumerBit);
+        consumer_ready = true;
+        uint32_t last = 0;
+        bool first = true;
+        while (true) {
+            uint32_t value;
+            if (queue.Pop(value)) {
+                if (!first && value <= last) {
+                    order_errors++;
+                }
+                first = false;
+                last = value;
+                popped++;
+                continue;
+            }
+            if (producer_done && queue.empty()) {
+                break;
+            }
+            xTaskNotifyWait(0, kConsumerBit, nullptr, pdMS_TO_TICKS(10));
+        }
+        queue.SetConsumerTask(nullptr, 0);
+    });
+    while (!consumer_ready) {
+        std::this_thread::yield();
+    }
+
+    std::atomic<bool> stop_clearing{false};
+    std::atomic<uint32_t> clears{0};
+    std::thread clearer([&] {
+        std::mt19937 random(42);
+        while (!stop_clearing) {
+            std::this_thread::sleep_for(std::chrono::microseconds(random() % 500));
+            queue.Clear();
+            clears++;
+        }
+    });
+
+    std::thread producer([&] {
+        queue.SetProducerTask(xTaskGetCurrentTaskHandle(), kProducerBit);
+        for (uint32_t i = 0; i < kItems; i++) {
+            uint32_t value = i;
+            while (!queue.Push(std::move(value))) {
+                ASSERT_TRUE(queue.WaitForSpace(pdMS_TO_TICKS(1000)));
+            }
+        }
+        queue.SetProducerTask(nullptr, 0);
+        producer_done = true;
+    });
+    producer.join();
+    stop_clearing = true;
+    clearer.join();
+    consumer.join();
+
+    EXPECT_EQ(order_errors, 0u);
+    EXPECT_GT(clears, 0u);
+    EXPECT_LE(popped, kItems);
+    EXPECT_GT(popped, 0u);
+    EXPECT_TRUE(queue.empty());
+}
+
+// Baseline the SPSC ring replaced
+template <typename T, size_t Capacity>
+class MutexQueue {
+public:
+    void Push(T item) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [this] { return items_.size() < Capacity; });
+        items_.push_back(std::move(item));
+        cv_.notify_all();
+    }
+
+    T Pop() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [this] { return !items_.empty(); });
+        T item = std::move(items_.front());
+        items_.pop_front();
+        cv_.notify_all();
+        return item;
+    }
+
+private:
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<T> items_;
+};
+
+template <typename Function>
+double NanosecondsPerItem(uint32_t items, Function function) {
+    auto start = std::chrono::steady_clock::now();
+    function();
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    return std::chrono::duration<double, std::nano>(elapsed).count() / items;
+}
+
+TEST(SpscQueueTest, BenchmarkAgainstDequeWithMutex) {
+    constexpr uint32_t kItems = 200000;
+    constexpr size_t kCapacity = 16;
+
+    double spsc_ns = NanosecondsPerItem(kItems, [] {
+        SpscQueue<std::unique_ptr<uint32_t>, kCapacity> queue;
+        std::atomic<bool> ready{false};
+        std::thread consumer([&] {
+            queue.SetConsumerTask(xTaskGetCurrentTaskHandle(), kConsumerBit);
+            ready = true;
+            uint32_t received = 0;
+            std::unique_ptr<uint32_t> item;
+            while (received < kItems) {
+                if (queue.Pop(item)) {
+                    received++;
+                } else {
+                    xTaskNotifyWait(0, kConsumerBit, nullptr, portMAX_DELAY);
+                }
+            }
+        });
+        while (!ready) {
+            std::this_thread::yield();
+        }
+        queue.SetProducerTask(xTaskGetCurrentTaskHandle(), kProducerBit);
+        for (uint32_t i = 0; i < kItems; i++) {
+            auto item = std::make_unique<uint32_t>(i);
+            while (!queue.Push(std::move(item))) {
+                queue.WaitForSpace(portMAX_DELAY);
+            }
+        }
+        consumer.join();
+    });
+
+    // The data structures alone, one thread filling and emptying them: no wakeups involved
+    double ring_ns = NanosecondsPerItem(kItems, [] {
+        SpscQueue<std::unique_ptr<uint32_t>, kCapacity> queue;
+        std::unique_ptr<uint32_t> item;
+        for (uint32_t i = 0; i < kItems; i += kCapacity) {
+            for (size_t j = 0; j < kCapacity; j++) {
+                queue.Push(std::make_unique<uint32_t>(i + j));
+            }
+            while (queue.Pop(item)) {
+            }
+        }
+    });
+    double deque_ns = NanosecondsPerItem(kItems, [] {
+        std::mutex mutex;
+        std::deque<std::unique_ptr<uint32_t>> queue;
+        for (uint32_t i = 0; i < kItems; i += kCapacity) {
+            for (size_t j = 0; j < kCapacity; j++) {
+                std::lock_guard<std::mutex> lock(mutex);
+                queue.push_back(std::make_unique<uint32_t>(i + j));
+            }
+            while (true) {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (queue.empty()) {
+                    break;
+                }
+                queue.pop_front();
+            }
+        }
+    });
+
+    double mutex_ns = NanosecondsPerItem(kItems, [] {
+        MutexQueue<std::unique_ptr<uint32_t>, kCapacity> queue;
+        std::thread consumer([&] {
+            for (uint32_t i = 0; i < kItems; i++) {
+                queue.Pop();
+            }
+        });
+        for (uint32_t i = 0; i < kItems; i++) {
+            queue.Push(std::make_unique<uint32_t>(i));
+        }
+        consumer.join();
+    });
+
+    // On the host every task notification is itself a mutex + condition variable (see the
+    // FreeRTOS shim), so the two thread numbers measure the shim as much as the ring
+    printf("[ BENCH    ] %u items, capacity %zu, two threads: SpscQueue %.0f ns/item, deque+mutex+cv %.0f ns/item\n",
+        kItems, kCapacity, spsc_ns, mutex_ns);
+    printf("[ BENCH    ] one thread, no wakeups: SpscQueue %.0f ns/item, deque+mutex %.0f ns/item\n", ring_ns, deque_ns);
+    RecordProperty("spsc_ns_per_item", (int)spsc_ns);
+    RecordProperty("spsc_ring_ns_per_item", (int)ring_ns);
+    RecordProperty("deque_ns_per_item", (int)deque_ns);
+    RecordProperty("mutex_ns_per_item", (int)mutex_ns);
+}
+
+} // namespace
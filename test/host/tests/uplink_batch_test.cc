@@ -0,0 +1,130 @@
+// audio_uploader built with CONFIG_AUDIO_UPLINK_BATCH_FRAMES=3 and a 100 ms batch timeout:
+// message format, the timeout flush, and the preallocated send ring dropping the newest
+// frames instead of blocking the encoder when the link is slow.
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+
+#include "audio_uploader.h"
+#include "host_test_util.h"
+
+using namespace host_test;
+
+namespace {
+
+std::vector<uint8_t> Frame(uint8_t tag, size_t len) {
+    std::vector<uint8_t> frame(len);
+    for (size_t i = 0; i < len; i++) {
+        frame[i] = (uint8_t)(tag + i);
+    }
+    return frame;
+}
+
+// Splits a batched message into its [len_hi][len_lo][payload] frames
+std::vector<std::vector<uint8_t>> Unbatch(const std::vector<uint8_t>& message) {
+    std::vector<std::vector<uint8_t>> frames;
+    size_t offset = 0;
+    while (offset + 2 <= message.size()) {
+        size_t len = (message[offset] << 8) | message[offset + 1];
+        offset += 2;
+        if (offset + len > message.size()) {
+            ADD_FAILURE() << "truncated batch";
+            break;
+        }
+        frames.emplace_back(message.begin() + offset, message.begin() + offset + len);
+        offset += len;
+    }
+    return frames;
+}
+
+size_t SentFrames() {
+    size_t frames = 0;
+    for (auto& message : SentOnChannel(WS_CHANNEL_AUDIO_UP)) {
+        frames += Unbatch(message).size();
+    }
+    return frames;
+}
+
+class UplinkBatchTest : public ::testing::Test {
+protected:
+    static void SetUpTestSuite() {
+        audio_uploader_init();
+        host_ws_set_connected(true);
+    }
+
+    void SetUp() override {
+        host_ws_set_send_delay_us(0);
+        // Let anything left from the previous case go out first
+        WaitFor([] { return false; }, 150);
+        host_ws_clear_sent();
+    }
+};
+
+TEST_F(UplinkBatchTest, BatchesFramesIntoOneMessage) {
+    auto a = Frame(1, 40), b = Frame(2, 41), c = Frame(3, 42);
+    audio_uploader_send_bytes(a.data(), a.size());
+    audio_uploader_send_bytes(b.data(), b.size());
+    audio_uploader_send_bytes(c.data(), c.size());
+    ASSERT_TRUE(WaitFor([] { return SentOnChannel(WS_CHANNEL_AUDIO_UP).size() >= 1; }, 1000));
+
+    auto messages = SentOnChannel(WS_CHANNEL_AUDIO_UP);
+    ASSERT_EQ(messages.size(), 1u);
+    auto frames = Unbatch(messages[0]);
+    ASSERT_EQ(frames.size(), 3u);
+    EXPECT_EQ(frames[0], a);
+    EXPECT_EQ(frames[1], b);
+    EXPECT_EQ(frames[2], c);
+}
+
+TEST_F(UplinkBatchTest, FlushesPartialBatchAfterTimeout) {
+    auto a = Frame(7, 60);
+    auto start = std::chrono::steady_clock::now();
+    audio_uploader_send_bytes(a.data(), a.size());
+    ASSERT_TRUE(WaitFor([] { return SentOnChannel(WS_CHANNEL_AUDIO_UP).size() >= 1; }, 1000));
+    auto waited = std::chrono::steady_clock::now() - start;
+
+    EXPECT_GE(waited, std::chrono::milliseconds(90));
+    EXPECT_LT(waited, std::chrono::milliseconds(400));
+    auto frames = Unbatch(SentOnChannel(WS_CHANNEL_AUDIO_UP)[0]);
+    ASSERT_EQ(frames.size(), 1u);
+    EXPECT_EQ(frames[0], a);
+}
+
+TEST_F(UplinkBatchTest, FullRingDropsNewestWithoutBlocking) {
+    constexpr int kFrames = 200;
+    uint32_t ring_full = Metric("uplink.ring_full_frames");
+    host_ws_set_send_delay_us(50000);
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < kFrames; i++) {
+        auto frame = Frame(i, 1000);
+        audio_uploader_send_bytes(frame.data(), frame.size());
+    }
+    auto enqueue_time = std::chrono::steady_clock::now() - start;
+    uint32_t dropped = Metric("uplink.ring_full_frames") - ring_full;
+
+    // The producer never waits for the link
+    EXPECT_LT(enqueue_time, std::chrono::milliseconds(50));
+    EXPECT_GT(dropped, 0u);
+
+    host_ws_set_send_delay_us(0);
+    ASSERT_TRUE(WaitFor([dropped] { return SentFrames() + dropped == kFrames; }, 5000))
+        << SentFrames() << " sent, " << dropped << " dropped";
+    printf("[ RING     ] %d frames of 1000 B into a stalled link: %u queued, %u dropped, enqueue %lld us\n",
+        kFrames, kFrames - dropped, dropped,
+        (long long)std::chrono::duration_cast<std::chrono::microseconds>(enqueue_time).count());
+}
+
+TEST_F(UplinkBatchTest, DisconnectedUplinkSendsNothing) {
+    host_ws_set_connected(false);
+    auto a = Frame(9, 50);
+    for (int i = 0; i < 6; i++) {
+        audio_uploader_send_bytes(a.data(), a.size());
+    }
+    WaitFor([] { return false; }, 200);
+    EXPECT_EQ(SentOnChannel(WS_CHANNEL_AUDIO_UP).size(), 0u);
+    host_ws_set_connected(true);
+}
+
+} // namespace
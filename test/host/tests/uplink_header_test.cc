@@ -0,0 +1,130 @@
+// Uplink frame header: negotiated per connection through uplink_hello, big endian fields,
+// sequence numbers that also count frames dropped while disconnected.
+
+#include <gtest/gtest.h>
+
+#include <arpa/inet.h>
+
+#include "audio_uploader.h"
+#include "host_test_util.h"
+
+using namespace host_test;
+
+namespace {
+
+int requested_frame_duration = 0;
+
+void ServerHello(const std::string& json) {
+    host_ws_receive(WS_TRANSPORT_OPCODES_TEXT, json.data(), json.size());
+}
+
+std::vector<std::vector<uint8_t>> WaitForFrames(size_t count) {
+    WaitFor([count] { return SentOnChannel(WS_CHANNEL_AUDIO_UP).size() >= count; }, 1000);
+    return SentOnChannel(WS_CHANNEL_AUDIO_UP);
+}
+
+const audio_uplink_header_t* Header(const std::vector<uint8_t>& message) {
+    return reinterpret_cast<const audio_uplink_header_t*>(message.data());
+}
+
+class UplinkHeaderTest : public ::testing::Test {
+protected:
+    static void SetUpTestSuite() {
+        audio_uploader_set_frame_duration_cb([](int duration) { requested_frame_duration = duration; });
+        audio_uploader_init();
+    }
+
+    void SetUp() override {
+        host_ws_set_connected(false);
+        host_ws_clear_sent();
+        host_ws_set_connected(true);
+    }
+
+    const uint8_t payload_[5] = {1, 2, 3, 4, 5};
+};
+
+TEST_F(UplinkHeaderTest, HelloAdvertisesHeaderAndDurations) {
+    auto messages = SentMessages();
+    ASSERT_GE(messages.size(), 1u);
+    EXPECT_EQ(messages[0].op_code, WS_TRANSPORT_OPCODES_TEXT);
+    std::string hello(messages[0].data.begin(), messages[0].data.end());
+    EXPECT_NE(hello.find("\"type\":\"uplink_hello\""), std::string::npos);
+    EXPECT_NE(hello.find("\"uplink_header\":1"), std::string::npos);
+    EXPECT_NE(hello.find("\"frame_durations\":[10,20,40,60]"), std::string::npos);
+}
+
+TEST_F(UplinkHeaderTest, BareFramesUntilServerAgrees) {
+    audio_uploader_send_frame(payload_, sizeof(payload_), 1000, 60, true);
+    auto frames = WaitForFrames(1);
+    ASSERT_EQ(frames.size(), 1u);
+    EXPECT_EQ(frames[0], std::vector<uint8_t>(payload_, payload_ + sizeof(payload_)));
+
+    // Another header version is a refusal
+    ServerHello("{\"type\":\"uplink_hello\",\"uplink_header\":2}");
+    audio_uploader_send_frame(payload_, sizeof(payload_), 1060, 60, true);
+    frames = WaitForFrames(2);
+    ASSERT_EQ(frames.size(), 2u);
+    EXPECT_EQ(frames[1].size(), sizeof(payload_));
+}
+
+TEST_F(UplinkHeaderTest, HeaderFieldsAreBigEndian) {
+    ServerHello("{\"type\":\"uplink_hello\",\"uplink_header\":1}");
+    audio_uploader_send_frame(payload_, sizeof(payload_), 0x01020304, 20, true);
+    audio_uploader_send_frame(payload_, 3, 0x01020318, 20, false);
+    auto frames = WaitForFrames(2);
+    ASSERT_EQ(frames.size(), 2u);
+
+    ASSERT_EQ(frames[0].size(), sizeof(audio_uplink_header_t) + sizeof(payload_));
+    auto header = Header(frames[0]);
+    EXPECT_EQ(header->version, AUDIO_UPLINK_HEADER_VERSION);
+    EXPECT_EQ(header->flags, AUDIO_UPLINK_FLAG_VOICE);
+    EXPECT_EQ(ntohl(header->timestamp), 0x01020304u);
+    EXPECT_EQ(ntohs(header->frame_duration), 20);
+    EXPECT_EQ(ntohs(header->payload_size), sizeof(payload_));
+    EXPECT_EQ(memcmp(header->payload, payload_, sizeof(payload_)), 0);
+    // Raw bytes, independent of the host's byte order
+    EXPECT_EQ(frames[0][4], 0x01);
+    EXPECT_EQ(frames[0][7], 0x04);
+
+    auto second = Header(frames[1]);
+    EXPECT_EQ(second->flags, 0);
+    EXPECT_EQ(ntohs(second->payload_size), 3);
+    EXPECT_EQ((uint16_t)(ntohs(second->sequence) - ntohs(header->sequence)), 1);
+}
+
+TEST_F(UplinkHeaderTest, DroppedFramesConsumeSequenceNumbers) {
+    ServerHello("{\"type\":\"uplink_hello\",\"uplink_header\":1}");
+    audio_uploader_send_frame(payload_, sizeof(payload_), 0, 60, true);
+    auto frames = WaitForFrames(1);
+    ASSERT_EQ(frames.size(), 1u);
+    uint16_t first = ntohs(Header(frames[0])->sequence);
+
+    // Three frames encoded while the link is down
+    host_ws_set_connected(false);
+    for (int i = 0; i < 3; i++) {
+        audio_uploader_send_frame(payload_, sizeof(payload_), 60 * (i + 1), 60, true);
+    }
+    host_ws_clear_sent();
+
+    // Every connection negotiates again
+    host_ws_set_connected(true);
+    audio_uploader_send_frame(payload_, sizeof(payload_), 240, 60, true);
+    frames = WaitForFrames(1);
+    ASSERT_EQ(frames.size(), 1u);
+    EXPECT_EQ(frames[0].size(), sizeof(payload_));
+
+    ServerHello("{\"type\":\"uplink_hello\",\"uplink_header\":1}");
+    audio_uploader_send_frame(payload_, sizeof(payload_), 300, 60, true);
+    frames = WaitForFrames(2);
+    ASSERT_EQ(frames.size(), 2u);
+    EXPECT_EQ((uint16_t)(ntohs(Header(frames[1])->sequence) - first), 5);
+}
+
+TEST_F(UplinkHeaderTest, ServerPicksFrameDuration) {
+    requested_frame_duration = 0;
+    audio_uploader_set_frame_duration(60);
+    ServerHello("{\"type\":\"uplink_hello\",\"uplink_header\":1,\"frame_duration\":20}");
+    EXPECT_EQ(requested_frame_duration, 20);
+}
+
+} // namespace
@@ -0,0 +1,124 @@
+// VideoRateController against a simulated camera and link, in virtual time.
+//
+// Frame size model: bytes = pixels * 2.4 / jpeg_quality (about 74 KB for VGA at quality
+// 10, 18 KB at 40), close to what the OV2640 produces for an indoor scene. The link sends
+// at link_kbps; the camera delivers target_fps frames unless the previous send is still
+// running, like the pipelined capture/send in video_stream.
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+
+#include "video_rate_controller.h"
+
+namespace {
+
+constexpr int kTargetFps = 10;
+
+struct Simulation {
+    VideoRateController controller;
+    int64_t now_us = 0;
+    int64_t link_busy_until_us = 0;
+    int changes = 0;
+    int64_t last_change_us = 0;
+
+    Simulation(int target_kbps, int width, int height, int quality)
+        : controller(target_kbps, kTargetFps, width, height, quality) {}
+
+    size_t FrameBytes() const {
+        auto& state = controller.state();
+        return (size_t)state.width * state.height * 24 / 10 / state.jpeg_quality;
+    }
+
+    // Runs for seconds with a link of link_kbps
+    void Run(double seconds, uint32_t link_kbps, bool failing = false) {
+        int64_t end_us = now_us + (int64_t)(seconds * 1e6);
+        int64_t interval_us = 1000000 / kTargetFps;
+        for (; now_us < end_us; now_us += interval_us) {
+            if (now_us >= link_busy_until_us) {
+                size_t bytes = FrameBytes();
+                int64_t send_us = (int64_t)bytes * 8000 / link_kbps;
+                controller.OnFrameSent(bytes, send_us, !failing);
+                link_busy_until_us = now_us + send_us;
+            }
+            if (controller.Update(now_us)) {
+                changes++;
+                last_change_us = now_us;
+            }
+        }
+    }
+
+    void Print(const char* label) const {
+        auto& state = controller.state();
+        printf("[ VRC      ] %-28s %dx%d q=%d, %u fps, %u kbps sent, link %u kbps, frame %u B / budget %u B\n",
+            label, state.width, state.height, state.jpeg_quality, state.fps, state.kbps, state.link_kbps,
+            state.avg_frame_bytes, state.budget_frame_bytes);
+    }
+};
+
+TEST(VideoRateControllerTest, SettlesWithinTheLinkBudget) {
+    Simulation sim(2000, 640, 480, 12);
+    sim.Run(90, 1000);
+    sim.Print("1 Mbps link, 2 Mbps target:");
+
+    auto& state = sim.controller.state();
+    // Frames fit the budget (80% of the link) within the hysteresis band
+    EXPECT_LE(state.avg_frame_bytes * 100, state.budget_frame_bytes * 115);
+    EXPECT_GE(state.avg_frame_bytes * 100, state.budget_frame_bytes * 70);
+    EXPECT_LE(state.kbps, 1000u);
+    EXPECT_GE(state.fps, (uint32_t)kTargetFps - 1);
+
+    // Settled: no more changes in the last 30 s
+    int changes = sim.changes;
+    sim.Run(30, 1000);
+    EXPECT_EQ(sim.changes, changes);
+}
+
+TEST(VideoRateControllerTest, StepsDownResolutionOnlyAfterQuality) {
+    Simulation sim(4000, 640, 480, 10);
+    sim.Run(4, 250);
+    // The first reactions only touch the quality
+    EXPECT_EQ(sim.controller.state().width, 640);
+    EXPECT_GT(sim.controller.state().jpeg_quality, 10);
+
+    sim.Run(120, 250);
+    sim.Print("250 kbps link:");
+    EXPECT_LT(sim.controller.state().width, 640);
+    EXPECT_LE(sim.controller.state().kbps, 250u);
+}
+
+TEST(VideoRateControllerTest, RecoversWhenTheLinkImproves) {
+    Simulation sim(3000, 640, 480, 10);
+    sim.Run(120, 200);
+    sim.Print("200 kbps link:");
+    int low_level = sim.controller.state().level;
+
+    sim.Run(180, 8000);
+    sim.Print("then 8 Mbps link:");
+    EXPECT_GT(sim.controller.state().level, low_level);
+    EXPECT_GT(sim.controller.state().kbps, 1000u);
+
+}
+
+TEST(VideoRateControllerTest, NeverExceedsTheInitialResolution) {
+    // Headroom everywhere, SVGA would fit but the sensor buffers are sized for VGA
+    Simulation sim(20000, 640, 480, 20);
+    sim.Run(120, 50000);
+    sim.Print("50 Mbps link, 20 Mbps target:");
+    EXPECT_EQ(sim.controller.state().width, 640);
+    EXPECT_EQ(sim.controller.state().height, 480);
+    EXPECT_EQ(sim.controller.state().jpeg_quality, 10);
+}
+
+TEST(VideoRateControllerTest, FailedSendsStillMeasureTheLink) {
+    Simulation sim(2000, 640, 480, 10);
+    sim.Run(3, 1000);
+    uint32_t link = sim.controller.state().link_kbps;
+    EXPECT_GT(link, 0u);
+    // Failed sends add time but no bytes: no new throughput sample, nothing sent
+    sim.Run(2, 100, true);
+    EXPECT_EQ(sim.controller.state().kbps, 0u);
+    EXPECT_EQ(sim.controller.state().fps, 0u);
+}
+
+} // namespace
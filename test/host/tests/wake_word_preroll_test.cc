@@ -0,0 +1,100 @@
+// WakeWordPreroll as the detection task drives it: 30 ms chunks stored in real time, then
+// Encode() on detection and GetOpus() until the end. The packets hold the last ~2 s of
+// audio without a gap, ending at the detection. Reports the time from detection to the
+// first and to the last packet, with the Opus shim sleeping a modelled encode time.
+//
+// Built twice: wake_word_preroll_test encodes in one burst after detection (the default),
+// wake_word_preroll_test_incremental with CONFIG_WAKE_WORD_PREROLL_INCREMENTAL.
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <thread>
+
+#include <opus_encoder.h>
+
+#include "audio_service.h"
+#include "host_test_util.h"
+#include "wake_words/wake_word_preroll.h"
+
+using namespace host_test;
+
+namespace {
+
+constexpr size_t kChunk = 512;                  // AFE fetch size at 16 kHz
+constexpr size_t kFrame = 16000 * OPUS_FRAME_DURATION_MS / 1000;
+// Assumed device encode time of one frame at complexity 0, not measured
+constexpr uint32_t kEncodeUs = 8000;
+// Sample values count up and wrap, so the packets can be checked for gaps
+constexpr int kPeriod = 30000;
+
+#if CONFIG_WAKE_WORD_PREROLL_INCREMENTAL
+const char* kMode = "incremental";
+#else
+const char* kMode = "burst";
+#endif
+
+double ElapsedMs(std::chrono::steady_clock::time_point since) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - since).count();
+}
+
+TEST(WakeWordPrerollTest, FirstPacketAfterDetection) {
+    host_opus_set_encode_us(kEncodeUs);
+    // Not deleted: on the host vTaskDelete does not stop the encode task
+    auto preroll = new WakeWordPreroll();
+
+    // 2.5 s of listening, paced like the AFE fetch
+    constexpr size_t kStored = 16000 * 2500 / 1000 / kChunk * kChunk;
+    std::vector<int16_t> chunk(kChunk);
+    auto start = std::chrono::steady_clock::now();
+    for (size_t stored = 0; stored < kStored; stored += kChunk) {
+        for (size_t i = 0; i < kChunk; i++) {
+            chunk[i] = (int16_t)((stored + i) % kPeriod);
+        }
+        preroll->Store(chunk.data(), chunk.size());
+        std::this_thread::sleep_until(start + std::chrono::microseconds((stored + kChunk) * 1000000 / 16000));
+    }
+
+    auto detected = std::chrono::steady_clock::now();
+    preroll->Encode();
+    std::vector<uint8_t> opus;
+    ASSERT_TRUE(preroll->GetOpus(opus));
+    double first_ms = ElapsedMs(detected);
+
+    std::vector<int16_t> samples;
+    do {
+        // The shim's packet is the frame's PCM
+        ASSERT_EQ(opus.size(), kFrame * sizeof(int16_t));
+        auto pcm = reinterpret_cast<const int16_t*>(opus.data());
+        samples.insert(samples.end(), pcm, pcm + kFrame);
+    } while (preroll->GetOpus(opus));
+    double last_ms = ElapsedMs(detected);
+    size_t packets = samples.size() / kFrame;
+
+    printf("[ LATENCY  ] %s: first packet %.1f ms, all %zu packets %.1f ms after detection "
+        "(encode modelled at %u us per %d ms frame)\n",
+        kMode, first_ms, packets, last_ms, kEncodeUs, OPUS_FRAME_DURATION_MS);
+    RecordProperty("first_packet_us", (int)(first_ms * 1000));
+    RecordProperty("last_packet_us", (int)(last_ms * 1000));
+
+    // About 2 s, continuous, ending with the last complete frame before the detection
+    EXPECT_GE(samples.size(), 16000u * 1900 / 1000);
+    for (size_t i = 1; i < samples.size(); i++) {
+        ASSERT_EQ(samples[i], (samples[i - 1] + 1) % kPeriod) << "gap at sample " << i;
+    }
+    int last_stored = (kStored - 1) % kPeriod;
+    EXPECT_LT((last_stored - samples.back() + kPeriod) % kPeriod, (int)kFrame);
+
+#if CONFIG_WAKE_WORD_PREROLL_INCREMENTAL
+    // Already encoded while listening: nothing to wait for but the lock
+    EXPECT_LT(first_ms, kEncodeUs / 1000.0);
+    EXPECT_LT(last_ms, 4 * kEncodeUs / 1000.0);
+#else
+    // The burst encodes the first frame before anything ships, and every frame before the last
+    EXPECT_GE(first_ms, kEncodeUs / 1000.0);
+    EXPECT_GE(last_ms, packets * kEncodeUs / 1000.0);
+#endif
+    host_opus_set_encode_us(0);
+}
+
+} // namespace
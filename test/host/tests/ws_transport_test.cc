@@ -0,0 +1,210 @@
+// ws_transport: the channel mux is negotiated in uplink_hello and every connection starts in
+// the plain format (binary = audio), received messages are reassembled from client events and
+// WebSocket fragments, and audio waits for at most one video chunk on a shared connection.
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+
+#include "audio_uploader.h"
+#include "host_test_util.h"
+
+using namespace host_test;
+
+namespace {
+
+std::mutex received_mutex;
+std::vector<std::vector<uint8_t>> received_audio;
+std::vector<std::string> received_text;
+
+void ServerSend(int op_code, const std::string& data) {
+    host_ws_receive(op_code, data.data(), data.size());
+}
+
+std::string MuxMessage(ws_channel_t channel, const std::string& payload) {
+    std::string message(WS_MUX_HEADER_SIZE, '\0');
+    message[0] = (char)channel;
+    message[1] = (char)(WS_MUX_FLAG_FIRST | WS_MUX_FLAG_LAST);
+    return message + payload;
+}
+
+std::string Pattern(size_t len) {
+    std::string data(len, '\0');
+    for (size_t i = 0; i < len; i++) {
+        data[i] = (char)(i * 7 + 3);
+    }
+    return data;
+}
+
+class WsTransportTest : public ::testing::Test {
+protected:
+    static void SetUpTestSuite() {
+        audio_uploader_set_binary_cb([](const uint8_t* data, size_t len) {
+            std::lock_guard<std::mutex> lock(received_mutex);
+            received_audio.emplace_back(data, data + len);
+        });
+        audio_uploader_set_text_cb([](const char* data, size_t len) {
+            std::lock_guard<std::mutex> lock(received_mutex);
+            received_text.emplace_back(data, len);
+        });
+        audio_uploader_init();
+    }
+
+    void SetUp() override {
+        host_ws_set_send_delay_us(0);
+        host_ws_set_connected(false);
+        host_ws_clear_sent();
+        host_ws_set_connected(true);
+        std::lock_guard<std::mutex> lock(received_mutex);
+        received_audio.clear();
+        received_text.clear();
+    }
+
+    void AcceptMux() {
+        ServerSend(WS_TRANSPORT_OPCODES_TEXT, "{\"type\":\"uplink_hello\",\"mux\":1}");
+        ASSERT_TRUE(ws_transport_mux_enabled());
+    }
+};
+
+TEST_F(WsTransportTest, HelloAdvertisesMux) {
+    auto messages = SentMessages();
+    ASSERT_GE(messages.size(), 1u);
+    std::string hello(messages[0].data.begin(), messages[0].data.end());
+    EXPECT_EQ(messages[0].op_code, WS_TRANSPORT_OPCODES_TEXT);
+    EXPECT_NE(hello.find("\"mux\":1"), std::string::npos);
+    EXPECT_FALSE(ws_transport_mux_enabled());
+}
+
+TEST_F(WsTransportTest, PlainFramesUntilServerAcceptsMux) {
+    const uint8_t audio[] = {9, 8, 7};
+    EXPECT_EQ(ws_transport_send(WS_CHANNEL_AUDIO_UP, audio, sizeof(audio), portMAX_DELAY), (int)sizeof(audio));
+    EXPECT_LT(ws_transport_send(WS_CHANNEL_VIDEO, audio, sizeof(audio), portMAX_DELAY), 0);
+    EXPECT_LT(ws_transport_send_chunked(WS_CHANNEL_METRICS, audio, sizeof(audio), portMAX_DELAY), 0);
+
+    auto messages = SentMessages();
+    ASSERT_EQ(messages.size(), 2u);
+    EXPECT_EQ(messages[1].op_code, WS_TRANSPORT_OPCODES_BINARY);
+    EXPECT_EQ(messages[1].data, std::vector<uint8_t>(audio, audio + sizeof(audio)));
+
+    // A binary message from the server is downlink audio as a whole, first byte included
+    ServerSend(WS_TRANSPORT_OPCODES_BINARY, "\x02\x03opus");
+    ASSERT_EQ(received_audio.size(), 1u);
+    EXPECT_EQ(std::string(received_audio[0].begin(), received_audio[0].end()), "\x02\x03opus");
+}
+
+TEST_F(WsTransportTest, ServerReplyWithoutMuxKeepsPlainFrames) {
+    ServerSend(WS_TRANSPORT_OPCODES_TEXT, "{\"type\":\"uplink_hello\",\"uplink_header\":1}");
+    EXPECT_FALSE(ws_transport_mux_enabled());
+    ServerSend(WS_TRANSPORT_OPCODES_TEXT, "{\"type\":\"uplink_hello\",\"mux\":2}");
+    EXPECT_FALSE(ws_transport_mux_enabled());
+}
+
+TEST_F(WsTransportTest, MuxUntilReconnect) {
+    AcceptMux();
+    const uint8_t audio[] = {9, 8, 7};
+    ws_transport_send(WS_CHANNEL_AUDIO_UP, audio, sizeof(audio), portMAX_DELAY);
+    auto sent = SentOnChannel(WS_CHANNEL_AUDIO_UP);
+    ASSERT_EQ(sent.size(), 1u);
+    EXPECT_EQ(sent[0], std::vector<uint8_t>(audio, audio + sizeof(audio)));
+
+    ServerSend(WS_TRANSPORT_OPCODES_BINARY, MuxMessage(WS_CHANNEL_AUDIO_DOWN, "opus"));
+    ServerSend(WS_TRANSPORT_OPCODES_BINARY, MuxMessage(WS_CHANNEL_VIDEO, "ignored"));
+    ASSERT_EQ(received_audio.size(), 1u);
+    EXPECT_EQ(std::string(received_audio[0].begin(), received_audio[0].end()), "opus");
+
+    host_ws_set_connected(false);
+    EXPECT_FALSE(ws_transport_mux_enabled());
+    host_ws_set_connected(true);
+    EXPECT_FALSE(ws_transport_mux_enabled());
+}
+
+TEST_F(WsTransportTest, BufferHoldsHeaderAndChunk) {
+    EXPECT_GE(host_ws_buffer_size(), WS_MUX_HEADER_SIZE + WS_TRANSPORT_CHUNK_SIZE);
+
+    // A full chunk arrives in one event and is passed through
+    AcceptMux();
+    std::string payload = Pattern(WS_TRANSPORT_CHUNK_SIZE);
+    ServerSend(WS_TRANSPORT_OPCODES_BINARY, MuxMessage(WS_CHANNEL_AUDIO_DOWN, payload));
+    ASSERT_EQ(received_audio.size(), 1u);
+    EXPECT_EQ(std::string(received_audio[0].begin(), received_audio[0].end()), payload);
+}
+
+TEST_F(WsTransportTest, ReassemblesFragments) {
+    AcceptMux();
+    std::string payload = Pattern(WS_TRANSPORT_CHUNK_SIZE);
+    std::string message = MuxMessage(WS_CHANNEL_AUDIO_DOWN, payload);
+    host_ws_receive_fragmented(WS_TRANSPORT_OPCODES_BINARY, message.data(), message.size(), 1000);
+    ASSERT_EQ(received_audio.size(), 1u);
+    EXPECT_EQ(std::string(received_audio[0].begin(), received_audio[0].end()), payload);
+
+    std::string text = "{\"type\":\"tts\",\"text\":\"" + std::string(3000, 'x') + "\"}";
+    host_ws_receive_fragmented(WS_TRANSPORT_OPCODES_TEXT, text.data(), text.size(), 700);
+    ASSERT_EQ(received_text.size(), 1u);
+    EXPECT_EQ(received_text[0], text);
+}
+
+TEST_F(WsTransportTest, DropsOversizedMessages) {
+    // Larger than the buffer: split into events by payload_offset, too big to reassemble
+    std::string big = Pattern(2 * WS_TRANSPORT_CHUNK_SIZE);
+    ServerSend(WS_TRANSPORT_OPCODES_BINARY, big);
+    host_ws_receive_fragmented(WS_TRANSPORT_OPCODES_BINARY, big.data(), big.size(), 3000);
+    EXPECT_TRUE(received_audio.empty());
+
+    ServerSend(WS_TRANSPORT_OPCODES_BINARY, "next");
+    ASSERT_EQ(received_audio.size(), 1u);
+    EXPECT_EQ(std::string(received_audio[0].begin(), received_audio[0].end()), "next");
+}
+
+// Audio queueing behind a stream of 40 KB camera frames on the shared connection. Each send
+// blocks for 2 ms (a 4 KB chunk at 16 Mbps). Unchunked, a frame would hold the connection for
+// ten sends.
+TEST_F(WsTransportTest, AudioWaitsForAtMostOneVideoChunk) {
+    AcceptMux();
+    const int kSendDelayUs = 2000;
+    host_ws_set_send_delay_us(kSendDelayUs);
+
+    std::atomic<bool> stop{false};
+    std::atomic<int> video_frames{0};
+    std::thread video([&] {
+        std::vector<uint8_t> frame(10 * WS_TRANSPORT_CHUNK_SIZE, 0x55);
+        while (!stop) {
+            if (ws_transport_send_chunked(WS_CHANNEL_VIDEO, frame.data(), frame.size(), pdMS_TO_TICKS(2000)) > 0) {
+                video_frames++;
+            }
+        }
+    });
+
+    std::vector<int64_t> waits_us;
+    const uint8_t audio[40] = {};
+    for (int i = 0; i < 50; i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        auto start = std::chrono::steady_clock::now();
+        ASSERT_GT(ws_transport_send(WS_CHANNEL_AUDIO_UP, audio, sizeof(audio), pdMS_TO_TICKS(1000)), 0);
+        auto us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+        // The audio message's own send is not queueing
+        waits_us.push_back(us.count() - kSendDelayUs);
+    }
+    stop = true;
+    video.join();
+
+    std::sort(waits_us.begin(), waits_us.end());
+    int64_t p50 = waits_us[waits_us.size() / 2];
+    int64_t p90 = waits_us[waits_us.size() * 9 / 10];
+    int64_t max = waits_us.back();
+    printf("[ LATENCY  ] audio queueing behind video: p50 %.1f ms, p90 %.1f ms, max %.1f ms (one chunk %.1f ms, "
+        "whole frame %.1f ms), %d video frames\n", p50 / 1000.0, p90 / 1000.0, max / 1000.0, kSendDelayUs / 1000.0,
+        10 * kSendDelayUs / 1000.0, video_frames.load());
+    RecordProperty("audio_wait_p50_us", (int)p50);
+    RecordProperty("audio_wait_max_us", (int)max);
+    EXPECT_GT(video_frames.load(), 0);
+    // One chunk in flight plus scheduling slack. A single outlier can be the host scheduler
+    // (one core shared with the video thread), the worst case only has to stay under a frame.
+    EXPECT_LT(p90, 2 * kSendDelayUs + 1000);
+    EXPECT_LT(max, 10 * kSendDelayUs / 2);
+}
+
+} // namespace